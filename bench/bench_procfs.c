@@ -0,0 +1,204 @@
+/*
+ * Procfs parser micro-benchmark
+ *
+ * Compares the table-driven parsers in procfs_parser.c against the
+ * stdio/sscanf code the collectors used before (reproduced below),
+ * using captured /proc/[pid] files from bench/fixtures.
+ *
+ * Usage: bench_procfs [fixture_dir] [iterations]
+ */
+#include "../include/procfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_ITERATIONS 200000
+
+static volatile uint64_t sink;
+
+/* Legacy parsers: same calls as the original collectors, over an in-memory FILE */
+
+static void legacy_parse_stat(const char *buffer, size_t len) {
+    FILE *fp = fmemopen((void *)buffer, len, "r");
+    if (!fp) return;
+
+    uint64_t utime = 0, stime = 0, cutime = 0, cstime = 0;
+    long num_threads = 0;
+    int items = fscanf(fp, "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+                          "%lu %lu %lu %lu %*d %*d %ld",
+                          &utime, &stime, &cutime, &cstime, &num_threads);
+    rewind(fp);
+
+    unsigned long minflt = 0, majflt = 0;
+    items += fscanf(fp, "%*d %*s %*c %*d %*d %*d %*d %*d %*u "
+                       "%lu %*u %lu", &minflt, &majflt);
+    fclose(fp);
+
+    sink += utime + stime + num_threads + minflt + majflt + (uint64_t)items;
+}
+
+static void legacy_parse_status(const char *buffer, size_t len) {
+    FILE *fp = fmemopen((void *)buffer, len, "r");
+    if (!fp) return;
+
+    uint64_t rss = 0, vsz = 0, shared = 0, data = 0, stack = 0, text = 0, swap = 0;
+    uint64_t vol = 0, nonvol = 0;
+    char line[256];
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "VmRSS:", 6) == 0) {
+            sscanf(line + 6, "%lu", &rss);
+        } else if (strncmp(line, "VmSize:", 7) == 0) {
+            sscanf(line + 7, "%lu", &vsz);
+        } else if (strncmp(line, "RssShmem:", 9) == 0) {
+            sscanf(line + 9, "%lu", &shared);
+        } else if (strncmp(line, "VmData:", 7) == 0) {
+            sscanf(line + 7, "%lu", &data);
+        } else if (strncmp(line, "VmStk:", 6) == 0) {
+            sscanf(line + 6, "%lu", &stack);
+        } else if (strncmp(line, "VmExe:", 6) == 0) {
+            sscanf(line + 6, "%lu", &text);
+        } else if (strncmp(line, "VmSwap:", 7) == 0) {
+            sscanf(line + 7, "%lu", &swap);
+        }
+    }
+    rewind(fp);
+
+    /* The CPU collector scanned the file a second time for context switches */
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "voluntary_ctxt_switches: %lu", &vol) == 1) {
+            continue;
+        }
+        if (sscanf(line, "nonvoluntary_ctxt_switches: %lu", &nonvol) == 1) {
+            continue;
+        }
+    }
+    fclose(fp);
+
+    sink += rss + vsz + shared + data + stack + text + swap + vol + nonvol;
+}
+
+static void legacy_parse_io(const char *buffer, size_t len) {
+    FILE *fp = fmemopen((void *)buffer, len, "r");
+    if (!fp) return;
+
+    uint64_t v[7] = {0};
+    char line[256];
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "rchar:", 6) == 0) {
+            sscanf(line + 6, "%lu", &v[0]);
+        } else if (strncmp(line, "wchar:", 6) == 0) {
+            sscanf(line + 6, "%lu", &v[1]);
+        } else if (strncmp(line, "syscr:", 6) == 0) {
+            sscanf(line + 6, "%lu", &v[2]);
+        } else if (strncmp(line, "syscw:", 6) == 0) {
+            sscanf(line + 6, "%lu", &v[3]);
+        } else if (strncmp(line, "read_bytes:", 11) == 0) {
+            sscanf(line + 11, "%lu", &v[4]);
+        } else if (strncmp(line, "write_bytes:", 12) == 0) {
+            sscanf(line + 12, "%lu", &v[5]);
+        } else if (strncmp(line, "cancelled_write_bytes:", 22) == 0) {
+            sscanf(line + 22, "%lu", &v[6]);
+        }
+    }
+    fclose(fp);
+
+    sink += v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6];
+}
+
+/* New parsers */
+
+static void table_parse_stat(const char *buffer, size_t len) {
+    (void)len;
+    proc_snapshot_t snap;
+    proc_snapshot_parse_stat(buffer, &snap);
+    sink += snap.utime + snap.stime + (uint64_t)snap.num_threads + snap.minflt + snap.majflt;
+}
+
+static void table_parse_status(const char *buffer, size_t len) {
+    (void)len;
+    proc_snapshot_t snap;
+    proc_snapshot_parse_status(buffer, &snap);
+    sink += snap.vm_rss + snap.vm_size + snap.voluntary_ctxt_switches +
+            snap.nonvoluntary_ctxt_switches;
+}
+
+static void table_parse_io(const char *buffer, size_t len) {
+    (void)len;
+    proc_snapshot_t snap;
+    proc_snapshot_parse_io(buffer, &snap);
+    sink += snap.rchar + snap.wchar + snap.read_bytes + snap.cancelled_write_bytes;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double run(void (*parse)(const char *, size_t), const char *buffer,
+                  size_t len, long iterations) {
+    /* Warm up caches and branch predictors */
+    for (long i = 0; i < iterations / 10; i++) {
+        parse(buffer, len);
+    }
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++) {
+        parse(buffer, len);
+    }
+    return (now_ns() - start) / iterations;
+}
+
+static int load_fixture(const char *dir, const char *name, char *buffer, size_t size) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Failed to open fixture %s\n", path);
+        return -1;
+    }
+    size_t n = fread(buffer, 1, size - 1, fp);
+    buffer[n] = '\0';
+    fclose(fp);
+    return (int)n;
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = (argc > 1) ? argv[1] : "bench/fixtures";
+    long iterations = (argc > 2) ? atol(argv[2]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) iterations = DEFAULT_ITERATIONS;
+
+    struct {
+        const char *name;
+        void (*legacy)(const char *, size_t);
+        void (*table)(const char *, size_t);
+    } cases[] = {
+        {"stat",   legacy_parse_stat,   table_parse_stat},
+        {"status", legacy_parse_status, table_parse_status},
+        {"io",     legacy_parse_io,     table_parse_io},
+    };
+
+    printf("\n=== Procfs Parser Benchmark (%ld iterations) ===\n\n", iterations);
+    printf("%-8s %14s %14s %10s\n", "file", "legacy ns", "table ns", "speedup");
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        char buffer[PROCFS_BUFFER_SIZE];
+        int len = load_fixture(dir, cases[i].name, buffer, sizeof(buffer));
+        if (len < 0) {
+            return 1;
+        }
+
+        double legacy_ns = run(cases[i].legacy, buffer, (size_t)len, iterations);
+        double table_ns = run(cases[i].table, buffer, (size_t)len, iterations);
+
+        printf("%-8s %14.1f %14.1f %9.1fx\n", cases[i].name,
+               legacy_ns, table_ns, legacy_ns / table_ns);
+    }
+
+    printf("\n");
+    return 0;
+}
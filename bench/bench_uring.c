@@ -0,0 +1,131 @@
+/*
+ * Batched procfs read benchmark
+ *
+ * Forks sleeping children and snapshots all of them once per "tick",
+ * first with one pread() per file (PROCFS_IO_PREAD) and then with the
+ * whole batch submitted through io_uring (PROCFS_IO_URING). Descriptors
+ * are cached in both modes, so the difference is the per-file syscall.
+ *
+ * Usage: bench_uring [processes] [ticks]
+ */
+#include "../include/procfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define DEFAULT_PROCESSES 1000
+#define DEFAULT_TICKS 50
+
+static double clock_ms(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Time ticks batched snapshots; returns 0 and the per-tick wall and CPU ms */
+static int run(procfs_io_mode_t mode, const pid_t *pids, int count, int ticks,
+               proc_snapshot_t *snaps, int *errors, double *wall_ms, double *cpu_ms) {
+    if (proc_snapshot_set_io_mode(mode) != 0) {
+        return -1;
+    }
+    unsigned int files = PROCFS_SNAP_STAT | PROCFS_SNAP_STATUS | PROCFS_SNAP_IO;
+
+    /* Warm-up tick opens every descriptor */
+    if (proc_snapshot_take_batch(pids, count, files, snaps, errors) != count) {
+        fprintf(stderr, "Warm-up snapshot incomplete\n");
+        return -1;
+    }
+
+    double wall = clock_ms(CLOCK_MONOTONIC);
+    double cpu = clock_ms(CLOCK_PROCESS_CPUTIME_ID);
+    for (int t = 0; t < ticks; t++) {
+        proc_snapshot_take_batch(pids, count, files, snaps, errors);
+    }
+    *wall_ms = (clock_ms(CLOCK_MONOTONIC) - wall) / ticks;
+    *cpu_ms = (clock_ms(CLOCK_PROCESS_CPUTIME_ID) - cpu) / ticks;
+    return 0;
+}
+
+static void reap(const pid_t *pids, int count) {
+    for (int i = 0; i < count; i++) {
+        kill(pids[i], SIGKILL);
+    }
+    for (int i = 0; i < count; i++) {
+        waitpid(pids[i], NULL, 0);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int count = (argc > 1) ? atoi(argv[1]) : DEFAULT_PROCESSES;
+    int ticks = (argc > 2) ? atoi(argv[2]) : DEFAULT_TICKS;
+    if (count <= 0) count = DEFAULT_PROCESSES;
+    if (ticks <= 0) ticks = DEFAULT_TICKS;
+
+    /* Three cached descriptors per process */
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    pid_t *pids = calloc(count, sizeof(pid_t));
+    proc_snapshot_t *snaps = calloc(count, sizeof(proc_snapshot_t));
+    int *errors = calloc(count, sizeof(int));
+    if (!pids || !snaps || !errors) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    int spawned = 0;
+    for (; spawned < count; spawned++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            fprintf(stderr, "fork failed after %d children: %s\n", spawned, strerror(errno));
+            break;
+        }
+        if (pid == 0) {
+            pause();
+            _exit(0);
+        }
+        pids[spawned] = pid;
+    }
+    if (spawned == 0) {
+        return 1;
+    }
+
+    procfs_init();
+
+    double pread_wall, pread_cpu, uring_wall, uring_cpu;
+    int status = 0;
+    printf("\n=== Batched Snapshot Benchmark (%d processes, %d ticks) ===\n\n", spawned, ticks);
+    printf("%-8s %14s %14s\n", "mode", "wall ms/tick", "cpu ms/tick");
+
+    if (run(PROCFS_IO_PREAD, pids, spawned, ticks, snaps, errors, &pread_wall, &pread_cpu) != 0) {
+        status = 1;
+    } else {
+        printf("%-8s %14.3f %14.3f\n", "pread", pread_wall, pread_cpu);
+        if (run(PROCFS_IO_URING, pids, spawned, ticks, snaps, errors,
+                &uring_wall, &uring_cpu) != 0) {
+            printf("%-8s %14s (%s)\n", "io_uring", "unavailable", strerror(errno));
+        } else {
+            printf("%-8s %14.3f %14.3f\n", "io_uring", uring_wall, uring_cpu);
+            printf("\nspeedup: %.2fx wall, %.2fx cpu\n",
+                   pread_wall / uring_wall, pread_cpu / uring_cpu);
+        }
+    }
+    printf("\n");
+
+    procfs_uring_cleanup();
+    procfs_cleanup();
+    reap(pids, spawned);
+    free(pids);
+    free(snaps);
+    free(errors);
+    return status;
+}
@@ -5,8 +5,15 @@
 #include <time.h>
 
 #define MAX_SAMPLES 100
+#define ANOMALY_MAX_PENDING 8        /* Trigger events queued between checks */
 #define ANOMALY_THRESHOLD_SIGMA 2.0  /* 2 standard deviations */
 
+/* Adaptive sampling */
+#define ADAPTIVE_WINDOW 8            /* Recent samples judged for volatility */
+#define ADAPTIVE_TIGHTEN_SCORE 1.0   /* Drop straight to the floor at or above */
+#define ADAPTIVE_RELAX_SCORE 0.25    /* Stretch the interval below */
+#define ADAPTIVE_RELAX_FACTOR 1.5
+
 /* Anomaly types */
 typedef enum {
     ANOMALY_NONE = 0,
@@ -15,7 +22,14 @@ typedef enum {
     ANOMALY_IO_SPIKE,
     ANOMALY_CPU_DROP,
     ANOMALY_MEMORY_LEAK,
-    ANOMALY_IO_STALL
+    ANOMALY_IO_STALL,
+    ANOMALY_CPU_PRESSURE,        /* PSI trigger fired (kernel-side, not sampled) */
+    ANOMALY_MEMORY_PRESSURE,
+    ANOMALY_IO_PRESSURE,
+    ANOMALY_OOM_KILL,            /* Cgroup event files (kernel-side, not sampled) */
+    ANOMALY_MEMORY_LIMIT,        /* memory.high/max, oom, swap.max breaches */
+    ANOMALY_PIDS_LIMIT,          /* fork() rejected at pids.max */
+    ANOMALY_CGROUP_STATE         /* Cgroup emptied, populated, frozen or thawed */
 } anomaly_type_t;
 
 /* Anomaly severity */
@@ -39,6 +53,17 @@ typedef struct {
     time_t last_sample_time;
 } metric_stats_t;
 
+/* Detected anomaly */
+typedef struct {
+    anomaly_type_t type;
+    anomaly_severity_t severity;
+    double value;
+    double expected_mean;
+    double deviation_sigma;
+    time_t detected_at;
+    char description[256];
+} anomaly_event_t;
+
 /* Anomaly detector for a single process */
 typedef struct {
     pid_t pid;
@@ -46,19 +71,24 @@ typedef struct {
     metric_stats_t memory_stats;
     metric_stats_t io_read_stats;
     metric_stats_t io_write_stats;
+    anomaly_event_t pending[ANOMALY_MAX_PENDING];  /* Reported events not yet returned */
+    int pending_count;
     int initialized;
 } anomaly_detector_t;
 
-/* Detected anomaly */
+/* Volatility-driven sampling interval of one target.
+ * A jump or a noisy recent window drops the interval to the floor at once,
+ * so a spike is followed at full resolution; a quiet target relaxes
+ * geometrically toward the ceiling. */
 typedef struct {
-    anomaly_type_t type;
-    anomaly_severity_t severity;
-    double value;
-    double expected_mean;
-    double deviation_sigma;
-    time_t detected_at;
-    char description[256];
-} anomaly_event_t;
+    double floor;                /* Seconds */
+    double ceiling;              /* Seconds */
+    double interval;             /* Interval until the next sample */
+    double score;                /* Volatility of the last update */
+    metric_stats_t cpu_stats;    /* CPU percent */
+    metric_stats_t memory_stats; /* RSS in KB */
+    metric_stats_t io_stats;     /* Read + write bytes/sec */
+} adaptive_rate_t;
 
 /* Function declarations */
 
@@ -74,8 +104,31 @@ void anomaly_detector_update_cpu(anomaly_detector_t *detector, double cpu_percen
 void anomaly_detector_update_memory(anomaly_detector_t *detector, double memory_kb);
 void anomaly_detector_update_io(anomaly_detector_t *detector, double read_rate, double write_rate);
 
+/**
+ * Report a fired PSI trigger: stall_us of stall within window_us
+ * type is one of the ANOMALY_*_PRESSURE kinds and avg10 the pressure read
+ * right after the event. The event is queued, oldest dropped when full.
+ */
+void anomaly_detector_report_pressure(anomaly_detector_t *detector, anomaly_type_t type,
+                                      double avg10, uint32_t stall_us, uint32_t window_us);
+
+/**
+ * Queue an event the kernel reported (cgroup OOM kills, limit breaches, ...)
+ */
+void anomaly_detector_report(anomaly_detector_t *detector, anomaly_type_t type,
+                             anomaly_severity_t severity, double value,
+                             const char *description);
+
+/**
+ * Return the queued trigger events without evaluating the sampled metrics
+ * Returns the number of events copied.
+ */
+int anomaly_detector_take_events(anomaly_detector_t *detector, anomaly_event_t *events,
+                                 int max_events);
+
 /**
  * Check for anomalies and return detected events
+ * Queued trigger events come first.
  * Returns number of anomalies detected (0 if none)
  */
 int anomaly_detector_check(anomaly_detector_t *detector, anomaly_event_t *events, int max_events);
@@ -105,4 +158,18 @@ void anomaly_detector_reset(anomaly_detector_t *detector);
  */
 void anomaly_detector_cleanup(anomaly_detector_t *detector);
 
+/**
+ * Initialize an adaptive interval between floor and ceiling (seconds)
+ * Starts at initial, clamped into the range.
+ */
+int adaptive_rate_init(adaptive_rate_t *rate, double floor, double ceiling, double initial);
+
+/**
+ * Feed one sample and return the interval until the next one
+ * The score is the largest, over all metrics, of the last change or the
+ * recent standard deviation relative to the metric's recent level.
+ */
+double adaptive_rate_update(adaptive_rate_t *rate, double cpu_percent,
+                            double rss_kb, double io_rate);
+
 #endif /* ANOMALY_H */
@@ -43,14 +43,57 @@ typedef struct {
     struct timespec timestamp;
 } cgroup_memory_t;
 
+#define CGROUP_MAX_IO_DEVICES 16
+#define CGROUP_IO_STAT_SIZE 16384    /* io.stat buffer: a line of up to ~250 bytes per device */
+#define CGROUP_DEVICE_NAME 32
+
+/* One device line of io.stat, plus its io.latency target */
+typedef struct {
+    unsigned int major;
+    unsigned int minor;
+    char name[CGROUP_DEVICE_NAME];   /* "vda", "nvme0n1", or "MAJ:MIN" if not in /proc/partitions */
+    uint64_t rbytes;
+    uint64_t wbytes;
+    uint64_t dbytes;             /* Discarded bytes (Linux 5.0+) */
+    uint64_t rios;
+    uint64_t wios;
+    uint64_t dios;
+    int has_cost;                /* cost.* keys: iocost enabled on the device */
+    double cost_vrate;           /* Device vtime rate in percent */
+    uint64_t cost_usage_usec;    /* Device time charged to the cgroup */
+    uint64_t cost_wait_usec;     /* Time waiting for budget */
+    uint64_t cost_indebt_usec;   /* Time spent in debt */
+    uint64_t cost_indelay_usec;  /* Time delayed to pay back debt */
+    int has_latency;             /* blk-iolatency keys in io.stat */
+    uint64_t avg_lat_usec;       /* Moving average completion latency */
+    uint64_t latency_window_msec;
+    uint64_t use_delay;          /* Current throttling depth */
+    uint64_t delay_nsec;         /* Current delay per I/O */
+    uint64_t latency_target_usec; /* io.latency target, 0 if none */
+    double read_rate;            /* Rates since the previous sample, bytes per second */
+    double write_rate;
+    double discard_rate;
+    double read_iops;            /* Operations per second */
+    double write_iops;
+    double discard_iops;
+    double cost_usage_percent;   /* cost.* deltas relative to wall time */
+    double cost_wait_percent;
+    double cost_indebt_percent;
+    double cost_indelay_percent;
+} cgroup_io_device_t;
+
 /* Block I/O controller metrics */
 typedef struct {
     uint64_t read_bytes;         /* Total bytes read */
     uint64_t write_bytes;        /* Total bytes written */
     uint64_t read_iops;          /* Read IOPS */
     uint64_t write_iops;         /* Write IOPS */
+    uint64_t discard_bytes;      /* Total bytes discarded */
+    uint64_t discard_ios;
     uint64_t read_bps_limit;     /* Read BPS limit */
     uint64_t write_bps_limit;    /* Write BPS limit */
+    int device_count;            /* Devices beyond CGROUP_MAX_IO_DEVICES only count in the totals */
+    cgroup_io_device_t devices[CGROUP_MAX_IO_DEVICES];
     struct timespec timestamp;
 } cgroup_blkio_t;
 
@@ -61,6 +104,63 @@ typedef struct {
     struct timespec timestamp;
 } cgroup_pids_t;
 
+/* Resources with pressure stall information */
+typedef enum {
+    CGROUP_PSI_CPU,
+    CGROUP_PSI_MEMORY,
+    CGROUP_PSI_IO,
+    CGROUP_PSI_RESOURCES
+} cgroup_psi_resource_t;
+
+/* One *.pressure file: share of wall time tasks were stalled on the resource */
+typedef struct {
+    double some_avg10;           /* % of time at least one task stalled, 10s average */
+    double some_avg60;
+    double some_avg300;
+    uint64_t some_total;         /* Total stall time in microseconds */
+    double full_avg10;           /* % of time all non-idle tasks stalled at once */
+    double full_avg60;
+    double full_avg300;
+    uint64_t full_total;
+    int has_full;                /* cpu.pressure has no full line before Linux 5.13 */
+} cgroup_psi_t;
+
+/* Pressure stall information of cpu, memory and io */
+typedef struct {
+    cgroup_psi_t psi[CGROUP_PSI_RESOURCES];   /* Indexed by cgroup_psi_resource_t */
+    int has_psi[CGROUP_PSI_RESOURCES];
+    struct timespec timestamp;
+} cgroup_pressure_t;
+
+/* Kernel-side PSI trigger: fd reports EPOLLPRI once stall_us of stall
+ * accumulated within a window_us sliding window */
+typedef struct {
+    int fd;
+    cgroup_psi_resource_t resource;
+    int full;                    /* Trigger on "full" instead of "some" stalls */
+    uint32_t stall_us;
+    uint32_t window_us;
+    uint64_t events;             /* Times the trigger fired */
+} cgroup_psi_trigger_t;
+
+/* Interface files read through the handle cache */
+typedef enum {
+    CGROUP_FILE_CPU_STAT,
+    CGROUP_FILE_CPU_MAX,
+    CGROUP_FILE_MEMORY_CURRENT,
+    CGROUP_FILE_MEMORY_MAX,
+    CGROUP_FILE_MEMORY_STAT,
+    CGROUP_FILE_MEMORY_EVENTS,
+    CGROUP_FILE_IO_STAT,
+    CGROUP_FILE_IO_LATENCY,
+    CGROUP_FILE_PIDS_CURRENT,
+    CGROUP_FILE_PIDS_MAX,
+    CGROUP_FILE_CPU_PRESSURE,    /* Same order as cgroup_psi_resource_t */
+    CGROUP_FILE_MEMORY_PRESSURE,
+    CGROUP_FILE_IO_PRESSURE,
+    CGROUP_FILE_COUNT
+} cgroup_file_t;
+
 /* Complete cgroup metrics */
 typedef struct {
     char cgroup_path[MAX_CGROUP_PATH];
@@ -69,12 +169,32 @@ typedef struct {
     cgroup_memory_t memory;
     cgroup_blkio_t blkio;
     cgroup_pids_t pids;
+    cgroup_pressure_t pressure;
     int has_cpu;
     int has_memory;
     int has_blkio;
     int has_pids;
+    int has_pressure;
 } cgroup_metrics_t;
 
+/* Rates between two consecutive samples of a cgroup */
+typedef struct {
+    double interval;             /* Seconds between the samples */
+    double cpu_cores;            /* CPU time per wall second, 1.0 = one core busy */
+    double user_cores;
+    double system_cores;
+    double cpu_limit_percent;    /* cpu_cores relative to cpu.max (0 = unlimited) */
+    double throttle_rate;        /* Throttled periods / elapsed periods */
+    double throttled_percent;    /* Throttled time relative to wall time, summed over CPUs */
+    double memory_percent;       /* memory.current relative to memory.max (0 = unlimited) */
+    double read_rate;            /* Bytes per second */
+    double write_rate;
+    double read_iops;            /* Operations per second */
+    double write_iops;
+    double discard_rate;         /* Bytes per second */
+    double discard_iops;
+} cgroup_rates_t;
+
 /* Cgroup configuration for creation */
 typedef struct {
     char name[MAX_CGROUP_NAME];
@@ -99,13 +219,26 @@ typedef struct {
 } cgroup_config_t;
 
 /* Throttling analysis result */
+#define CGROUP_THROTTLE_BUCKETS 12   /* Per-period usage in 10% steps of quota, last >= 110% */
+
 typedef struct {
-    double configured_limit;     /* Configured CPU limit in cores */
+    double configured_limit;     /* Configured CPU limit in cores (0 = unlimited) */
     double measured_usage;       /* Measured CPU usage in cores */
-    double throttle_percentage;  /* Percentage of time throttled */
+    double throttle_percentage;  /* Throttled time relative to wall time, summed over CPUs */
     uint64_t throttle_count;     /* Number of throttle events */
-    double precision;            /* How close measured is to configured */
+    double precision;            /* How close throttled periods get to the quota, 100 = exact */
     struct timespec duration;    /* Duration of measurement */
+    uint64_t periods;            /* Enforcement periods with runnable tasks */
+    double throttle_ratio;       /* Throttled periods / periods */
+    uint64_t throttled_usec;     /* Throttled time during the measurement */
+    int burst_count;             /* Runs of consecutive throttled periods */
+    int max_burst;               /* Longest run, in periods */
+    double mean_burst;
+    uint64_t usage_histogram[CGROUP_THROTTLE_BUCKETS];  /* Periods by usage / quota */
+    double mean_period_usage;    /* Mean CPU time per period in microseconds */
+    double throttled_period_usage; /* Mean CPU time of the throttled periods */
+    int samples;                 /* cpu.stat reads */
+    double sample_interval;      /* Seconds between reads */
 } cgroup_throttle_analysis_t;
 
 /* Cgroup manager functions */
@@ -123,6 +256,89 @@ int cgroup_collect_cpu(const char *cgroup_path, cgroup_cpu_t *cpu);
 int cgroup_collect_memory(const char *cgroup_path, cgroup_memory_t *memory);
 int cgroup_collect_blkio(const char *cgroup_path, cgroup_blkio_t *blkio);
 int cgroup_collect_pids(const char *cgroup_path, cgroup_pids_t *pids);
+int cgroup_collect_pressure(const char *cgroup_path, cgroup_pressure_t *pressure);
+
+/* Interface file access */
+
+/**
+ * Read an interface file of a cgroup (path relative to the cgroup mount)
+ * The first read opens the cgroup directory relative to the mount
+ * descriptor and the file relative to the directory; both stay cached,
+ * so later reads are a single pread() without a kernfs path lookup. A
+ * removed cgroup (ENODEV) is dropped from the cache and reopened once, in
+ * case it was created again. The cache is per thread. Returns the number
+ * of bytes read (NUL-terminated), -1 with errno set.
+ */
+ssize_t cgroup_read_file(const char *cgroup_path, cgroup_file_t file, char *buffer, size_t size);
+
+/**
+ * Close the cached descriptors of one cgroup
+ */
+void cgroup_forget(const char *cgroup_path);
+
+/**
+ * Close every cached descriptor of the calling thread
+ */
+void cgroup_cache_cleanup(void);
+
+/**
+ * Cgroups with cached descriptors in the calling thread
+ */
+int cgroup_cached_count(void);
+
+/* Per-device I/O */
+
+/**
+ * Parse io.stat into per-device counters and the totals over all devices
+ * Each "MAJ:MIN key=value ..." line is read key by key, so unknown keys
+ * and any key order are accepted; cost.* (iocost) and blk-iolatency keys
+ * are kept when present. Device names come from the table loaded by
+ * cgroup_init(). Returns the number of devices stored.
+ */
+int cgroup_parse_io_stat(const char *text, cgroup_blkio_t *blkio);
+
+/**
+ * Fill the per-device rates of curr from the previous sample, matching
+ * devices by major:minor (a device new in curr gets zero rates)
+ */
+void cgroup_calculate_device_rates(const cgroup_blkio_t *prev, cgroup_blkio_t *curr);
+
+/**
+ * Name of a block device from /proc/partitions, read once in cgroup_init()
+ * Returns NULL for devices that were not listed then.
+ */
+const char *cgroup_device_name(unsigned int major, unsigned int minor);
+
+/* Pressure stall information */
+
+/**
+ * Parse the "some" and "full" lines of a *.pressure file
+ * Returns 0 if at least the "some" line was found, -1 otherwise.
+ */
+int cgroup_parse_psi(const char *text, cgroup_psi_t *psi);
+
+/**
+ * Arm a PSI trigger on cgroup_path (the root cgroup falls back to
+ * /proc/pressure on hosts without a v2 root pressure file)
+ * Writes "some|full <stall_us> <window_us>"; the window must be 500 ms..10 s
+ * and unprivileged callers need a multiple of 2 s. Wait for EPOLLPRI on
+ * trigger->fd. Returns 0 on success, -1 with errno set.
+ */
+int cgroup_psi_trigger_open(const char *cgroup_path, cgroup_psi_resource_t resource,
+                            int full, uint32_t stall_us, uint32_t window_us,
+                            cgroup_psi_trigger_t *trigger);
+
+/**
+ * Acknowledge a fired trigger and read the resource's current pressure
+ * Returns 0 on success, -1 if the cgroup went away.
+ */
+int cgroup_psi_trigger_read(cgroup_psi_trigger_t *trigger, cgroup_psi_t *psi);
+void cgroup_psi_trigger_close(cgroup_psi_trigger_t *trigger);
+
+/**
+ * "cpu", "memory" or "io"
+ */
+const char *cgroup_psi_resource_name(cgroup_psi_resource_t resource);
 
 /* Cgroup manipulation */
 int cgroup_create(const cgroup_config_t *config, char *created_path, size_t path_len);
@@ -137,28 +353,85 @@ int cgroup_set_io_limit(const char *cgroup_path, uint64_t read_bps, uint64_t wri
 int cgroup_set_pid_limit(const char *cgroup_path, uint64_t limit);
 
 /* Analysis functions */
+
+/**
+ * Profile CFS bandwidth throttling for duration_sec
+ * Reads cpu.stat four times per enforcement period (every 1..25 ms) and
+ * hands the samples to cgroup_analyze_throttling_samples().
+ * Returns 0 on success, -1 on error.
+ */
 int cgroup_analyze_throttling(const char *cgroup_path, double duration_sec,
                               cgroup_throttle_analysis_t *analysis);
+
+/**
+ * Attribute the usage between consecutive cpu.stat samples to the periods
+ * that ended in between, then derive throttle ratio, bursts of throttled
+ * periods and the per-period usage distribution against the quota
+ */
+int cgroup_analyze_throttling_samples(const cgroup_cpu_t *samples, int count,
+                                      cgroup_throttle_analysis_t *analysis);
 int cgroup_analyze_memory_pressure(const char *cgroup_path, int duration_sec,
                                    double *oom_events_per_sec);
 
 /* Utilization reporting */
 int cgroup_generate_utilization_report(const char *cgroup_path,
                                        char *report, size_t report_len);
+
+/**
+ * CPU cores used between two cpu.stat samples (usage_usec per wall second)
+ * Returns 0 if the timestamps do not advance or the counter went back
+ * because the cgroup was recreated.
+ */
 double cgroup_calculate_cpu_utilization(const cgroup_cpu_t *prev,
                                        const cgroup_cpu_t *current);
+
+/**
+ * memory.current as a percentage of memory.max, 0 without a limit
+ */
 double cgroup_calculate_memory_utilization(const cgroup_memory_t *memory);
 
+/**
+ * Derive CPU cores, throttling, memory use and I/O throughput and IOPS from
+ * two consecutive samples of the same cgroup
+ * Counters that went back (cgroup recreated) count as no activity.
+ */
+int cgroup_calculate_rates(const cgroup_metrics_t *prev, const cgroup_metrics_t *curr,
+                           cgroup_rates_t *rates);
+
 /* Utility functions */
 void cgroup_print_metrics(const cgroup_metrics_t *metrics);
 void cgroup_print_cpu(const cgroup_cpu_t *cpu);
 void cgroup_print_memory(const cgroup_memory_t *memory);
 void cgroup_print_blkio(const cgroup_blkio_t *blkio);
+void cgroup_print_devices(const cgroup_blkio_t *blkio);
 void cgroup_print_pids(const cgroup_pids_t *pids);
+void cgroup_print_pressure(const cgroup_pressure_t *pressure);
 void cgroup_print_throttle_analysis(const cgroup_throttle_analysis_t *analysis);
+void cgroup_print_rates(const cgroup_rates_t *rates);
+
+/**
+ * Copy text into out as the body of a JSON string: quotes, backslashes
+ * and control characters are escaped (at most 6 bytes per input byte).
+ * Truncates before an escape sequence when out is too small. Returns out.
+ */
+const char *cgroup_json_escape(const char *text, char *out, size_t size);
+
+/**
+ * Copy text into out as one quoted CSV field, doubling embedded quotes
+ * (out needs twice the length plus 3). Returns out.
+ */
+const char *cgroup_csv_quote(const char *text, char *out, size_t size);
+
+/* Export functions: counters of one sample plus the rates since the
+ * previous one (rates may be NULL for the first sample) */
+int cgroup_export_metrics_json(const cgroup_metrics_t *metrics, const cgroup_rates_t *rates,
+                               const char *filename);
+int cgroup_export_metrics_csv(const cgroup_metrics_t *metrics, const cgroup_rates_t *rates,
+                              const char *filename, int append);
 
-/* Export functions */
-int cgroup_export_metrics_json(const cgroup_metrics_t *metrics, const char *filename);
-int cgroup_export_metrics_csv(const cgroup_metrics_t *metrics, const char *filename, int append);
+/**
+ * One row per io.stat device with its counters, rates, iocost and latency
+ */
+int cgroup_export_devices_csv(const cgroup_metrics_t *metrics, const char *filename, int append);
 
 #endif /* CGROUP_H */
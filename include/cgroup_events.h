@@ -0,0 +1,79 @@
+#ifndef CGROUP_EVENTS_H
+#define CGROUP_EVENTS_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define CGROUP_EVENTS_MAX_WATCHED 64
+#define CGROUP_EVENTS_MAX_EVENTS 64
+
+/* Counters and states of memory.events, memory.swap.events, pids.events
+ * and cgroup.events */
+typedef enum {
+    CGROUP_EVENT_MEMORY_LOW,     /* Reclaimed below memory.low */
+    CGROUP_EVENT_MEMORY_HIGH,    /* Throttled above memory.high */
+    CGROUP_EVENT_MEMORY_MAX,     /* Allocation hit memory.max */
+    CGROUP_EVENT_OOM,            /* Reclaim at memory.max failed */
+    CGROUP_EVENT_OOM_KILL,       /* Process killed by the OOM killer */
+    CGROUP_EVENT_OOM_GROUP_KILL, /* Whole cgroup killed (memory.oom.group) */
+    CGROUP_EVENT_SWAP_HIGH,
+    CGROUP_EVENT_SWAP_MAX,
+    CGROUP_EVENT_SWAP_FAIL,      /* Swap-out failed at swap.max */
+    CGROUP_EVENT_PIDS_MAX,       /* fork()/clone() rejected at pids.max */
+    CGROUP_EVENT_POPULATED,      /* State: 1 while the subtree has processes */
+    CGROUP_EVENT_FROZEN,         /* State: 1 while cgroup.freeze is in effect */
+    CGROUP_EVENT_KINDS
+} cgroup_event_kind_t;
+
+/* One change of a counter or state */
+typedef struct {
+    int watch;                   /* Id returned by cgroup_events_watch() */
+    cgroup_event_kind_t kind;
+    uint64_t value;              /* Counter after the change, or the new state */
+    uint64_t delta;              /* Counter increase since the last read (1 for states) */
+    struct timespec timestamp;   /* CLOCK_MONOTONIC when the change was read */
+} cgroup_event_t;
+
+/**
+ * Create the epoll set holding the event files of every watched cgroup
+ */
+int cgroup_events_init(void);
+
+/**
+ * Close every event file and the epoll set
+ */
+void cgroup_events_cleanup(void);
+
+/**
+ * Watch the event files of a cgroup (path relative to the cgroup mount)
+ * The current values become the baseline. Files of disabled controllers
+ * are skipped. The kernel flags a file with EPOLLPRI when it changes, so
+ * an idle cgroup is never read. Returns the watch id, or -1 with errno
+ * set (ENOENT if the cgroup has no event files).
+ */
+int cgroup_events_watch(const char *cgroup_path);
+int cgroup_events_unwatch(int watch);
+
+/**
+ * Read the files flagged since the last call, without blocking
+ * Files that do not fit in events stay flagged for the next call. A
+ * removed cgroup is unwatched. Returns number of events stored, -1 on error.
+ */
+int cgroup_events_read(cgroup_event_t *events, int max_events);
+
+/**
+ * Epoll descriptor of the watch set, readable when any event file changed
+ */
+int cgroup_events_get_fd(void);
+
+/**
+ * Path a watch id was created with
+ */
+const char *cgroup_events_path(int watch);
+
+/**
+ * "oom_kill", "memory.high", "populated", ...
+ */
+const char *cgroup_event_name(cgroup_event_kind_t kind);
+
+#endif /* CGROUP_EVENTS_H */
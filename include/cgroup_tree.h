@@ -0,0 +1,100 @@
+#ifndef CGROUP_TREE_H
+#define CGROUP_TREE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include "cgroup.h"
+
+#define CGROUP_TREE_MAX_THREADS 64
+
+/* Column the top-N view is ordered by */
+typedef enum {
+    CGROUP_TREE_SORT_CPU,
+    CGROUP_TREE_SORT_MEMORY,
+    CGROUP_TREE_SORT_IO
+} cgroup_tree_sort_t;
+
+/* One cgroup found by a sweep */
+typedef struct {
+    char path[MAX_CGROUP_PATH];          /* Relative to the sweep root, "/" for the root */
+    int depth;
+    ino_t id;                            /* Directory inode (cgroup id), detects a recreated cgroup */
+    int has_cpu;                         /* File read succeeded */
+    int has_memory;
+    int has_io;
+    int has_pids;
+    uint64_t usage_usec;                 /* cpu.stat */
+    uint64_t throttled_usec;
+    uint64_t memory_current;             /* memory.current in bytes */
+    uint64_t read_bytes;                 /* io.stat, summed over devices */
+    uint64_t write_bytes;
+    uint64_t read_ios;
+    uint64_t write_ios;
+    uint64_t pids_current;
+    double cpu_percent;                  /* Rates since the previous sweep, 100 = one core */
+    double read_rate;                    /* Bytes per second */
+    double write_rate;
+} cgroup_tree_node_t;
+
+/* Result of one sweep, nodes sorted by path */
+typedef struct {
+    cgroup_tree_node_t *nodes;
+    int count;
+    int capacity;
+    double walk_ms;                      /* getdents64 walk of the hierarchy */
+    double scan_ms;                      /* Walk plus the parallel file reads */
+    struct timespec timestamp;
+} cgroup_tree_result_t;
+
+/**
+ * Open the sweep root and start the worker pool
+ * root is relative to the cgroup mount ("/" for the whole hierarchy);
+ * threads <= 0 uses one worker per online CPU. Call cgroup_init() first.
+ */
+int cgroup_tree_init(const char *root, int threads);
+
+/**
+ * Stop the workers and close the root descriptor
+ */
+void cgroup_tree_cleanup(void);
+
+/**
+ * Number of worker threads
+ */
+int cgroup_tree_thread_count(void);
+
+/**
+ * Walk the hierarchy below the root and read cpu.stat, memory.current,
+ * io.stat and pids.current of every cgroup
+ * Directories are listed with getdents64 relative to the root descriptor.
+ * The nodes are sharded by path across the workers, which read them in
+ * parallel through cgroup_read_file(), so each worker keeps its cgroups'
+ * descriptors open from one sweep to the next. result may be reused
+ * between sweeps. Returns the number of cgroups, -1 on error.
+ */
+int cgroup_tree_scan(cgroup_tree_result_t *result);
+
+/**
+ * Fill cpu_percent / read_rate / write_rate of curr from the previous sweep
+ */
+void cgroup_tree_calculate_rates(const cgroup_tree_result_t *prev, cgroup_tree_result_t *curr);
+
+/**
+ * Release the nodes of a result
+ */
+void cgroup_tree_result_free(cgroup_tree_result_t *result);
+
+/**
+ * Parse "cpu", "memory" or "io"; returns -1 for anything else
+ */
+int cgroup_tree_parse_sort(const char *name, cgroup_tree_sort_t *sort);
+
+/**
+ * Print the top_n cgroups by the sort column
+ */
+void cgroup_tree_print(const cgroup_tree_result_t *result, cgroup_tree_sort_t sort, int top_n);
+
+int cgroup_tree_export_csv(const cgroup_tree_result_t *result, const char *filename, int append);
+
+#endif /* CGROUP_TREE_H */
@@ -0,0 +1,90 @@
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define COLLECTOR_MAX_SOURCES 32
+#define COLLECTOR_CADENCE_CHEAP 1       /* Ticks between reads per cost class */
+#define COLLECTOR_CADENCE_MEDIUM 5
+#define COLLECTOR_CADENCE_EXPENSIVE 60
+#define COLLECTOR_MAX_STRETCH 64        /* Largest budget multiplier of a cadence */
+#define COLLECTOR_BUDGET_WINDOW 1.0     /* Seconds of wall time per budget check */
+
+/* Cost class of a metric source */
+typedef enum {
+    COST_CHEAP = 0,      /* A few pread()s, e.g. stat/status/io */
+    COST_MEDIUM,         /* Directory listings, e.g. /proc/[pid]/fd */
+    COST_EXPENSIVE,      /* Kernel walks, e.g. smaps_rollup */
+    COST_CLASS_COUNT
+} cost_class_t;
+
+/* Reads one source for pid; returns 0 on success, -1 on failure */
+typedef int (*source_collect_t)(pid_t pid, void *arg);
+
+/* A registered metric source */
+typedef struct {
+    const char *name;
+    cost_class_t cost;
+    unsigned int cadence;        /* Ticks between reads before budget stretch */
+    unsigned int phase;          /* Tick offset, keeps sources off each other's ticks */
+    source_collect_t collect;
+    void *arg;
+    uint64_t runs;
+    uint64_t failures;
+    uint64_t cpu_ns;             /* Monitor CPU time spent in collect */
+} metric_source_t;
+
+/* Tiered collection: every source runs on its own cadence, phases are
+ * chosen so costly reads land on different ticks, and an optional CPU
+ * budget stretches medium and expensive cadences when the monitor uses
+ * more than its share of a core. Cheap sources always run every tick;
+ * the sampling interval is their knob. */
+typedef struct {
+    metric_source_t sources[COLLECTOR_MAX_SOURCES];
+    int count;
+    unsigned int stretch[COST_CLASS_COUNT];  /* Budget multiplier per class */
+    double budget;                           /* Share of one core, 0 = unlimited */
+    double usage;                            /* Share used in the last window */
+    uint64_t window_class_ns[COST_CLASS_COUNT];
+    struct timespec window_start;            /* CLOCK_MONOTONIC */
+    uint64_t window_cpu_start_ns;            /* Process CPU time at window start */
+    uint64_t adjustments;                    /* Stretch changes made by the budget */
+    int over_budget_warned;
+} collector_t;
+
+/**
+ * Initialize a collector
+ * budget is the share of one core the whole monitor may use (0.05 = 5%),
+ * 0 disables budgeting.
+ */
+int collector_init(collector_t *collector, double budget);
+
+/**
+ * Register a source with its cost class
+ * cadence 0 selects the class default. Returns the source index, or -1.
+ */
+int collector_register(collector_t *collector, const char *name, cost_class_t cost,
+                       unsigned int cadence, source_collect_t collect, void *arg);
+
+/**
+ * Current cadence of a source in ticks, including the budget stretch
+ */
+unsigned int collector_cadence(const collector_t *collector, int index);
+
+/**
+ * Returns 1 if the source is due on tick
+ * A source that has not run yet is always due.
+ */
+int collector_is_due(const collector_t *collector, int index, uint64_t tick);
+
+/**
+ * Run every source due on tick, then re-check the CPU budget
+ * Returns the number of sources that failed.
+ */
+int collector_run(collector_t *collector, uint64_t tick, pid_t pid);
+
+void print_collector_stats(const collector_t *collector);
+
+#endif /* COLLECTOR_H */
@@ -0,0 +1,100 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include "monitor.h"
+#include "anomaly.h"
+#include "cgroup.h"
+
+#define EVENT_LOOP_MAX_FDS 32
+#define EVENT_LOOP_MAX_SUBSCRIBERS 8
+#define MONITOR_SAMPLE_MAX_ANOMALIES 10
+
+/* Called when fd becomes ready; events is the epoll mask */
+typedef void (*event_handler_t)(int fd, uint32_t events, void *arg);
+
+/* One sample of a monitored process or cgroup, delivered to every front end */
+typedef struct {
+    pid_t pid;
+    uint64_t tick;
+    double elapsed;                      /* Scheduled time since the start */
+    struct timespec timestamp;           /* Actual collection time (CLOCK_MONOTONIC) */
+    double interval;                     /* Interval until the next sample */
+    int exited;                          /* Final sample of an exited process */
+    int events_only;                     /* Trigger events between ticks, no metrics */
+    int has_cpu;
+    int has_memory;
+    int has_io;
+    int has_fds;                         /* Costlier sources: set on ticks they ran */
+    int has_smaps;
+    int has_network;
+    cpu_metrics_t cpu;                   /* cpu_percent filled */
+    memory_metrics_t memory;
+    io_metrics_t io;                     /* Rates filled */
+    int fd_count;
+    memory_smaps_t smaps;
+    network_metrics_t network;           /* Rates filled */
+    int has_cgroup;                      /* Cgroup sample (-g): pid is 0, no process metrics */
+    cgroup_metrics_t cgroup;
+    cgroup_rates_t cgroup_rates;         /* Since the previous sample */
+    int anomaly_count;
+    anomaly_event_t anomalies[MONITOR_SAMPLE_MAX_ANOMALIES];
+} monitor_sample_t;
+
+typedef void (*sample_subscriber_t)(const monitor_sample_t *sample, void *arg);
+
+/**
+ * Create the epoll set with the sampling timerfd and a signalfd
+ * SIGINT and SIGTERM are blocked and delivered through the signalfd; they
+ * clear *running and stop the loop.
+ */
+int event_loop_init(volatile int *running);
+
+/**
+ * Close every descriptor owned by the loop, unblock the signals and drop
+ * all handlers and subscribers
+ */
+void event_loop_cleanup(void);
+
+/**
+ * Dispatch readiness of fd to handler (EPOLLIN unless events says otherwise)
+ */
+int event_loop_add_fd(int fd, uint32_t events, event_handler_t handler, void *arg);
+int event_loop_remove_fd(int fd);
+
+/**
+ * Run handlers until deadline (CLOCK_MONOTONIC, absolute)
+ * Returns 0 at the deadline, 1 if a handler called event_loop_wake(),
+ * -1 once the loop was stopped by a signal or event_loop_stop().
+ */
+int event_loop_run_until(const struct timespec *deadline);
+
+/**
+ * Make the current event_loop_run_until() return 1 after this dispatch round
+ */
+void event_loop_wake(void);
+
+/**
+ * Stop the loop as a signal would (clears *running)
+ */
+void event_loop_stop(void);
+
+/**
+ * Register a front end for the sample stream
+ */
+int event_loop_subscribe(sample_subscriber_t subscriber, void *arg);
+
+/**
+ * Deliver a sample to every subscriber in registration order
+ */
+void event_loop_publish(const monitor_sample_t *sample);
+
+/**
+ * Append the anomalies of an events_only sample to the sample a front end
+ * shows, dropping the oldest ones when it is full
+ */
+void monitor_sample_merge_events(monitor_sample_t *shown, const monitor_sample_t *events);
+
+#endif /* EVENT_LOOP_H */
@@ -0,0 +1,86 @@
+#ifndef FD_CACHE_H
+#define FD_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Descriptor value remembering that an optional file does not exist */
+#define FD_CACHE_MISSING (-2)
+
+/* Header every cached entry starts with */
+typedef struct {
+    uint32_t hash;
+    uint32_t last_used;          /* use_clock at the last fd_cache_touch() */
+    int in_use;                  /* 0 marks an empty slot */
+} fd_cache_entry_t;
+
+/* Open-addressing table of per-key descriptor handles (linear probing,
+ * backward-shift deletion). Used one per thread, like the procfs and
+ * cgroup caches built on it; entries move when the table grows or an
+ * entry is removed, so pointers are only valid until the next change. */
+typedef struct {
+    void *entries;
+    size_t entry_size;           /* sizeof the caller's entry type */
+    size_t initial_capacity;     /* Power of two */
+    size_t capacity;
+    size_t count;
+    uint32_t use_clock;
+} fd_cache_t;
+
+/* Closes the descriptors and frees what an entry owns */
+typedef void (*fd_cache_release_t)(void *entry);
+
+/* Compares an entry with a lookup key */
+typedef int (*fd_cache_match_t)(const void *entry, const void *key);
+
+#define FD_CACHE_INIT(type, initial) { NULL, sizeof(type), (initial), 0, 0, 0 }
+
+/**
+ * Raise the RLIMIT_NOFILE soft limit to the hard limit
+ * Caches keep several descriptors per key open.
+ */
+void fd_cache_raise_limit(void);
+
+/**
+ * Slot i of the table (0 <= i < capacity), used or not
+ */
+void *fd_cache_slot(const fd_cache_t *cache, size_t i);
+
+/**
+ * Entry with this hash for which match(entry, key) is non-zero, or NULL
+ */
+void *fd_cache_find(const fd_cache_t *cache, uint32_t hash, fd_cache_match_t match,
+                    const void *key);
+
+/**
+ * Claim a zeroed entry for hash, growing the table to keep the load
+ * factor below 1/2. Returns NULL when out of memory.
+ */
+void *fd_cache_insert(fd_cache_t *cache, uint32_t hash);
+
+/**
+ * Release an entry and close the gap it leaves in its probe chain
+ * A later entry may move into its slot.
+ */
+void fd_cache_remove(fd_cache_t *cache, void *entry, fd_cache_release_t release);
+
+/**
+ * Stamp an entry as used now, for fd_cache_evict_lru()
+ */
+void fd_cache_touch(fd_cache_t *cache, void *entry);
+
+/**
+ * Remove the least recently used half of the entries, sparing the one
+ * matching keep and anything used within the last min_age touches
+ * Returns the number of entries removed; entry pointers must be looked
+ * up again afterwards.
+ */
+int fd_cache_evict_lru(fd_cache_t *cache, fd_cache_match_t match, const void *keep,
+                       uint32_t min_age, fd_cache_release_t release);
+
+/**
+ * Release every entry and free the table
+ */
+void fd_cache_clear(fd_cache_t *cache, fd_cache_release_t release);
+
+#endif /* FD_CACHE_H */
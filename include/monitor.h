@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <time.h>
 #include <sys/types.h>
+#include "procfs.h"
+#include "sock_diag.h"
 
 /* CPU metrics structure */
 typedef struct {
@@ -15,6 +17,12 @@ typedef struct {
     long num_threads;                    /* Number of threads */
     uint64_t voluntary_ctxt_switches;    /* Voluntary context switches */
     uint64_t nonvoluntary_ctxt_switches; /* Involuntary context switches */
+    uint64_t cpu_time_ns;                /* Scheduler runtime in ns (0 if unknown) */
+    uint64_t runqueue_wait_ns;           /* Time spent waiting for a CPU */
+    uint64_t timeslices;                 /* Times scheduled on a CPU */
+    int has_delays;                      /* blkio/swap-in delays measured (taskstats) */
+    uint64_t blkio_delay_ns;             /* Time blocked on synchronous block I/O */
+    uint64_t swapin_delay_ns;            /* Time blocked on swap-in */
     double cpu_percent;                  /* CPU usage percentage */
     struct timespec timestamp;           /* Collection timestamp */
 } cpu_metrics_t;
@@ -34,6 +42,22 @@ typedef struct {
     struct timespec timestamp;
 } memory_metrics_t;
 
+/* /proc/[pid]/smaps_rollup totals in KB; costly, the kernel walks every mapping */
+typedef struct {
+    pid_t pid;
+    uint64_t rss;
+    uint64_t pss;          /* Proportional set size */
+    uint64_t pss_anon;
+    uint64_t pss_file;
+    uint64_t shared_clean;
+    uint64_t shared_dirty;
+    uint64_t private_clean;
+    uint64_t private_dirty;
+    uint64_t swap;
+    uint64_t swap_pss;
+    struct timespec timestamp;
+} memory_smaps_t;
+
 /* I/O metrics structure */
 typedef struct {
     pid_t pid;
@@ -49,18 +73,34 @@ typedef struct {
     struct timespec timestamp;
 } io_metrics_t;
 
-/* Network metrics structure */
+/* Where interface counters come from */
+typedef enum {
+    NETWORK_SOURCE_PROCFS = 0,   /* /proc/[pid]/net/dev of each namespace */
+    NETWORK_SOURCE_VETH          /* Host-side veth peers, one RTM_GETLINK dump per tick */
+} network_source_t;
+
+/* Network metrics structure: totals over the non-loopback interfaces of
+ * the process's network namespace */
 typedef struct {
     pid_t pid;
-    char interface[32];
+    ino_t netns;           /* Network namespace inode */
+    char interface[32];    /* First non-loopback interface (host-side peer with veth) */
+    int interface_count;   /* Non-loopback interfaces summed below */
+    int host_side;         /* Counters from host-side veth peers, rx/tx turned around */
     uint64_t rx_bytes;
     uint64_t tx_bytes;
     uint64_t rx_packets;
     uint64_t tx_packets;
     uint64_t rx_errors;
     uint64_t tx_errors;
-    int tcp_connections;
-    int udp_connections;
+    uint64_t rx_dropped;
+    uint64_t tx_dropped;
+    double rx_rate;        /* Receive rate in bytes/sec */
+    double tx_rate;        /* Transmit rate in bytes/sec */
+    int tcp_connections;   /* Established TCP sockets (IPv4 + IPv6) */
+    int udp_connections;   /* UDP sockets (IPv4 + IPv6) */
+    int has_sockets;       /* sockets below came from NETLINK_SOCK_DIAG */
+    sock_counts_t sockets; /* Per-state counts and full listeners */
     struct timespec timestamp;
 } network_metrics_t;
 
@@ -68,6 +108,7 @@ typedef struct {
 int cpu_monitor_init(void);
 void cpu_monitor_cleanup(void);
 int cpu_monitor_collect(pid_t pid, cpu_metrics_t *metrics);
+int cpu_monitor_from_snapshot(const proc_snapshot_t *snap, cpu_metrics_t *metrics);
 int cpu_monitor_calculate_percentage(const cpu_metrics_t *prev,
                                      const cpu_metrics_t *curr,
                                      cpu_metrics_t *result);
@@ -78,11 +119,14 @@ int get_system_clock_ticks(void);
 int memory_monitor_init(void);
 void memory_monitor_cleanup(void);
 int memory_monitor_collect(pid_t pid, memory_metrics_t *metrics);
+int memory_monitor_from_snapshot(const proc_snapshot_t *snap, memory_metrics_t *metrics);
+int memory_monitor_collect_smaps(pid_t pid, memory_smaps_t *smaps);
 
 /* I/O monitor functions */
 int io_monitor_init(void);
 void io_monitor_cleanup(void);
 int io_monitor_collect(pid_t pid, io_metrics_t *metrics);
+int io_monitor_from_snapshot(const proc_snapshot_t *snap, io_metrics_t *metrics);
 int io_monitor_calculate_rates(const io_metrics_t *prev,
                                const io_metrics_t *curr,
                                io_metrics_t *result);
@@ -91,6 +135,12 @@ int io_monitor_calculate_rates(const io_metrics_t *prev,
 int network_monitor_init(void);
 void network_monitor_cleanup(void);
 int network_monitor_collect(pid_t pid, network_metrics_t *metrics);
+int network_monitor_calculate_rates(const network_metrics_t *prev,
+                                    const network_metrics_t *curr,
+                                    network_metrics_t *result);
+void network_monitor_set_max_age(double seconds);
+int network_monitor_set_source(network_source_t source);
+int network_monitor_cached_count(void);
 int network_monitor_list_interfaces(char interfaces[][32], int max_interfaces, int *count);
 
 /* Export functions */
@@ -106,6 +156,7 @@ int export_network_metrics_csv(const network_metrics_t *metrics, const char *fil
 /* Print functions */
 void print_cpu_metrics(const cpu_metrics_t *metrics);
 void print_memory_metrics(const memory_metrics_t *metrics);
+void print_memory_smaps(const memory_smaps_t *smaps);
 void print_io_metrics(const io_metrics_t *metrics);
 void print_network_metrics(const network_metrics_t *metrics);
 
@@ -3,6 +3,7 @@
 
 #include "monitor.h"
 #include "anomaly.h"
+#include "event_loop.h"
 #include <sys/types.h>
 
 /**
@@ -17,9 +18,9 @@ int ncurses_ui_init(void);
 void ncurses_ui_cleanup(void);
 
 /**
- * Draw header with title and process info
+ * Draw header with title and process info (pid 0: title only)
  */
-void ncurses_ui_draw_header(const char *title, pid_t pid, int elapsed);
+void ncurses_ui_draw_header(const char *title, pid_t pid, double elapsed);
 
 /**
  * Draw CPU metrics at specified line
@@ -36,6 +37,17 @@ void ncurses_ui_draw_memory_metrics(const memory_metrics_t *mem, int line);
  */
 void ncurses_ui_draw_io_metrics(const io_metrics_t *io, int line);
 
+/**
+ * Draw cgroup CPU cores, throttling, memory and I/O rates at specified line
+ */
+void ncurses_ui_draw_cgroup_metrics(const cgroup_metrics_t *cgroup, const cgroup_rates_t *rates,
+                                    int line);
+
+/**
+ * Draw one io.stat device per line (up to max_rows) at specified line
+ */
+void ncurses_ui_draw_cgroup_devices(const cgroup_blkio_t *blkio, int line, int max_rows);
+
 /**
  * Draw anomaly alert at specified line
  */
@@ -67,4 +79,16 @@ void ncurses_ui_clear_metrics(void);
  */
 int ncurses_ui_check_quit(void);
 
+/**
+ * Drive the UI from the event loop
+ * Keys are read when stdin becomes readable ('q' stops the loop) and the
+ * screen is redrawn for every published sample.
+ */
+int ncurses_ui_attach(void);
+
+/**
+ * Draw one sample: header, metric panels, anomalies and status bar
+ */
+void ncurses_ui_draw_sample(const monitor_sample_t *sample, void *arg);
+
 #endif /* NCURSES_UI_H */
@@ -0,0 +1,62 @@
+#ifndef PIDWATCH_H
+#define PIDWATCH_H
+
+#include <time.h>
+#include <sys/types.h>
+
+#define PIDWATCH_MAX_EVENTS 64
+
+/* Exit notification for a watched process */
+typedef struct {
+    pid_t pid;
+    struct timespec exit_time;   /* CLOCK_MONOTONIC when the exit was delivered */
+} pidwatch_event_t;
+
+/**
+ * Create the epoll set holding one pidfd per watched process
+ */
+int pidwatch_init(void);
+
+/**
+ * Close every pidfd and the epoll set
+ */
+void pidwatch_cleanup(void);
+
+/**
+ * Start watching a process with pidfd_open()
+ * Also opens its cached /proc descriptors and verifies afterwards that the
+ * pidfd has not fired, so the cached files cannot belong to a reused PID.
+ * Returns 0 on success, -1 with errno set (ENOSYS without pidfd support,
+ * ESRCH if the process is gone).
+ */
+int pidwatch_add(pid_t pid);
+
+/**
+ * Stop watching a process
+ */
+int pidwatch_remove(pid_t pid);
+
+/**
+ * Wait up to timeout_ms for watched processes to exit
+ * Exited processes are removed from the watch set before returning.
+ * Returns number of events stored, 0 on timeout, -1 on error.
+ */
+int pidwatch_wait(int timeout_ms, pidwatch_event_t *events, int max_events);
+
+/**
+ * Returns 1 if the process is still running, 0 if it exited,
+ * -1 if it is not watched
+ */
+int pidwatch_is_alive(pid_t pid);
+
+/**
+ * Epoll descriptor of the watch set, readable when any process exits
+ */
+int pidwatch_get_fd(void);
+
+/**
+ * Number of watched processes
+ */
+int pidwatch_count(void);
+
+#endif /* PIDWATCH_H */
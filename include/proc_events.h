@@ -0,0 +1,120 @@
+#ifndef PROC_EVENTS_H
+#define PROC_EVENTS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include "taskstats_backend.h"
+
+#define PROC_EVENTS_MAX_BATCH 64
+
+/* Process lifecycle events from the netlink proc connector */
+typedef enum {
+    PROC_EVENT_TYPE_FORK = 0,    /* New process (thread creation is filtered out) */
+    PROC_EVENT_TYPE_EXEC,
+    PROC_EVENT_TYPE_EXIT,        /* Thread group leader exited */
+    PROC_EVENT_TYPE_OVERRUN      /* Socket buffer overflowed, events were lost */
+} proc_event_type_t;
+
+typedef struct {
+    proc_event_type_t type;
+    pid_t pid;                   /* Child (fork) or subject process (exec/exit) */
+    pid_t parent;                /* Parent process (fork/exit) */
+    uint32_t exit_code;          /* Wait status (exit only) */
+    struct timespec timestamp;   /* CLOCK_MONOTONIC at receipt */
+} proc_event_t;
+
+/* Aggregated metrics of one followed process tree for one interval */
+typedef struct {
+    pid_t root;                  /* Seed PID given with -p */
+    int processes;               /* Live members at sample time */
+    int forks;                   /* Members added since the previous sample */
+    int exits;                   /* Members removed since the previous sample */
+    int finals;                  /* Exits whose final accounting was captured */
+    long threads;
+    double cpu_percent;          /* Sum over members incl. exited ones, may exceed 100% */
+    uint64_t rss;                /* KB */
+    uint64_t read_bytes;         /* Storage bytes read during the interval */
+    uint64_t write_bytes;
+    double read_rate;            /* bytes/sec */
+    double write_rate;
+    struct timespec timestamp;
+} proc_tree_metrics_t;
+
+/**
+ * Subscribe to the proc connector (needs CAP_NET_ADMIN)
+ * Returns 0 on success, -1 with errno set.
+ */
+int proc_events_init(void);
+
+/**
+ * Unsubscribe and close the connector socket
+ */
+void proc_events_cleanup(void);
+
+/**
+ * Non-blocking connector socket, for poll()/epoll
+ */
+int proc_events_get_fd(void);
+
+/**
+ * Drain pending events without blocking
+ * Returns the number of events stored, 0 if none, -1 on error.
+ */
+int proc_events_read(proc_event_t *events, int max_events);
+
+/**
+ * Decode the connector messages of one received datagram
+ * Thread creation and non-leader exits are filtered out; every event gets
+ * the timestamp now. Returns the number of events stored.
+ */
+int proc_events_parse(const void *buffer, size_t len, const struct timespec *now,
+                      proc_event_t *events, int max_events);
+
+/**
+ * Initialize / release the followed tree set
+ */
+int proc_tree_init(void);
+void proc_tree_cleanup(void);
+
+/**
+ * Follow a seed PID and its current descendants
+ * Existing children are found through /proc/[pid]/task/[tid]/children.
+ */
+int proc_tree_add_root(pid_t pid);
+
+/**
+ * Update membership from one event
+ * An exit reads the member's final counters while it is still unreaped;
+ * the member is dropped at the next proc_tree_sample().
+ * Returns 1 if a member was added or removed, 0 otherwise.
+ */
+int proc_tree_handle_event(const proc_event_t *event);
+
+/**
+ * Fold a taskstats exit record into the tree of the exiting process
+ * Returns 1 if the record belonged to a member.
+ */
+int proc_tree_handle_exit_record(const task_accounting_t *record);
+
+/**
+ * Rebuild membership from the children files after lost events
+ */
+int proc_tree_resync(void);
+
+/**
+ * Live members across all trees / number of seeds
+ */
+int proc_tree_member_count(void);
+int proc_tree_root_count(void);
+
+/**
+ * Snapshot every member and aggregate per tree
+ * Returns the number of trees stored (one per seed).
+ */
+int proc_tree_sample(proc_tree_metrics_t *trees, int max_trees);
+
+void print_proc_tree_metrics(const proc_tree_metrics_t *metrics);
+int export_proc_tree_metrics_csv(const proc_tree_metrics_t *metrics, const char *filename, int append);
+
+#endif /* PROC_EVENTS_H */
@@ -0,0 +1,90 @@
+#ifndef PROC_SCANNER_H
+#define PROC_SCANNER_H
+
+#include <sys/types.h>
+#include "monitor.h"
+#include "namespace.h"
+
+#define PROC_SCAN_MAX_THREADS 64
+
+/* Data collected per task (PROC_SCAN_* flags) */
+#define PROC_SCAN_CPU       (1u << 0)
+#define PROC_SCAN_MEMORY    (1u << 1)
+#define PROC_SCAN_IO        (1u << 2)
+#define PROC_SCAN_NAMESPACE (1u << 3)
+#define PROC_SCAN_ALL       (PROC_SCAN_CPU | PROC_SCAN_MEMORY | PROC_SCAN_IO | PROC_SCAN_NAMESPACE)
+
+/* One process found by a scan */
+typedef struct {
+    pid_t pid;
+    char comm[PROCFS_COMM_LEN];
+    char state;
+    uint64_t starttime;                  /* Clock ticks since boot, detects PID reuse */
+    int has_io;                          /* io read succeeded */
+    cpu_metrics_t cpu;
+    memory_metrics_t memory;
+    io_metrics_t io;
+    ino_t ns_inodes[MAX_NS_TYPES];       /* Same order as namespace_report_t, 0 if unknown */
+} proc_scan_entry_t;
+
+/* Result of one scan, entries sorted by PID */
+typedef struct {
+    proc_scan_entry_t *entries;
+    int count;
+    int capacity;
+    int listed;                          /* PIDs returned by getdents64 */
+    int skipped;                         /* Live PIDs left out because a read failed */
+    int skip_errno;                      /* errno of one of the skipped reads */
+    double scan_ms;                      /* Wall time of the whole scan */
+    struct timespec timestamp;
+} proc_scan_result_t;
+
+/**
+ * Start the worker pool
+ * threads <= 0 uses one worker per online CPU.
+ */
+int proc_scanner_init(int threads);
+
+/**
+ * Stop the workers and close the /proc descriptor
+ */
+void proc_scanner_cleanup(void);
+
+/**
+ * Number of worker threads
+ */
+int proc_scanner_thread_count(void);
+
+/**
+ * List every PID in /proc with getdents64 on one cached descriptor
+ * *pids is grown as needed and may be reused between calls.
+ * Returns the number of PIDs, -1 on error.
+ */
+int proc_scanner_list_pids(pid_t **pids, int *capacity);
+
+/**
+ * Collect the flagged data for every process
+ * PIDs are sharded by value across the workers, so each worker keeps
+ * hitting its own procfs handle cache; the per-worker results are merged
+ * into result->entries. result may be reused between scans.
+ */
+int proc_scanner_scan(unsigned int flags, proc_scan_result_t *result);
+
+/**
+ * Fill cpu_percent / read_rate / write_rate of curr from the previous scan
+ */
+void proc_scanner_calculate_rates(const proc_scan_result_t *prev, proc_scan_result_t *curr);
+
+/**
+ * Release the entries of a result
+ */
+void proc_scan_result_free(proc_scan_result_t *result);
+
+/**
+ * Print the top_n processes by CPU usage
+ */
+void print_proc_scan_result(const proc_scan_result_t *result, int top_n);
+
+int export_proc_scan_csv(const proc_scan_result_t *result, const char *filename, int append);
+
+#endif /* PROC_SCANNER_H */
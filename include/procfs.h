@@ -0,0 +1,334 @@
+#ifndef PROCFS_H
+#define PROCFS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define PROCFS_BUFFER_SIZE 4096
+
+/* Per-PID procfs files kept open by the handle cache */
+typedef enum {
+    PROCFS_STAT = 0,     /* /proc/[pid]/stat */
+    PROCFS_STATUS,       /* /proc/[pid]/status */
+    PROCFS_IO,           /* /proc/[pid]/io */
+    PROCFS_SCHEDSTAT,    /* /proc/[pid]/schedstat */
+    PROCFS_SMAPS_ROLLUP, /* /proc/[pid]/smaps_rollup (walks every mapping) */
+    PROCFS_FD_DIR,       /* /proc/[pid]/fd directory, listed not read */
+    PROCFS_TASK_DIR,     /* /proc/[pid]/task directory, per-thread schedstat */
+    PROCFS_FILE_COUNT
+} procfs_file_t;
+
+/* Snapshot file selection masks */
+#define PROCFS_SNAP_STAT   (1u << PROCFS_STAT)
+#define PROCFS_SNAP_STATUS (1u << PROCFS_STATUS)
+#define PROCFS_SNAP_IO     (1u << PROCFS_IO)
+#define PROCFS_SNAP_SCHEDSTAT (1u << PROCFS_SCHEDSTAT)
+#define PROCFS_SNAP_ALL    (PROCFS_SNAP_STAT | PROCFS_SNAP_STATUS | PROCFS_SNAP_IO)
+#define PROCFS_SNAP_TASKSTATS (1u << 8)  /* Netlink taskstats reply, no text file */
+
+/* Source of the per-process CPU and I/O counters */
+typedef enum {
+    PROCFS_BACKEND_PROCFS = 0,   /* /proc/[pid]/{stat,status,io} */
+    PROCFS_BACKEND_TASKSTATS     /* TASKSTATS generic netlink, procfs fallback */
+} procfs_backend_t;
+
+/* Clock behind the procfs CPU counters */
+typedef enum {
+    PROCFS_CPU_CLOCK_TICKS = 0,  /* utime/stime from stat, USER_HZ resolution */
+    PROCFS_CPU_CLOCK_SCHEDSTAT   /* ns runtime from schedstat, ticks as fallback */
+} procfs_cpu_clock_t;
+
+/* How batched snapshots issue their reads */
+typedef enum {
+    PROCFS_IO_PREAD = 0,         /* One pread() per file */
+    PROCFS_IO_URING              /* One io_uring submission per batch of files */
+} procfs_io_mode_t;
+
+#define PROCFS_URING_ENTRIES 256 /* Reads per io_uring submission */
+
+#define PROCFS_COMM_LEN 64
+
+/* Layout of records returned by getdents64 (not exported by glibc headers) */
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Scheduler counters of a schedstat file, or their sum over threads */
+typedef struct {
+    uint64_t cpu_time_ns;        /* Runtime on a CPU */
+    uint64_t cpu_delay_ns;       /* Time spent waiting on a run queue */
+    uint64_t timeslices;
+} procfs_schedstat_t;
+
+/* One consistent read of a process's procfs files, shared by all collectors */
+typedef struct {
+    pid_t pid;
+    unsigned int files;          /* PROCFS_SNAP_* mask of files actually read */
+    int io_errno;                /* errno of a failed /proc/[pid]/io read */
+
+    /* /proc/[pid]/stat */
+    char comm[PROCFS_COMM_LEN];  /* Command name without parentheses */
+    char state;
+    pid_t ppid;
+    uint64_t minflt;
+    uint64_t majflt;
+    uint64_t utime;              /* Clock ticks */
+    uint64_t stime;
+    uint64_t cutime;
+    uint64_t cstime;
+    long num_threads;
+    uint64_t starttime;          /* Clock ticks since boot */
+
+    /* /proc/[pid]/status (KB) */
+    uint64_t vm_rss;
+    uint64_t vm_size;
+    uint64_t rss_shmem;
+    uint64_t vm_data;
+    uint64_t vm_stk;
+    uint64_t vm_exe;
+    uint64_t vm_swap;
+    uint64_t voluntary_ctxt_switches;
+    uint64_t nonvoluntary_ctxt_switches;
+
+    /* /proc/[pid]/io */
+    uint64_t rchar;
+    uint64_t wchar;
+    uint64_t syscr;
+    uint64_t syscw;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t cancelled_write_bytes;
+
+    /* TASKSTATS (ns); stat/io fields above are filled from the same reply.
+     * cpu_time_ns, cpu_delay_ns and timeslices also come from schedstat */
+    int taskstats_per_task;      /* Reply covered faults and I/O (single thread) */
+    uint64_t cpu_time_ns;        /* Scheduler runtime */
+    uint64_t cpu_delay_ns;       /* Time spent waiting on a run queue */
+    uint64_t timeslices;         /* Times scheduled on a CPU */
+    int has_delays;              /* blkio/swap-in delays below were accounted */
+    uint64_t blkio_delay_ns;
+    uint64_t swapin_delay_ns;
+
+    struct timespec timestamp;   /* CLOCK_MONOTONIC after the reads */
+} proc_snapshot_t;
+
+/* Table entry mapping a procfs key to a uint64_t field of an output struct */
+typedef struct {
+    const char *key;             /* Key without ':' separator, e.g. "VmRSS" */
+    uint8_t key_len;
+    uint16_t offset;             /* offsetof() of the uint64_t destination */
+} procfs_field_t;
+
+#define PROCFS_FIELD(name, type, member) \
+    { name, (uint8_t)(sizeof(name) - 1), (uint16_t)offsetof(type, member) }
+
+/* Table entry mapping a 1-based /proc/[pid]/stat field number to a struct member */
+typedef struct {
+    uint8_t index;               /* Field number as documented in proc(5) */
+    uint8_t size;                /* Destination size: 4 or 8 bytes */
+    uint16_t offset;
+} procfs_stat_field_t;
+
+#define PROCFS_STAT_FIELD(idx, type, member) \
+    { (uint8_t)(idx), (uint8_t)sizeof(((type *)0)->member), (uint16_t)offsetof(type, member) }
+
+/**
+ * Initialize the procfs handle cache
+ * Raises RLIMIT_NOFILE so that several files per PID can stay open. When
+ * an open still fails with EMFILE/ENFILE, the least recently used half of
+ * the calling thread's handles is closed and the open retried.
+ */
+int procfs_init(void);
+
+/**
+ * Close every cached descriptor owned by the calling thread
+ */
+void procfs_cleanup(void);
+
+/**
+ * Read a procfs file of a process into buffer (NUL-terminated)
+ * The file is opened on first use and re-read with pread() afterwards.
+ * Returns number of bytes read, or -1 with errno set. ESRCH/ENOENT mean
+ * the process has exited; its handle is dropped from the cache.
+ */
+ssize_t procfs_read(pid_t pid, procfs_file_t file, char *buffer, size_t size);
+
+/**
+ * Open the files in mask (PROCFS_SNAP_*) without reading them
+ * Failure to open /proc/[pid]/io or schedstat is ignored.
+ * Returns 0 on success, -1 with errno set.
+ */
+int procfs_open_files(pid_t pid, unsigned int files);
+
+/**
+ * Cached descriptor of a procfs file, opened on first use
+ * Returns the descriptor, or -1 with errno set. The descriptor stays owned
+ * by the cache.
+ */
+int procfs_get_fd(pid_t pid, procfs_file_t file);
+
+/**
+ * Keep every handle looked up after this call open until unpinned
+ * Descriptors queued on io_uring must outlive their reads, so eviction at
+ * the descriptor limit spares handles used since the pin.
+ */
+void procfs_pin_handles(void);
+void procfs_unpin_handles(void);
+
+/**
+ * Drop all cached descriptors for a process
+ */
+void procfs_forget(pid_t pid);
+
+/**
+ * Number of processes with cached handles in the calling thread
+ */
+int procfs_cached_count(void);
+
+/**
+ * List the numeric entries of /proc or /proc/[pid]/task with getdents64
+ * dirfd is rewound first so one descriptor can be reused across calls;
+ * *pids is grown as needed. Returns the number of IDs, -1 on error.
+ */
+int procfs_list_pids(int dirfd, pid_t **pids, int *capacity);
+
+/**
+ * Count the open file descriptors of a process
+ * Lists the cached /proc/[pid]/fd descriptor with getdents64.
+ * Returns the count, or -1 with errno set.
+ */
+int procfs_count_fds(pid_t pid);
+
+/**
+ * Scheduler counters of a whole process in ns
+ * A single-threaded process re-reads its cached schedstat. Otherwise
+ * /proc/[pid]/task is listed on its cached descriptor and every thread's
+ * schedstat is read relative to it; once a process has been summed it
+ * stays on that path, and threads that exited keep contributing their
+ * last reading so the totals never go backwards while the handle stays
+ * cached (runtime since that reading is lost). threads is num_threads
+ * from stat. Returns 0 or -1 with errno set.
+ */
+int procfs_read_schedstat(pid_t pid, long threads, procfs_schedstat_t *out);
+
+/**
+ * Returns 1 if errno value means the process is gone
+ */
+int procfs_is_gone_error(int err);
+
+/**
+ * Read the requested files of a process once and parse them
+ * Fails if the process is gone or stat/status cannot be read.
+ * A failed io read (usually EACCES) only clears PROCFS_SNAP_IO.
+ * PROCFS_SNAP_SCHEDSTAT is only honoured together with PROCFS_SNAP_STAT:
+ * num_threads decides between the process's schedstat and the sum over
+ * its threads (procfs_read_schedstat()).
+ * PROCFS_SNAP_TASKSTATS falls back to stat and status when netlink fails;
+ * a per-task reply also satisfies PROCFS_SNAP_IO and the fault counters.
+ */
+int proc_snapshot_take(pid_t pid, unsigned int files, proc_snapshot_t *snap);
+
+/**
+ * Snapshot many processes at once; errors[i] receives 0 or the errno of pids[i]
+ * Under PROCFS_IO_URING the stat, status and io reads of a whole batch go
+ * to the kernel in one io_uring_enter() into registered buffers; otherwise,
+ * and for taskstats snapshots, each PID goes through proc_snapshot_take().
+ * Cgroup files are not batched: the cgroup monitor and tree view read
+ * cpu.stat and memory.current every tick, but through cgroup_read_file()
+ * and their own worker threads, and the ring measured slower than pread
+ * on procfs.
+ * Returns the number of snapshots taken.
+ */
+int proc_snapshot_take_batch(const pid_t *pids, int count, unsigned int files,
+                             proc_snapshot_t *snaps, int *errors);
+
+/**
+ * Select how batched snapshots read (process-wide; rings are per thread)
+ * Returns -1 with errno set if io_uring is unavailable; pread stays active.
+ */
+int proc_snapshot_set_io_mode(procfs_io_mode_t mode);
+procfs_io_mode_t proc_snapshot_get_io_mode(void);
+
+/**
+ * Tear down the calling thread's io_uring ring
+ */
+void procfs_uring_cleanup(void);
+
+/**
+ * Select where snapshots requesting PROCFS_SNAP_TASKSTATS get their data
+ * Returns -1 if the taskstats family cannot be used (needs CAP_NET_ADMIN);
+ * the procfs backend stays active in that case. Warns when
+ * kernel.task_delayacct is 0: block I/O and swap-in delays are then
+ * reported as unavailable rather than as zero.
+ */
+int proc_snapshot_set_backend(procfs_backend_t backend);
+
+/**
+ * Backend in effect for the calling thread
+ * A thread whose taskstats queries fail falls back to procfs on its own;
+ * other threads keep the backend that was set.
+ */
+procfs_backend_t proc_snapshot_get_backend(void);
+
+/**
+ * Select the clock of procfs CPU counters (procfs backend only)
+ * Returns -1 if schedstat is not readable (CONFIG_SCHED_INFO off); ticks
+ * stay active in that case.
+ */
+int proc_snapshot_set_cpu_clock(procfs_cpu_clock_t clock);
+procfs_cpu_clock_t proc_snapshot_get_cpu_clock(void);
+
+/**
+ * Snapshot mask needed by the given collectors under the current backend
+ */
+unsigned int proc_snapshot_files_for(int cpu, int memory, int io);
+
+/**
+ * Parse raw file contents into a snapshot (used by proc_snapshot_take)
+ */
+int proc_snapshot_parse_stat(const char *buffer, proc_snapshot_t *snap);
+int proc_snapshot_parse_status(const char *buffer, proc_snapshot_t *snap);
+int proc_snapshot_parse_io(const char *buffer, proc_snapshot_t *snap);
+
+/**
+ * Fill the ns counters of a snapshot whose stat is already parsed
+ * Uses procfs_read_schedstat with snap->num_threads. Returns -1 only when
+ * the process is gone; other failures leave the tick counters in place.
+ */
+int proc_snapshot_read_schedstat(pid_t pid, proc_snapshot_t *snap);
+
+/**
+ * Decode an unsigned decimal at *cursor, skipping leading blanks
+ * Advances *cursor past the digits.
+ */
+uint64_t procfs_parse_u64(const char **cursor);
+
+/**
+ * Parse a schedstat file: "<run ns> <run-queue wait ns> <timeslices>"
+ * Returns -1 if the text does not end after the three counters.
+ */
+int procfs_parse_schedstat(const char *buffer, procfs_schedstat_t *out);
+
+/**
+ * Parse "key: value" or "key value" lines into out using a field table
+ * Stops as soon as every field in the table was found.
+ * Returns the number of fields found.
+ */
+int procfs_parse_kv(const char *buffer, const procfs_field_t *fields,
+                    int field_count, void *out);
+
+/**
+ * Parse space separated /proc/[pid]/stat fields after the comm field
+ * fields must be sorted by index; parsing stops after the last one.
+ * Returns the number of fields found.
+ */
+int procfs_parse_stat_fields(const char *after_comm, const procfs_stat_field_t *fields,
+                             int field_count, void *out);
+
+#endif /* PROCFS_H */
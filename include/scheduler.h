@@ -0,0 +1,61 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define SCHEDULER_MIN_INTERVAL 0.001   /* Seconds */
+
+/* Fixed-rate sampling clock on absolute CLOCK_MONOTONIC deadlines.
+ * Tick n is due at start + n * interval regardless of how long the
+ * previous collection took, so collection time never accumulates as drift. */
+typedef struct {
+    uint64_t interval_ns;
+    struct timespec start;
+    struct timespec grid;        /* Origin of the current interval's deadlines */
+    struct timespec deadline;    /* Deadline of the pending tick */
+    struct timespec last_tick;   /* Actual wake-up time of the last tick */
+    uint64_t slots;              /* Deadlines passed, fired or missed */
+    uint64_t ticks;              /* Ticks fired */
+    uint64_t missed;             /* Deadlines skipped because collection overran */
+    uint64_t retunes;            /* Interval changes by scheduler_set_interval() */
+    int64_t jitter_ns;           /* Last tick: wake-up time minus deadline */
+    int64_t max_jitter_ns;
+    double jitter_sum_ns;
+} sample_scheduler_t;
+
+/**
+ * Start the clock now; the first tick is due one interval later
+ * Returns -1 if interval is below SCHEDULER_MIN_INTERVAL.
+ */
+int scheduler_init(sample_scheduler_t *sched, double interval);
+
+/**
+ * Advance to the next deadline
+ * Deadlines that already passed while the previous tick was collected are
+ * counted as missed and skipped, keeping ticks aligned to the grid.
+ * Returns the number of deadlines skipped.
+ */
+int scheduler_next(sample_scheduler_t *sched);
+
+/**
+ * Change the interval from the tick just fired on
+ * The following deadlines are laid out from that tick's deadline, so
+ * earlier ticks keep their timestamps. Returns -1 below SCHEDULER_MIN_INTERVAL.
+ */
+int scheduler_set_interval(sample_scheduler_t *sched, double interval);
+
+/**
+ * Record the wake-up of the pending tick
+ * Call once event_loop_run_until(&sched->deadline) returns 0.
+ */
+void scheduler_tick(sample_scheduler_t *sched);
+
+/**
+ * Scheduled time of the pending tick, in seconds since the start
+ */
+double scheduler_elapsed(const sample_scheduler_t *sched);
+
+void print_scheduler_stats(const sample_scheduler_t *sched);
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,62 @@
+#ifndef SOCK_DIAG_H
+#define SOCK_DIAG_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define SOCK_DIAG_TCP_STATES 13          /* TCP_ESTABLISHED (1) .. TCP_NEW_SYN_RECV (12) */
+#define SOCK_DIAG_MAX_FULL_LISTENERS 4
+
+/* Kernel TCP states used as tcp_states[] indices */
+#define SOCK_TCP_ESTABLISHED 1
+#define SOCK_TCP_TIME_WAIT 6
+#define SOCK_TCP_LISTEN 10
+
+/* A listener whose accept queue is at its backlog */
+typedef struct {
+    uint16_t port;
+    uint32_t inode;              /* Socket inode, for sock_diag_find_owner() */
+    uint32_t queued;             /* Connections waiting for accept() */
+    uint32_t backlog;
+} sock_listener_t;
+
+/* Socket counts of one network namespace from NETLINK_SOCK_DIAG dumps */
+typedef struct {
+    int tcp_states[SOCK_DIAG_TCP_STATES];  /* TCP + TCPv6 sockets per state */
+    int udp_sockets;                       /* UDP + UDPv6 sockets */
+    int listen_full;                       /* Listeners with a full accept queue */
+    int full_count;                        /* Entries in full[] */
+    sock_listener_t full[SOCK_DIAG_MAX_FULL_LISTENERS];
+} sock_counts_t;
+
+/**
+ * Open a NETLINK_SOCK_DIAG socket in the network namespace of pid
+ * pid 0, or a PID in the caller's namespace, opens one directly; other
+ * namespaces are entered with setns() by a short-lived helper thread
+ * (needs CAP_SYS_ADMIN), so the caller never leaves its own namespace.
+ * The socket stays bound to that namespace. Returns the descriptor, or
+ * -1 with errno set.
+ */
+int sock_diag_open(pid_t pid);
+
+/**
+ * Count the TCP and UDP sockets (IPv4 and IPv6) of the socket's namespace
+ * Returns 0 on success, -1 with errno set.
+ */
+int sock_diag_count(int fd, sock_counts_t *counts);
+
+/**
+ * Find a process holding the socket with this inode
+ * Looks through hint's descriptors first, then the owner remembered for
+ * the inode, and searches every process only when neither holds it; the
+ * result, found or not, is remembered per thread for the next call.
+ * Returns the PID, or -1 if no process was found.
+ */
+pid_t sock_diag_find_owner(uint32_t inode, pid_t hint);
+
+/**
+ * Name of a TCP state ("ESTABLISHED", "TIME_WAIT", ...)
+ */
+const char *sock_diag_state_name(int state);
+
+#endif /* SOCK_DIAG_H */
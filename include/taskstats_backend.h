@@ -0,0 +1,109 @@
+#ifndef TASKSTATS_BACKEND_H
+#define TASKSTATS_BACKEND_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Accounting record decoded from one TASKSTATS generic-netlink reply */
+typedef struct {
+    pid_t pid;                   /* PID or TGID the record describes */
+    pid_t tgid;                  /* Thread group of the task */
+    int is_tgid;                 /* 1 if aggregated over the thread group */
+    uint32_t exit_code;
+
+    /* CPU */
+    uint64_t utime_us;           /* User CPU time in microseconds */
+    uint64_t stime_us;           /* System CPU time in microseconds */
+    uint64_t cpu_time_ns;        /* Scheduler runtime (sum_exec_runtime) in ns */
+    uint64_t nvcsw;              /* Voluntary context switches */
+    uint64_t nivcsw;             /* Involuntary context switches */
+
+    /* Delay accounting */
+    uint64_t cpu_count;          /* Times scheduled on a CPU */
+    uint64_t cpu_delay_ns;       /* Time waiting on a run queue */
+    uint64_t blkio_count;
+    uint64_t blkio_delay_ns;     /* Time waiting for block I/O */
+    uint64_t swapin_count;
+    uint64_t swapin_delay_ns;    /* Time waiting for swap-in */
+
+    /* Memory (per-task replies only) */
+    uint64_t minflt;
+    uint64_t majflt;
+    uint64_t hiwater_rss_kb;
+
+    /* I/O (per-task replies only) */
+    int has_io;
+    uint64_t read_char;
+    uint64_t write_char;
+    uint64_t read_syscalls;
+    uint64_t write_syscalls;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t cancelled_write_bytes;
+} task_accounting_t;
+
+/**
+ * Open the generic-netlink socket and resolve the TASKSTATS family
+ * Returns 0 if taskstats is usable, -1 otherwise (errno set).
+ */
+int taskstats_init(void);
+
+/**
+ * Close the calling thread's netlink socket
+ */
+void taskstats_cleanup(void);
+
+/**
+ * Returns 1 if the TASKSTATS family was resolved
+ */
+int taskstats_is_available(void);
+
+/**
+ * Query accounting aggregated over a thread group (CPU, context
+ * switches and delays; no I/O or page faults)
+ */
+int taskstats_query_tgid(pid_t tgid, task_accounting_t *acct);
+
+/**
+ * Query accounting of a single task (adds I/O and page faults)
+ */
+int taskstats_query_pid(pid_t pid, task_accounting_t *acct);
+
+/**
+ * Decode a TASKSTATS netlink message (reply or exit notification)
+ * Returns 0 if a stats record was found.
+ */
+int taskstats_parse_message(const void *msg, size_t len, task_accounting_t *acct);
+
+/**
+ * Decode every record of a message; an exit notification carries the
+ * task's record and, when the last thread of a group exits, the group's
+ * Returns the number of records stored.
+ */
+int taskstats_parse_records(const void *msg, size_t len, task_accounting_t *records,
+                            int max_records);
+
+/**
+ * Register for exit records of tasks on every possible CPU
+ * Uses its own non-blocking socket. Returns 0 on success, -1 with errno set.
+ */
+int taskstats_exit_listen(void);
+
+/**
+ * Deregister and close the exit socket
+ */
+void taskstats_exit_cleanup(void);
+
+/**
+ * Exit socket descriptor for poll(), -1 if not listening
+ */
+int taskstats_exit_get_fd(void);
+
+/**
+ * Drain pending exit records without blocking
+ * *lost is set when the socket overflowed and records were dropped.
+ * Returns the number of records stored, -1 on error.
+ */
+int taskstats_exit_read(task_accounting_t *records, int max_records, int *lost);
+
+#endif /* TASKSTATS_BACKEND_H */
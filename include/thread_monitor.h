@@ -0,0 +1,70 @@
+#ifndef THREAD_MONITOR_H
+#define THREAD_MONITOR_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include "procfs.h"
+
+#define THREAD_MONITOR_MAX_PROCESSES 64
+#define THREAD_MONITOR_DEFAULT_TOP 10
+
+/* CPU usage of one thread over the last interval */
+typedef struct {
+    pid_t tid;
+    char comm[PROCFS_COMM_LEN];
+    char state;
+    uint64_t utime;                      /* Clock ticks */
+    uint64_t stime;
+    uint64_t cpu_time_ns;                /* Scheduler runtime, with --cpu-clock schedstat */
+    uint64_t voluntary_ctxt_switches;
+    uint64_t nonvoluntary_ctxt_switches;
+    double cpu_percent;
+    double voluntary_rate;               /* Switches/sec */
+    double nonvoluntary_rate;
+} thread_metrics_t;
+
+/* All threads of one process for one interval */
+typedef struct {
+    pid_t pid;
+    int count;
+    int created;                         /* Threads that appeared since the previous collect */
+    int exited;                          /* Threads that disappeared */
+    const thread_metrics_t *threads;     /* Sorted by TID, valid until the next collect */
+    struct timespec timestamp;
+} thread_sample_t;
+
+/**
+ * Initialize / release the per-process TID tables
+ */
+int thread_monitor_init(void);
+void thread_monitor_cleanup(void);
+
+/**
+ * Read every thread of a process and compute rates since the previous call
+ * The TID table is updated incrementally: /proc/[pid]/task is listed with
+ * getdents64 on a cached descriptor, and only threads that appeared since
+ * the previous call open their stat and status files (and schedstat, which
+ * CPU% is computed from under --cpu-clock schedstat). A thread whose files
+ * fail to open or read for any reason other than exiting is kept, with
+ * rates 0, and retried on the next call. The first call for a PID only
+ * records a baseline (all rates 0).
+ * Returns 0 on success, -1 with errno set (ESRCH once the process is gone).
+ */
+int thread_monitor_collect(pid_t pid, thread_sample_t *sample);
+
+/**
+ * Stop tracking a process and close its descriptors
+ */
+void thread_monitor_forget(pid_t pid);
+
+/**
+ * Copy the max busiest threads into top, highest CPU first
+ * Returns the number of threads stored.
+ */
+int thread_monitor_top(const thread_sample_t *sample, thread_metrics_t *top, int max);
+
+void print_thread_sample(const thread_sample_t *sample, int top_n);
+int export_thread_sample_csv(const thread_sample_t *sample, const char *filename, int append);
+
+#endif /* THREAD_MONITOR_H */
@@ -0,0 +1,71 @@
+#ifndef VETH_STATS_H
+#define VETH_STATS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <net/if.h>
+
+#define VETH_NSID_NONE (-1)              /* Namespace has no id in the host */
+
+/* One host interface from an RTM_GETLINK dump */
+typedef struct {
+    int ifindex;
+    char name[IF_NAMESIZE];
+    int link_nsid;               /* Namespace of the peer, VETH_NSID_NONE if local */
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+    uint64_t rx_packets;
+    uint64_t tx_packets;
+    uint64_t rx_errors;
+    uint64_t tx_errors;
+    uint64_t rx_dropped;
+    uint64_t tx_dropped;
+} veth_link_t;
+
+/* Traffic of one container namespace as seen from its host-side peers,
+ * already turned around: the host side's tx is the container's rx */
+typedef struct {
+    int links;                   /* Host interfaces whose peer is in the namespace */
+    char first[IF_NAMESIZE];     /* Name of the first of them */
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+    uint64_t rx_packets;
+    uint64_t tx_packets;
+    uint64_t rx_errors;
+    uint64_t tx_errors;
+    uint64_t rx_dropped;
+    uint64_t tx_dropped;
+    struct timespec timestamp;   /* Time of the dump */
+} veth_totals_t;
+
+/**
+ * Open the NETLINK_ROUTE socket in the monitor's namespace
+ */
+int veth_stats_init(void);
+void veth_stats_cleanup(void);
+
+/**
+ * Dump every host interface with its 64-bit counters in one RTM_GETLINK
+ * Returns the number of interfaces, or -1 with errno set.
+ */
+int veth_stats_refresh(void);
+
+/**
+ * Id the host assigned to the network namespace of pid (RTM_GETNSID)
+ * Returns the id, VETH_NSID_NONE if none is assigned, or -2 on error.
+ */
+int veth_stats_nsid(pid_t pid);
+
+/**
+ * Sum the interfaces of the last dump whose peer lives in namespace nsid
+ * Returns 0 if at least one was found, -1 otherwise.
+ */
+int veth_stats_totals(int nsid, veth_totals_t *totals);
+
+/**
+ * Interfaces in the last dump
+ */
+int veth_stats_links(const veth_link_t **links);
+
+#endif /* VETH_STATS_H */
@@ -3,11 +3,13 @@
 
 #include "monitor.h"
 #include "anomaly.h"
+#include "event_loop.h"
 #include <sys/types.h>
 
 #define WEB_DEFAULT_PORT 8080
 #define WEB_MAX_CLIENTS 10
-#define WEB_BUFFER_SIZE 8192
+#define WEB_BUFFER_SIZE 16384
+#define WEB_SEND_TIMEOUT_MS 1000
 
 /**
  * Web dashboard configuration
@@ -15,42 +17,43 @@
 typedef struct {
     int port;
     pid_t monitored_pid;
-    int interval;
-    int enable_anomaly;
-    volatile int *running;
+    const char *cgroup_path;     /* Set when a cgroup (-g) is monitored instead */
 } web_config_t;
 
 /**
  * Initialize web dashboard server
- * Returns server socket fd on success, -1 on failure
+ * Returns non-blocking server socket fd on success, -1 on failure
  */
 int web_dashboard_init(int port);
 
 /**
- * Start web dashboard server (blocking)
- * Runs in main thread and serves HTTP requests
+ * Serve the dashboard from the event loop
+ * The listening socket and its clients are handled by event_loop handlers;
+ * /api/metrics answers from the latest published sample, so requests
+ * never trigger collection.
  */
-int web_dashboard_start(web_config_t *config);
+int web_dashboard_attach(const web_config_t *config);
 
 /**
- * Cleanup and close web dashboard
+ * Close the listening socket and any open clients
  */
-void web_dashboard_cleanup(int server_fd);
+void web_dashboard_cleanup(void);
 
 /**
- * Generate JSON response with current metrics
+ * Generate JSON response for one sample
+ * Cgroup samples carry a "cgroup" object instead of "cpu", "memory" and "io".
  */
-int web_generate_metrics_json(pid_t pid, char *buffer, size_t buffer_size,
-                              int enable_anomaly, anomaly_detector_t *detector);
+int web_generate_metrics_json(const monitor_sample_t *sample, char *buffer, size_t buffer_size);
 
 /**
- * Generate HTML dashboard page
+ * Generate HTML dashboard page for the monitored PID or cgroup
  */
-int web_generate_html(char *buffer, size_t buffer_size, pid_t pid);
+int web_generate_html(char *buffer, size_t buffer_size, const web_config_t *config);
 
 /**
  * Handle HTTP request
+ * Returns 0 once the whole response is sent, -1 if it could not be built or sent.
  */
-int web_handle_request(int client_fd, const char *request, web_config_t *config);
+int web_handle_request(int client_fd, const char *request, const web_config_t *config);
 
 #endif /* WEB_DASHBOARD_H */
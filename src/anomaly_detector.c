@@ -101,12 +101,86 @@ void anomaly_detector_update_io(anomaly_detector_t *detector, double read_rate,
     update_stats(&detector->io_write_stats, write_rate);
 }
 
+/* Next slot of the pending queue, dropping the oldest event when full */
+static anomaly_event_t *queue_event(anomaly_detector_t *detector) {
+    if (detector->pending_count == ANOMALY_MAX_PENDING) {
+        memmove(&detector->pending[0], &detector->pending[1],
+                (ANOMALY_MAX_PENDING - 1) * sizeof(anomaly_event_t));
+        detector->pending_count--;
+    }
+    anomaly_event_t *evt = &detector->pending[detector->pending_count++];
+    memset(evt, 0, sizeof(anomaly_event_t));
+    evt->detected_at = time(NULL);
+    return evt;
+}
+
+void anomaly_detector_report(anomaly_detector_t *detector, anomaly_type_t type,
+                             anomaly_severity_t severity, double value,
+                             const char *description) {
+    if (!detector || !detector->initialized || !description) {
+        return;
+    }
+
+    anomaly_event_t *evt = queue_event(detector);
+    evt->type = type;
+    evt->severity = severity;
+    evt->value = value;
+    snprintf(evt->description, sizeof(evt->description), "%s", description);
+}
+
+void anomaly_detector_report_pressure(anomaly_detector_t *detector, anomaly_type_t type,
+                                      double avg10, uint32_t stall_us, uint32_t window_us) {
+    if (!detector || !detector->initialized || window_us == 0) {
+        return;
+    }
+
+    anomaly_event_t *evt = queue_event(detector);
+
+    /* The trigger threshold as a share of the window is what the 10s
+     * average is compared with; a short burst can fire it while avg10
+     * still trails below */
+    double threshold = 100.0 * stall_us / window_us;
+    const char *resource = (type == ANOMALY_CPU_PRESSURE) ? "CPU" :
+                           (type == ANOMALY_MEMORY_PRESSURE) ? "Memory" : "I/O";
+    evt->type = type;
+    evt->value = avg10;
+    evt->expected_mean = threshold;
+    evt->deviation_sigma = 0.0;
+    snprintf(evt->description, sizeof(evt->description),
+             "%s pressure: %.0f ms stalled within %.0f ms (avg10 %.2f%%)",
+             resource, stall_us / 1000.0, window_us / 1000.0, avg10);
+
+    if (avg10 >= 4.0 * threshold) {
+        evt->severity = SEVERITY_CRITICAL;
+    } else if (avg10 >= 2.0 * threshold) {
+        evt->severity = SEVERITY_HIGH;
+    } else if (avg10 >= threshold) {
+        evt->severity = SEVERITY_MEDIUM;
+    } else {
+        evt->severity = SEVERITY_LOW;
+    }
+}
+
+int anomaly_detector_take_events(anomaly_detector_t *detector, anomaly_event_t *events,
+                                 int max_events) {
+    if (!detector || !detector->initialized || !events || max_events <= 0) {
+        return 0;
+    }
+
+    int count = detector->pending_count < max_events ? detector->pending_count : max_events;
+    memcpy(events, detector->pending, count * sizeof(anomaly_event_t));
+    memmove(&detector->pending[0], &detector->pending[count],
+            (detector->pending_count - count) * sizeof(anomaly_event_t));
+    detector->pending_count -= count;
+    return count;
+}
+
 int anomaly_detector_check(anomaly_detector_t *detector, anomaly_event_t *events, int max_events) {
     if (!detector || !detector->initialized || !events || max_events <= 0) {
         return 0;
     }
 
-    int event_count = 0;
+    int event_count = anomaly_detector_take_events(detector, events, max_events);
     double sigma;
 
     /* Check CPU anomalies */
@@ -369,3 +443,68 @@ void anomaly_detector_cleanup(anomaly_detector_t *detector) {
 
     memset(detector, 0, sizeof(anomaly_detector_t));
 }
+
+/* Change of the newest sample and spread of the last ADAPTIVE_WINDOW
+ * samples, relative to their level; abs_floor keeps near-zero metrics
+ * from turning noise into volatility */
+static double recent_volatility(const metric_stats_t *stats, double relative, double abs_floor) {
+    if (stats->count < 2) {
+        return 0.0;
+    }
+
+    int window = stats->count < ADAPTIVE_WINDOW ? stats->count : ADAPTIVE_WINDOW;
+    double values[ADAPTIVE_WINDOW];
+    double sum = 0.0;
+    for (int i = 0; i < window; i++) {
+        values[i] = stats->samples[(stats->index - 1 - i + 2 * MAX_SAMPLES) % MAX_SAMPLES];
+        sum += values[i];
+    }
+    double mean = sum / window;
+
+    double variance = 0.0;
+    for (int i = 0; i < window; i++) {
+        variance += (values[i] - mean) * (values[i] - mean);
+    }
+    double stddev = sqrt(variance / window);
+    double change = fabs(values[0] - values[1]);
+
+    double scale = fabs(mean) * relative + abs_floor;
+    return (change > stddev ? change : stddev) / scale;
+}
+
+int adaptive_rate_init(adaptive_rate_t *rate, double floor, double ceiling, double initial) {
+    if (!rate || floor <= 0.0 || ceiling < floor) {
+        return -1;
+    }
+
+    memset(rate, 0, sizeof(adaptive_rate_t));
+    rate->floor = floor;
+    rate->ceiling = ceiling;
+    rate->interval = initial < floor ? floor : (initial > ceiling ? ceiling : initial);
+    return 0;
+}
+
+double adaptive_rate_update(adaptive_rate_t *rate, double cpu_percent,
+                            double rss_kb, double io_rate) {
+    update_stats(&rate->cpu_stats, cpu_percent);
+    update_stats(&rate->memory_stats, rss_kb);
+    update_stats(&rate->io_stats, io_rate);
+
+    /* CPU moves in percentage points; memory and I/O relative to their level */
+    double score = recent_volatility(&rate->cpu_stats, 0.1, 2.0);
+    double memory = recent_volatility(&rate->memory_stats, 0.02, 1024.0);
+    double io = recent_volatility(&rate->io_stats, 0.25, 65536.0);
+    if (memory > score) score = memory;
+    if (io > score) score = io;
+    rate->score = score;
+
+    if (score >= ADAPTIVE_TIGHTEN_SCORE) {
+        rate->interval = rate->floor;
+    } else if (score < ADAPTIVE_RELAX_SCORE) {
+        rate->interval *= ADAPTIVE_RELAX_FACTOR;
+        if (rate->interval > rate->ceiling) {
+            rate->interval = rate->ceiling;
+        }
+    }
+    return rate->interval;
+}
@@ -0,0 +1,260 @@
+#include "../include/cgroup_events.h"
+#include "../include/cgroup.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#define EVENT_FILES 4
+#define EVENT_FILE_SIZE 512
+#define EVENT_BATCH 16
+
+static const char *event_files[EVENT_FILES] = {
+    "memory.events", "memory.swap.events", "pids.events", "cgroup.events"
+};
+
+/* Keys reported from each file; anything else the kernel adds is ignored */
+static const struct {
+    int file;
+    const char *key;
+    cgroup_event_kind_t kind;
+    int is_state;
+} event_keys[] = {
+    { 0, "low",            CGROUP_EVENT_MEMORY_LOW,      0 },
+    { 0, "high",           CGROUP_EVENT_MEMORY_HIGH,     0 },
+    { 0, "max",            CGROUP_EVENT_MEMORY_MAX,      0 },
+    { 0, "oom",            CGROUP_EVENT_OOM,             0 },
+    { 0, "oom_kill",       CGROUP_EVENT_OOM_KILL,        0 },
+    { 0, "oom_group_kill", CGROUP_EVENT_OOM_GROUP_KILL,  0 },
+    { 1, "high",           CGROUP_EVENT_SWAP_HIGH,       0 },
+    { 1, "max",            CGROUP_EVENT_SWAP_MAX,        0 },
+    { 1, "fail",           CGROUP_EVENT_SWAP_FAIL,       0 },
+    { 2, "max",            CGROUP_EVENT_PIDS_MAX,        0 },
+    { 3, "populated",      CGROUP_EVENT_POPULATED,       1 },
+    { 3, "frozen",         CGROUP_EVENT_FROZEN,          1 },
+};
+#define EVENT_KEYS ((int)(sizeof(event_keys) / sizeof(event_keys[0])))
+#define MAX_KEYS_PER_FILE 6
+
+static const char *event_names[CGROUP_EVENT_KINDS] = {
+    "memory.low", "memory.high", "memory.max", "oom", "oom_kill", "oom_group_kill",
+    "swap.high", "swap.max", "swap.fail", "pids.max", "populated", "frozen"
+};
+
+/* Watched cgroup and one descriptor per event file (-1 if absent) */
+typedef struct {
+    int in_use;
+    char path[MAX_CGROUP_PATH];
+    int fds[EVENT_FILES];
+    uint64_t last[CGROUP_EVENT_KINDS];
+} event_watch_t;
+
+static int epoll_fd = -1;
+static event_watch_t watches[CGROUP_EVENTS_MAX_WATCHED];
+
+const char *cgroup_event_name(cgroup_event_kind_t kind) {
+    if (kind < 0 || kind >= CGROUP_EVENT_KINDS) {
+        return "unknown";
+    }
+    return event_names[kind];
+}
+
+int cgroup_events_init(void) {
+    if (epoll_fd >= 0) {
+        return 0;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        fprintf(stderr, "Failed to create epoll set: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void cgroup_events_cleanup(void) {
+    for (int w = 0; w < CGROUP_EVENTS_MAX_WATCHED; w++) {
+        if (watches[w].in_use) {
+            cgroup_events_unwatch(w);
+        }
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+}
+
+/* Read one event file; the read also clears the kernel's change flag */
+static int read_event_file(int fd, uint64_t values[CGROUP_EVENT_KINDS], int file) {
+    char buffer[EVENT_FILE_SIZE];
+    ssize_t n = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (n < 0) {
+        return -1;
+    }
+    buffer[n] = '\0';
+
+    char *saveptr;
+    for (char *line = strtok_r(buffer, "\n", &saveptr); line;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+        char key[32];
+        unsigned long long value;
+        if (sscanf(line, "%31s %llu", key, &value) != 2) {
+            continue;
+        }
+        for (int k = 0; k < EVENT_KEYS; k++) {
+            if (event_keys[k].file == file && strcmp(event_keys[k].key, key) == 0) {
+                values[event_keys[k].kind] = value;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+int cgroup_events_watch(const char *cgroup_path) {
+    if (!cgroup_path) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (epoll_fd < 0 && cgroup_events_init() != 0) {
+        return -1;
+    }
+
+    int w = 0;
+    while (w < CGROUP_EVENTS_MAX_WATCHED && watches[w].in_use) {
+        w++;
+    }
+    if (w == CGROUP_EVENTS_MAX_WATCHED) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    event_watch_t *watch = &watches[w];
+    memset(watch, 0, sizeof(event_watch_t));
+    snprintf(watch->path, sizeof(watch->path), "%s", cgroup_path);
+
+    int opened = 0;
+    for (int f = 0; f < EVENT_FILES; f++) {
+        char path[MAX_CGROUP_PATH + 64];
+        snprintf(path, sizeof(path), "%s/%s/%s", cgroup_get_mount_point(), cgroup_path,
+                 event_files[f]);
+        watch->fds[f] = open(path, O_RDONLY | O_CLOEXEC);
+        if (watch->fds[f] < 0) {
+            continue;
+        }
+
+        /* Level-triggered: a file left unread stays flagged */
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLPRI;
+        ev.data.u64 = ((uint64_t)w << 8) | (uint64_t)f;
+        if (read_event_file(watch->fds[f], watch->last, f) != 0 ||
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, watch->fds[f], &ev) != 0) {
+            close(watch->fds[f]);
+            watch->fds[f] = -1;
+            continue;
+        }
+        opened++;
+    }
+
+    if (opened == 0) {
+        errno = ENOENT;
+        return -1;
+    }
+    watch->in_use = 1;
+    return w;
+}
+
+int cgroup_events_unwatch(int w) {
+    if (w < 0 || w >= CGROUP_EVENTS_MAX_WATCHED || !watches[w].in_use) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    for (int f = 0; f < EVENT_FILES; f++) {
+        if (watches[w].fds[f] >= 0) {
+            if (epoll_fd >= 0) {
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, watches[w].fds[f], NULL);
+            }
+            close(watches[w].fds[f]);
+            watches[w].fds[f] = -1;
+        }
+    }
+    watches[w].in_use = 0;
+    return 0;
+}
+
+/* Compare a file's keys with the last values and store the changes */
+static int diff_file(int w, int file, const uint64_t values[CGROUP_EVENT_KINDS],
+                     const struct timespec *now, cgroup_event_t *events) {
+    event_watch_t *watch = &watches[w];
+    int count = 0;
+    for (int k = 0; k < EVENT_KEYS; k++) {
+        if (event_keys[k].file != file) {
+            continue;
+        }
+        cgroup_event_kind_t kind = event_keys[k].kind;
+        if (values[kind] == watch->last[kind]) {
+            continue;
+        }
+
+        cgroup_event_t *event = &events[count++];
+        event->watch = w;
+        event->kind = kind;
+        event->value = values[kind];
+        event->delta = (event_keys[k].is_state || values[kind] < watch->last[kind])
+                       ? 1 : values[kind] - watch->last[kind];
+        event->timestamp = *now;
+        watch->last[kind] = values[kind];
+    }
+    return count;
+}
+
+int cgroup_events_read(cgroup_event_t *events, int max_events) {
+    if (epoll_fd < 0 || !events || max_events <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct epoll_event ready[EVENT_BATCH];
+    int n = epoll_wait(epoll_fd, ready, EVENT_BATCH, 0);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    int count = 0;
+    for (int i = 0; i < n && max_events - count >= MAX_KEYS_PER_FILE; i++) {
+        int w = (int)(ready[i].data.u64 >> 8);
+        int f = (int)(ready[i].data.u64 & 0xff);
+        if (!watches[w].in_use || watches[w].fds[f] < 0) {
+            continue;
+        }
+
+        uint64_t values[CGROUP_EVENT_KINDS];
+        memcpy(values, watches[w].last, sizeof(values));
+        if (read_event_file(watches[w].fds[f], values, f) != 0) {
+            /* The cgroup was removed (ENODEV) */
+            cgroup_events_unwatch(w);
+            continue;
+        }
+        count += diff_file(w, f, values, &now, events + count);
+    }
+    return count;
+}
+
+int cgroup_events_get_fd(void) {
+    return epoll_fd;
+}
+
+const char *cgroup_events_path(int w) {
+    if (w < 0 || w >= CGROUP_EVENTS_MAX_WATCHED || !watches[w].in_use) {
+        return NULL;
+    }
+    return watches[w].path;
+}
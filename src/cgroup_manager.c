@@ -1,4 +1,5 @@
 #include "../include/cgroup.h"
+#include "../include/fd_cache.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,23 +8,142 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <time.h>
+#include <math.h>
+#include <stddef.h>
+
+#define CGROUP_INITIAL_CAPACITY 64
+#define CGROUP_STAT_SIZE 4096
+#define CGROUP_CONTROLLERS_SIZE 256
+
+static const char *psi_resource_names[CGROUP_PSI_RESOURCES] = { "cpu", "memory", "io" };
+
+static const char *cgroup_file_names[CGROUP_FILE_COUNT] = {
+    "cpu.stat", "cpu.max", "memory.current", "memory.max", "memory.stat", "memory.events",
+    "io.stat", "io.latency", "pids.current", "pids.max", "cpu.pressure", "memory.pressure",
+    "io.pressure"
+};
+
+/* Block devices of /proc/partitions, sorted by major:minor */
+typedef struct {
+    unsigned int major;
+    unsigned int minor;
+    char name[CGROUP_DEVICE_NAME];
+} device_name_t;
+
+static device_name_t *device_names = NULL;
+static int device_name_count = 0;
 
 static cgroup_version_t cgroup_version = CGROUP_V2;
 static char cgroup_mount[MAX_CGROUP_PATH] = "/sys/fs/cgroup";
+static int mount_fd = -1;
+
+/* Cached descriptors for one cgroup; FD_CACHE_MISSING marks a file the
+ * cgroup does not have (no such controller, or cpu.max at the root) */
+typedef struct {
+    fd_cache_entry_t entry;
+    char *path;                  /* Relative to the mount, without surrounding slashes */
+    size_t len;
+    int dirfd;
+    int fds[CGROUP_FILE_COUNT];
+    int controllers_fd;          /* cgroup.controllers, opened once a file is missing */
+    uint32_t controllers_hash;   /* Its contents when the missing marks were made */
+    time_t controllers_checked;  /* CLOCK_MONOTONIC second of the last comparison */
+} cgroup_handle_t;
+
+/* One table per thread, like the procfs handle cache */
+static _Thread_local fd_cache_t cache = FD_CACHE_INIT(cgroup_handle_t, CGROUP_INITIAL_CAPACITY);
+
+static int compare_devices(const void *a, const void *b) {
+    const device_name_t *x = a, *y = b;
+    if (x->major != y->major) {
+        return x->major < y->major ? -1 : 1;
+    }
+    return (x->minor > y->minor) - (x->minor < y->minor);
+}
+
+/* io.stat names devices by number only; resolve them once instead of
+ * per sample */
+static void load_device_names(void) {
+    free(device_names);
+    device_names = NULL;
+    device_name_count = 0;
+
+    FILE *fp = fopen("/proc/partitions", "r");
+    if (!fp) {
+        return;
+    }
+
+    int capacity = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        device_name_t device;
+        if (sscanf(line, "%u %u %*u %31s", &device.major, &device.minor, device.name) != 3) {
+            continue;
+        }
+        if (device_name_count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 32;
+            device_name_t *grown = realloc(device_names, new_capacity * sizeof(device_name_t));
+            if (!grown) {
+                break;
+            }
+            device_names = grown;
+            capacity = new_capacity;
+        }
+        device_names[device_name_count++] = device;
+    }
+    fclose(fp);
+
+    qsort(device_names, device_name_count, sizeof(device_name_t), compare_devices);
+}
+
+const char *cgroup_device_name(unsigned int major, unsigned int minor) {
+    device_name_t key = { .major = major, .minor = minor };
+    const device_name_t *device = bsearch(&key, device_names, device_name_count,
+                                          sizeof(device_name_t), compare_devices);
+    return device ? device->name : NULL;
+}
 
 int cgroup_init(void) {
     cgroup_version = cgroup_detect_version();
+    load_device_names();
+
+    /* Hybrid hosts mount the v2 hierarchy, and with it PSI, below the v1 ones */
+    struct stat st;
+    if (stat("/sys/fs/cgroup/cgroup.controllers", &st) != 0 &&
+        stat("/sys/fs/cgroup/unified/cgroup.controllers", &st) == 0) {
+        snprintf(cgroup_mount, sizeof(cgroup_mount), "/sys/fs/cgroup/unified");
+    }
+
+    /* A directory and a few files per cgroup stay open */
+    fd_cache_raise_limit();
+
+    if (mount_fd >= 0) {
+        close(mount_fd);
+    }
+    mount_fd = open(cgroup_mount, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (mount_fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", cgroup_mount, strerror(errno));
+        return -1;
+    }
     return 0;
 }
 
 void cgroup_cleanup(void) {
-    /* Nothing to clean up currently */
+    cgroup_cache_cleanup();
+    free(device_names);
+    device_names = NULL;
+    device_name_count = 0;
+    if (mount_fd >= 0) {
+        close(mount_fd);
+        mount_fd = -1;
+    }
 }
 
 cgroup_version_t cgroup_detect_version(void) {
-    /* Check if cgroup v2 is mounted */
+    /* Check if cgroup v2 is mounted, alone or next to v1 */
     struct stat st;
-    if (stat("/sys/fs/cgroup/cgroup.controllers", &st) == 0) {
+    if (stat("/sys/fs/cgroup/cgroup.controllers", &st) == 0 ||
+        stat("/sys/fs/cgroup/unified/cgroup.controllers", &st) == 0) {
         return CGROUP_V2;
     }
     return CGROUP_V1;
@@ -37,19 +157,256 @@ const char* cgroup_get_mount_point(void) {
     return cgroup_mount;
 }
 
-static int read_cgroup_file(const char *path, char *buffer, size_t size) {
-    FILE *fp = fopen(path, "r");
-    if (!fp) {
-        return -1;
+/* "/a/b/" and "a/b" name the same cgroup; "" is the root */
+static const char *trim_path(const char *path, size_t *len) {
+    path += strspn(path, "/");
+    size_t n = strlen(path);
+    while (n > 0 && path[n - 1] == '/') {
+        n--;
     }
+    *len = n;
+    return path;
+}
 
-    size_t bytes_read = fread(buffer, 1, size - 1, fp);
-    buffer[bytes_read] = '\0';
-    fclose(fp);
+static uint32_t hash_path(const char *path, size_t len) {
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)path[i]) * 16777619u;
+    }
+    return hash;
+}
 
+/* Lookup key: a trimmed path is not NUL-terminated */
+typedef struct {
+    const char *path;
+    size_t len;
+} path_key_t;
+
+static int match_path(const void *entry, const void *key) {
+    const cgroup_handle_t *handle = entry;
+    const path_key_t *k = key;
+    return handle->len == k->len && memcmp(handle->path, k->path, k->len) == 0;
+}
+
+static void close_handle(void *entry) {
+    cgroup_handle_t *handle = entry;
+    for (int i = 0; i < CGROUP_FILE_COUNT; i++) {
+        if (handle->fds[i] >= 0) {
+            close(handle->fds[i]);
+        }
+        handle->fds[i] = -1;
+    }
+    if (handle->controllers_fd >= 0) {
+        close(handle->controllers_fd);
+        handle->controllers_fd = -1;
+    }
+    if (handle->dirfd >= 0) {
+        close(handle->dirfd);
+        handle->dirfd = -1;
+    }
+    free(handle->path);
+    handle->path = NULL;
+}
+
+static cgroup_handle_t *find_handle(const char *path, size_t len, uint32_t hash) {
+    path_key_t key = { path, len };
+    return fd_cache_find(&cache, hash, match_path, &key);
+}
+
+static cgroup_handle_t *insert_handle(const char *path, size_t len, uint32_t hash) {
+    char *copy = strndup(path, len);
+    if (!copy) {
+        return NULL;
+    }
+    cgroup_handle_t *handle = fd_cache_insert(&cache, hash);
+    if (!handle) {
+        free(copy);
+        return NULL;
+    }
+
+    handle->path = copy;
+    handle->len = len;
+    handle->dirfd = -1;
+    handle->controllers_fd = -1;
+    for (int i = 0; i < CGROUP_FILE_COUNT; i++) {
+        handle->fds[i] = -1;
+    }
+    return handle;
+}
+
+static void remove_handle(cgroup_handle_t *handle) {
+    fd_cache_remove(&cache, handle, close_handle);
+}
+
+/* Hash of the cgroup's cgroup.controllers, 0 if it cannot be read (v1) */
+static uint32_t hash_controllers(cgroup_handle_t *handle) {
+    if (handle->controllers_fd < 0) {
+        handle->controllers_fd = openat(handle->dirfd, "cgroup.controllers",
+                                        O_RDONLY | O_CLOEXEC);
+        if (handle->controllers_fd < 0) {
+            return 0;
+        }
+    }
+    char buffer[CGROUP_CONTROLLERS_SIZE];
+    ssize_t len = pread(handle->controllers_fd, buffer, sizeof(buffer), 0);
+    return len >= 0 ? hash_path(buffer, (size_t)len) : 0;
+}
+
+/* Forget the missing marks once the controllers enabled for the cgroup
+ * have changed; compared at most once a second per handle */
+static int controllers_changed(cgroup_handle_t *handle) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    if (now.tv_sec == handle->controllers_checked) {
+        return 0;
+    }
+    handle->controllers_checked = now.tv_sec;
+
+    uint32_t hash = hash_controllers(handle);
+    if (hash == handle->controllers_hash) {
+        return 0;
+    }
+    handle->controllers_hash = hash;
+    for (int i = 0; i < CGROUP_FILE_COUNT; i++) {
+        if (handle->fds[i] == FD_CACHE_MISSING) {
+            handle->fds[i] = -1;
+        }
+    }
+    return 1;
+}
+
+/* Open the file relative to the cgroup directory, opening that first;
+ * a cgroup that does not exist is not kept in the cache */
+static int open_file(cgroup_handle_t *handle, cgroup_file_t file) {
+    if (handle->dirfd < 0) {
+        handle->dirfd = openat(mount_fd, handle->path[0] ? handle->path : ".",
+                               O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (handle->dirfd < 0) {
+            int saved_errno = errno;
+            remove_handle(handle);
+            errno = saved_errno;
+            return -1;
+        }
+    }
+
+    handle->fds[file] = openat(handle->dirfd, cgroup_file_names[file], O_RDONLY | O_CLOEXEC);
+    if (handle->fds[file] < 0) {
+        /* Remembered until the cgroup's controllers change, so optional
+         * files are not looked up again on every read */
+        if (errno == ENOENT) {
+            if (handle->controllers_fd < 0) {
+                handle->controllers_hash = hash_controllers(handle);
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+                handle->controllers_checked = now.tv_sec;
+            }
+            handle->fds[file] = FD_CACHE_MISSING;
+            errno = ENOENT;
+        }
+        return -1;
+    }
     return 0;
 }
 
+ssize_t cgroup_read_file(const char *cgroup_path, cgroup_file_t file, char *buffer, size_t size) {
+    if (!cgroup_path || file < 0 || file >= CGROUP_FILE_COUNT || !buffer || size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (mount_fd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+
+    size_t len;
+    const char *path = trim_path(cgroup_path, &len);
+    uint32_t hash = hash_path(path, len);
+
+    /* Second attempt after a removed cgroup was dropped: it may exist again */
+    for (int attempt = 0; attempt < 2; attempt++) {
+        cgroup_handle_t *handle = find_handle(path, len, hash);
+        if (!handle) {
+            handle = insert_handle(path, len, hash);
+            if (!handle) {
+                errno = ENOMEM;
+                return -1;
+            }
+        }
+        if (handle->fds[file] == FD_CACHE_MISSING && !controllers_changed(handle)) {
+            errno = ENOENT;
+            return -1;
+        }
+        if (handle->fds[file] < 0 && open_file(handle, file) != 0) {
+            return -1;
+        }
+
+        ssize_t bytes_read = pread(handle->fds[file], buffer, size - 1, 0);
+        if (bytes_read >= 0) {
+            buffer[bytes_read] = '\0';
+            return bytes_read;
+        }
+        if (errno != ENODEV) {
+            return -1;
+        }
+        remove_handle(handle);
+        errno = ENODEV;
+    }
+    return -1;
+}
+
+void cgroup_forget(const char *cgroup_path) {
+    if (!cgroup_path) {
+        return;
+    }
+    size_t len;
+    const char *path = trim_path(cgroup_path, &len);
+    cgroup_handle_t *handle = find_handle(path, len, hash_path(path, len));
+    if (handle) {
+        remove_handle(handle);
+    }
+}
+
+void cgroup_cache_cleanup(void) {
+    fd_cache_clear(&cache, close_handle);
+}
+
+int cgroup_cached_count(void) {
+    return (int)cache.count;
+}
+
+/* One key of a flat-keyed file and where its value goes */
+typedef struct {
+    const char *key;
+    uint64_t *value;
+} cgroup_key_t;
+
+/* Single pass over "key value" lines (cpu.stat, memory.stat, memory.events) */
+static void parse_flat_keyed(const char *text, const cgroup_key_t *keys, int count) {
+    const char *line = text;
+    while (*line) {
+        size_t key_len = strcspn(line, " \n");
+        if (line[key_len] == ' ') {
+            for (int k = 0; k < count; k++) {
+                if (strncmp(line, keys[k].key, key_len) == 0 && keys[k].key[key_len] == '\0') {
+                    *keys[k].value = strtoull(line + key_len + 1, NULL, 10);
+                    break;
+                }
+            }
+        }
+        const char *next = strchr(line, '\n');
+        if (!next) {
+            break;
+        }
+        line = next + 1;
+    }
+}
+
+/* memory.max and pids.max hold a number or "max" */
+static uint64_t parse_limit(const char *text) {
+    return strncmp(text, "max", 3) == 0 ? UINT64_MAX : strtoull(text, NULL, 10);
+}
+
 static int write_cgroup_file(const char *path, const char *value) {
     FILE *fp = fopen(path, "w");
     if (!fp) {
@@ -76,36 +433,24 @@ int cgroup_collect_cpu(const char *cgroup_path, cgroup_cpu_t *cpu) {
     clock_gettime(CLOCK_MONOTONIC, &cpu->timestamp);
 
     if (cgroup_version == CGROUP_V2) {
-        /* Read cpu.stat */
-        char stat_path[MAX_CGROUP_PATH];
-        snprintf(stat_path, sizeof(stat_path), "%s/%s/cpu.stat",
-                cgroup_mount, cgroup_path);
-
-        FILE *fp = fopen(stat_path, "r");
-        if (!fp) {
+        char buffer[CGROUP_STAT_SIZE];
+        if (cgroup_read_file(cgroup_path, CGROUP_FILE_CPU_STAT, buffer, sizeof(buffer)) < 0) {
             return -1;
         }
-
-        char line[256];
-        while (fgets(line, sizeof(line), fp)) {
-            if (sscanf(line, "usage_usec %lu", &cpu->usage_usec) == 1) continue;
-            if (sscanf(line, "user_usec %lu", &cpu->user_usec) == 1) continue;
-            if (sscanf(line, "system_usec %lu", &cpu->system_usec) == 1) continue;
-            if (sscanf(line, "nr_periods %lu", &cpu->nr_periods) == 1) continue;
-            if (sscanf(line, "nr_throttled %lu", &cpu->nr_throttled) == 1) continue;
-            if (sscanf(line, "throttled_usec %lu", &cpu->throttled_usec) == 1) continue;
-        }
-        fclose(fp);
+        const cgroup_key_t keys[] = {
+            { "usage_usec", &cpu->usage_usec },
+            { "user_usec", &cpu->user_usec },
+            { "system_usec", &cpu->system_usec },
+            { "nr_periods", &cpu->nr_periods },
+            { "nr_throttled", &cpu->nr_throttled },
+            { "throttled_usec", &cpu->throttled_usec },
+        };
+        parse_flat_keyed(buffer, keys, (int)(sizeof(keys) / sizeof(keys[0])));
 
         /* Read cpu.max for quota */
-        char max_path[MAX_CGROUP_PATH];
-        snprintf(max_path, sizeof(max_path), "%s/%s/cpu.max",
-                cgroup_mount, cgroup_path);
-
-        fp = fopen(max_path, "r");
-        if (fp) {
+        if (cgroup_read_file(cgroup_path, CGROUP_FILE_CPU_MAX, buffer, sizeof(buffer)) >= 0) {
             char quota_str[32], period_str[32];
-            if (fscanf(fp, "%s %s", quota_str, period_str) == 2) {
+            if (sscanf(buffer, "%31s %31s", quota_str, period_str) == 2) {
                 if (strcmp(quota_str, "max") == 0) {
                     cpu->quota_usec = -1;
                 } else {
@@ -113,7 +458,6 @@ int cgroup_collect_cpu(const char *cgroup_path, cgroup_cpu_t *cpu) {
                 }
                 cpu->period_usec = atoll(period_str);
             }
-            fclose(fp);
         }
     }
 
@@ -129,62 +473,144 @@ int cgroup_collect_memory(const char *cgroup_path, cgroup_memory_t *memory) {
     clock_gettime(CLOCK_MONOTONIC, &memory->timestamp);
 
     if (cgroup_version == CGROUP_V2) {
-        /* Read memory.current */
-        char current_path[MAX_CGROUP_PATH];
-        snprintf(current_path, sizeof(current_path), "%s/%s/memory.current",
-                cgroup_mount, cgroup_path);
-
-        char buffer[64];
-        if (read_cgroup_file(current_path, buffer, sizeof(buffer)) == 0) {
-            memory->current = strtoull(buffer, NULL, 10);
+        char buffer[CGROUP_STAT_SIZE];
+        if (cgroup_read_file(cgroup_path, CGROUP_FILE_MEMORY_CURRENT, buffer, sizeof(buffer)) < 0) {
+            return -1;
+        }
+        memory->current = strtoull(buffer, NULL, 10);
+        if (cgroup_read_file(cgroup_path, CGROUP_FILE_MEMORY_MAX, buffer, sizeof(buffer)) >= 0) {
+            memory->limit = parse_limit(buffer);
         }
 
-        /* Read memory.max */
-        char max_path[MAX_CGROUP_PATH];
-        snprintf(max_path, sizeof(max_path), "%s/%s/memory.max",
-                cgroup_mount, cgroup_path);
+        if (cgroup_read_file(cgroup_path, CGROUP_FILE_MEMORY_STAT, buffer, sizeof(buffer)) >= 0) {
+            const cgroup_key_t keys[] = {
+                { "file", &memory->cache },
+                { "anon", &memory->rss },
+            };
+            parse_flat_keyed(buffer, keys, 2);
+        }
 
-        if (read_cgroup_file(max_path, buffer, sizeof(buffer)) == 0) {
-            if (strcmp(buffer, "max\n") == 0) {
-                memory->limit = UINT64_MAX;
-            } else {
-                memory->limit = strtoull(buffer, NULL, 10);
-            }
+        /* OOM kills */
+        if (cgroup_read_file(cgroup_path, CGROUP_FILE_MEMORY_EVENTS, buffer, sizeof(buffer)) >= 0) {
+            const cgroup_key_t keys[] = { { "oom_kill", &memory->oom_kill_count } };
+            parse_flat_keyed(buffer, keys, 1);
         }
+    }
 
-        /* Read memory.stat */
-        char stat_path[MAX_CGROUP_PATH];
-        snprintf(stat_path, sizeof(stat_path), "%s/%s/memory.stat",
-                cgroup_mount, cgroup_path);
+    return 0;
+}
 
-        FILE *fp = fopen(stat_path, "r");
-        if (fp) {
-            char line[256];
-            while (fgets(line, sizeof(line), fp)) {
-                if (sscanf(line, "file %lu", &memory->cache) == 1) continue;
-                if (sscanf(line, "anon %lu", &memory->rss) == 1) continue;
-            }
-            fclose(fp);
+/* Integer keys of an io.stat device line and where their values go */
+typedef enum {
+    IO_KEY_STAT,                 /* Always present */
+    IO_KEY_COST,                 /* iocost, with io.cost.qos enabled */
+    IO_KEY_LATENCY               /* blk-iolatency, with an io.latency target */
+} io_key_group_t;
+
+static const struct {
+    const char *key;
+    size_t offset;
+    io_key_group_t group;
+} io_stat_keys[] = {
+    { "rbytes",       offsetof(cgroup_io_device_t, rbytes),              IO_KEY_STAT },
+    { "wbytes",       offsetof(cgroup_io_device_t, wbytes),              IO_KEY_STAT },
+    { "rios",         offsetof(cgroup_io_device_t, rios),                IO_KEY_STAT },
+    { "wios",         offsetof(cgroup_io_device_t, wios),                IO_KEY_STAT },
+    { "dbytes",       offsetof(cgroup_io_device_t, dbytes),              IO_KEY_STAT },
+    { "dios",         offsetof(cgroup_io_device_t, dios),                IO_KEY_STAT },
+    { "cost.usage",   offsetof(cgroup_io_device_t, cost_usage_usec),     IO_KEY_COST },
+    { "cost.wait",    offsetof(cgroup_io_device_t, cost_wait_usec),      IO_KEY_COST },
+    { "cost.indebt",  offsetof(cgroup_io_device_t, cost_indebt_usec),    IO_KEY_COST },
+    { "cost.indelay", offsetof(cgroup_io_device_t, cost_indelay_usec),   IO_KEY_COST },
+    { "use_delay",    offsetof(cgroup_io_device_t, use_delay),           IO_KEY_LATENCY },
+    { "delay_nsec",   offsetof(cgroup_io_device_t, delay_nsec),          IO_KEY_LATENCY },
+    { "avg_lat",      offsetof(cgroup_io_device_t, avg_lat_usec),        IO_KEY_LATENCY },
+    { "win",          offsetof(cgroup_io_device_t, latency_window_msec), IO_KEY_LATENCY },
+};
+#define IO_STAT_KEYS ((int)(sizeof(io_stat_keys) / sizeof(io_stat_keys[0])))
+
+/* Store one key=value field of a device line */
+static void parse_io_field(const char *key, size_t key_len, const char *value,
+                           cgroup_io_device_t *device) {
+    if (key_len == 10 && strncmp(key, "cost.vrate", 10) == 0) {
+        device->cost_vrate = strtod(value, NULL);
+        device->has_cost = 1;
+        return;
+    }
+    for (int k = 0; k < IO_STAT_KEYS; k++) {
+        if (strncmp(key, io_stat_keys[k].key, key_len) != 0 ||
+            io_stat_keys[k].key[key_len] != '\0') {
+            continue;
+        }
+        /* use_delay goes negative while blk-iolatency winds a delay down */
+        *(uint64_t *)((char *)device + io_stat_keys[k].offset) =
+            value[0] == '-' ? 0 : strtoull(value, NULL, 10);
+        if (io_stat_keys[k].group == IO_KEY_COST) {
+            device->has_cost = 1;
+        } else if (io_stat_keys[k].group == IO_KEY_LATENCY) {
+            device->has_latency = 1;
         }
+        return;
+    }
+}
+
+int cgroup_parse_io_stat(const char *text, cgroup_blkio_t *blkio) {
+    if (!text || !blkio) {
+        return -1;
+    }
 
-        /* Read memory.events for OOM kills */
-        char events_path[MAX_CGROUP_PATH];
-        snprintf(events_path, sizeof(events_path), "%s/%s/memory.events",
-                cgroup_mount, cgroup_path);
+    blkio->read_bytes = blkio->write_bytes = blkio->discard_bytes = 0;
+    blkio->read_iops = blkio->write_iops = blkio->discard_ios = 0;
+    blkio->device_count = 0;
+
+    const char *line = text;
+    while (*line) {
+        size_t line_len = strcspn(line, "\n");
+        unsigned int major, minor;
+        int consumed;
+        if (sscanf(line, "%u:%u%n", &major, &minor, &consumed) == 2) {
+            /* Devices past the table still count in the totals */
+            cgroup_io_device_t overflow;
+            cgroup_io_device_t *device = blkio->device_count < CGROUP_MAX_IO_DEVICES ?
+                                         &blkio->devices[blkio->device_count] : &overflow;
+            memset(device, 0, sizeof(cgroup_io_device_t));
+            device->major = major;
+            device->minor = minor;
+            const char *name = cgroup_device_name(major, minor);
+            if (name) {
+                snprintf(device->name, sizeof(device->name), "%s", name);
+            } else {
+                snprintf(device->name, sizeof(device->name), "%u:%u", major, minor);
+            }
 
-        fp = fopen(events_path, "r");
-        if (fp) {
-            char line[256];
-            while (fgets(line, sizeof(line), fp)) {
-                if (sscanf(line, "oom_kill %lu", &memory->oom_kill_count) == 1) {
-                    break;
+            const char *field = line + consumed;
+            const char *end = line + line_len;
+            while (field < end) {
+                field += strspn(field, " ");
+                size_t field_len = strcspn(field, " \n");
+                const char *eq = memchr(field, '=', field_len);
+                if (eq) {
+                    parse_io_field(field, (size_t)(eq - field), eq + 1, device);
                 }
+                field += field_len;
+            }
+
+            blkio->read_bytes += device->rbytes;
+            blkio->write_bytes += device->wbytes;
+            blkio->discard_bytes += device->dbytes;
+            blkio->read_iops += device->rios;
+            blkio->write_iops += device->wios;
+            blkio->discard_ios += device->dios;
+            if (device != &overflow) {
+                blkio->device_count++;
             }
-            fclose(fp);
         }
+        if (line[line_len] == '\0') {
+            break;
+        }
+        line += line_len + 1;
     }
-
-    return 0;
+    return blkio->device_count;
 }
 
 int cgroup_collect_blkio(const char *cgroup_path, cgroup_blkio_t *blkio) {
@@ -196,25 +622,30 @@ int cgroup_collect_blkio(const char *cgroup_path, cgroup_blkio_t *blkio) {
     clock_gettime(CLOCK_MONOTONIC, &blkio->timestamp);
 
     if (cgroup_version == CGROUP_V2) {
-        /* Read io.stat */
-        char stat_path[MAX_CGROUP_PATH];
-        snprintf(stat_path, sizeof(stat_path), "%s/%s/io.stat",
-                cgroup_mount, cgroup_path);
-
-        FILE *fp = fopen(stat_path, "r");
-        if (fp) {
-            char line[512];
-            while (fgets(line, sizeof(line), fp)) {
-                unsigned long rbytes, wbytes, rios, wios;
-                if (sscanf(line, "%*s rbytes=%lu wbytes=%lu rios=%lu wios=%lu",
-                          &rbytes, &wbytes, &rios, &wios) == 4) {
-                    blkio->read_bytes += rbytes;
-                    blkio->write_bytes += wbytes;
-                    blkio->read_iops += rios;
-                    blkio->write_iops += wios;
+        char buffer[CGROUP_IO_STAT_SIZE];
+        if (cgroup_read_file(cgroup_path, CGROUP_FILE_IO_STAT, buffer, sizeof(buffer)) < 0) {
+            return -1;
+        }
+        cgroup_parse_io_stat(buffer, blkio);
+
+        /* "MAJ:MIN target=<usec>" for devices with a latency target */
+        if (blkio->device_count > 0 &&
+            cgroup_read_file(cgroup_path, CGROUP_FILE_IO_LATENCY, buffer, sizeof(buffer)) >= 0) {
+            char *saveptr;
+            for (char *line = strtok_r(buffer, "\n", &saveptr); line;
+                 line = strtok_r(NULL, "\n", &saveptr)) {
+                unsigned int major, minor;
+                unsigned long target;
+                if (sscanf(line, "%u:%u target=%lu", &major, &minor, &target) != 3) {
+                    continue;
+                }
+                for (int d = 0; d < blkio->device_count; d++) {
+                    if (blkio->devices[d].major == major && blkio->devices[d].minor == minor) {
+                        blkio->devices[d].latency_target_usec = target;
+                        break;
+                    }
                 }
             }
-            fclose(fp);
         }
     }
 
@@ -230,33 +661,314 @@ int cgroup_collect_pids(const char *cgroup_path, cgroup_pids_t *pids) {
     clock_gettime(CLOCK_MONOTONIC, &pids->timestamp);
 
     if (cgroup_version == CGROUP_V2) {
-        /* Read pids.current */
-        char current_path[MAX_CGROUP_PATH];
-        snprintf(current_path, sizeof(current_path), "%s/%s/pids.current",
-                cgroup_mount, cgroup_path);
-
         char buffer[64];
-        if (read_cgroup_file(current_path, buffer, sizeof(buffer)) == 0) {
-            pids->current = strtoull(buffer, NULL, 10);
+        if (cgroup_read_file(cgroup_path, CGROUP_FILE_PIDS_CURRENT, buffer, sizeof(buffer)) < 0) {
+            return -1;
         }
+        pids->current = strtoull(buffer, NULL, 10);
+        if (cgroup_read_file(cgroup_path, CGROUP_FILE_PIDS_MAX, buffer, sizeof(buffer)) >= 0) {
+            pids->limit = parse_limit(buffer);
+        }
+    }
+
+    return 0;
+}
 
-        /* Read pids.max */
-        char max_path[MAX_CGROUP_PATH];
-        snprintf(max_path, sizeof(max_path), "%s/%s/pids.max",
-                cgroup_mount, cgroup_path);
+const char *cgroup_psi_resource_name(cgroup_psi_resource_t resource) {
+    if (resource < 0 || resource >= CGROUP_PSI_RESOURCES) {
+        return "unknown";
+    }
+    return psi_resource_names[resource];
+}
 
-        if (read_cgroup_file(max_path, buffer, sizeof(buffer)) == 0) {
-            if (strcmp(buffer, "max\n") == 0) {
-                pids->limit = UINT64_MAX;
-            } else {
-                pids->limit = strtoull(buffer, NULL, 10);
+int cgroup_parse_psi(const char *text, cgroup_psi_t *psi) {
+    if (!text || !psi) {
+        return -1;
+    }
+
+    memset(psi, 0, sizeof(cgroup_psi_t));
+    int has_some = 0;
+    const char *line = text;
+    while (line && *line) {
+        if (sscanf(line, "some avg10=%lf avg60=%lf avg300=%lf total=%lu",
+                   &psi->some_avg10, &psi->some_avg60, &psi->some_avg300,
+                   &psi->some_total) == 4) {
+            has_some = 1;
+        } else if (sscanf(line, "full avg10=%lf avg60=%lf avg300=%lf total=%lu",
+                          &psi->full_avg10, &psi->full_avg60, &psi->full_avg300,
+                          &psi->full_total) == 4) {
+            psi->has_full = 1;
+        }
+        line = strchr(line, '\n');
+        if (line) line++;
+    }
+    return has_some ? 0 : -1;
+}
+
+/* Pressure file of a cgroup; the root of a v1-only host has just /proc/pressure */
+static void pressure_path(const char *cgroup_path, cgroup_psi_resource_t resource,
+                          char *path, size_t size) {
+    snprintf(path, size, "%s/%s/%s.pressure", cgroup_mount, cgroup_path,
+             psi_resource_names[resource]);
+
+    int is_root = (cgroup_path[strspn(cgroup_path, "/")] == '\0');
+    if (is_root && access(path, F_OK) != 0) {
+        snprintf(path, size, "/proc/pressure/%s", psi_resource_names[resource]);
+    }
+}
+
+/* System-wide pressure, for a root cgroup without pressure files */
+static ssize_t read_proc_pressure(cgroup_psi_resource_t resource, char *buffer, size_t size) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/pressure/%s", psi_resource_names[resource]);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, buffer, size - 1);
+    close(fd);
+    if (n >= 0) {
+        buffer[n] = '\0';
+    }
+    return n;
+}
+
+int cgroup_collect_pressure(const char *cgroup_path, cgroup_pressure_t *pressure) {
+    if (!cgroup_path || !pressure) {
+        return -1;
+    }
+
+    memset(pressure, 0, sizeof(cgroup_pressure_t));
+    clock_gettime(CLOCK_MONOTONIC, &pressure->timestamp);
+
+    int is_root = (cgroup_path[strspn(cgroup_path, "/")] == '\0');
+    int found = 0;
+    for (int r = 0; r < CGROUP_PSI_RESOURCES; r++) {
+        char buffer[256];
+        ssize_t n = cgroup_read_file(cgroup_path, CGROUP_FILE_CPU_PRESSURE + r,
+                                     buffer, sizeof(buffer));
+        if (n < 0 && is_root) {
+            n = read_proc_pressure(r, buffer, sizeof(buffer));
+        }
+        if (n >= 0 && cgroup_parse_psi(buffer, &pressure->psi[r]) == 0) {
+            pressure->has_psi[r] = 1;
+            found++;
+        }
+    }
+    return found > 0 ? 0 : -1;
+}
+
+int cgroup_psi_trigger_open(const char *cgroup_path, cgroup_psi_resource_t resource,
+                            int full, uint32_t stall_us, uint32_t window_us,
+                            cgroup_psi_trigger_t *trigger) {
+    if (!cgroup_path || !trigger || resource < 0 || resource >= CGROUP_PSI_RESOURCES ||
+        stall_us == 0 || stall_us > window_us) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(trigger, 0, sizeof(cgroup_psi_trigger_t));
+    trigger->fd = -1;
+
+    char path[MAX_CGROUP_PATH];
+    pressure_path(cgroup_path, resource, path, sizeof(path));
+    int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    /* The kernel parses the string including its terminating NUL */
+    char spec[64];
+    int len = snprintf(spec, sizeof(spec), "%s %u %u", full ? "full" : "some",
+                       stall_us, window_us);
+    if (write(fd, spec, len + 1) < 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    trigger->fd = fd;
+    trigger->resource = resource;
+    trigger->full = full;
+    trigger->stall_us = stall_us;
+    trigger->window_us = window_us;
+    return 0;
+}
+
+int cgroup_psi_trigger_read(cgroup_psi_trigger_t *trigger, cgroup_psi_t *psi) {
+    if (!trigger || trigger->fd < 0 || !psi) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    trigger->events++;
+    char buffer[256];
+    ssize_t n = pread(trigger->fd, buffer, sizeof(buffer) - 1, 0);
+    if (n < 0) {
+        return -1;
+    }
+    buffer[n] = '\0';
+    return cgroup_parse_psi(buffer, psi);
+}
+
+void cgroup_psi_trigger_close(cgroup_psi_trigger_t *trigger) {
+    if (trigger && trigger->fd >= 0) {
+        close(trigger->fd);
+        trigger->fd = -1;
+    }
+}
+
+/* Close a run of consecutive throttled periods */
+static void end_burst(cgroup_throttle_analysis_t *analysis, int *run, uint64_t *burst_sum) {
+    if (*run == 0) {
+        return;
+    }
+    analysis->burst_count++;
+    if (*run > analysis->max_burst) {
+        analysis->max_burst = *run;
+    }
+    *burst_sum += *run;
+    *run = 0;
+}
+
+int cgroup_analyze_throttling_samples(const cgroup_cpu_t *samples, int count,
+                                      cgroup_throttle_analysis_t *analysis) {
+    if (!samples || count < 2 || !analysis) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(analysis, 0, sizeof(cgroup_throttle_analysis_t));
+    const cgroup_cpu_t *first = &samples[0];
+    const cgroup_cpu_t *last = &samples[count - 1];
+    double wall = (last->timestamp.tv_sec - first->timestamp.tv_sec) +
+                  (last->timestamp.tv_nsec - first->timestamp.tv_nsec) / 1e9;
+    if (wall <= 0.0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    double quota = (last->quota_usec > 0) ? (double)last->quota_usec : 0.0;
+    if (quota > 0.0 && last->period_usec > 0) {
+        analysis->configured_limit = quota / last->period_usec;
+    }
+    analysis->measured_usage = (last->usage_usec - first->usage_usec) / (wall * 1e6);
+    analysis->periods = last->nr_periods - first->nr_periods;
+    analysis->throttle_count = last->nr_throttled - first->nr_throttled;
+    analysis->throttled_usec = last->throttled_usec - first->throttled_usec;
+    analysis->throttle_percentage = analysis->throttled_usec / (wall * 1e6) * 100.0;
+    if (analysis->periods > 0) {
+        analysis->throttle_ratio = (double)analysis->throttle_count / analysis->periods;
+    }
+    analysis->duration.tv_sec = (time_t)wall;
+    analysis->duration.tv_nsec = (long)((wall - (time_t)wall) * 1e9);
+    analysis->samples = count;
+    analysis->sample_interval = wall / (count - 1);
+
+    /* Usage accumulates until nr_periods moves; then it is split evenly
+     * over the periods that ended since. Sampling several times per period
+     * keeps that almost always a single period. */
+    uint64_t pending_usage = 0;
+    uint64_t pending_throttled = 0;
+    uint64_t usage_sum = 0, throttled_usage_sum = 0, throttled_periods = 0;
+    uint64_t burst_sum = 0;
+    int run = 0;
+    for (int i = 1; i < count; i++) {
+        pending_usage += samples[i].usage_usec - samples[i - 1].usage_usec;
+        pending_throttled += samples[i].nr_throttled - samples[i - 1].nr_throttled;
+        uint64_t ended = samples[i].nr_periods - samples[i - 1].nr_periods;
+        if (ended == 0) {
+            continue;
+        }
+
+        double per_period = (double)pending_usage / ended;
+        usage_sum += pending_usage;
+        if (quota > 0.0) {
+            int bucket = (int)(per_period / quota * 10.0);
+            if (bucket >= CGROUP_THROTTLE_BUCKETS - 1) {
+                bucket = CGROUP_THROTTLE_BUCKETS - 1;
             }
+            analysis->usage_histogram[bucket] += ended;
         }
+
+        uint64_t throttled = pending_throttled < ended ? pending_throttled : ended;
+        throttled_usage_sum += (uint64_t)(per_period * throttled);
+        throttled_periods += throttled;
+        run += (int)throttled;
+        if (throttled < ended) {
+            end_burst(analysis, &run, &burst_sum);
+        }
+        pending_usage = 0;
+        pending_throttled = 0;
     }
+    end_burst(analysis, &run, &burst_sum);
 
+    if (analysis->burst_count > 0) {
+        analysis->mean_burst = (double)burst_sum / analysis->burst_count;
+    }
+    if (analysis->periods > 0) {
+        analysis->mean_period_usage = (double)usage_sum / analysis->periods;
+    }
+    if (throttled_periods > 0) {
+        analysis->throttled_period_usage = (double)throttled_usage_sum / throttled_periods;
+        /* A throttled period should have consumed exactly the quota */
+        if (quota > 0.0) {
+            double error = fabs(analysis->throttled_period_usage - quota) / quota;
+            analysis->precision = (error < 1.0) ? (1.0 - error) * 100.0 : 0.0;
+        }
+    }
     return 0;
 }
 
+int cgroup_analyze_throttling(const char *cgroup_path, double duration_sec,
+                              cgroup_throttle_analysis_t *analysis) {
+    if (!cgroup_path || !analysis || duration_sec <= 0.0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    cgroup_cpu_t first;
+    if (cgroup_collect_cpu(cgroup_path, &first) != 0) {
+        return -1;
+    }
+
+    /* Four reads per period resolve single periods, within 1..25 ms */
+    uint64_t period = first.period_usec ? first.period_usec : 100000;
+    uint64_t step_ns = period * 1000 / 4;
+    if (step_ns < 1000000) step_ns = 1000000;
+    if (step_ns > 25000000) step_ns = 25000000;
+
+    int capacity = (int)(duration_sec * 1e9 / step_ns) + 1;
+    cgroup_cpu_t *samples = malloc(capacity * sizeof(cgroup_cpu_t));
+    if (!samples) {
+        errno = ENOMEM;
+        return -1;
+    }
+    samples[0] = first;
+    int count = 1;
+
+    /* Absolute deadlines so read latency does not stretch the interval */
+    struct timespec deadline = first.timestamp;
+    while (count < capacity) {
+        deadline.tv_nsec += step_ns;
+        while (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_nsec -= 1000000000L;
+            deadline.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+        }
+        if (cgroup_collect_cpu(cgroup_path, &samples[count]) != 0) {
+            break;
+        }
+        count++;
+    }
+
+    int status = cgroup_analyze_throttling_samples(samples, count, analysis);
+    free(samples);
+    return status;
+}
+
 int cgroup_collect_metrics(const char *cgroup_path, cgroup_metrics_t *metrics) {
     if (!cgroup_path || !metrics) {
         return -1;
@@ -270,10 +982,138 @@ int cgroup_collect_metrics(const char *cgroup_path, cgroup_metrics_t *metrics) {
     metrics->has_memory = (cgroup_collect_memory(cgroup_path, &metrics->memory) == 0);
     metrics->has_blkio = (cgroup_collect_blkio(cgroup_path, &metrics->blkio) == 0);
     metrics->has_pids = (cgroup_collect_pids(cgroup_path, &metrics->pids) == 0);
+    metrics->has_pressure = (cgroup_collect_pressure(cgroup_path, &metrics->pressure) == 0);
+
+    return 0;
+}
+
+static double elapsed_seconds(const struct timespec *prev, const struct timespec *curr) {
+    return (curr->tv_sec - prev->tv_sec) + (curr->tv_nsec - prev->tv_nsec) / 1e9;
+}
+
+/* Counters restart from zero when a cgroup is recreated under the same path */
+static uint64_t counter_delta(uint64_t prev, uint64_t curr) {
+    return curr >= prev ? curr - prev : 0;
+}
+
+double cgroup_calculate_cpu_utilization(const cgroup_cpu_t *prev,
+                                       const cgroup_cpu_t *current) {
+    if (!prev || !current) {
+        return 0.0;
+    }
+
+    double seconds = elapsed_seconds(&prev->timestamp, &current->timestamp);
+    if (seconds <= 0.0) {
+        return 0.0;
+    }
+    return counter_delta(prev->usage_usec, current->usage_usec) / 1e6 / seconds;
+}
+
+double cgroup_calculate_memory_utilization(const cgroup_memory_t *memory) {
+    if (!memory || memory->limit == 0 || memory->limit == UINT64_MAX) {
+        return 0.0;
+    }
+    return memory->current * 100.0 / memory->limit;
+}
+
+int cgroup_calculate_rates(const cgroup_metrics_t *prev, const cgroup_metrics_t *curr,
+                           cgroup_rates_t *rates) {
+    if (!prev || !curr || !rates) {
+        return -1;
+    }
+
+    memset(rates, 0, sizeof(cgroup_rates_t));
+
+    if (prev->has_cpu && curr->has_cpu) {
+        const cgroup_cpu_t *p = &prev->cpu;
+        const cgroup_cpu_t *c = &curr->cpu;
+        double seconds = elapsed_seconds(&p->timestamp, &c->timestamp);
+        rates->interval = seconds;
+        if (seconds > 0.0) {
+            rates->cpu_cores = cgroup_calculate_cpu_utilization(p, c);
+            rates->user_cores = counter_delta(p->user_usec, c->user_usec) / 1e6 / seconds;
+            rates->system_cores = counter_delta(p->system_usec, c->system_usec) / 1e6 / seconds;
+            rates->throttled_percent =
+                counter_delta(p->throttled_usec, c->throttled_usec) / 1e4 / seconds;
+        }
+        uint64_t periods = counter_delta(p->nr_periods, c->nr_periods);
+        if (periods > 0) {
+            rates->throttle_rate =
+                (double)counter_delta(p->nr_throttled, c->nr_throttled) / periods;
+        }
+        if (c->quota_usec > 0 && c->period_usec > 0) {
+            rates->cpu_limit_percent =
+                rates->cpu_cores * 100.0 * c->period_usec / c->quota_usec;
+        }
+    }
+
+    if (curr->has_memory) {
+        rates->memory_percent = cgroup_calculate_memory_utilization(&curr->memory);
+    }
+
+    if (prev->has_blkio && curr->has_blkio) {
+        const cgroup_blkio_t *p = &prev->blkio;
+        const cgroup_blkio_t *c = &curr->blkio;
+        double seconds = elapsed_seconds(&p->timestamp, &c->timestamp);
+        if (rates->interval <= 0.0) {
+            rates->interval = seconds;
+        }
+        if (seconds > 0.0) {
+            rates->read_rate = counter_delta(p->read_bytes, c->read_bytes) / seconds;
+            rates->write_rate = counter_delta(p->write_bytes, c->write_bytes) / seconds;
+            rates->read_iops = counter_delta(p->read_iops, c->read_iops) / seconds;
+            rates->write_iops = counter_delta(p->write_iops, c->write_iops) / seconds;
+            rates->discard_rate = counter_delta(p->discard_bytes, c->discard_bytes) / seconds;
+            rates->discard_iops = counter_delta(p->discard_ios, c->discard_ios) / seconds;
+        }
+    }
 
     return 0;
 }
 
+void cgroup_calculate_device_rates(const cgroup_blkio_t *prev, cgroup_blkio_t *curr) {
+    if (!prev || !curr) {
+        return;
+    }
+
+    double seconds = elapsed_seconds(&prev->timestamp, &curr->timestamp);
+    for (int d = 0; d < curr->device_count; d++) {
+        cgroup_io_device_t *c = &curr->devices[d];
+        const cgroup_io_device_t *p = NULL;
+        for (int i = 0; i < prev->device_count; i++) {
+            if (prev->devices[i].major == c->major && prev->devices[i].minor == c->minor) {
+                p = &prev->devices[i];
+                break;
+            }
+        }
+
+        c->read_rate = c->write_rate = c->discard_rate = 0.0;
+        c->read_iops = c->write_iops = c->discard_iops = 0.0;
+        c->cost_usage_percent = c->cost_wait_percent = 0.0;
+        c->cost_indebt_percent = c->cost_indelay_percent = 0.0;
+        if (!p || seconds <= 0.0) {
+            continue;
+        }
+
+        c->read_rate = counter_delta(p->rbytes, c->rbytes) / seconds;
+        c->write_rate = counter_delta(p->wbytes, c->wbytes) / seconds;
+        c->discard_rate = counter_delta(p->dbytes, c->dbytes) / seconds;
+        c->read_iops = counter_delta(p->rios, c->rios) / seconds;
+        c->write_iops = counter_delta(p->wios, c->wios) / seconds;
+        c->discard_iops = counter_delta(p->dios, c->dios) / seconds;
+        if (c->has_cost) {
+            c->cost_usage_percent =
+                counter_delta(p->cost_usage_usec, c->cost_usage_usec) / 1e4 / seconds;
+            c->cost_wait_percent =
+                counter_delta(p->cost_wait_usec, c->cost_wait_usec) / 1e4 / seconds;
+            c->cost_indebt_percent =
+                counter_delta(p->cost_indebt_usec, c->cost_indebt_usec) / 1e4 / seconds;
+            c->cost_indelay_percent =
+                counter_delta(p->cost_indelay_usec, c->cost_indelay_usec) / 1e4 / seconds;
+        }
+    }
+}
+
 int cgroup_create(const cgroup_config_t *config, char *created_path, size_t path_len) {
     if (!config || !created_path) {
         return -1;
@@ -339,6 +1179,32 @@ int cgroup_set_memory_limit(const char *cgroup_path, uint64_t limit_bytes) {
     return write_cgroup_file(max_path, value);
 }
 
+int cgroup_get_process_cgroup(pid_t pid, char *cgroup_path, size_t path_len) {
+    if (!cgroup_path || path_len == 0) {
+        return -1;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/cgroup", pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    /* The v2 membership is the "0::/path" line, also on hybrid hosts */
+    char line[MAX_CGROUP_PATH + 16];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "0::", 3) == 0) {
+            line[strcspn(line, "\n")] = '\0';
+            snprintf(cgroup_path, path_len, "%s", line + 3);
+            found = 1;
+        }
+    }
+    fclose(fp);
+    return found ? 0 : -1;
+}
+
 int cgroup_move_process(pid_t pid, const char *cgroup_path) {
     if (!cgroup_path) {
         return -1;
@@ -398,6 +1264,144 @@ void cgroup_print_blkio(const cgroup_blkio_t *blkio) {
     printf("    Write bytes:    %lu\n", blkio->write_bytes);
     printf("    Read IOPS:      %lu\n", blkio->read_iops);
     printf("    Write IOPS:     %lu\n", blkio->write_iops);
+    printf("    Discard bytes:  %lu (%lu ops)\n", blkio->discard_bytes, blkio->discard_ios);
+    printf("    Devices:        %d\n", blkio->device_count);
+}
+
+void cgroup_print_devices(const cgroup_blkio_t *blkio) {
+    if (!blkio || blkio->device_count == 0) return;
+
+    printf("=== Cgroup I/O by Device ===\n");
+    printf("%-12s %10s %10s %10s %8s %8s %8s\n", "DEVICE", "READ KB/s", "WRITE KB/s",
+           "DISC KB/s", "R IOPS", "W IOPS", "D IOPS");
+    for (int d = 0; d < blkio->device_count; d++) {
+        const cgroup_io_device_t *device = &blkio->devices[d];
+        printf("%-12s %10.2f %10.2f %10.2f %8.1f %8.1f %8.1f\n", device->name,
+               device->read_rate / 1024.0, device->write_rate / 1024.0,
+               device->discard_rate / 1024.0, device->read_iops, device->write_iops,
+               device->discard_iops);
+        if (device->has_cost) {
+            printf("%-12s iocost: usage %.1f%%, wait %.1f%%, indebt %.1f%%, indelay %.1f%%"
+                   " (vrate %.2f%%)\n", "", device->cost_usage_percent,
+                   device->cost_wait_percent, device->cost_indebt_percent,
+                   device->cost_indelay_percent, device->cost_vrate);
+        }
+        if (device->has_latency || device->latency_target_usec > 0) {
+            printf("%-12s latency: avg %lu us", "", device->avg_lat_usec);
+            if (device->latency_target_usec > 0) {
+                printf(" (target %lu us)", device->latency_target_usec);
+            }
+            printf(", window %lu ms, delay %lu ns, depth %lu\n", device->latency_window_msec,
+                   device->delay_nsec, device->use_delay);
+        }
+    }
+    printf("\n");
+}
+
+void cgroup_print_pids(const cgroup_pids_t *pids) {
+    if (!pids) return;
+
+    printf("  PIDs:\n");
+    printf("    Current:        %lu\n", pids->current);
+    if (pids->limit == UINT64_MAX) {
+        printf("    Limit:          unlimited\n");
+    } else {
+        printf("    Limit:          %lu\n", pids->limit);
+    }
+}
+
+void cgroup_print_pressure(const cgroup_pressure_t *pressure) {
+    if (!pressure) return;
+
+    printf("  Pressure (avg10 / avg60 / avg300, total stall):\n");
+    for (int r = 0; r < CGROUP_PSI_RESOURCES; r++) {
+        if (!pressure->has_psi[r]) continue;
+        const cgroup_psi_t *psi = &pressure->psi[r];
+        printf("    %-6s some:    %6.2f%% / %6.2f%% / %6.2f%%, %lu us\n",
+               psi_resource_names[r], psi->some_avg10, psi->some_avg60,
+               psi->some_avg300, psi->some_total);
+        if (psi->has_full) {
+            printf("    %-6s full:    %6.2f%% / %6.2f%% / %6.2f%%, %lu us\n",
+                   "", psi->full_avg10, psi->full_avg60, psi->full_avg300,
+                   psi->full_total);
+        }
+    }
+}
+
+void cgroup_print_throttle_analysis(const cgroup_throttle_analysis_t *analysis) {
+    if (!analysis) return;
+
+    double seconds = analysis->duration.tv_sec + analysis->duration.tv_nsec / 1e9;
+    printf("\n=== CPU Throttling Analysis (%.1fs, %d samples every %.1f ms) ===\n",
+           seconds, analysis->samples, analysis->sample_interval * 1e3);
+    if (analysis->configured_limit > 0.0) {
+        printf("Configured limit:     %.3f cores\n", analysis->configured_limit);
+    } else {
+        printf("Configured limit:     unlimited\n");
+    }
+    printf("Measured usage:       %.3f cores\n", analysis->measured_usage);
+    printf("Periods:              %lu (%lu throttled, ratio %.1f%%)\n",
+           analysis->periods, analysis->throttle_count, analysis->throttle_ratio * 100.0);
+    printf("Throttled time:       %lu us (%.1f%% of wall time)\n",
+           analysis->throttled_usec, analysis->throttle_percentage);
+    printf("Throttle bursts:      %d (mean %.1f, longest %d periods)\n",
+           analysis->burst_count, analysis->mean_burst, analysis->max_burst);
+    if (analysis->periods > 0) {
+        printf("Usage per period:     %.0f us mean", analysis->mean_period_usage);
+        if (analysis->throttle_count > 0) {
+            printf(", %.0f us when throttled", analysis->throttled_period_usage);
+        }
+        printf("\n");
+    }
+    if (analysis->configured_limit <= 0.0) {
+        return;
+    }
+    if (analysis->throttle_count > 0) {
+        printf("Quota precision:      %.1f%%\n", analysis->precision);
+    }
+
+    uint64_t max = 0;
+    for (int b = 0; b < CGROUP_THROTTLE_BUCKETS; b++) {
+        if (analysis->usage_histogram[b] > max) max = analysis->usage_histogram[b];
+    }
+    printf("\nPeriods by usage / quota:\n");
+    for (int b = 0; b < CGROUP_THROTTLE_BUCKETS && max > 0; b++) {
+        char label[16];
+        if (b == CGROUP_THROTTLE_BUCKETS - 1) {
+            snprintf(label, sizeof(label), ">=%d%%", (CGROUP_THROTTLE_BUCKETS - 1) * 10);
+        } else {
+            snprintf(label, sizeof(label), "%d-%d%%", b * 10, b * 10 + 10);
+        }
+        int width = (int)(analysis->usage_histogram[b] * 40 / max);
+        printf("  %-8s %8lu %.*s\n", label, analysis->usage_histogram[b], width,
+               "########################################");
+    }
+}
+
+void cgroup_print_rates(const cgroup_rates_t *rates) {
+    if (!rates) return;
+
+    printf("=== Cgroup Rates (over %.2fs) ===\n", rates->interval);
+    printf("CPU:            %.3f cores (user %.3f, system %.3f)",
+           rates->cpu_cores, rates->user_cores, rates->system_cores);
+    if (rates->cpu_limit_percent > 0.0) {
+        printf(", %.1f%% of limit", rates->cpu_limit_percent);
+    }
+    printf("\n");
+    printf("Throttling:     %.1f%% of periods, %.1f%% of wall time\n",
+           rates->throttle_rate * 100.0, rates->throttled_percent);
+    if (rates->memory_percent > 0.0) {
+        printf("Memory:         %.1f%% of limit\n", rates->memory_percent);
+    }
+    printf("I/O:            %.2f KB/s read, %.2f KB/s write\n",
+           rates->read_rate / 1024.0, rates->write_rate / 1024.0);
+    printf("IOPS:           %.1f read, %.1f write\n",
+           rates->read_iops, rates->write_iops);
+    if (rates->discard_rate > 0.0 || rates->discard_iops > 0.0) {
+        printf("Discard:        %.2f KB/s, %.1f IOPS\n",
+               rates->discard_rate / 1024.0, rates->discard_iops);
+    }
+    printf("\n");
 }
 
 void cgroup_print_metrics(const cgroup_metrics_t *metrics) {
@@ -409,6 +1413,219 @@ void cgroup_print_metrics(const cgroup_metrics_t *metrics) {
     if (metrics->has_cpu) cgroup_print_cpu(&metrics->cpu);
     if (metrics->has_memory) cgroup_print_memory(&metrics->memory);
     if (metrics->has_blkio) cgroup_print_blkio(&metrics->blkio);
+    if (metrics->has_pids) cgroup_print_pids(&metrics->pids);
+    if (metrics->has_pressure) cgroup_print_pressure(&metrics->pressure);
 
     printf("========================================\n\n");
 }
+
+const char *cgroup_json_escape(const char *text, char *out, size_t size) {
+    size_t len = 0;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        char escaped[8];
+        if (*p == '"' || *p == '\\') {
+            snprintf(escaped, sizeof(escaped), "\\%c", *p);
+        } else if (*p < 0x20) {
+            snprintf(escaped, sizeof(escaped), "\\u%04x", *p);
+        } else {
+            escaped[0] = (char)*p;
+            escaped[1] = '\0';
+        }
+        /* Never cut an escape sequence in half */
+        size_t n = strlen(escaped);
+        if (len + n >= size) {
+            break;
+        }
+        memcpy(out + len, escaped, n);
+        len += n;
+    }
+    out[len] = '\0';
+    return out;
+}
+
+const char *cgroup_csv_quote(const char *text, char *out, size_t size) {
+    if (size < 3) {
+        if (size > 0) {
+            out[0] = '\0';
+        }
+        return out;
+    }
+
+    size_t len = 0;
+    out[len++] = '"';
+    for (const char *p = text; *p; p++) {
+        size_t n = (*p == '"') ? 2 : 1;
+        /* Room for the closing quote and the terminator */
+        if (len + n + 2 > size) {
+            break;
+        }
+        if (*p == '"') {
+            out[len++] = '"';
+        }
+        out[len++] = *p;
+    }
+    out[len++] = '"';
+    out[len] = '\0';
+    return out;
+}
+
+int cgroup_export_metrics_json(const cgroup_metrics_t *metrics, const cgroup_rates_t *rates,
+                               const char *filename) {
+    if (!metrics || !filename) {
+        return -1;
+    }
+
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    cgroup_rates_t none;
+    if (!rates) {
+        memset(&none, 0, sizeof(none));
+        rates = &none;
+    }
+
+    char path[MAX_CGROUP_PATH * 6];
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"cgroup\": \"%s\",\n",
+            cgroup_json_escape(metrics->cgroup_path, path, sizeof(path)));
+    fprintf(fp, "  \"usage_usec\": %lu,\n", metrics->cpu.usage_usec);
+    fprintf(fp, "  \"user_usec\": %lu,\n", metrics->cpu.user_usec);
+    fprintf(fp, "  \"system_usec\": %lu,\n", metrics->cpu.system_usec);
+    fprintf(fp, "  \"nr_periods\": %lu,\n", metrics->cpu.nr_periods);
+    fprintf(fp, "  \"nr_throttled\": %lu,\n", metrics->cpu.nr_throttled);
+    fprintf(fp, "  \"throttled_usec\": %lu,\n", metrics->cpu.throttled_usec);
+    fprintf(fp, "  \"quota_usec\": %ld,\n", metrics->cpu.quota_usec);
+    fprintf(fp, "  \"period_usec\": %lu,\n", metrics->cpu.period_usec);
+    fprintf(fp, "  \"memory_current\": %lu,\n", metrics->memory.current);
+    fprintf(fp, "  \"memory_limit\": %lu,\n", metrics->memory.limit);
+    fprintf(fp, "  \"oom_kill_count\": %lu,\n", metrics->memory.oom_kill_count);
+    fprintf(fp, "  \"read_bytes\": %lu,\n", metrics->blkio.read_bytes);
+    fprintf(fp, "  \"write_bytes\": %lu,\n", metrics->blkio.write_bytes);
+    fprintf(fp, "  \"read_ios\": %lu,\n", metrics->blkio.read_iops);
+    fprintf(fp, "  \"write_ios\": %lu,\n", metrics->blkio.write_iops);
+    fprintf(fp, "  \"pids_current\": %lu,\n", metrics->pids.current);
+    fprintf(fp, "  \"cpu_cores\": %.4f,\n", rates->cpu_cores);
+    fprintf(fp, "  \"cpu_limit_percent\": %.2f,\n", rates->cpu_limit_percent);
+    fprintf(fp, "  \"throttle_rate\": %.4f,\n", rates->throttle_rate);
+    fprintf(fp, "  \"throttled_percent\": %.2f,\n", rates->throttled_percent);
+    fprintf(fp, "  \"memory_percent\": %.2f,\n", rates->memory_percent);
+    fprintf(fp, "  \"read_rate\": %.2f,\n", rates->read_rate);
+    fprintf(fp, "  \"write_rate\": %.2f,\n", rates->write_rate);
+    fprintf(fp, "  \"read_iops\": %.2f,\n", rates->read_iops);
+    fprintf(fp, "  \"write_iops\": %.2f,\n", rates->write_iops);
+    fprintf(fp, "  \"discard_rate\": %.2f,\n", rates->discard_rate);
+    fprintf(fp, "  \"discard_iops\": %.2f,\n", rates->discard_iops);
+    fprintf(fp, "  \"devices\": [");
+    for (int d = 0; d < metrics->blkio.device_count; d++) {
+        const cgroup_io_device_t *device = &metrics->blkio.devices[d];
+        fprintf(fp, "%s\n    {\"device\": \"%s\", \"major\": %u, \"minor\": %u, "
+                "\"read_rate\": %.2f, \"write_rate\": %.2f, \"discard_rate\": %.2f, "
+                "\"read_iops\": %.2f, \"write_iops\": %.2f, \"discard_iops\": %.2f, "
+                "\"cost_usage_percent\": %.2f, \"cost_wait_percent\": %.2f, "
+                "\"cost_indebt_percent\": %.2f, \"cost_indelay_percent\": %.2f, "
+                "\"cost_vrate\": %.2f, \"avg_lat_usec\": %lu, \"latency_target_usec\": %lu}",
+                d > 0 ? "," : "", device->name, device->major, device->minor,
+                device->read_rate, device->write_rate, device->discard_rate,
+                device->read_iops, device->write_iops, device->discard_iops,
+                device->cost_usage_percent, device->cost_wait_percent,
+                device->cost_indebt_percent, device->cost_indelay_percent,
+                device->cost_vrate, device->avg_lat_usec, device->latency_target_usec);
+    }
+    fprintf(fp, "%s],\n", metrics->blkio.device_count > 0 ? "\n  " : "");
+    fprintf(fp, "  \"timestamp\": %ld.%09ld\n", metrics->cpu.timestamp.tv_sec,
+            metrics->cpu.timestamp.tv_nsec);
+    fprintf(fp, "}\n");
+
+    fclose(fp);
+    return 0;
+}
+
+int cgroup_export_metrics_csv(const cgroup_metrics_t *metrics, const cgroup_rates_t *rates,
+                              const char *filename, int append) {
+    if (!metrics || !filename) {
+        return -1;
+    }
+
+    FILE *fp = fopen(filename, append ? "a" : "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    cgroup_rates_t none;
+    if (!rates) {
+        memset(&none, 0, sizeof(none));
+        rates = &none;
+    }
+
+    /* Write header if new file */
+    if (!append) {
+        fprintf(fp, "timestamp,cgroup,usage_usec,nr_periods,nr_throttled,throttled_usec,");
+        fprintf(fp, "memory_current,memory_limit,read_bytes,write_bytes,read_ios,write_ios,");
+        fprintf(fp, "pids_current,cpu_cores,cpu_limit_percent,throttle_rate,throttled_percent,");
+        fprintf(fp, "memory_percent,read_rate,write_rate,read_iops,write_iops,");
+        fprintf(fp, "discard_rate,discard_iops\n");
+    }
+
+    char path[MAX_CGROUP_PATH * 2 + 3];
+    fprintf(fp, "%ld.%09ld,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,"
+            "%.4f,%.2f,%.4f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+            metrics->cpu.timestamp.tv_sec, metrics->cpu.timestamp.tv_nsec,
+            cgroup_csv_quote(metrics->cgroup_path, path, sizeof(path)),
+            metrics->cpu.usage_usec, metrics->cpu.nr_periods,
+            metrics->cpu.nr_throttled, metrics->cpu.throttled_usec,
+            metrics->memory.current, metrics->memory.limit,
+            metrics->blkio.read_bytes, metrics->blkio.write_bytes,
+            metrics->blkio.read_iops, metrics->blkio.write_iops, metrics->pids.current,
+            rates->cpu_cores, rates->cpu_limit_percent, rates->throttle_rate,
+            rates->throttled_percent, rates->memory_percent, rates->read_rate,
+            rates->write_rate, rates->read_iops, rates->write_iops,
+            rates->discard_rate, rates->discard_iops);
+
+    fclose(fp);
+    return 0;
+}
+
+int cgroup_export_devices_csv(const cgroup_metrics_t *metrics, const char *filename, int append) {
+    if (!metrics || !filename) {
+        return -1;
+    }
+
+    FILE *fp = fopen(filename, append ? "a" : "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    /* Write header if new file */
+    if (!append) {
+        fprintf(fp, "timestamp,cgroup,device,major,minor,rbytes,wbytes,dbytes,rios,wios,dios,");
+        fprintf(fp, "read_rate,write_rate,discard_rate,read_iops,write_iops,discard_iops,");
+        fprintf(fp, "cost_vrate,cost_usage_percent,cost_wait_percent,cost_indebt_percent,");
+        fprintf(fp, "cost_indelay_percent,avg_lat_usec,latency_target_usec,delay_nsec\n");
+    }
+
+    char path[MAX_CGROUP_PATH * 2 + 3];
+    cgroup_csv_quote(metrics->cgroup_path, path, sizeof(path));
+    const cgroup_blkio_t *blkio = &metrics->blkio;
+    for (int d = 0; d < blkio->device_count; d++) {
+        const cgroup_io_device_t *device = &blkio->devices[d];
+        fprintf(fp, "%ld.%09ld,%s,%s,%u,%u,%lu,%lu,%lu,%lu,%lu,%lu,"
+                "%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%lu,%lu,%lu\n",
+                blkio->timestamp.tv_sec, blkio->timestamp.tv_nsec, path,
+                device->name, device->major, device->minor,
+                device->rbytes, device->wbytes, device->dbytes,
+                device->rios, device->wios, device->dios,
+                device->read_rate, device->write_rate, device->discard_rate,
+                device->read_iops, device->write_iops, device->discard_iops,
+                device->cost_vrate, device->cost_usage_percent, device->cost_wait_percent,
+                device->cost_indebt_percent, device->cost_indelay_percent,
+                device->avg_lat_usec, device->latency_target_usec, device->delay_nsec);
+    }
+
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,498 @@
+#include "../include/cgroup_tree.h"
+#include "../include/procfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define TREE_GETDENTS_BUFFER_SIZE 32768
+
+typedef struct {
+    pthread_t thread;
+    int index;
+    unsigned long seen;          /* Last generation handled */
+} tree_worker_t;
+
+static tree_worker_t workers[CGROUP_TREE_MAX_THREADS];
+static int worker_count = 0;
+static int root_fd = -1;
+
+/* Work hand-off, as in the /proc scanner: the sweeping thread bumps
+ * generation, workers report done */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t work_done = PTHREAD_COND_INITIALIZER;
+static unsigned long generation = 0;
+static int pending_workers = 0;
+static int shutting_down = 0;
+
+static char root_path[MAX_CGROUP_PATH];    /* Sweep root relative to the mount */
+static cgroup_tree_node_t *sweep_nodes = NULL;
+static int sweep_count = 0;
+
+/* Path for openat() relative to the root descriptor */
+static const char *node_relative(const cgroup_tree_node_t *node) {
+    return node->path[1] ? node->path + 1 : ".";
+}
+
+/* Stable across sweeps, so a cgroup keeps its worker and cached descriptors */
+static unsigned int node_shard(const cgroup_tree_node_t *node) {
+    unsigned int hash = 5381;
+    for (const char *c = node->path; *c; c++) {
+        hash = hash * 33 + (unsigned char)*c;
+    }
+    return hash % (unsigned int)worker_count;
+}
+
+static void collect_node(cgroup_tree_node_t *node) {
+    char path[MAX_CGROUP_PATH * 2];
+    snprintf(path, sizeof(path), "%s%s", root_path, node->path);
+
+    /* Sized for io.stat, the largest of the files */
+    char buffer[CGROUP_IO_STAT_SIZE];
+    char *saveptr;
+
+    if (cgroup_read_file(path, CGROUP_FILE_CPU_STAT, buffer, sizeof(buffer)) >= 0) {
+        node->has_cpu = 1;
+        for (char *line = strtok_r(buffer, "\n", &saveptr); line;
+             line = strtok_r(NULL, "\n", &saveptr)) {
+            if (sscanf(line, "usage_usec %lu", &node->usage_usec) == 1) continue;
+            if (sscanf(line, "throttled_usec %lu", &node->throttled_usec) == 1) continue;
+        }
+    }
+
+    if (cgroup_read_file(path, CGROUP_FILE_MEMORY_CURRENT, buffer, sizeof(buffer)) >= 0) {
+        node->has_memory = 1;
+        node->memory_current = strtoull(buffer, NULL, 10);
+    }
+
+    if (cgroup_read_file(path, CGROUP_FILE_PIDS_CURRENT, buffer, sizeof(buffer)) >= 0) {
+        node->has_pids = 1;
+        node->pids_current = strtoull(buffer, NULL, 10);
+    }
+
+    /* Summed over the devices by the shared io.stat parser */
+    if (cgroup_read_file(path, CGROUP_FILE_IO_STAT, buffer, sizeof(buffer)) >= 0) {
+        cgroup_blkio_t blkio;
+        cgroup_parse_io_stat(buffer, &blkio);
+        node->has_io = 1;
+        node->read_bytes = blkio.read_bytes;
+        node->write_bytes = blkio.write_bytes;
+        node->read_ios = blkio.read_iops;
+        node->write_ios = blkio.write_iops;
+    }
+}
+
+static void *worker_main(void *arg) {
+    tree_worker_t *worker = arg;
+    unsigned long seen = worker->seen;
+
+    for (;;) {
+        pthread_mutex_lock(&pool_lock);
+        while (generation == seen && !shutting_down) {
+            pthread_cond_wait(&work_ready, &pool_lock);
+        }
+        if (shutting_down) {
+            pthread_mutex_unlock(&pool_lock);
+            break;
+        }
+        seen = generation;
+        cgroup_tree_node_t *nodes = sweep_nodes;
+        int count = sweep_count;
+        pthread_mutex_unlock(&pool_lock);
+
+        /* Nodes are pre-allocated, so each worker fills its shard in place */
+        int shard_size = 0;
+        for (int i = 0; i < count; i++) {
+            if ((int)node_shard(&nodes[i]) == worker->index) {
+                collect_node(&nodes[i]);
+                shard_size++;
+            }
+        }
+
+        /* Descriptors of removed cgroups linger in the cache; start over
+         * once they clearly outnumber the live shard */
+        if (cgroup_cached_count() > 2 * shard_size + 64) {
+            cgroup_cache_cleanup();
+        }
+
+        pthread_mutex_lock(&pool_lock);
+        if (--pending_workers == 0) {
+            pthread_cond_signal(&work_done);
+        }
+        pthread_mutex_unlock(&pool_lock);
+    }
+
+    cgroup_cache_cleanup();
+    return NULL;
+}
+
+int cgroup_tree_init(const char *root, int threads) {
+    if (worker_count > 0) {
+        return 0;
+    }
+    if (!root) {
+        root = "/";
+    }
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int)cpus : 1;
+    }
+    if (threads > CGROUP_TREE_MAX_THREADS) {
+        threads = CGROUP_TREE_MAX_THREADS;
+    }
+
+    char path[MAX_CGROUP_PATH * 2];
+    snprintf(path, sizeof(path), "%s/%s", cgroup_get_mount_point(), root);
+    snprintf(root_path, sizeof(root_path), "%s", root);
+    root_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    shutting_down = 0;
+    for (int i = 0; i < threads; i++) {
+        memset(&workers[i], 0, sizeof(tree_worker_t));
+        workers[i].index = i;
+        workers[i].seen = generation;
+        int err = pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+        if (err != 0) {
+            fprintf(stderr, "Failed to start cgroup sweep thread: %s\n", strerror(err));
+            break;
+        }
+        worker_count++;
+    }
+
+    if (worker_count == 0) {
+        close(root_fd);
+        root_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void cgroup_tree_cleanup(void) {
+    pthread_mutex_lock(&pool_lock);
+    shutting_down = 1;
+    pthread_cond_broadcast(&work_ready);
+    pthread_mutex_unlock(&pool_lock);
+
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+        memset(&workers[i], 0, sizeof(tree_worker_t));
+    }
+    worker_count = 0;
+
+    if (root_fd >= 0) {
+        close(root_fd);
+        root_fd = -1;
+    }
+}
+
+int cgroup_tree_thread_count(void) {
+    return worker_count;
+}
+
+static cgroup_tree_node_t *append_node(cgroup_tree_result_t *result) {
+    if (result->count == result->capacity) {
+        int new_capacity = result->capacity ? result->capacity * 2 : 256;
+        cgroup_tree_node_t *grown = realloc(result->nodes,
+                                            new_capacity * sizeof(cgroup_tree_node_t));
+        if (!grown) {
+            return NULL;
+        }
+        result->nodes = grown;
+        result->capacity = new_capacity;
+    }
+    cgroup_tree_node_t *node = &result->nodes[result->count++];
+    memset(node, 0, sizeof(cgroup_tree_node_t));
+    return node;
+}
+
+/* List the child cgroups of nodes[index] and append them to the result */
+static int walk_node(cgroup_tree_result_t *result, int index) {
+    int dirfd = openat(root_fd, node_relative(&result->nodes[index]),
+                       O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0) {
+        /* Removed since its parent was listed */
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(dirfd, &st) == 0) {
+        result->nodes[index].id = st.st_ino;
+    }
+
+    char buffer[TREE_GETDENTS_BUFFER_SIZE] __attribute__((aligned(8)));
+    for (;;) {
+        long len = syscall(SYS_getdents64, dirfd, buffer, sizeof(buffer));
+        if (len <= 0) {
+            break;
+        }
+
+        for (long offset = 0; offset < len; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buffer + offset);
+            offset += d->d_reclen;
+
+            /* Interface files are regular; every directory is a child cgroup */
+            if (d->d_type != DT_DIR || strcmp(d->d_name, ".") == 0 ||
+                strcmp(d->d_name, "..") == 0) {
+                continue;
+            }
+
+            /* append_node() may move the array */
+            const char *parent = result->nodes[index].path;
+            char path[MAX_CGROUP_PATH];
+            int n = snprintf(path, sizeof(path), "%s/%s", parent[1] ? parent : "", d->d_name);
+            if (n < 0 || n >= (int)sizeof(path)) {
+                continue;
+            }
+            int depth = result->nodes[index].depth + 1;
+
+            cgroup_tree_node_t *child = append_node(result);
+            if (!child) {
+                close(dirfd);
+                errno = ENOMEM;
+                return -1;
+            }
+            memcpy(child->path, path, n + 1);
+            child->depth = depth;
+        }
+    }
+
+    close(dirfd);
+    return 0;
+}
+
+static int compare_node_path(const void *a, const void *b) {
+    return strcmp(((const cgroup_tree_node_t *)a)->path, ((const cgroup_tree_node_t *)b)->path);
+}
+
+int cgroup_tree_scan(cgroup_tree_result_t *result) {
+    if (!result || worker_count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* Breadth-first: the result array doubles as the queue */
+    result->count = 0;
+    cgroup_tree_node_t *root = append_node(result);
+    if (!root) {
+        errno = ENOMEM;
+        return -1;
+    }
+    snprintf(root->path, sizeof(root->path), "/");
+    for (int i = 0; i < result->count; i++) {
+        if (walk_node(result, i) != 0 && errno == ENOMEM) {
+            fprintf(stderr, "Out of memory walking the cgroup tree\n");
+            return -1;
+        }
+    }
+
+    struct timespec walked;
+    clock_gettime(CLOCK_MONOTONIC, &walked);
+
+    pthread_mutex_lock(&pool_lock);
+    sweep_nodes = result->nodes;
+    sweep_count = result->count;
+    pending_workers = worker_count;
+    generation++;
+    pthread_cond_broadcast(&work_ready);
+    while (pending_workers > 0) {
+        pthread_cond_wait(&work_done, &pool_lock);
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    qsort(result->nodes, result->count, sizeof(cgroup_tree_node_t), compare_node_path);
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->timestamp = end;
+    result->walk_ms = (walked.tv_sec - start.tv_sec) * 1e3 +
+                      (walked.tv_nsec - start.tv_nsec) / 1e6;
+    result->scan_ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    return result->count;
+}
+
+void cgroup_tree_calculate_rates(const cgroup_tree_result_t *prev, cgroup_tree_result_t *curr) {
+    if (!prev || !curr) {
+        return;
+    }
+
+    double seconds = (curr->timestamp.tv_sec - prev->timestamp.tv_sec) +
+                     (curr->timestamp.tv_nsec - prev->timestamp.tv_nsec) / 1e9;
+    if (seconds <= 0.0) {
+        return;
+    }
+
+    /* Both arrays are sorted by path: walk them in step */
+    int j = 0;
+    for (int i = 0; i < curr->count; i++) {
+        cgroup_tree_node_t *node = &curr->nodes[i];
+        while (j < prev->count && strcmp(prev->nodes[j].path, node->path) < 0) {
+            j++;
+        }
+        if (j >= prev->count || strcmp(prev->nodes[j].path, node->path) != 0) {
+            continue;
+        }
+
+        const cgroup_tree_node_t *old = &prev->nodes[j];
+        /* A different inode means the cgroup was removed and created again */
+        if (old->id != node->id) {
+            continue;
+        }
+
+        if (node->has_cpu && old->has_cpu && node->usage_usec >= old->usage_usec) {
+            node->cpu_percent = (node->usage_usec - old->usage_usec) / (seconds * 1e4);
+        }
+        if (node->has_io && old->has_io) {
+            if (node->read_bytes >= old->read_bytes) {
+                node->read_rate = (node->read_bytes - old->read_bytes) / seconds;
+            }
+            if (node->write_bytes >= old->write_bytes) {
+                node->write_rate = (node->write_bytes - old->write_bytes) / seconds;
+            }
+        }
+    }
+}
+
+void cgroup_tree_result_free(cgroup_tree_result_t *result) {
+    if (!result) {
+        return;
+    }
+    free(result->nodes);
+    memset(result, 0, sizeof(cgroup_tree_result_t));
+}
+
+int cgroup_tree_parse_sort(const char *name, cgroup_tree_sort_t *sort) {
+    if (!name || !sort) {
+        return -1;
+    }
+    if (strcmp(name, "cpu") == 0) {
+        *sort = CGROUP_TREE_SORT_CPU;
+    } else if (strcmp(name, "memory") == 0 || strcmp(name, "mem") == 0) {
+        *sort = CGROUP_TREE_SORT_MEMORY;
+    } else if (strcmp(name, "io") == 0) {
+        *sort = CGROUP_TREE_SORT_IO;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static double sort_value(const cgroup_tree_node_t *node, cgroup_tree_sort_t sort) {
+    switch (sort) {
+        case CGROUP_TREE_SORT_MEMORY:
+            return (double)node->memory_current;
+        case CGROUP_TREE_SORT_IO:
+            return node->read_rate + node->write_rate;
+        case CGROUP_TREE_SORT_CPU:
+        default:
+            return node->cpu_percent;
+    }
+}
+
+static cgroup_tree_sort_t print_sort;
+
+static int compare_node_sort(const void *a, const void *b) {
+    const cgroup_tree_node_t *na = *(const cgroup_tree_node_t *const *)a;
+    const cgroup_tree_node_t *nb = *(const cgroup_tree_node_t *const *)b;
+    double va = sort_value(na, print_sort);
+    double vb = sort_value(nb, print_sort);
+    if (va != vb) {
+        return (va < vb) ? 1 : -1;
+    }
+    /* Ties keep the tree order, parents ahead of their children */
+    return strcmp(na->path, nb->path);
+}
+
+void cgroup_tree_print(const cgroup_tree_result_t *result, cgroup_tree_sort_t sort, int top_n) {
+    if (!result) {
+        return;
+    }
+
+    printf("=== Cgroup Sweep: %d cgroups in %.2f ms (walk %.2f ms, %d threads) ===\n",
+           result->count, result->scan_ms, result->walk_ms, worker_count);
+
+    if (result->count == 0 || top_n <= 0) {
+        printf("\n");
+        return;
+    }
+
+    const cgroup_tree_node_t **order = malloc(result->count * sizeof(*order));
+    if (!order) {
+        return;
+    }
+    for (int i = 0; i < result->count; i++) {
+        order[i] = &result->nodes[i];
+    }
+    print_sort = sort;
+    qsort(order, result->count, sizeof(*order), compare_node_sort);
+
+    if (top_n > result->count) {
+        top_n = result->count;
+    }
+
+    printf("%6s %8s %12s %12s %12s  %s\n",
+           "TASKS", "CPU%", "MEMORY(KB)", "READ(B/s)", "WRITE(B/s)", "PATH");
+    for (int i = 0; i < top_n; i++) {
+        const cgroup_tree_node_t *n = order[i];
+        char tasks[24] = "-", memory[24] = "-", read_rate[24] = "-", write_rate[24] = "-";
+        if (n->has_pids) {
+            snprintf(tasks, sizeof(tasks), "%lu", n->pids_current);
+        }
+        if (n->has_memory) {
+            snprintf(memory, sizeof(memory), "%lu", n->memory_current / 1024);
+        }
+        if (n->has_io) {
+            snprintf(read_rate, sizeof(read_rate), "%.0f", n->read_rate);
+            snprintf(write_rate, sizeof(write_rate), "%.0f", n->write_rate);
+        }
+        printf("%6s %8.2f %12s %12s %12s  %s\n",
+               tasks, n->cpu_percent, memory, read_rate, write_rate, n->path);
+    }
+    printf("\n");
+    free(order);
+}
+
+int cgroup_tree_export_csv(const cgroup_tree_result_t *result, const char *filename, int append) {
+    if (!result || !filename) {
+        return -1;
+    }
+
+    FILE *fp = fopen(filename, append ? "a" : "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    if (!append) {
+        fprintf(fp, "timestamp,path,depth,id,usage_usec,throttled_usec,cpu_percent,");
+        fprintf(fp, "memory_current,read_bytes,write_bytes,read_ios,write_ios,");
+        fprintf(fp, "read_rate,write_rate,pids_current\n");
+    }
+
+    char path[MAX_CGROUP_PATH * 2 + 3];
+    for (int i = 0; i < result->count; i++) {
+        const cgroup_tree_node_t *n = &result->nodes[i];
+        fprintf(fp, "%ld.%09ld,%s,%d,%lu,%lu,%lu,%.2f,%lu,%lu,%lu,%lu,%lu,%.2f,%.2f,%lu\n",
+                result->timestamp.tv_sec, result->timestamp.tv_nsec,
+                cgroup_csv_quote(n->path, path, sizeof(path)), n->depth, (unsigned long)n->id, n->usage_usec, n->throttled_usec,
+                n->cpu_percent, n->memory_current, n->read_bytes, n->write_bytes,
+                n->read_ios, n->write_ios, n->read_rate, n->write_rate, n->pids_current);
+    }
+
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include "../include/collector.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#define NSEC_PER_SEC 1000000000ULL
+
+static const unsigned int default_cadence[COST_CLASS_COUNT] = {
+    COLLECTOR_CADENCE_CHEAP, COLLECTOR_CADENCE_MEDIUM, COLLECTOR_CADENCE_EXPENSIVE
+};
+
+/* Relative weight of a class when spreading phases */
+static const unsigned int cost_weight[COST_CLASS_COUNT] = { 0, 1, 4 };
+
+static const char *cost_names[COST_CLASS_COUNT] = { "cheap", "medium", "expensive" };
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static unsigned int gcd(unsigned int a, unsigned int b) {
+    while (b) {
+        unsigned int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+int collector_init(collector_t *collector, double budget) {
+    if (!collector || budget < 0.0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(collector, 0, sizeof(collector_t));
+    collector->budget = budget;
+    for (int i = 0; i < COST_CLASS_COUNT; i++) {
+        collector->stretch[i] = 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &collector->window_start);
+    collector->window_cpu_start_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    return 0;
+}
+
+int collector_register(collector_t *collector, const char *name, cost_class_t cost,
+                       unsigned int cadence, source_collect_t collect, void *arg) {
+    if (!collector || !collect || cost < 0 || cost >= COST_CLASS_COUNT) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (collector->count >= COLLECTOR_MAX_SOURCES) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    metric_source_t *source = &collector->sources[collector->count];
+    memset(source, 0, sizeof(metric_source_t));
+    source->name = name;
+    source->cost = cost;
+    source->cadence = cadence ? cadence : default_cadence[cost];
+    source->collect = collect;
+    source->arg = arg;
+
+    /* Two sources meet on some tick iff their phases agree modulo the gcd
+     * of their cadences; take the phase with the least weight of costly
+     * sources already meeting it */
+    unsigned int best_load = ~0u;
+    for (unsigned int phase = 0; phase < source->cadence && cost_weight[cost] > 0; phase++) {
+        unsigned int load = 0;
+        for (int i = 0; i < collector->count; i++) {
+            const metric_source_t *other = &collector->sources[i];
+            unsigned int g = gcd(source->cadence, other->cadence);
+            if (phase % g == other->phase % g) {
+                load += cost_weight[other->cost];
+            }
+        }
+        if (load < best_load) {
+            best_load = load;
+            source->phase = phase;
+        }
+    }
+
+    return collector->count++;
+}
+
+unsigned int collector_cadence(const collector_t *collector, int index) {
+    const metric_source_t *source = &collector->sources[index];
+    return source->cadence * collector->stretch[source->cost];
+}
+
+int collector_is_due(const collector_t *collector, int index, uint64_t tick) {
+    if (!collector || index < 0 || index >= collector->count) {
+        return 0;
+    }
+    /* Every source runs on the first tick, so no reading waits a full cadence */
+    if (collector->sources[index].runs == 0) {
+        return 1;
+    }
+    unsigned int cadence = collector_cadence(collector, index);
+    return tick % cadence == collector->sources[index].phase % cadence;
+}
+
+/* Stretch the class costing the most CPU when over budget, relax the
+ * cheapest stretched class when well under it */
+static void check_budget(collector_t *collector) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double wall = (now.tv_sec - collector->window_start.tv_sec) +
+                  (now.tv_nsec - collector->window_start.tv_nsec) / 1e9;
+    if (wall < COLLECTOR_BUDGET_WINDOW) {
+        return;
+    }
+
+    uint64_t cpu_now = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    collector->usage = (cpu_now - collector->window_cpu_start_ns) / 1e9 / wall;
+
+    if (collector->budget > 0.0) {
+        if (collector->usage > collector->budget) {
+            int target = -1;
+            for (int c = COST_MEDIUM; c < COST_CLASS_COUNT; c++) {
+                if (collector->stretch[c] < COLLECTOR_MAX_STRETCH &&
+                    collector->window_class_ns[c] > 0 &&
+                    (target < 0 || collector->window_class_ns[c] > collector->window_class_ns[target])) {
+                    target = c;
+                }
+            }
+            if (target >= 0) {
+                collector->stretch[target] *= 2;
+                collector->adjustments++;
+            } else if (!collector->over_budget_warned) {
+                fprintf(stderr, "Warning: monitor uses %.2f%% of a core, over the %.2f%% budget "
+                        "with every costly source stretched; raise -i\n",
+                        collector->usage * 100.0, collector->budget * 100.0);
+                collector->over_budget_warned = 1;
+            }
+        } else if (collector->usage < collector->budget / 2) {
+            for (int c = COST_MEDIUM; c < COST_CLASS_COUNT; c++) {
+                if (collector->stretch[c] > 1) {
+                    collector->stretch[c] /= 2;
+                    collector->adjustments++;
+                    break;
+                }
+            }
+        }
+    }
+
+    collector->window_start = now;
+    collector->window_cpu_start_ns = cpu_now;
+    memset(collector->window_class_ns, 0, sizeof(collector->window_class_ns));
+}
+
+int collector_run(collector_t *collector, uint64_t tick, pid_t pid) {
+    if (!collector) {
+        return -1;
+    }
+
+    int failures = 0;
+    for (int i = 0; i < collector->count; i++) {
+        if (!collector_is_due(collector, i, tick)) {
+            continue;
+        }
+
+        metric_source_t *source = &collector->sources[i];
+        uint64_t start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+        if (source->collect(pid, source->arg) != 0) {
+            source->failures++;
+            failures++;
+        }
+        uint64_t spent = clock_ns(CLOCK_THREAD_CPUTIME_ID) - start;
+
+        source->runs++;
+        source->cpu_ns += spent;
+        collector->window_class_ns[source->cost] += spent;
+    }
+
+    check_budget(collector);
+    return failures;
+}
+
+void print_collector_stats(const collector_t *collector) {
+    if (!collector || collector->count == 0) {
+        return;
+    }
+
+    printf("Collection tiers (monitor CPU %.2f%% of a core", collector->usage * 100.0);
+    if (collector->budget > 0.0) {
+        printf(", budget %.2f%%, %lu adjustment(s)", collector->budget * 100.0,
+               collector->adjustments);
+    }
+    printf("):\n");
+
+    for (int i = 0; i < collector->count; i++) {
+        const metric_source_t *source = &collector->sources[i];
+        printf("  %-14s %-9s every %3u tick(s), phase %2u: %lu reads, %.1f us/read",
+               source->name ? source->name : "?", cost_names[source->cost],
+               collector_cadence(collector, i), source->phase, source->runs,
+               source->runs ? source->cpu_ns / 1e3 / source->runs : 0.0);
+        if (source->failures) {
+            printf(", %lu failed", source->failures);
+        }
+        printf("\n");
+    }
+}
@@ -1,4 +1,5 @@
 #include "../include/monitor.h"
+#include "../include/procfs.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,6 +9,7 @@
 static long clock_ticks_per_sec = 0;
 
 int cpu_monitor_init(void) {
+    procfs_init();
     clock_ticks_per_sec = sysconf(_SC_CLK_TCK);
     if (clock_ticks_per_sec <= 0) {
         fprintf(stderr, "Failed to get clock ticks per second\n");
@@ -17,7 +19,7 @@ int cpu_monitor_init(void) {
 }
 
 void cpu_monitor_cleanup(void) {
-    /* Nothing to cleanup */
+    procfs_cleanup();
 }
 
 int process_exists(pid_t pid) {
@@ -30,73 +32,53 @@ int get_system_clock_ticks(void) {
     return (int)clock_ticks_per_sec;
 }
 
-int cpu_monitor_collect(pid_t pid, cpu_metrics_t *metrics) {
-    if (!metrics) {
-        fprintf(stderr, "NULL metrics pointer\n");
+int cpu_monitor_from_snapshot(const proc_snapshot_t *snap, cpu_metrics_t *metrics) {
+    if (!snap || !metrics) {
+        fprintf(stderr, "NULL pointer in cpu_monitor_from_snapshot\n");
         return -1;
     }
 
-    if (!process_exists(pid)) {
-        fprintf(stderr, "Process %d does not exist\n", pid);
-        return -1;
-    }
-
-    /* Read /proc/[pid]/stat */
-    char stat_path[256];
-    snprintf(stat_path, sizeof(stat_path), "/proc/%d/stat", pid);
-
-    FILE *fp = fopen(stat_path, "r");
-    if (!fp) {
-        fprintf(stderr, "Failed to open %s: %s\n", stat_path, strerror(errno));
+    if (!(snap->files & (PROCFS_SNAP_STAT | PROCFS_SNAP_TASKSTATS))) {
         return -1;
     }
 
-    /* Parse stat file - format: pid (comm) state ppid ... */
-    int items = fscanf(fp, "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
-                          "%lu %lu %lu %lu %*d %*d %ld",
-                          &metrics->utime, &metrics->stime,
-                          &metrics->cutime, &metrics->cstime,
-                          &metrics->num_threads);
-    fclose(fp);
-
-    if (items != 5) {
-        fprintf(stderr, "Failed to parse %s\n", stat_path);
-        return -1;
-    }
-
-    metrics->pid = pid;
+    metrics->pid = snap->pid;
+    metrics->utime = snap->utime;
+    metrics->stime = snap->stime;
+    metrics->cutime = snap->cutime;
+    metrics->cstime = snap->cstime;
+    metrics->num_threads = snap->num_threads;
+    metrics->voluntary_ctxt_switches = snap->voluntary_ctxt_switches;
+    metrics->nonvoluntary_ctxt_switches = snap->nonvoluntary_ctxt_switches;
+    metrics->cpu_time_ns = snap->cpu_time_ns;
+    metrics->runqueue_wait_ns = snap->cpu_delay_ns;
+    metrics->timeslices = snap->timeslices;
+    metrics->has_delays = snap->has_delays;
+    metrics->blkio_delay_ns = snap->blkio_delay_ns;
+    metrics->swapin_delay_ns = snap->swapin_delay_ns;
+    metrics->timestamp = snap->timestamp;
+    metrics->cpu_percent = 0.0;
 
-    /* Read /proc/[pid]/status for context switches */
-    char status_path[256];
-    snprintf(status_path, sizeof(status_path), "/proc/%d/status", pid);
+    return 0;
+}
 
-    fp = fopen(status_path, "r");
-    if (!fp) {
-        fprintf(stderr, "Failed to open %s: %s\n", status_path, strerror(errno));
+int cpu_monitor_collect(pid_t pid, cpu_metrics_t *metrics) {
+    if (!metrics) {
+        fprintf(stderr, "NULL metrics pointer\n");
         return -1;
     }
 
-    char line[256];
-    metrics->voluntary_ctxt_switches = 0;
-    metrics->nonvoluntary_ctxt_switches = 0;
-
-    while (fgets(line, sizeof(line), fp)) {
-        if (sscanf(line, "voluntary_ctxt_switches: %lu",
-                   &metrics->voluntary_ctxt_switches) == 1) {
-            continue;
-        }
-        if (sscanf(line, "nonvoluntary_ctxt_switches: %lu",
-                   &metrics->nonvoluntary_ctxt_switches) == 1) {
-            continue;
+    proc_snapshot_t snap;
+    if (proc_snapshot_take(pid, proc_snapshot_files_for(1, 0, 0), &snap) != 0) {
+        if (procfs_is_gone_error(errno)) {
+            fprintf(stderr, "Process %d does not exist\n", pid);
+        } else {
+            fprintf(stderr, "Failed to read /proc/%d: %s\n", pid, strerror(errno));
         }
+        return -1;
     }
-    fclose(fp);
 
-    /* Get timestamp */
-    clock_gettime(CLOCK_MONOTONIC, &metrics->timestamp);
-    metrics->cpu_percent = 0.0;
-
-    return 0;
+    return cpu_monitor_from_snapshot(&snap, metrics);
 }
 
 int cpu_monitor_calculate_percentage(const cpu_metrics_t *prev,
@@ -119,11 +101,14 @@ int cpu_monitor_calculate_percentage(const cpu_metrics_t *prev,
         return -1;
     }
 
-    /* Calculate CPU time delta in clock ticks */
-    uint64_t total_ticks = (curr->utime + curr->stime) - (prev->utime + prev->stime);
-
-    /* Convert to seconds and calculate percentage */
-    double cpu_time = (double)total_ticks / clock_ticks_per_sec;
+    /* Prefer the ns scheduler runtime; fall back to clock ticks */
+    double cpu_time;
+    if (prev->cpu_time_ns > 0 && curr->cpu_time_ns >= prev->cpu_time_ns) {
+        cpu_time = (curr->cpu_time_ns - prev->cpu_time_ns) / 1e9;
+    } else {
+        uint64_t total_ticks = (curr->utime + curr->stime) - (prev->utime + prev->stime);
+        cpu_time = (double)total_ticks / clock_ticks_per_sec;
+    }
     result->cpu_percent = (cpu_time / elapsed) * 100.0;
 
     return 0;
@@ -140,6 +125,17 @@ void print_cpu_metrics(const cpu_metrics_t *metrics) {
     printf("Threads:       %ld\n", metrics->num_threads);
     printf("Voluntary context switches:    %lu\n", metrics->voluntary_ctxt_switches);
     printf("Nonvoluntary context switches: %lu\n", metrics->nonvoluntary_ctxt_switches);
+    if (metrics->cpu_time_ns > 0) {
+        printf("CPU time:      %.3f ms\n", metrics->cpu_time_ns / 1e6);
+        printf("Run-queue wait: %.3f ms over %lu timeslices\n",
+               metrics->runqueue_wait_ns / 1e6, metrics->timeslices);
+        if (metrics->has_delays) {
+            printf("Block I/O delay: %.3f ms, swap-in delay: %.3f ms\n",
+                   metrics->blkio_delay_ns / 1e6, metrics->swapin_delay_ns / 1e6);
+        } else if (proc_snapshot_get_backend() == PROCFS_BACKEND_TASKSTATS) {
+            printf("Block I/O delay: n/a, swap-in delay: n/a (kernel.task_delayacct=0)\n");
+        }
+    }
     printf("CPU usage:     %.2f%%\n", metrics->cpu_percent);
     printf("\n");
 }
@@ -164,6 +160,17 @@ int export_cpu_metrics_json(const cpu_metrics_t *metrics, const char *filename)
     fprintf(fp, "  \"num_threads\": %ld,\n", metrics->num_threads);
     fprintf(fp, "  \"voluntary_ctxt_switches\": %lu,\n", metrics->voluntary_ctxt_switches);
     fprintf(fp, "  \"nonvoluntary_ctxt_switches\": %lu,\n", metrics->nonvoluntary_ctxt_switches);
+    fprintf(fp, "  \"cpu_time_ns\": %lu,\n", metrics->cpu_time_ns);
+    fprintf(fp, "  \"runqueue_wait_ns\": %lu,\n", metrics->runqueue_wait_ns);
+    fprintf(fp, "  \"timeslices\": %lu,\n", metrics->timeslices);
+    /* null rather than 0 when delay accounting was off */
+    if (metrics->has_delays) {
+        fprintf(fp, "  \"blkio_delay_ns\": %lu,\n", metrics->blkio_delay_ns);
+        fprintf(fp, "  \"swapin_delay_ns\": %lu,\n", metrics->swapin_delay_ns);
+    } else {
+        fprintf(fp, "  \"blkio_delay_ns\": null,\n");
+        fprintf(fp, "  \"swapin_delay_ns\": null,\n");
+    }
     fprintf(fp, "  \"cpu_percent\": %.2f,\n", metrics->cpu_percent);
     fprintf(fp, "  \"timestamp\": %ld.%09ld\n", metrics->timestamp.tv_sec, metrics->timestamp.tv_nsec);
     fprintf(fp, "}\n");
@@ -186,15 +193,23 @@ int export_cpu_metrics_csv(const cpu_metrics_t *metrics, const char *filename, i
     /* Write header if new file */
     if (!append) {
         fprintf(fp, "timestamp,pid,utime,stime,cutime,cstime,num_threads,");
-        fprintf(fp, "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,cpu_percent\n");
+        fprintf(fp, "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,cpu_percent,");
+        fprintf(fp, "cpu_time_ns,runqueue_wait_ns,timeslices,blkio_delay_ns,swapin_delay_ns\n");
     }
 
-    fprintf(fp, "%ld.%09ld,%d,%lu,%lu,%lu,%lu,%ld,%lu,%lu,%.2f\n",
+    fprintf(fp, "%ld.%09ld,%d,%lu,%lu,%lu,%lu,%ld,%lu,%lu,%.2f,%lu,%lu,%lu",
             metrics->timestamp.tv_sec, metrics->timestamp.tv_nsec,
             metrics->pid, metrics->utime, metrics->stime,
             metrics->cutime, metrics->cstime, metrics->num_threads,
             metrics->voluntary_ctxt_switches, metrics->nonvoluntary_ctxt_switches,
-            metrics->cpu_percent);
+            metrics->cpu_percent, metrics->cpu_time_ns, metrics->runqueue_wait_ns,
+            metrics->timeslices);
+    /* Empty fields when delay accounting was off */
+    if (metrics->has_delays) {
+        fprintf(fp, ",%lu,%lu\n", metrics->blkio_delay_ns, metrics->swapin_delay_ns);
+    } else {
+        fprintf(fp, ",,\n");
+    }
 
     fclose(fp);
     return 0;
@@ -0,0 +1,244 @@
+#include "../include/event_loop.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#define EVENT_BATCH 16
+
+/* epoll data tags for the loop's own descriptors; handler slots use
+ * their index */
+#define TAG_TIMER  (EVENT_LOOP_MAX_FDS)
+#define TAG_SIGNAL (EVENT_LOOP_MAX_FDS + 1)
+
+typedef struct {
+    int fd;                      /* -1 marks a free slot */
+    event_handler_t handler;
+    void *arg;
+} fd_slot_t;
+
+typedef struct {
+    sample_subscriber_t subscriber;
+    void *arg;
+} subscriber_t;
+
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static int signal_fd = -1;
+static sigset_t saved_mask;
+static volatile int *running_flag = NULL;
+static int woken = 0;
+
+static fd_slot_t slots[EVENT_LOOP_MAX_FDS];
+static subscriber_t subscribers[EVENT_LOOP_MAX_SUBSCRIBERS];
+static int subscriber_count = 0;
+
+static int watch(int fd, uint32_t events, uint32_t tag) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u32 = tag;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int event_loop_init(volatile int *running) {
+    if (!running) {
+        errno = EINVAL;
+        return -1;
+    }
+    running_flag = running;
+    woken = 0;
+    subscriber_count = 0;
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++) {
+        slots[i].fd = -1;
+        slots[i].handler = NULL;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        return -1;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0 || watch(timer_fd, EPOLLIN, TAG_TIMER) != 0) {
+        event_loop_cleanup();
+        return -1;
+    }
+
+    /* Blocked before any worker thread starts, so every thread inherits
+     * the mask and the signals can only arrive through the signalfd */
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    if (sigprocmask(SIG_BLOCK, &mask, &saved_mask) != 0) {
+        event_loop_cleanup();
+        return -1;
+    }
+    signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0 || watch(signal_fd, EPOLLIN, TAG_SIGNAL) != 0) {
+        event_loop_cleanup();
+        return -1;
+    }
+
+    return 0;
+}
+
+void event_loop_cleanup(void) {
+    if (signal_fd >= 0) {
+        close(signal_fd);
+        signal_fd = -1;
+        sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+    }
+    if (timer_fd >= 0) {
+        close(timer_fd);
+        timer_fd = -1;
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++) {
+        slots[i].fd = -1;
+        slots[i].handler = NULL;
+    }
+    subscriber_count = 0;
+}
+
+int event_loop_add_fd(int fd, uint32_t events, event_handler_t handler, void *arg) {
+    if (epoll_fd < 0 || fd < 0 || !handler) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++) {
+        if (slots[i].fd >= 0) {
+            continue;
+        }
+        if (watch(fd, events ? events : EPOLLIN, (uint32_t)i) != 0) {
+            return -1;
+        }
+        slots[i].fd = fd;
+        slots[i].handler = handler;
+        slots[i].arg = arg;
+        return 0;
+    }
+
+    errno = ENOSPC;
+    return -1;
+}
+
+int event_loop_remove_fd(int fd) {
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++) {
+        if (slots[i].fd == fd) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            slots[i].fd = -1;
+            slots[i].handler = NULL;
+            return 0;
+        }
+    }
+    errno = ENOENT;
+    return -1;
+}
+
+void event_loop_wake(void) {
+    woken = 1;
+}
+
+void event_loop_stop(void) {
+    if (running_flag) {
+        *running_flag = 0;
+    }
+}
+
+int event_loop_run_until(const struct timespec *deadline) {
+    if (epoll_fd < 0 || !deadline) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* An all-zero it_value would disarm the timer instead of firing */
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value = *deadline;
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+        its.it_value.tv_nsec = 1;
+    }
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) != 0) {
+        return -1;
+    }
+
+    woken = 0;
+    while (*running_flag) {
+        struct epoll_event events[EVENT_BATCH];
+        int n = epoll_wait(epoll_fd, events, EVENT_BATCH, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        int due = 0;
+        for (int i = 0; i < n; i++) {
+            uint32_t tag = events[i].data.u32;
+            if (tag == TAG_TIMER) {
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+                    due = 1;
+                }
+            } else if (tag == TAG_SIGNAL) {
+                struct signalfd_siginfo info;
+                while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                }
+                *running_flag = 0;
+            } else if (tag < EVENT_LOOP_MAX_FDS && slots[tag].handler) {
+                /* A handler earlier in this batch may have removed the slot */
+                slots[tag].handler(slots[tag].fd, events[i].events, slots[tag].arg);
+            }
+        }
+
+        if (!*running_flag) {
+            return -1;
+        }
+        if (woken) {
+            return 1;
+        }
+        if (due) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int event_loop_subscribe(sample_subscriber_t subscriber, void *arg) {
+    if (!subscriber || subscriber_count >= EVENT_LOOP_MAX_SUBSCRIBERS) {
+        errno = subscriber ? ENOSPC : EINVAL;
+        return -1;
+    }
+    subscribers[subscriber_count].subscriber = subscriber;
+    subscribers[subscriber_count].arg = arg;
+    subscriber_count++;
+    return 0;
+}
+
+void event_loop_publish(const monitor_sample_t *sample) {
+    for (int i = 0; i < subscriber_count; i++) {
+        subscribers[i].subscriber(sample, subscribers[i].arg);
+    }
+}
+
+void monitor_sample_merge_events(monitor_sample_t *shown, const monitor_sample_t *events) {
+    for (int i = 0; i < events->anomaly_count; i++) {
+        if (shown->anomaly_count == MONITOR_SAMPLE_MAX_ANOMALIES) {
+            memmove(&shown->anomalies[0], &shown->anomalies[1],
+                    (MONITOR_SAMPLE_MAX_ANOMALIES - 1) * sizeof(anomaly_event_t));
+            shown->anomaly_count--;
+        }
+        shown->anomalies[shown->anomaly_count++] = events->anomalies[i];
+    }
+}
@@ -0,0 +1,153 @@
+#include "../include/fd_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+static fd_cache_entry_t *entry_at(const fd_cache_t *cache, size_t i) {
+    return (fd_cache_entry_t *)((char *)cache->entries + i * cache->entry_size);
+}
+
+void fd_cache_raise_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+void *fd_cache_slot(const fd_cache_t *cache, size_t i) {
+    return entry_at(cache, i);
+}
+
+static int grow_table(fd_cache_t *cache) {
+    size_t new_capacity = cache->capacity ? cache->capacity * 2 : cache->initial_capacity;
+    char *new_entries = calloc(new_capacity, cache->entry_size);
+    if (!new_entries) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < cache->capacity; i++) {
+        fd_cache_entry_t *entry = entry_at(cache, i);
+        if (!entry->in_use) {
+            continue;
+        }
+        size_t slot = entry->hash & (new_capacity - 1);
+        while (((fd_cache_entry_t *)(new_entries + slot * cache->entry_size))->in_use) {
+            slot = (slot + 1) & (new_capacity - 1);
+        }
+        memcpy(new_entries + slot * cache->entry_size, entry, cache->entry_size);
+    }
+
+    free(cache->entries);
+    cache->entries = new_entries;
+    cache->capacity = new_capacity;
+    return 0;
+}
+
+void *fd_cache_find(const fd_cache_t *cache, uint32_t hash, fd_cache_match_t match,
+                    const void *key) {
+    if (cache->capacity == 0) {
+        return NULL;
+    }
+
+    size_t slot = hash & (cache->capacity - 1);
+    fd_cache_entry_t *entry;
+    while ((entry = entry_at(cache, slot))->in_use) {
+        if (entry->hash == hash && match(entry, key)) {
+            return entry;
+        }
+        slot = (slot + 1) & (cache->capacity - 1);
+    }
+    return NULL;
+}
+
+void *fd_cache_insert(fd_cache_t *cache, uint32_t hash) {
+    /* Keep load factor below 1/2 */
+    if ((cache->count + 1) * 2 > cache->capacity && grow_table(cache) != 0) {
+        return NULL;
+    }
+
+    size_t slot = hash & (cache->capacity - 1);
+    while (entry_at(cache, slot)->in_use) {
+        slot = (slot + 1) & (cache->capacity - 1);
+    }
+
+    /* The slot may hold a stale copy left behind by a backward shift */
+    fd_cache_entry_t *entry = entry_at(cache, slot);
+    memset(entry, 0, cache->entry_size);
+    entry->hash = hash;
+    entry->in_use = 1;
+    cache->count++;
+    return entry;
+}
+
+void fd_cache_remove(fd_cache_t *cache, void *entry, fd_cache_release_t release) {
+    release(entry);
+    ((fd_cache_entry_t *)entry)->in_use = 0;
+    cache->count--;
+
+    /* Backward-shift deletion keeps probe chains intact without tombstones */
+    size_t mask = cache->capacity - 1;
+    size_t hole = (size_t)((char *)entry - (char *)cache->entries) / cache->entry_size;
+    size_t slot = (hole + 1) & mask;
+    fd_cache_entry_t *next;
+    while ((next = entry_at(cache, slot))->in_use) {
+        size_t home = next->hash & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            memcpy(entry_at(cache, hole), next, cache->entry_size);
+            next->in_use = 0;
+            hole = slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+void fd_cache_touch(fd_cache_t *cache, void *entry) {
+    ((fd_cache_entry_t *)entry)->last_used = ++cache->use_clock;
+}
+
+int fd_cache_evict_lru(fd_cache_t *cache, fd_cache_match_t match, const void *keep,
+                       uint32_t min_age, fd_cache_release_t release) {
+    if (cache->count <= 1) {
+        return 0;
+    }
+
+    /* Stamps are relative to use_clock so wrap-around keeps the order */
+    uint32_t oldest_age = 0;
+    for (size_t i = 0; i < cache->capacity; i++) {
+        fd_cache_entry_t *entry = entry_at(cache, i);
+        if (entry->in_use && cache->use_clock - entry->last_used > oldest_age) {
+            oldest_age = cache->use_clock - entry->last_used;
+        }
+    }
+    if (min_age < oldest_age / 2) {
+        min_age = oldest_age / 2;
+    }
+
+    int evicted = 0;
+    for (size_t i = 0; i < cache->capacity; ) {
+        /* fd_cache_remove() shifts a later entry into slot i: look again */
+        fd_cache_entry_t *entry = entry_at(cache, i);
+        if (entry->in_use && !match(entry, keep) &&
+            cache->use_clock - entry->last_used >= min_age) {
+            fd_cache_remove(cache, entry, release);
+            evicted++;
+            continue;
+        }
+        i++;
+    }
+    return evicted;
+}
+
+void fd_cache_clear(fd_cache_t *cache, fd_cache_release_t release) {
+    for (size_t i = 0; i < cache->capacity; i++) {
+        fd_cache_entry_t *entry = entry_at(cache, i);
+        if (entry->in_use) {
+            release(entry);
+        }
+    }
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->capacity = 0;
+    cache->count = 0;
+}
@@ -1,73 +1,71 @@
 #include "../include/monitor.h"
+#include "../include/procfs.h"
+#include "../include/veth_stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 int io_monitor_init(void) {
-    /* Nothing to initialize currently */
-    return 0;
+    return procfs_init();
 }
 
 void io_monitor_cleanup(void) {
-    /* Nothing to clean up currently */
+    procfs_cleanup();
 }
 
-int io_monitor_collect(pid_t pid, io_metrics_t *metrics) {
-    if (!metrics) {
-        fprintf(stderr, "NULL metrics pointer\n");
+int io_monitor_from_snapshot(const proc_snapshot_t *snap, io_metrics_t *metrics) {
+    if (!snap || !metrics) {
+        fprintf(stderr, "NULL pointer in io_monitor_from_snapshot\n");
         return -1;
     }
 
-    if (!process_exists(pid)) {
-        fprintf(stderr, "Process %d does not exist\n", pid);
+    if (!(snap->files & PROCFS_SNAP_IO)) {
         return -1;
     }
 
     /* Initialize all fields */
     memset(metrics, 0, sizeof(io_metrics_t));
-    metrics->pid = pid;
+    metrics->pid = snap->pid;
 
-    /* Read /proc/[pid]/io for I/O metrics */
-    char io_path[256];
-    snprintf(io_path, sizeof(io_path), "/proc/%d/io", pid);
+    metrics->rchar = snap->rchar;
+    metrics->wchar = snap->wchar;
+    metrics->syscr = snap->syscr;
+    metrics->syscw = snap->syscw;
+    metrics->read_bytes = snap->read_bytes;
+    metrics->write_bytes = snap->write_bytes;
+    metrics->cancelled_write_bytes = snap->cancelled_write_bytes;
+    metrics->timestamp = snap->timestamp;
 
-    FILE *fp = fopen(io_path, "r");
-    if (!fp) {
-        /* Process may not have permission or /proc/[pid]/io may not exist */
-        if (errno == EACCES) {
-            fprintf(stderr, "Permission denied reading %s (try running with sudo)\n", io_path);
-        } else {
-            fprintf(stderr, "Failed to open %s: %s\n", io_path, strerror(errno));
-        }
+    return 0;
+}
+
+int io_monitor_collect(pid_t pid, io_metrics_t *metrics) {
+    if (!metrics) {
+        fprintf(stderr, "NULL metrics pointer\n");
         return -1;
     }
 
-    char line[256];
-    while (fgets(line, sizeof(line), fp)) {
-        if (strncmp(line, "rchar:", 6) == 0) {
-            sscanf(line + 6, "%lu", &metrics->rchar);
-        } else if (strncmp(line, "wchar:", 6) == 0) {
-            sscanf(line + 6, "%lu", &metrics->wchar);
-        } else if (strncmp(line, "syscr:", 6) == 0) {
-            sscanf(line + 6, "%lu", &metrics->syscr);
-        } else if (strncmp(line, "syscw:", 6) == 0) {
-            sscanf(line + 6, "%lu", &metrics->syscw);
-        } else if (strncmp(line, "read_bytes:", 11) == 0) {
-            sscanf(line + 11, "%lu", &metrics->read_bytes);
-        } else if (strncmp(line, "write_bytes:", 12) == 0) {
-            sscanf(line + 12, "%lu", &metrics->write_bytes);
-        } else if (strncmp(line, "cancelled_write_bytes:", 22) == 0) {
-            sscanf(line + 22, "%lu", &metrics->cancelled_write_bytes);
+    proc_snapshot_t snap;
+    int ret = proc_snapshot_take(pid, proc_snapshot_files_for(0, 0, 1), &snap);
+    int err = (ret != 0) ? errno : snap.io_errno;
+    if (ret != 0 || !(snap.files & PROCFS_SNAP_IO)) {
+        /* Process may not have permission or /proc/[pid]/io may not exist */
+        if (err == EACCES) {
+            fprintf(stderr, "Permission denied reading /proc/%d/io (try running with sudo)\n", pid);
+        } else if (procfs_is_gone_error(err)) {
+            fprintf(stderr, "Process %d does not exist\n", pid);
+        } else {
+            fprintf(stderr, "Failed to read /proc/%d/io: %s\n", pid, strerror(err));
         }
+        return -1;
     }
-    fclose(fp);
-
-    clock_gettime(CLOCK_MONOTONIC, &metrics->timestamp);
 
-    return 0;
+    return io_monitor_from_snapshot(&snap, metrics);
 }
 
 int io_monitor_calculate_rates(const io_metrics_t *prev,
@@ -177,13 +175,346 @@ int export_io_metrics_csv(const io_metrics_t *metrics, const char *filename, int
     return 0;
 }
 
+/* Per-namespace files read by the network monitor */
+typedef enum {
+    NET_FILE_DEV = 0,
+    NET_FILE_TCP,
+    NET_FILE_TCP6,
+    NET_FILE_UDP,
+    NET_FILE_UDP6,
+    NET_FILE_COUNT
+} net_file_t;
+
+static const char *net_file_names[NET_FILE_COUNT] = { "dev", "tcp", "tcp6", "udp", "udp6" };
+
+#define NETNS_CACHE_SIZE 64
+
+/* One network namespace: descriptors opened through the first PID seen in
+ * it (an open /proc/[pid]/net file or sock_diag socket pins the namespace,
+ * not the task) and the last totals read from them */
+typedef struct {
+    ino_t netns;                 /* 0 marks a free slot */
+    int fds[NET_FILE_COUNT];     /* Socket tables only opened without diag_fd */
+    int diag_fd;                 /* NETLINK_SOCK_DIAG socket in the namespace */
+    int nsid;                    /* Host id of the namespace when read via veth */
+    network_metrics_t totals;
+    struct timespec read_at;     /* CLOCK_MONOTONIC, for the max age */
+    uint64_t last_used;
+} netns_entry_t;
+
+static netns_entry_t netns_cache[NETNS_CACHE_SIZE];
+static uint64_t netns_clock = 0;
+/* Reads younger than this are shared; main sets half the interval */
+static double netns_max_age = 0.001;
+
+static network_source_t network_source = NETWORK_SOURCE_PROCFS;
+static struct timespec veth_dump_at;
+
+/* Growable read buffer shared by every file; tcp tables can be large */
+static char *net_buffer = NULL;
+static size_t net_buffer_size = 0;
+
+static void netns_entry_reset(netns_entry_t *entry) {
+    memset(entry, 0, sizeof(netns_entry_t));
+    for (int f = 0; f < NET_FILE_COUNT; f++) {
+        entry->fds[f] = -1;
+    }
+    entry->diag_fd = -1;
+    entry->nsid = VETH_NSID_NONE;
+}
+
+static void netns_entry_close(netns_entry_t *entry) {
+    for (int f = 0; f < NET_FILE_COUNT; f++) {
+        if (entry->fds[f] >= 0) {
+            close(entry->fds[f]);
+        }
+    }
+    if (entry->diag_fd >= 0) {
+        close(entry->diag_fd);
+    }
+    netns_entry_reset(entry);
+}
+
 int network_monitor_init(void) {
-    /* Network monitoring implementation - placeholder */
+    for (int i = 0; i < NETNS_CACHE_SIZE; i++) {
+        netns_entry_reset(&netns_cache[i]);
+    }
+    netns_clock = 0;
     return 0;
 }
 
 void network_monitor_cleanup(void) {
-    /* Network monitoring cleanup - placeholder */
+    for (int i = 0; i < NETNS_CACHE_SIZE; i++) {
+        if (netns_cache[i].netns) {
+            netns_entry_close(&netns_cache[i]);
+        }
+    }
+    free(net_buffer);
+    net_buffer = NULL;
+    net_buffer_size = 0;
+
+    if (network_source == NETWORK_SOURCE_VETH) {
+        veth_stats_cleanup();
+        network_source = NETWORK_SOURCE_PROCFS;
+    }
+    memset(&veth_dump_at, 0, sizeof(veth_dump_at));
+}
+
+int network_monitor_set_source(network_source_t source) {
+    if (source == NETWORK_SOURCE_VETH && veth_stats_init() != 0) {
+        return -1;
+    }
+    network_source = source;
+    return 0;
+}
+
+void network_monitor_set_max_age(double seconds) {
+    netns_max_age = seconds > 0.0 ? seconds : 0.0;
+}
+
+int network_monitor_cached_count(void) {
+    int count = 0;
+    for (int i = 0; i < NETNS_CACHE_SIZE; i++) {
+        count += (netns_cache[i].netns != 0);
+    }
+    return count;
+}
+
+/* Read a whole procfs file from offset 0, growing net_buffer as needed */
+static ssize_t read_whole(int fd) {
+    size_t total = 0;
+    for (;;) {
+        if (net_buffer_size - total < PROCFS_BUFFER_SIZE) {
+            size_t new_size = net_buffer_size ? net_buffer_size * 2 : 4 * PROCFS_BUFFER_SIZE;
+            char *grown = realloc(net_buffer, new_size);
+            if (!grown) {
+                errno = ENOMEM;
+                return -1;
+            }
+            net_buffer = grown;
+            net_buffer_size = new_size;
+        }
+
+        ssize_t n = pread(fd, net_buffer + total, net_buffer_size - total - 1, (off_t)total);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+    net_buffer[total] = '\0';
+    return (ssize_t)total;
+}
+
+/* Sum the non-loopback interfaces of a /proc/net/dev listing */
+static void parse_net_dev(const char *buffer, network_metrics_t *metrics) {
+    /* Two header lines, then "name: 8 rx counters 8 tx counters" */
+    const char *line = buffer;
+    for (int skip = 0; skip < 2 && line; skip++) {
+        line = strchr(line, '\n');
+        line = line ? line + 1 : NULL;
+    }
+
+    while (line && *line) {
+        const char *colon = strchr(line, ':');
+        const char *eol = strchr(line, '\n');
+        if (!colon || (eol && colon > eol)) {
+            break;
+        }
+
+        const char *name = line;
+        while (*name == ' ') {
+            name++;
+        }
+        size_t name_len = (size_t)(colon - name);
+
+        if (!(name_len == 2 && strncmp(name, "lo", 2) == 0)) {
+            uint64_t v[16];
+            const char *cursor = colon + 1;
+            for (int i = 0; i < 16; i++) {
+                v[i] = procfs_parse_u64(&cursor);
+            }
+            metrics->rx_bytes += v[0];
+            metrics->rx_packets += v[1];
+            metrics->rx_errors += v[2];
+            metrics->rx_dropped += v[3];
+            metrics->tx_bytes += v[8];
+            metrics->tx_packets += v[9];
+            metrics->tx_errors += v[10];
+            metrics->tx_dropped += v[11];
+
+            if (metrics->interface_count++ == 0) {
+                if (name_len >= sizeof(metrics->interface)) {
+                    name_len = sizeof(metrics->interface) - 1;
+                }
+                memcpy(metrics->interface, name, name_len);
+                metrics->interface[name_len] = '\0';
+            }
+        }
+
+        line = eol ? eol + 1 : NULL;
+    }
+}
+
+/* Count the sockets of a /proc/net/{tcp,udp}[6] table, optionally only
+ * those in one state ("sl local rem st ...", st in hex) */
+static int count_sockets(const char *buffer, int state) {
+    int count = 0;
+    const char *line = strchr(buffer, '\n');   /* Skip the header */
+    while (line && *++line) {
+        if (state < 0) {
+            count++;
+        } else {
+            /* Fourth column */
+            const char *p = line;
+            for (int col = 0; col < 3 && p; col++) {
+                while (*p == ' ') p++;
+                p = strchr(p, ' ');
+            }
+            if (p) {
+                while (*p == ' ') p++;
+                int st = (int)strtol(p, NULL, 16);
+                count += (st == state);
+            }
+        }
+        line = strchr(line, '\n');
+    }
+    return count;
+}
+
+/* Counters of a container namespace from its host-side veth peers; all
+ * namespaces share one RTM_GETLINK dump per max age */
+static int read_veth(int nsid, network_metrics_t *totals) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double age = (now.tv_sec - veth_dump_at.tv_sec) + (now.tv_nsec - veth_dump_at.tv_nsec) / 1e9;
+    if (veth_dump_at.tv_sec == 0 || age >= netns_max_age) {
+        if (veth_stats_refresh() < 0) {
+            return -1;
+        }
+        veth_dump_at = now;
+    }
+
+    veth_totals_t veth;
+    if (veth_stats_totals(nsid, &veth) != 0) {
+        return -1;
+    }
+    totals->host_side = 1;
+    totals->interface_count = veth.links;
+    memcpy(totals->interface, veth.first, sizeof(veth.first));
+    totals->rx_bytes = veth.rx_bytes;
+    totals->tx_bytes = veth.tx_bytes;
+    totals->rx_packets = veth.rx_packets;
+    totals->tx_packets = veth.tx_packets;
+    totals->rx_errors = veth.rx_errors;
+    totals->tx_errors = veth.tx_errors;
+    totals->rx_dropped = veth.rx_dropped;
+    totals->tx_dropped = veth.tx_dropped;
+    totals->timestamp = veth.timestamp;
+    return 0;
+}
+
+static int read_netns(netns_entry_t *entry) {
+    network_metrics_t totals;
+    memset(&totals, 0, sizeof(totals));
+    totals.netns = entry->netns;
+
+    /* Interface counters are timestamped as read; rates use that time */
+    struct timespec counters_at;
+    if (entry->fds[NET_FILE_DEV] < 0) {
+        if (read_veth(entry->nsid, &totals) != 0) {
+            return -1;
+        }
+        counters_at = totals.timestamp;
+    } else {
+        if (read_whole(entry->fds[NET_FILE_DEV]) < 0) {
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &counters_at);
+        parse_net_dev(net_buffer, &totals);
+    }
+
+    if (entry->diag_fd >= 0 && sock_diag_count(entry->diag_fd, &totals.sockets) == 0) {
+        totals.has_sockets = 1;
+        totals.tcp_connections = totals.sockets.tcp_states[SOCK_TCP_ESTABLISHED];
+        totals.udp_connections = totals.sockets.udp_sockets;
+        totals.timestamp = counters_at;
+        entry->totals = totals;
+        entry->read_at = totals.timestamp;
+        return 0;
+    }
+
+    /* Text tables only without sock_diag (another namespace without
+     * CAP_SYS_ADMIN); they are optional, IPv6 may be disabled */
+    static const int tables[] = { NET_FILE_TCP, NET_FILE_TCP6, NET_FILE_UDP, NET_FILE_UDP6 };
+    for (size_t t = 0; t < sizeof(tables) / sizeof(tables[0]); t++) {
+        int f = tables[t];
+        if (entry->fds[f] < 0 || read_whole(entry->fds[f]) < 0) {
+            continue;
+        }
+        if (f == NET_FILE_TCP || f == NET_FILE_TCP6) {
+            totals.tcp_connections += count_sockets(net_buffer, SOCK_TCP_ESTABLISHED);
+        } else {
+            totals.udp_connections += count_sockets(net_buffer, -1);
+        }
+    }
+
+    totals.timestamp = counters_at;
+    entry->totals = totals;
+    entry->read_at = totals.timestamp;
+    return 0;
+}
+
+/* Find the entry of netns, or open one through pid (evicting the least
+ * recently used namespace when full) */
+static netns_entry_t *netns_lookup(pid_t pid, ino_t netns) {
+    netns_entry_t *victim = &netns_cache[0];
+    for (int i = 0; i < NETNS_CACHE_SIZE; i++) {
+        netns_entry_t *entry = &netns_cache[i];
+        if (entry->netns == netns) {
+            return entry;
+        }
+        if (victim->netns && (!entry->netns || entry->last_used < victim->last_used)) {
+            victim = entry;
+        }
+    }
+
+    if (victim->netns) {
+        netns_entry_close(victim);
+    }
+
+    /* With veth counters the container's own files are never opened,
+     * unless the namespace has no host-side peer (e.g. the host itself) */
+    victim->nsid = VETH_NSID_NONE;
+    if (network_source == NETWORK_SOURCE_VETH) {
+        int nsid = veth_stats_nsid(pid);
+        network_metrics_t probe;
+        if (nsid >= 0 && read_veth(nsid, &probe) == 0) {
+            victim->nsid = nsid;
+        }
+    }
+
+    char path[64];
+    if (victim->nsid == VETH_NSID_NONE) {
+        snprintf(path, sizeof(path), "/proc/%d/net/dev", pid);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return NULL;
+        }
+        victim->fds[NET_FILE_DEV] = fd;
+    }
+    victim->diag_fd = sock_diag_open(pid);
+    for (int f = NET_FILE_TCP; f < NET_FILE_COUNT && victim->diag_fd < 0; f++) {
+        snprintf(path, sizeof(path), "/proc/%d/net/%s", pid, net_file_names[f]);
+        victim->fds[f] = open(path, O_RDONLY | O_CLOEXEC);
+    }
+    victim->netns = netns;
+    return victim;
 }
 
 int network_monitor_collect(pid_t pid, network_metrics_t *metrics) {
@@ -192,20 +523,116 @@ int network_monitor_collect(pid_t pid, network_metrics_t *metrics) {
         return -1;
     }
 
-    if (!process_exists(pid)) {
-        fprintf(stderr, "Process %d does not exist\n", pid);
+    /* The namespace inode decides which cached entry answers */
+    char path[64];
+    struct stat st;
+    snprintf(path, sizeof(path), "/proc/%d/ns/net", pid);
+    if (stat(path, &st) != 0) {
+        if (procfs_is_gone_error(errno)) {
+            fprintf(stderr, "Process %d does not exist\n", pid);
+        } else {
+            fprintf(stderr, "Failed to read network namespace of PID %d: %s\n",
+                    pid, strerror(errno));
+        }
         return -1;
     }
 
-    /* Initialize all fields */
-    memset(metrics, 0, sizeof(network_metrics_t));
+    netns_entry_t *entry = netns_lookup(pid, st.st_ino);
+    if (!entry) {
+        fprintf(stderr, "Failed to open /proc/%d/net/dev: %s\n", pid, strerror(errno));
+        return -1;
+    }
+    entry->last_used = ++netns_clock;
+
+    /* Reuse a read younger than the max age: every PID of a namespace
+     * sampled in the same tick costs one read */
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double age = (now.tv_sec - entry->read_at.tv_sec) +
+                 (now.tv_nsec - entry->read_at.tv_nsec) / 1e9;
+    if (entry->read_at.tv_sec == 0 || age >= netns_max_age) {
+        if (read_netns(entry) != 0) {
+            fprintf(stderr, "Failed to read network stats of PID %d: %s\n", pid, strerror(errno));
+            netns_entry_close(entry);
+            return -1;
+        }
+    }
+
+    *metrics = entry->totals;
     metrics->pid = pid;
+    return 0;
+}
 
-    /* Network stats are complex and require parsing /proc/net files */
-    /* This is a simplified implementation */
+int network_monitor_calculate_rates(const network_metrics_t *prev,
+                                    const network_metrics_t *curr,
+                                    network_metrics_t *result) {
+    if (!prev || !curr || !result) {
+        fprintf(stderr, "NULL pointer in network_monitor_calculate_rates\n");
+        return -1;
+    }
+
+    memcpy(result, curr, sizeof(network_metrics_t));
+    result->rx_rate = 0.0;
+    result->tx_rate = 0.0;
+
+    double time_diff = (curr->timestamp.tv_sec - prev->timestamp.tv_sec) +
+                       (curr->timestamp.tv_nsec - prev->timestamp.tv_nsec) / 1e9;
+
+    /* A process that moved to another namespace has unrelated counters;
+     * interface counters also restart when a device is recreated */
+    if (time_diff <= 0 || prev->netns != curr->netns ||
+        curr->rx_bytes < prev->rx_bytes || curr->tx_bytes < prev->tx_bytes) {
+        return 0;
+    }
+
+    result->rx_rate = (double)(curr->rx_bytes - prev->rx_bytes) / time_diff;
+    result->tx_rate = (double)(curr->tx_bytes - prev->tx_bytes) / time_diff;
+    return 0;
+}
+
+int network_monitor_list_interfaces(char interfaces[][32], int max_interfaces, int *count) {
+    if (!interfaces || !count || max_interfaces < 0) {
+        errno = EINVAL;
+        return -1;
+    }
 
-    clock_gettime(CLOCK_MONOTONIC, &metrics->timestamp);
+    /* The monitor's own namespace */
+    int fd = open("/proc/self/net/dev", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open /proc/self/net/dev: %s\n", strerror(errno));
+        return -1;
+    }
+    ssize_t n = read_whole(fd);
+    close(fd);
+    if (n < 0) {
+        return -1;
+    }
+
+    *count = 0;
+    const char *line = net_buffer;
+    for (int skip = 0; skip < 2 && line; skip++) {
+        line = strchr(line, '\n');
+        line = line ? line + 1 : NULL;
+    }
+    while (line && *line && *count < max_interfaces) {
+        const char *colon = strchr(line, ':');
+        if (!colon) {
+            break;
+        }
+        while (*line == ' ') {
+            line++;
+        }
+        size_t len = (size_t)(colon - line);
+        if (len >= 32) {
+            len = 31;
+        }
+        memcpy(interfaces[*count], line, len);
+        interfaces[*count][len] = '\0';
+        (*count)++;
 
+        line = strchr(colon, '\n');
+        line = line ? line + 1 : NULL;
+    }
     return 0;
 }
 
@@ -215,11 +642,109 @@ void print_network_metrics(const network_metrics_t *metrics) {
     }
 
     printf("\n=== Network Metrics for PID %d ===\n", metrics->pid);
+    printf("Namespace:                 net:[%lu] (%d interface(s)%s%s%s)\n",
+           (unsigned long)metrics->netns, metrics->interface_count,
+           metrics->interface_count ? ", first " : "", metrics->interface,
+           metrics->host_side ? ", host-side veth" : "");
     printf("RX bytes:                  %lu\n", metrics->rx_bytes);
     printf("TX bytes:                  %lu\n", metrics->tx_bytes);
     printf("RX packets:                %lu\n", metrics->rx_packets);
     printf("TX packets:                %lu\n", metrics->tx_packets);
+    printf("RX errors/dropped:         %lu / %lu\n", metrics->rx_errors, metrics->rx_dropped);
+    printf("TX errors/dropped:         %lu / %lu\n", metrics->tx_errors, metrics->tx_dropped);
+    printf("RX rate:                   %.2f bytes/sec\n", metrics->rx_rate);
+    printf("TX rate:                   %.2f bytes/sec\n", metrics->tx_rate);
     printf("TCP connections:           %d\n", metrics->tcp_connections);
     printf("UDP connections:           %d\n", metrics->udp_connections);
+    if (metrics->has_sockets) {
+        const sock_counts_t *sockets = &metrics->sockets;
+        printf("TCP TIME_WAIT/LISTEN:      %d / %d\n",
+               sockets->tcp_states[SOCK_TCP_TIME_WAIT], sockets->tcp_states[SOCK_TCP_LISTEN]);
+        printf("Listen queues full:        %d\n", sockets->listen_full);
+        /* Owners are looked up only here, when there is something to show */
+        for (int i = 0; i < sockets->full_count; i++) {
+            const sock_listener_t *l = &sockets->full[i];
+            printf("  port %-5u %u/%u queued, PID %d\n", l->port, l->queued, l->backlog,
+                   sock_diag_find_owner(l->inode, metrics->pid));
+        }
+    }
     printf("===================================\n\n");
 }
+
+int export_network_metrics_json(const network_metrics_t *metrics, const char *filename) {
+    if (!metrics || !filename) {
+        return -1;
+    }
+
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"pid\": %d,\n", metrics->pid);
+    fprintf(fp, "  \"netns\": %lu,\n", (unsigned long)metrics->netns);
+    fprintf(fp, "  \"interface\": \"%s\",\n", metrics->interface);
+    fprintf(fp, "  \"interface_count\": %d,\n", metrics->interface_count);
+    fprintf(fp, "  \"rx_bytes\": %lu,\n", metrics->rx_bytes);
+    fprintf(fp, "  \"tx_bytes\": %lu,\n", metrics->tx_bytes);
+    fprintf(fp, "  \"rx_packets\": %lu,\n", metrics->rx_packets);
+    fprintf(fp, "  \"tx_packets\": %lu,\n", metrics->tx_packets);
+    fprintf(fp, "  \"rx_errors\": %lu,\n", metrics->rx_errors);
+    fprintf(fp, "  \"tx_errors\": %lu,\n", metrics->tx_errors);
+    fprintf(fp, "  \"rx_dropped\": %lu,\n", metrics->rx_dropped);
+    fprintf(fp, "  \"tx_dropped\": %lu,\n", metrics->tx_dropped);
+    fprintf(fp, "  \"rx_rate\": %.2f,\n", metrics->rx_rate);
+    fprintf(fp, "  \"tx_rate\": %.2f,\n", metrics->tx_rate);
+    fprintf(fp, "  \"tcp_connections\": %d,\n", metrics->tcp_connections);
+    fprintf(fp, "  \"udp_connections\": %d,\n", metrics->udp_connections);
+    if (metrics->has_sockets) {
+        fprintf(fp, "  \"tcp_states\": {");
+        for (int st = 1; st < SOCK_DIAG_TCP_STATES; st++) {
+            fprintf(fp, "\"%s\": %d%s", sock_diag_state_name(st), metrics->sockets.tcp_states[st],
+                    st < SOCK_DIAG_TCP_STATES - 1 ? ", " : "");
+        }
+        fprintf(fp, "},\n");
+        fprintf(fp, "  \"listen_full\": %d,\n", metrics->sockets.listen_full);
+    }
+    fprintf(fp, "  \"timestamp\": %ld.%09ld\n", metrics->timestamp.tv_sec, metrics->timestamp.tv_nsec);
+    fprintf(fp, "}\n");
+
+    fclose(fp);
+    return 0;
+}
+
+int export_network_metrics_csv(const network_metrics_t *metrics, const char *filename, int append) {
+    if (!metrics || !filename) {
+        return -1;
+    }
+
+    const char *mode = append ? "a" : "w";
+    FILE *fp = fopen(filename, mode);
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    /* Write header if not appending */
+    if (!append) {
+        fprintf(fp, "pid,netns,interfaces,rx_bytes,tx_bytes,rx_packets,tx_packets,"
+                   "rx_errors,tx_errors,rx_dropped,tx_dropped,rx_rate,tx_rate,"
+                   "tcp_connections,udp_connections,tcp_time_wait,tcp_listen,listen_full,"
+                   "timestamp\n");
+    }
+
+    fprintf(fp, "%d,%lu,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.2f,%.2f,%d,%d,%d,%d,%d,%ld.%09ld\n",
+            metrics->pid, (unsigned long)metrics->netns, metrics->interface_count,
+            metrics->rx_bytes, metrics->tx_bytes, metrics->rx_packets, metrics->tx_packets,
+            metrics->rx_errors, metrics->tx_errors, metrics->rx_dropped, metrics->tx_dropped,
+            metrics->rx_rate, metrics->tx_rate,
+            metrics->tcp_connections, metrics->udp_connections,
+            metrics->sockets.tcp_states[SOCK_TCP_TIME_WAIT],
+            metrics->sockets.tcp_states[SOCK_TCP_LISTEN], metrics->sockets.listen_full,
+            metrics->timestamp.tv_sec, metrics->timestamp.tv_nsec);
+
+    fclose(fp);
+    return 0;
+}
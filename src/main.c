@@ -1,33 +1,52 @@
 #include "../include/monitor.h"
 #include "../include/namespace.h"
 #include "../include/cgroup.h"
+#include "../include/cgroup_events.h"
+#include "../include/cgroup_tree.h"
 #include "../include/anomaly.h"
 #include "../include/web_dashboard.h"
 #include "../include/ncurses_ui.h"
+#include "../include/pidwatch.h"
+#include "../include/taskstats_backend.h"
+#include "../include/proc_events.h"
+#include "../include/proc_scanner.h"
+#include "../include/thread_monitor.h"
+#include "../include/scheduler.h"
+#include "../include/event_loop.h"
+#include "../include/collector.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <getopt.h>
-#include <signal.h>
+#include <time.h>
+#include <sys/epoll.h>
 
 static volatile int running = 1;
 
-void signal_handler(int signum) {
-    (void)signum;
-    running = 0;
-}
-
 void print_usage(const char *program_name) {
     printf("Linux Container Resource Monitoring System\n\n");
     printf("Usage: %s [OPTIONS]\n\n", program_name);
     printf("Resource Profiler Options:\n");
     printf("  -p, --pid PID         Monitor process with PID (supports multiple: -p 1234,5678)\n");
-    printf("  -i, --interval SEC    Sampling interval in seconds (default: 1)\n");
+    printf("  -i, --interval SEC    Sampling interval in seconds, e.g. 0.1 (default: 1)\n");
     printf("  -d, --duration SEC    Monitoring duration in seconds (default: infinite)\n");
     printf("  -o, --output FILE     Output file for metrics\n");
     printf("  -f, --format FORMAT   Output format: json, csv, console (default: console)\n");
-    printf("  -m, --metrics TYPE    Metric types: cpu, memory, io, all (default: all)\n\n");
+    printf("  -m, --metrics LIST    Comma-separated metric types: cpu, memory, io, fds, smaps,\n");
+    printf("                        net, all (= cpu,memory,io), full (everything) (default: all)\n");
+    printf("  --backend NAME        Counter source: procfs, taskstats (default: procfs)\n");
+    printf("  --cpu-clock NAME      procfs CPU clock: ticks, schedstat (default: ticks)\n");
+    printf("  --net-source NAME     Interface counters: procfs, veth (default: procfs)\n");
+    printf("  --follow-children     Follow descendants of -p PIDs and report per tree\n");
+    printf("  --per-thread          Report per-thread CPU and context switches of -p PIDs\n");
+    printf("  --top N               Rows shown by --per-thread and --cgroup-top (default: 10)\n");
+    printf("  --all                 Monitor every process on the host\n");
+    printf("  --threads N           Scanner threads for --all and --cgroup-top (default: online CPUs)\n");
+    printf("  --io-uring            Batch the --all procfs reads through io_uring\n");
+    printf("  --adaptive MIN,MAX    Adapt each PID's interval to its volatility within MIN..MAX\n");
+    printf("  --budget PCT          Stretch costly sources to keep the monitor under PCT%% of a core\n\n");
     printf("Namespace Analyzer Options:\n");
     printf("  -n, --namespace       Enable namespace analysis\n");
     printf("  -l, --list-ns PID     List namespaces for PID\n");
@@ -35,14 +54,20 @@ void print_usage(const char *program_name) {
     printf("  -r, --report          Generate system-wide namespace report\n");
     printf("  -t, --timing          Measure namespace creation overhead\n\n");
     printf("Control Group Manager Options:\n");
-    printf("  -g, --cgroup PATH     Monitor cgroup at PATH\n");
+    printf("  -g, --cgroup PATH     Monitor cgroup at PATH each interval (CPU cores, throttling,\n");
+    printf("                        memory, I/O bytes/s and IOPS)\n");
+    printf("  --throttle-profile SEC Profile CPU throttling of the -g cgroup for SEC seconds\n");
+    printf("  --cgroup-top KEY      Sweep every cgroup (below -g if given) each interval and\n");
+    printf("                        show the top ones by KEY: cpu, memory, io\n");
     printf("  --create-cgroup NAME  Create new cgroup with NAME\n");
     printf("  --cpu-limit CORES     Set CPU limit in cores (e.g., 0.5, 1.0)\n");
     printf("  --mem-limit MB        Set memory limit in MB\n");
     printf("  --move-to-cgroup PID  Move process to cgroup\n\n");
     printf("Anomaly Detection Options:\n");
     printf("  -a, --anomaly         Enable anomaly detection\n");
-    printf("  --anomaly-stats       Print anomaly detection statistics\n\n");
+    printf("  --anomaly-stats       Print anomaly detection statistics\n");
+    printf("  --psi-trigger MS[,WIN] Report CPU/memory/I/O stalls of MS ms within WIN ms\n");
+    printf("                        (default 2000) on the PID's or -g cgroup as they happen\n\n");
     printf("Web Dashboard Options:\n");
     printf("  --web PORT            Start web dashboard on PORT (default: 8080)\n\n");
     printf("Display Options:\n");
@@ -58,36 +83,432 @@ void print_usage(const char *program_name) {
     printf("\n");
 }
 
-int monitor_process(pid_t pid, int interval, int duration, const char *output_file,
-                   const char *format, const char *metrics_type, int enable_anomaly, int show_anomaly_stats) {
-    printf("Monitoring PID %d (interval: %ds, duration: %ds)\n",
-           pid, interval, duration);
+/* Exits reported by the pidwatch set, queued for the sampling loop */
+typedef struct {
+    pidwatch_event_t events[PIDWATCH_MAX_EVENTS];
+    int count;
+} exit_queue_t;
+
+static void on_pid_exit(int fd, uint32_t events, void *arg) {
+    (void)fd;
+    (void)events;
+    exit_queue_t *queue = arg;
+
+    int n = pidwatch_wait(0, queue->events + queue->count, PIDWATCH_MAX_EVENTS - queue->count);
+    if (n > 0) {
+        queue->count += n;
+        event_loop_wake();
+    }
+}
+
+/* Watch the pidwatch set from the event loop (no-op without pidfd support) */
+static void watch_exits(exit_queue_t *queue) {
+    queue->count = 0;
+    int fd = pidwatch_get_fd();
+    if (fd >= 0 && event_loop_add_fd(fd, EPOLLIN, on_pid_exit, queue) != 0) {
+        fprintf(stderr, "Warning: Could not watch for process exits: %s\n", strerror(errno));
+    }
+}
+
+/* Kernel notifications about the cgroup of the monitored process: PSI
+ * triggers and the event files, reported to the anomaly detector as they
+ * fire */
+typedef struct {
+    cgroup_psi_trigger_t triggers[CGROUP_PSI_RESOURCES];
+    int count;
+    int events_watch;            /* cgroup_events watch id, -1 if none */
+    anomaly_detector_t *detector;
+} cgroup_watch_t;
+
+static const anomaly_type_t pressure_anomalies[CGROUP_PSI_RESOURCES] = {
+    ANOMALY_CPU_PRESSURE, ANOMALY_MEMORY_PRESSURE, ANOMALY_IO_PRESSURE
+};
+
+static void on_pressure(int fd, uint32_t events, void *arg) {
+    cgroup_watch_t *watch = arg;
+    for (int i = 0; i < watch->count; i++) {
+        cgroup_psi_trigger_t *trigger = &watch->triggers[i];
+        if (trigger->fd != fd) {
+            continue;
+        }
+
+        cgroup_psi_t psi;
+        if ((events & EPOLLERR) || cgroup_psi_trigger_read(trigger, &psi) != 0) {
+            /* The cgroup was removed */
+            event_loop_remove_fd(fd);
+            cgroup_psi_trigger_close(trigger);
+            return;
+        }
+        anomaly_detector_report_pressure(watch->detector, pressure_anomalies[trigger->resource],
+                                         trigger->full ? psi.full_avg10 : psi.some_avg10,
+                                         trigger->stall_us, trigger->window_us);
+        event_loop_wake();
+        return;
+    }
+}
+
+/* Turn one counter or state change into an anomaly event */
+static void report_cgroup_event(anomaly_detector_t *detector, const cgroup_event_t *event) {
+    const char *path = cgroup_events_path(event->watch);
+    const char *name = cgroup_event_name(event->kind);
+    char description[256];
+    anomaly_type_t type = ANOMALY_MEMORY_LIMIT;
+    anomaly_severity_t severity = SEVERITY_HIGH;
+
+    switch (event->kind) {
+        case CGROUP_EVENT_OOM_KILL:
+        case CGROUP_EVENT_OOM_GROUP_KILL:
+            type = ANOMALY_OOM_KILL;
+            severity = SEVERITY_CRITICAL;
+            snprintf(description, sizeof(description),
+                     "OOM killer: %lu process(es) killed in %s (%s %lu)",
+                     event->delta, path, name, event->value);
+            break;
+        case CGROUP_EVENT_PIDS_MAX:
+            type = ANOMALY_PIDS_LIMIT;
+            snprintf(description, sizeof(description),
+                     "%lu fork() call(s) rejected at pids.max in %s (total %lu)",
+                     event->delta, path, event->value);
+            break;
+        case CGROUP_EVENT_POPULATED:
+        case CGROUP_EVENT_FROZEN:
+            type = ANOMALY_CGROUP_STATE;
+            severity = (event->kind == CGROUP_EVENT_FROZEN && event->value) ?
+                       SEVERITY_MEDIUM : SEVERITY_LOW;
+            snprintf(description, sizeof(description), "Cgroup %s is now %s", path,
+                     event->kind == CGROUP_EVENT_POPULATED ?
+                     (event->value ? "populated" : "empty") :
+                     (event->value ? "frozen" : "thawed"));
+            break;
+        default:
+            if (event->kind == CGROUP_EVENT_MEMORY_LOW) {
+                severity = SEVERITY_LOW;
+            } else if (event->kind == CGROUP_EVENT_MEMORY_HIGH ||
+                       event->kind == CGROUP_EVENT_SWAP_HIGH) {
+                severity = SEVERITY_MEDIUM;
+            }
+            snprintf(description, sizeof(description),
+                     "%s limit hit %lu time(s) in %s (total %lu)",
+                     name, event->delta, path, event->value);
+            break;
+    }
+    anomaly_detector_report(detector, type, severity, (double)event->value, description);
+}
+
+static void on_cgroup_events(int fd, uint32_t events, void *arg) {
+    (void)fd;
+    (void)events;
+    cgroup_watch_t *watch = arg;
+
+    cgroup_event_t changes[CGROUP_EVENTS_MAX_EVENTS];
+    int n = cgroup_events_read(changes, CGROUP_EVENTS_MAX_EVENTS);
+    for (int i = 0; i < n; i++) {
+        report_cgroup_event(watch->detector, &changes[i]);
+    }
+    if (n > 0) {
+        event_loop_wake();
+    }
+}
+
+/* Watch the event files of a cgroup and, with stall_us, arm a "some" PSI
+ * trigger per resource; returns the number of PSI triggers armed */
+static int watch_cgroup(cgroup_watch_t *watch, const char *cgroup_path, uint32_t stall_us,
+                        uint32_t window_us) {
+    watch->count = 0;
+    watch->events_watch = -1;
+
+    cgroup_init();
+    watch->events_watch = cgroup_events_watch(cgroup_path);
+    if (watch->events_watch >= 0 &&
+        event_loop_add_fd(cgroup_events_get_fd(), EPOLLIN, on_cgroup_events, watch) != 0) {
+        cgroup_events_unwatch(watch->events_watch);
+        watch->events_watch = -1;
+    }
+
+    for (int r = 0; r < CGROUP_PSI_RESOURCES && stall_us > 0; r++) {
+        cgroup_psi_trigger_t *trigger = &watch->triggers[watch->count];
+        if (cgroup_psi_trigger_open(cgroup_path, r, 0, stall_us, window_us, trigger) != 0) {
+            /* Without CAP_SYS_RESOURCE the kernel takes whole 2 s windows only */
+            fprintf(stderr, "Warning: No %s pressure trigger on %s: %s%s\n",
+                    cgroup_psi_resource_name(r), cgroup_path, strerror(errno),
+                    (errno == EINVAL && window_us % 2000000 != 0) ?
+                    " (unprivileged windows must be multiples of 2000 ms)" : "");
+            continue;
+        }
+        if (event_loop_add_fd(trigger->fd, EPOLLPRI, on_pressure, watch) != 0) {
+            cgroup_psi_trigger_close(trigger);
+            continue;
+        }
+        watch->count++;
+    }
+    return watch->count;
+}
+
+static void unwatch_cgroup(cgroup_watch_t *watch) {
+    for (int i = 0; i < watch->count; i++) {
+        cgroup_psi_trigger_close(&watch->triggers[i]);
+    }
+    watch->count = 0;
+    cgroup_events_cleanup();
+    watch->events_watch = -1;
+    cgroup_cleanup();
+}
+
+/* Publish the anomalies reported by kernel notifications since the last
+ * tick as an events_only sample */
+static void publish_alerts(anomaly_detector_t *detector, pid_t pid, uint64_t tick,
+                           double elapsed) {
+    monitor_sample_t alert;
+    memset(&alert, 0, sizeof(alert));
+    alert.pid = pid;
+    alert.tick = tick;
+    alert.elapsed = elapsed;
+    alert.events_only = 1;
+    clock_gettime(CLOCK_MONOTONIC, &alert.timestamp);
+    alert.anomaly_count = anomaly_detector_take_events(detector, alert.anomalies,
+                                                       MONITOR_SAMPLE_MAX_ANOMALIES);
+    if (alert.anomaly_count > 0) {
+        event_loop_publish(&alert);
+    }
+}
+
+/* Metric sources of the single-process loop, filled by collector_run() */
+typedef struct {
+    unsigned int snap_files;
+    proc_snapshot_t snap;
+    int snap_ok;
+    int fd_count;
+    int has_fds;
+    memory_smaps_t smaps;
+    int has_smaps;
+    network_metrics_t network;
+    int has_network;
+} process_sources_t;
+
+static int collect_snapshot(pid_t pid, void *arg) {
+    process_sources_t *sources = arg;
+    /* Read each procfs file once; all collectors share this snapshot */
+    sources->snap_ok = (proc_snapshot_take(pid, sources->snap_files, &sources->snap) == 0);
+    return sources->snap_ok ? 0 : -1;
+}
+
+static int collect_fds(pid_t pid, void *arg) {
+    process_sources_t *sources = arg;
+    sources->fd_count = procfs_count_fds(pid);
+    sources->has_fds = (sources->fd_count >= 0);
+    return sources->has_fds ? 0 : -1;
+}
+
+static int collect_smaps(pid_t pid, void *arg) {
+    process_sources_t *sources = arg;
+    sources->has_smaps = (memory_monitor_collect_smaps(pid, &sources->smaps) == 0);
+    return sources->has_smaps ? 0 : -1;
+}
+
+static int collect_network(pid_t pid, void *arg) {
+    process_sources_t *sources = arg;
+    sources->has_network = (network_monitor_collect(pid, &sources->network) == 0);
+    return sources->has_network ? 0 : -1;
+}
+
+/* Console, CSV and JSON output of the single-process sample stream */
+typedef struct {
+    const char *output_file;
+    int is_csv;
+    int is_json;
+    int append;
+    int network_append;          /* Network rows start on a later tick */
+    int device_append;           /* Rows only for ticks with io.stat devices */
+    int anomaly_append;
+} console_sink_t;
+
+static void console_print_sample(const monitor_sample_t *sample, void *arg) {
+    console_sink_t *sink = arg;
+    const char *output_file = sink->output_file;
+
+    if (sample->has_cgroup) {
+        if (sink->is_csv) {
+            cgroup_export_metrics_csv(&sample->cgroup, &sample->cgroup_rates, output_file,
+                                      sink->append);
+            if (sample->cgroup.blkio.device_count > 0) {
+                char device_file[512];
+                snprintf(device_file, sizeof(device_file), "%s.devices.csv", output_file);
+                cgroup_export_devices_csv(&sample->cgroup, device_file, sink->device_append);
+                sink->device_append = 1;
+            }
+        } else if (sink->is_json) {
+            char json_file[512];
+            snprintf(json_file, sizeof(json_file), "%s.cgroup.%g.json",
+                    output_file, sample->elapsed);
+            cgroup_export_metrics_json(&sample->cgroup, &sample->cgroup_rates, json_file);
+        } else {
+            cgroup_print_metrics(&sample->cgroup);
+            cgroup_print_rates(&sample->cgroup_rates);
+            cgroup_print_devices(&sample->cgroup.blkio);
+        }
+    }
+
+    if (sample->has_cpu) {
+        if (sink->is_csv) {
+            export_cpu_metrics_csv(&sample->cpu, output_file, sink->append);
+        } else if (sink->is_json) {
+            char json_file[512];
+            snprintf(json_file, sizeof(json_file), "%s.cpu.%g.json",
+                    output_file, sample->elapsed);
+            export_cpu_metrics_json(&sample->cpu, json_file);
+        } else {
+            print_cpu_metrics(&sample->cpu);
+        }
+    }
+
+    if (sample->has_memory) {
+        if (sink->is_csv) {
+            char mem_file[512];
+            snprintf(mem_file, sizeof(mem_file), "%s.memory.csv", output_file);
+            export_memory_metrics_csv(&sample->memory, mem_file, sink->append);
+        } else if (sink->is_json) {
+            char json_file[512];
+            snprintf(json_file, sizeof(json_file), "%s.memory.%g.json",
+                    output_file, sample->elapsed);
+            export_memory_metrics_json(&sample->memory, json_file);
+        } else {
+            print_memory_metrics(&sample->memory);
+        }
+    }
+
+    if (sample->has_io) {
+        if (sink->is_csv) {
+            char io_file[512];
+            snprintf(io_file, sizeof(io_file), "%s.io.csv", output_file);
+            export_io_metrics_csv(&sample->io, io_file, sink->append);
+        } else if (sink->is_json) {
+            char json_file[512];
+            snprintf(json_file, sizeof(json_file), "%s.io.%g.json",
+                    output_file, sample->elapsed);
+            export_io_metrics_json(&sample->io, json_file);
+        } else {
+            print_io_metrics(&sample->io);
+        }
+    }
+    if (sample->has_network) {
+        if (sink->is_csv) {
+            char net_file[512];
+            snprintf(net_file, sizeof(net_file), "%s.network.csv", output_file);
+            export_network_metrics_csv(&sample->network, net_file, sink->network_append);
+            sink->network_append = 1;
+        } else if (sink->is_json) {
+            char json_file[512];
+            snprintf(json_file, sizeof(json_file), "%s.network.%g.json",
+                    output_file, sample->elapsed);
+            export_network_metrics_json(&sample->network, json_file);
+        } else {
+            print_network_metrics(&sample->network);
+        }
+    }
+    sink->append = 1;
+
+    if (!sink->is_csv && !sink->is_json) {
+        if (sample->has_fds) {
+            printf("Open file descriptors:     %d\n\n", sample->fd_count);
+        }
+        if (sample->has_smaps) {
+            print_memory_smaps(&sample->smaps);
+        }
+    }
+
+    if (sample->anomaly_count > 0) {
+        printf("\n");
+        for (int i = 0; i < sample->anomaly_count; i++) {
+            anomaly_print_event(&sample->anomalies[i]);
+        }
+
+        /* Export anomalies to CSV if output file specified */
+        if (output_file[0] != '\0') {
+            char anomaly_file[512];
+            snprintf(anomaly_file, sizeof(anomaly_file), "%s.anomalies.csv", output_file);
+            anomaly_export_csv(sample->anomalies, sample->anomaly_count, anomaly_file,
+                               sink->anomaly_append);
+            sink->anomaly_append = 1;
+        }
+    }
+}
+
+#define METRICS_CPU     0x01
+#define METRICS_MEMORY  0x02
+#define METRICS_IO      0x04
+#define METRICS_FDS     0x08
+#define METRICS_SMAPS   0x10
+#define METRICS_NETWORK 0x20
+#define METRICS_ALL     (METRICS_CPU | METRICS_MEMORY | METRICS_IO)
+#define METRICS_FULL    (METRICS_ALL | METRICS_FDS | METRICS_SMAPS | METRICS_NETWORK)
+
+static const struct {
+    const char *name;
+    unsigned int mask;
+} metric_names[] = {
+    { "cpu", METRICS_CPU }, { "memory", METRICS_MEMORY }, { "io", METRICS_IO },
+    { "fds", METRICS_FDS }, { "smaps", METRICS_SMAPS }, { "net", METRICS_NETWORK },
+    { "all", METRICS_ALL }, { "full", METRICS_FULL },
+};
+
+/* Parse a comma-separated -m list; returns 0 on an unknown name */
+static unsigned int parse_metrics(const char *list) {
+    char copy[128];
+    snprintf(copy, sizeof(copy), "%s", list);
+
+    unsigned int mask = 0;
+    char *saveptr = NULL;
+    for (char *name = strtok_r(copy, ",", &saveptr); name; name = strtok_r(NULL, ",", &saveptr)) {
+        size_t i;
+        for (i = 0; i < sizeof(metric_names) / sizeof(metric_names[0]); i++) {
+            if (strcmp(name, metric_names[i].name) == 0) {
+                mask |= metric_names[i].mask;
+                break;
+            }
+        }
+        if (i == sizeof(metric_names) / sizeof(metric_names[0])) {
+            return 0;
+        }
+    }
+    return mask;
+}
 
-    int monitor_cpu = (strcmp(metrics_type, "all") == 0 ||
-                      strcmp(metrics_type, "cpu") == 0);
-    int monitor_memory = (strcmp(metrics_type, "all") == 0 ||
-                         strcmp(metrics_type, "memory") == 0);
-    int monitor_io = (strcmp(metrics_type, "all") == 0 ||
-                     strcmp(metrics_type, "io") == 0);
+/* Collect one process and publish each sample to the console, ncurses and
+ * web front ends, all driven by the same event loop */
+int monitor_process(pid_t pid, double interval, int duration, const char *output_file,
+                    const char *format, unsigned int metrics, int enable_anomaly,
+                    int show_anomaly_stats, int use_ncurses, int web_port,
+                    const adaptive_rate_t *adaptive, double budget,
+                    uint32_t psi_stall_us, uint32_t psi_window_us) {
+    int use_console = !use_ncurses && web_port == 0;
+    if (!use_ncurses) {
+        printf("Monitoring PID %d (interval: %gs, duration: %ds)\n",
+               pid, interval, duration);
+    }
+
+    int monitor_cpu = (metrics & METRICS_CPU) != 0;
+    int monitor_memory = (metrics & METRICS_MEMORY) != 0;
+    int monitor_io = (metrics & METRICS_IO) != 0;
+    int monitor_fds = (metrics & METRICS_FDS) != 0;
+    int monitor_smaps = (metrics & METRICS_SMAPS) != 0;
+    int monitor_network = (metrics & METRICS_NETWORK) != 0;
 
     /* Initialize anomaly detector */
     anomaly_detector_t anomaly_detector;
     if (enable_anomaly) {
         if (anomaly_detector_init(&anomaly_detector, pid) == 0) {
-            printf("Anomaly detection enabled (threshold: %.1f sigma)\n", ANOMALY_THRESHOLD_SIGMA);
+            if (!use_ncurses) {
+                printf("Anomaly detection enabled (threshold: %.1f sigma)\n",
+                       ANOMALY_THRESHOLD_SIGMA);
+            }
         } else {
             fprintf(stderr, "Warning: Failed to initialize anomaly detector\n");
             enable_anomaly = 0;
         }
     }
 
-    cpu_metrics_t prev_cpu, curr_cpu, result_cpu;
-    memory_metrics_t memory;
-    io_metrics_t prev_io, curr_io, result_io;
-
-    int is_csv = (strcmp(format, "csv") == 0);
-    int is_json = (strcmp(format, "json") == 0);
-    int append = 0;
+    cpu_metrics_t prev_cpu, curr_cpu;
+    io_metrics_t prev_io, curr_io;
 
     /* Initialize monitors */
     if (monitor_cpu) {
@@ -121,117 +542,230 @@ int monitor_process(pid_t pid, int interval, int duration, const char *output_fi
         }
     }
 
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    /* Cheap snapshot every tick, fd listing and smaps walk on their cadences */
+    process_sources_t sources;
+    memset(&sources, 0, sizeof(sources));
+    sources.snap_files = proc_snapshot_files_for(monitor_cpu, monitor_memory, monitor_io);
 
-    int elapsed = 0;
-    while (running && (duration == 0 || elapsed < duration)) {
-        sleep(interval);
-        elapsed += interval;
+    collector_t collector;
+    collector_init(&collector, budget);
+    collector_register(&collector, "procfs", COST_CHEAP, 0, collect_snapshot, &sources);
+    if (monitor_fds) {
+        collector_register(&collector, "fd count", COST_MEDIUM, 0, collect_fds, &sources);
+    }
+    if (monitor_smaps) {
+        collector_register(&collector, "smaps_rollup", COST_EXPENSIVE, 0, collect_smaps, &sources);
+    }
+    network_metrics_t prev_net;
+    int has_prev_net = 0;
+    if (monitor_network) {
+        network_monitor_init();
+        network_monitor_set_max_age((adaptive ? adaptive->floor : interval) / 2);
+        collector_register(&collector, "network", COST_MEDIUM, 0, collect_network, &sources);
+        /* Get initial reading, so the first tick already has rates */
+        has_prev_net = (network_monitor_collect(pid, &prev_net) == 0);
+    }
 
-        /* Collect CPU metrics */
-        if (monitor_cpu) {
-            if (cpu_monitor_collect(pid, &curr_cpu) != 0) {
-                fprintf(stderr, "Process %d no longer exists\n", pid);
-                break;
-            }
-            cpu_monitor_calculate_percentage(&prev_cpu, &curr_cpu, &result_cpu);
+    if (event_loop_init(&running) != 0) {
+        fprintf(stderr, "Failed to create event loop: %s\n", strerror(errno));
+        return -1;
+    }
 
-            /* Update anomaly detector */
-            if (enable_anomaly) {
-                anomaly_detector_update_cpu(&anomaly_detector, result_cpu.cpu_percent);
-            }
+    /* Exit is delivered through a pidfd instead of failed collections */
+    exit_queue_t exits;
+    pidwatch_init();
+    if (pidwatch_add(pid) != 0 && errno != ENOSYS) {
+        fprintf(stderr, "Warning: Could not watch PID %d for exit: %s\n", pid, strerror(errno));
+    }
+    watch_exits(&exits);
 
-            if (is_csv && output_file) {
-                export_cpu_metrics_csv(&result_cpu, output_file, append);
-                append = 1;
-            } else if (is_json && output_file) {
-                char json_file[512];
-                snprintf(json_file, sizeof(json_file), "%s.cpu.%d.json",
-                        output_file, elapsed);
-                export_cpu_metrics_json(&result_cpu, json_file);
-            } else {
-                print_cpu_metrics(&result_cpu);
-            }
+    /* OOM kills, limit breaches and stalls of the process's cgroup arrive
+     * as kernel notifications, not through sampling */
+    cgroup_watch_t cgroup_watch = { .count = 0, .events_watch = -1,
+                                    .detector = &anomaly_detector };
+    if (enable_anomaly) {
+        char cgroup_path[MAX_CGROUP_PATH];
+        if (cgroup_get_process_cgroup(pid, cgroup_path, sizeof(cgroup_path)) != 0) {
+            fprintf(stderr, "Warning: Could not find the cgroup of PID %d\n", pid);
+        } else if (watch_cgroup(&cgroup_watch, cgroup_path, psi_stall_us, psi_window_us) > 0 &&
+                   !use_ncurses) {
+            printf("PSI triggers armed: %u ms of stall within %u ms\n",
+                   psi_stall_us / 1000, psi_window_us / 1000);
+        }
+    }
 
-            prev_cpu = curr_cpu;
+    console_sink_t sink = {
+        .output_file = output_file,
+        .is_csv = (strcmp(format, "csv") == 0) && output_file[0] != '\0',
+        .is_json = (strcmp(format, "json") == 0) && output_file[0] != '\0',
+    };
+    if (use_console) {
+        event_loop_subscribe(console_print_sample, &sink);
+    }
+
+    /* Web first: the dashboard announces its URL before ncurses owns the screen */
+    int status = 0;
+    if (web_port > 0) {
+        web_config_t web_config = {
+            .port = web_port,
+            .monitored_pid = pid,
+        };
+        if (web_dashboard_attach(&web_config) != 0) {
+            status = -1;
         }
+    }
+    if (status == 0 && use_ncurses) {
+        if (ncurses_ui_init() != 0 || ncurses_ui_attach() != 0) {
+            ncurses_ui_cleanup();
+            fprintf(stderr, "Failed to initialize ncurses UI\n");
+            use_ncurses = 0;
+            status = -1;
+        }
+    }
 
-        /* Collect memory metrics */
-        if (monitor_memory) {
-            if (memory_monitor_collect(pid, &memory) == 0) {
-                /* Update anomaly detector */
-                if (enable_anomaly) {
-                    anomaly_detector_update_memory(&anomaly_detector, (double)memory.rss);
-                }
+    /* Adaptive mode starts from -i clamped into the floor..ceiling range */
+    adaptive_rate_t rate;
+    if (adaptive) {
+        rate = *adaptive;
+        interval = rate.interval;
+    }
 
-                if (is_csv && output_file) {
-                    char mem_file[512];
-                    snprintf(mem_file, sizeof(mem_file), "%s.memory.csv", output_file);
-                    export_memory_metrics_csv(&memory, mem_file, append);
-                } else if (is_json && output_file) {
-                    char json_file[512];
-                    snprintf(json_file, sizeof(json_file), "%s.memory.%d.json",
-                            output_file, elapsed);
-                    export_memory_metrics_json(&memory, json_file);
-                } else {
-                    print_memory_metrics(&memory);
-                }
-            }
+    sample_scheduler_t sched;
+    scheduler_init(&sched, interval);
+
+    double elapsed = 0.0;
+    int process_exited = 0;
+    int process_gone = 0;
+    while (status == 0 && running && !process_exited &&
+           (duration == 0 || elapsed < duration)) {
+        int skipped = scheduler_next(&sched);
+        if (skipped > 0 && !use_ncurses) {
+            fprintf(stderr, "Warning: collection overran, skipped %d sample(s)\n", skipped);
         }
 
-        /* Collect I/O metrics */
-        if (monitor_io) {
-            if (io_monitor_collect(pid, &curr_io) == 0) {
-                io_monitor_calculate_rates(&prev_io, &curr_io, &result_io);
+        /* Trigger events are published as they arrive, without
+         * moving the next tick */
+        int woke;
+        while ((woke = event_loop_run_until(&sched.deadline)) == 1 && exits.count == 0 &&
+               enable_anomaly) {
+            publish_alerts(&anomaly_detector, pid, sched.ticks, elapsed);
+        }
+        if (woke < 0) {
+            break;
+        }
+        if (exits.count > 0) {
+            /* Finalize with one last read while the task is still a zombie */
+            process_exited = 1;
+            if (!use_ncurses) {
+                printf("Process %d exited after %.3fs\n", pid,
+                       (exits.events[0].exit_time.tv_sec - sched.start.tv_sec) +
+                       (exits.events[0].exit_time.tv_nsec - sched.start.tv_nsec) / 1e9);
+            }
+        }
+        scheduler_tick(&sched);
+        elapsed = scheduler_elapsed(&sched);
+
+        monitor_sample_t sample;
+        memset(&sample, 0, sizeof(sample));
+        sample.pid = pid;
+        sample.tick = sched.ticks;
+        sample.elapsed = elapsed;
+        sample.exited = process_exited;
+        sample.interval = sched.interval_ns / 1e9;
+
+        sources.has_fds = 0;
+        sources.has_smaps = 0;
+        sources.has_network = 0;
+        collector_run(&collector, sched.ticks - 1, pid);
+
+        const proc_snapshot_t *snap = &sources.snap;
+        if (!sources.snap_ok ||
+            (monitor_cpu && cpu_monitor_from_snapshot(snap, &curr_cpu) != 0)) {
+            process_gone = 1;
+            break;
+        }
+        sample.timestamp = snap->timestamp;
+        sample.has_fds = sources.has_fds;
+        sample.fd_count = sources.fd_count;
+        sample.has_smaps = sources.has_smaps;
+        sample.smaps = sources.smaps;
+        if (sources.has_network) {
+            /* The first read only sets the baseline for rates */
+            if (has_prev_net) {
+                network_monitor_calculate_rates(&prev_net, &sources.network, &sample.network);
+                sample.has_network = 1;
+            }
+            prev_net = sources.network;
+            has_prev_net = 1;
+        }
 
-                /* Update anomaly detector */
-                if (enable_anomaly) {
-                    anomaly_detector_update_io(&anomaly_detector, result_io.read_rate, result_io.write_rate);
-                }
+        if (monitor_cpu) {
+            cpu_monitor_calculate_percentage(&prev_cpu, &curr_cpu, &sample.cpu);
+            sample.has_cpu = 1;
+            if (enable_anomaly) {
+                anomaly_detector_update_cpu(&anomaly_detector, sample.cpu.cpu_percent);
+            }
+            prev_cpu = curr_cpu;
+        }
 
-                if (is_csv && output_file) {
-                    char io_file[512];
-                    snprintf(io_file, sizeof(io_file), "%s.io.csv", output_file);
-                    export_io_metrics_csv(&result_io, io_file, append);
-                } else if (is_json && output_file) {
-                    char json_file[512];
-                    snprintf(json_file, sizeof(json_file), "%s.io.%d.json",
-                            output_file, elapsed);
-                    export_io_metrics_json(&result_io, json_file);
-                } else {
-                    print_io_metrics(&result_io);
-                }
+        if (monitor_memory && memory_monitor_from_snapshot(snap, &sample.memory) == 0) {
+            sample.has_memory = 1;
+            if (enable_anomaly) {
+                anomaly_detector_update_memory(&anomaly_detector, (double)sample.memory.rss);
+            }
+        }
 
-                prev_io = curr_io;
+        if (monitor_io && io_monitor_from_snapshot(snap, &curr_io) == 0) {
+            io_monitor_calculate_rates(&prev_io, &curr_io, &sample.io);
+            sample.has_io = 1;
+            if (enable_anomaly) {
+                anomaly_detector_update_io(&anomaly_detector, sample.io.read_rate,
+                                           sample.io.write_rate);
             }
+            prev_io = curr_io;
         }
 
-        /* Check for anomalies */
         if (enable_anomaly) {
-            anomaly_event_t anomalies[10];
-            int anomaly_count = anomaly_detector_check(&anomaly_detector, anomalies, 10);
+            sample.anomaly_count = anomaly_detector_check(&anomaly_detector, sample.anomalies,
+                                                          MONITOR_SAMPLE_MAX_ANOMALIES);
+        }
 
-            if (anomaly_count > 0) {
-                printf("\n");
-                for (int i = 0; i < anomaly_count; i++) {
-                    anomaly_print_event(&anomalies[i]);
-                }
+        /* Rates above use the snapshot timestamps, so they stay exact
+         * whatever interval preceded this sample */
+        if (adaptive) {
+            sample.interval = adaptive_rate_update(&rate, sample.cpu.cpu_percent,
+                                                   (double)sample.memory.rss,
+                                                   sample.io.read_rate + sample.io.write_rate);
+            scheduler_set_interval(&sched, sample.interval);
+        }
 
-                /* Export anomalies to CSV if output file specified */
-                if (output_file[0] != '\0') {
-                    char anomaly_file[512];
-                    snprintf(anomaly_file, sizeof(anomaly_file), "%s.anomalies.csv", output_file);
-                    anomaly_export_csv(anomalies, anomaly_count, anomaly_file, elapsed > interval);
-                }
-            }
+        event_loop_publish(&sample);
+    }
+
+    if (use_ncurses) {
+        /* Leave the last screen up long enough to be read */
+        if (process_gone) {
+            ncurses_ui_update_status("Process no longer exists");
+        }
+        if (process_gone || process_exited) {
+            sleep(2);
         }
+        ncurses_ui_cleanup();
+    }
+    if (process_gone) {
+        fprintf(stderr, "Process %d no longer exists\n", pid);
     }
 
     /* Cleanup */
+    if (web_port > 0) web_dashboard_cleanup();
+    event_loop_cleanup();
+    if (enable_anomaly) unwatch_cgroup(&cgroup_watch);
+    pidwatch_cleanup();
+    taskstats_cleanup();
     if (monitor_cpu) cpu_monitor_cleanup();
     if (monitor_memory) memory_monitor_cleanup();
     if (monitor_io) io_monitor_cleanup();
+    if (monitor_network) network_monitor_cleanup();
 
     /* Print anomaly statistics if requested */
     if (enable_anomaly && show_anomaly_stats) {
@@ -242,186 +776,782 @@ int monitor_process(pid_t pid, int interval, int duration, const char *output_fi
         anomaly_detector_cleanup(&anomaly_detector);
     }
 
+    if (status != 0) {
+        return -1;
+    }
+    if (monitor_fds || monitor_smaps || budget > 0.0) {
+        print_collector_stats(&collector);
+    }
+    print_scheduler_stats(&sched);
     printf("\nMonitoring completed.\n");
     return 0;
 }
 
-int monitor_process_ncurses(pid_t pid, int interval, int duration,
-                           const char *metrics_type, int enable_anomaly) {
-    int monitor_cpu = (strcmp(metrics_type, "all") == 0 ||
-                      strcmp(metrics_type, "cpu") == 0);
-    int monitor_memory = (strcmp(metrics_type, "all") == 0 ||
-                         strcmp(metrics_type, "memory") == 0);
-    int monitor_io = (strcmp(metrics_type, "all") == 0 ||
-                     strcmp(metrics_type, "io") == 0);
-
-    /* Initialize ncurses UI */
-    if (ncurses_ui_init() != 0) {
-        fprintf(stderr, "Failed to initialize ncurses UI\n");
+/* Sample a cgroup each interval and publish its rates to the console,
+ * ncurses and web front ends, like monitor_process() does for a PID */
+int monitor_cgroup(const char *cgroup_path, double interval, int duration,
+                   const char *output_file, const char *format, int enable_anomaly,
+                   int show_anomaly_stats, int use_ncurses, int web_port,
+                   uint32_t psi_stall_us, uint32_t psi_window_us) {
+    int use_console = !use_ncurses && web_port == 0;
+    if (cgroup_init() != 0) {
         return -1;
     }
 
-    /* Initialize anomaly detector */
+    /* The first sample is the baseline for rates */
+    cgroup_metrics_t prev, curr;
+    cgroup_collect_metrics(cgroup_path, &prev);
+    if (!prev.has_cpu && !prev.has_memory && !prev.has_blkio && !prev.has_pids) {
+        fprintf(stderr, "Failed to collect cgroup metrics for %s\n", cgroup_path);
+        cgroup_cleanup();
+        return -1;
+    }
+    if (!use_ncurses) {
+        printf("Monitoring cgroup %s%s (interval: %gs, duration: %ds)\n",
+               cgroup_get_mount_point(), cgroup_path, interval, duration);
+    }
+
     anomaly_detector_t anomaly_detector;
     if (enable_anomaly) {
-        if (anomaly_detector_init(&anomaly_detector, pid) != 0) {
-            ncurses_ui_cleanup();
-            fprintf(stderr, "Failed to initialize anomaly detector\n");
-            return -1;
+        if (anomaly_detector_init(&anomaly_detector, 0) == 0) {
+            if (!use_ncurses) {
+                printf("Anomaly detection enabled (threshold: %.1f sigma)\n",
+                       ANOMALY_THRESHOLD_SIGMA);
+            }
+        } else {
+            fprintf(stderr, "Warning: Failed to initialize anomaly detector\n");
+            enable_anomaly = 0;
         }
     }
 
-    cpu_metrics_t prev_cpu, curr_cpu, result_cpu;
-    memory_metrics_t memory;
-    io_metrics_t prev_io, curr_io, result_io;
+    if (event_loop_init(&running) != 0) {
+        fprintf(stderr, "Failed to create event loop: %s\n", strerror(errno));
+        cgroup_cleanup();
+        return -1;
+    }
 
-    /* Initialize monitors */
-    if (monitor_cpu) {
-        if (cpu_monitor_init() != 0) {
-            ncurses_ui_cleanup();
-            fprintf(stderr, "Failed to initialize CPU monitor\n");
-            return -1;
+    cgroup_watch_t cgroup_watch = { .count = 0, .events_watch = -1,
+                                    .detector = &anomaly_detector };
+    if (enable_anomaly &&
+        watch_cgroup(&cgroup_watch, cgroup_path, psi_stall_us, psi_window_us) > 0 &&
+        !use_ncurses) {
+        printf("PSI triggers armed: %u ms of stall within %u ms\n",
+               psi_stall_us / 1000, psi_window_us / 1000);
+    }
+
+    console_sink_t sink = {
+        .output_file = output_file,
+        .is_csv = (strcmp(format, "csv") == 0) && output_file[0] != '\0',
+        .is_json = (strcmp(format, "json") == 0) && output_file[0] != '\0',
+    };
+    if (use_console) {
+        event_loop_subscribe(console_print_sample, &sink);
+    }
+
+    int status = 0;
+    if (web_port > 0) {
+        web_config_t web_config = {
+            .port = web_port,
+            .cgroup_path = cgroup_path,
+        };
+        if (web_dashboard_attach(&web_config) != 0) {
+            status = -1;
         }
-        if (cpu_monitor_collect(pid, &prev_cpu) != 0) {
+    }
+    if (status == 0 && use_ncurses) {
+        if (ncurses_ui_init() != 0 || ncurses_ui_attach() != 0) {
             ncurses_ui_cleanup();
-            fprintf(stderr, "Failed to collect initial CPU metrics\n");
-            return -1;
+            fprintf(stderr, "Failed to initialize ncurses UI\n");
+            use_ncurses = 0;
+            status = -1;
         }
     }
 
-    if (monitor_memory) {
-        if (memory_monitor_init() != 0) {
-            ncurses_ui_cleanup();
-            fprintf(stderr, "Failed to initialize memory monitor\n");
-            return -1;
+    sample_scheduler_t sched;
+    scheduler_init(&sched, interval);
+
+    double elapsed = 0.0;
+    int cgroup_gone = 0;
+    while (status == 0 && running && (duration == 0 || elapsed < duration)) {
+        int skipped = scheduler_next(&sched);
+        if (skipped > 0 && !use_ncurses) {
+            fprintf(stderr, "Warning: collection overran, skipped %d sample(s)\n", skipped);
+        }
+
+        int woke;
+        while ((woke = event_loop_run_until(&sched.deadline)) == 1 && enable_anomaly) {
+            publish_alerts(&anomaly_detector, 0, sched.ticks, elapsed);
         }
+        if (woke < 0) {
+            break;
+        }
+        scheduler_tick(&sched);
+        elapsed = scheduler_elapsed(&sched);
+
+        cgroup_collect_metrics(cgroup_path, &curr);
+        if (!curr.has_cpu && !curr.has_memory && !curr.has_blkio && !curr.has_pids) {
+            cgroup_gone = 1;
+            break;
+        }
+
+        monitor_sample_t sample;
+        memset(&sample, 0, sizeof(sample));
+        sample.tick = sched.ticks;
+        sample.elapsed = elapsed;
+        sample.timestamp = curr.cpu.timestamp;
+        sample.interval = sched.interval_ns / 1e9;
+        sample.has_cgroup = 1;
+        cgroup_calculate_device_rates(&prev.blkio, &curr.blkio);
+        sample.cgroup = curr;
+        cgroup_calculate_rates(&prev, &curr, &sample.cgroup_rates);
+        prev = curr;
+
+        if (enable_anomaly) {
+            const cgroup_rates_t *rates = &sample.cgroup_rates;
+            if (curr.has_cpu) {
+                anomaly_detector_update_cpu(&anomaly_detector, rates->cpu_cores * 100.0);
+            }
+            if (curr.has_memory) {
+                anomaly_detector_update_memory(&anomaly_detector, curr.memory.current / 1024.0);
+            }
+            if (curr.has_blkio) {
+                anomaly_detector_update_io(&anomaly_detector, rates->read_rate,
+                                           rates->write_rate);
+            }
+            sample.anomaly_count = anomaly_detector_check(&anomaly_detector, sample.anomalies,
+                                                          MONITOR_SAMPLE_MAX_ANOMALIES);
+        }
+
+        event_loop_publish(&sample);
     }
 
-    if (monitor_io) {
-        if (io_monitor_init() != 0) {
-            ncurses_ui_cleanup();
-            fprintf(stderr, "Failed to initialize I/O monitor\n");
-            return -1;
+    if (use_ncurses) {
+        if (cgroup_gone) {
+            ncurses_ui_update_status("Cgroup no longer exists");
+            sleep(2);
         }
-        if (io_monitor_collect(pid, &prev_io) != 0) {
-            monitor_io = 0;
+        ncurses_ui_cleanup();
+    }
+    if (cgroup_gone) {
+        fprintf(stderr, "Cgroup %s no longer exists\n", cgroup_path);
+    }
+
+    if (web_port > 0) web_dashboard_cleanup();
+    event_loop_cleanup();
+    if (enable_anomaly) unwatch_cgroup(&cgroup_watch);
+    cgroup_cleanup();
+
+    if (enable_anomaly && show_anomaly_stats) {
+        anomaly_print_stats(&anomaly_detector);
+    }
+    if (enable_anomaly) {
+        anomaly_detector_cleanup(&anomaly_detector);
+    }
+
+    if (status != 0) {
+        return -1;
+    }
+    print_scheduler_stats(&sched);
+    printf("\nMonitoring completed.\n");
+    return 0;
+}
+
+#define MAX_MONITOR_PIDS 64
+#define SCAN_TOP_PROCESSES 20
+
+/* Scan every process each interval with the parallel /proc scanner */
+int monitor_all_processes(double interval, int duration, const char *output_file,
+                          const char *format, int threads) {
+    if (cpu_monitor_init() != 0) {
+        fprintf(stderr, "Failed to initialize CPU monitor\n");
+        return -1;
+    }
+    /* Before the workers start, so they inherit the blocked signals */
+    if (event_loop_init(&running) != 0) {
+        fprintf(stderr, "Failed to create event loop: %s\n", strerror(errno));
+        return -1;
+    }
+    if (proc_scanner_init(threads) != 0) {
+        fprintf(stderr, "Failed to start /proc scanner\n");
+        event_loop_cleanup();
+        return -1;
+    }
+
+    printf("Monitoring all processes with %d scanner threads (interval: %gs)\n",
+           proc_scanner_thread_count(), interval);
+
+    int is_csv = (strcmp(format, "csv") == 0) && output_file[0] != '\0';
+    int append = 0;
+
+    proc_scan_result_t prev, curr;
+    memset(&prev, 0, sizeof(prev));
+    memset(&curr, 0, sizeof(curr));
+
+    /* Baseline for CPU and I/O rates */
+    if (proc_scanner_scan(PROC_SCAN_ALL, &prev) < 0) {
+        proc_scanner_cleanup();
+        event_loop_cleanup();
+        return -1;
+    }
+
+    sample_scheduler_t sched;
+    scheduler_init(&sched, interval);
+
+    double elapsed = 0.0;
+    while (running && (duration == 0 || elapsed < duration)) {
+        scheduler_next(&sched);
+        if (event_loop_run_until(&sched.deadline) < 0) {
+            break;
+        }
+        scheduler_tick(&sched);
+        elapsed = scheduler_elapsed(&sched);
+
+        if (proc_scanner_scan(PROC_SCAN_ALL, &curr) < 0) {
+            break;
+        }
+        proc_scanner_calculate_rates(&prev, &curr);
+
+        if (is_csv) {
+            export_proc_scan_csv(&curr, output_file, append);
+            append = 1;
+            if (curr.skipped > 0) {
+                fprintf(stderr, "Warning: %d processes could not be read (%s) and are missing\n",
+                        curr.skipped, strerror(curr.skip_errno));
+            }
+        } else {
+            printf("\n===== Sample at %.3fs =====\n", elapsed);
+            print_proc_scan_result(&curr, SCAN_TOP_PROCESSES);
         }
+
+        proc_scan_result_t swap = prev;
+        prev = curr;
+        curr = swap;
     }
 
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    proc_scan_result_free(&prev);
+    proc_scan_result_free(&curr);
+    proc_scanner_cleanup();
+    event_loop_cleanup();
+    cpu_monitor_cleanup();
+    taskstats_cleanup();
 
-    int elapsed = 0;
+    print_scheduler_stats(&sched);
+    printf("\nMonitoring completed.\n");
+    return 0;
+}
+
+/* Sweep the cgroup hierarchy each interval and show the busiest cgroups */
+int monitor_cgroup_tree(const char *root, cgroup_tree_sort_t sort, int top_n, double interval,
+                        int duration, const char *output_file, const char *format, int threads) {
+    cgroup_init();
+    /* Before the workers start, so they inherit the blocked signals */
+    if (event_loop_init(&running) != 0) {
+        fprintf(stderr, "Failed to create event loop: %s\n", strerror(errno));
+        return -1;
+    }
+    if (cgroup_tree_init(root, threads) != 0) {
+        fprintf(stderr, "Failed to start cgroup sweep\n");
+        event_loop_cleanup();
+        return -1;
+    }
+
+    printf("Monitoring cgroups below %s%s with %d threads (interval: %gs)\n",
+           cgroup_get_mount_point(), root, cgroup_tree_thread_count(), interval);
+
+    int is_csv = (strcmp(format, "csv") == 0) && output_file[0] != '\0';
+    int append = 0;
+
+    cgroup_tree_result_t prev, curr;
+    memset(&prev, 0, sizeof(prev));
+    memset(&curr, 0, sizeof(curr));
+
+    /* Baseline for CPU and I/O rates */
+    if (cgroup_tree_scan(&prev) < 0) {
+        cgroup_tree_cleanup();
+        event_loop_cleanup();
+        return -1;
+    }
+
+    sample_scheduler_t sched;
+    scheduler_init(&sched, interval);
+
+    double elapsed = 0.0;
     while (running && (duration == 0 || elapsed < duration)) {
-        /* Check for quit key */
-        if (ncurses_ui_check_quit()) {
-            running = 0;
+        scheduler_next(&sched);
+        if (event_loop_run_until(&sched.deadline) < 0) {
+            break;
+        }
+        scheduler_tick(&sched);
+        elapsed = scheduler_elapsed(&sched);
+
+        if (cgroup_tree_scan(&curr) < 0) {
             break;
         }
+        cgroup_tree_calculate_rates(&prev, &curr);
 
-        sleep(interval);
-        elapsed += interval;
+        if (is_csv) {
+            cgroup_tree_export_csv(&curr, output_file, append);
+            append = 1;
+        } else {
+            printf("\n===== Sample at %.3fs =====\n", elapsed);
+            cgroup_tree_print(&curr, sort, top_n);
+        }
 
-        /* Clear and draw header */
-        ncurses_ui_clear_metrics();
-        ncurses_ui_draw_header("Resource Monitor", pid, elapsed);
+        cgroup_tree_result_t swap = prev;
+        prev = curr;
+        curr = swap;
+    }
 
-        int line = 3;
+    cgroup_tree_result_free(&prev);
+    cgroup_tree_result_free(&curr);
+    cgroup_tree_cleanup();
+    event_loop_cleanup();
+    cgroup_cleanup();
 
-        /* Collect and display CPU metrics */
-        if (monitor_cpu) {
-            if (cpu_monitor_collect(pid, &curr_cpu) != 0) {
-                ncurses_ui_update_status("Process no longer exists");
-                sleep(2);
-                break;
+    print_scheduler_stats(&sched);
+    printf("\nMonitoring completed.\n");
+    return 0;
+}
+
+/* Apply proc connector events and taskstats exit records to the
+ * followed trees; registered for both descriptors */
+static void on_tree_events(int fd, uint32_t events, void *arg) {
+    (void)fd;
+    (void)events;
+    (void)arg;
+    proc_event_t batch[PROC_EVENTS_MAX_BATCH];
+    task_accounting_t records[PROC_EVENTS_MAX_BATCH];
+
+    /* Connector first: a fork is queued before the exit record of
+     * the same child, so the child is a member when its record lands */
+    int n;
+    while ((n = proc_events_read(batch, PROC_EVENTS_MAX_BATCH)) > 0) {
+        for (int i = 0; i < n; i++) {
+            if (batch[i].type == PROC_EVENT_TYPE_OVERRUN) {
+                fprintf(stderr, "Warning: process events lost, rescanning trees\n");
             }
-            cpu_monitor_calculate_percentage(&prev_cpu, &curr_cpu, &result_cpu);
+            proc_tree_handle_event(&batch[i]);
+        }
+    }
 
-            if (enable_anomaly) {
-                anomaly_detector_update_cpu(&anomaly_detector, result_cpu.cpu_percent);
+    if (taskstats_exit_get_fd() >= 0) {
+        int lost = 0;
+        while ((n = taskstats_exit_read(records, PROC_EVENTS_MAX_BATCH, &lost)) > 0) {
+            for (int i = 0; i < n; i++) {
+                proc_tree_handle_exit_record(&records[i]);
             }
+        }
+        if (lost) {
+            fprintf(stderr, "Warning: taskstats exit records lost\n");
+        }
+    }
+}
 
-            ncurses_ui_draw_cpu_metrics(&result_cpu, line);
-            line += 3;
-            prev_cpu = curr_cpu;
+/* Follow seed PIDs and every descendant through proc connector events */
+int monitor_process_trees(const pid_t *pids, int num_pids, double interval, int duration,
+                          const char *output_file, const char *format) {
+    if (proc_events_init() != 0) {
+        fprintf(stderr, "Failed to subscribe to process events: %s (needs CAP_NET_ADMIN)\n",
+                strerror(errno));
+        return -1;
+    }
+
+    /* Exit records carry each task's final accounting; without them the
+     * last counters are read when the exit event arrives */
+    if (taskstats_exit_listen() != 0) {
+        fprintf(stderr, "Warning: taskstats exit records unavailable (%s)\n", strerror(errno));
+    }
+
+    /* Subscribed first, so a fork racing with the children scan is not missed */
+    if (proc_tree_init() != 0) {
+        taskstats_exit_cleanup();
+        proc_events_cleanup();
+        return -1;
+    }
+    for (int i = 0; i < num_pids; i++) {
+        if (proc_tree_add_root(pids[i]) != 0) {
+            fprintf(stderr, "Warning: Could not follow PID %d: %s\n", pids[i], strerror(errno));
         }
+    }
 
-        /* Collect and display memory metrics */
-        if (monitor_memory) {
-            if (memory_monitor_collect(pid, &memory) == 0) {
-                if (enable_anomaly) {
-                    anomaly_detector_update_memory(&anomaly_detector, (double)memory.rss);
-                }
+    printf("Following %d process tree(s), %d processes (interval: %gs)\n",
+           proc_tree_root_count(), proc_tree_member_count(), interval);
+
+    if (event_loop_init(&running) != 0 ||
+        event_loop_add_fd(proc_events_get_fd(), EPOLLIN, on_tree_events, NULL) != 0 ||
+        (taskstats_exit_get_fd() >= 0 &&
+         event_loop_add_fd(taskstats_exit_get_fd(), EPOLLIN, on_tree_events, NULL) != 0)) {
+        fprintf(stderr, "Failed to create event loop: %s\n", strerror(errno));
+        event_loop_cleanup();
+        proc_tree_cleanup();
+        proc_events_cleanup();
+        taskstats_exit_cleanup();
+        return -1;
+    }
+
+    int is_csv = (strcmp(format, "csv") == 0) && output_file[0] != '\0';
+    int append = 0;
+
+    proc_tree_metrics_t trees[MAX_MONITOR_PIDS];
+    sample_scheduler_t sched;
+    scheduler_init(&sched, interval);
+
+    double elapsed = 0.0;
+    while (running && proc_tree_member_count() > 0 && (duration == 0 || elapsed < duration)) {
+        scheduler_next(&sched);
+        if (event_loop_run_until(&sched.deadline) < 0) {
+            break;
+        }
+        scheduler_tick(&sched);
+        elapsed = scheduler_elapsed(&sched);
 
-                ncurses_ui_draw_separator(line);
-                line++;
-                ncurses_ui_draw_memory_metrics(&memory, line);
-                line += 3;
+        int count = proc_tree_sample(trees, MAX_MONITOR_PIDS);
+        if (!is_csv) {
+            printf("\n===== Sample at %.3fs =====\n\n", elapsed);
+        }
+        for (int i = 0; i < count; i++) {
+            if (is_csv) {
+                export_proc_tree_metrics_csv(&trees[i], output_file, append);
+                append = 1;
+            } else {
+                print_proc_tree_metrics(&trees[i]);
             }
         }
+    }
 
-        /* Collect and display I/O metrics */
-        if (monitor_io) {
-            if (io_monitor_collect(pid, &curr_io) == 0) {
-                io_monitor_calculate_rates(&prev_io, &curr_io, &result_io);
+    if (proc_tree_member_count() == 0) {
+        printf("All followed processes exited\n");
+    }
 
-                if (enable_anomaly) {
-                    anomaly_detector_update_io(&anomaly_detector, result_io.read_rate, result_io.write_rate);
-                }
+    event_loop_cleanup();
+    proc_tree_cleanup();
+    proc_events_cleanup();
+    taskstats_exit_cleanup();
+    taskstats_cleanup();
 
-                ncurses_ui_draw_separator(line);
-                line++;
-                ncurses_ui_draw_io_metrics(&result_io, line);
-                line += 3;
-                prev_io = curr_io;
-            }
+    print_scheduler_stats(&sched);
+    printf("\nMonitoring completed.\n");
+    return 0;
+}
+
+/* Per-thread CPU breakdown of each PID, hottest threads first */
+int monitor_process_threads(const pid_t *pids, int num_pids, double interval, int duration,
+                            const char *output_file, const char *format, int top_n) {
+    thread_monitor_init();
+
+    /* Baseline: the first collect only records each thread's counters */
+    int live = 0;
+    thread_sample_t sample;
+    for (int i = 0; i < num_pids; i++) {
+        if (thread_monitor_collect(pids[i], &sample) == 0) {
+            printf("PID %d: %d threads\n", pids[i], sample.count);
+            live++;
+        } else {
+            fprintf(stderr, "Warning: Could not read threads of PID %d: %s\n",
+                    pids[i], strerror(errno));
         }
+    }
+    if (live == 0) {
+        thread_monitor_cleanup();
+        return -1;
+    }
 
-        /* Check for anomalies and display */
-        if (enable_anomaly) {
-            anomaly_event_t anomalies[10];
-            int anomaly_count = anomaly_detector_check(&anomaly_detector, anomalies, 10);
-
-            if (anomaly_count > 0) {
-                ncurses_ui_draw_separator(line);
-                line++;
-                for (int i = 0; i < anomaly_count && i < 3; i++) {
-                    ncurses_ui_draw_anomaly(&anomalies[i], line);
-                    line++;
-                }
+    printf("Monitoring threads of %d process(es) (interval: %gs)\n", live, interval);
+
+    if (event_loop_init(&running) != 0) {
+        fprintf(stderr, "Failed to create event loop: %s\n", strerror(errno));
+        thread_monitor_cleanup();
+        return -1;
+    }
+
+    int is_csv = (strcmp(format, "csv") == 0) && output_file[0] != '\0';
+    int append = 0;
+    int active[MAX_MONITOR_PIDS];
+    for (int i = 0; i < num_pids; i++) {
+        active[i] = 1;
+    }
+
+    sample_scheduler_t sched;
+    scheduler_init(&sched, interval);
+
+    double elapsed = 0.0;
+    while (running && live > 0 && (duration == 0 || elapsed < duration)) {
+        scheduler_next(&sched);
+        if (event_loop_run_until(&sched.deadline) < 0) {
+            break;
+        }
+        scheduler_tick(&sched);
+        elapsed = scheduler_elapsed(&sched);
+
+        if (!is_csv) {
+            printf("\n===== Sample at %.3fs =====\n\n", elapsed);
+        }
+        for (int i = 0; i < num_pids; i++) {
+            if (!active[i]) {
+                continue;
+            }
+            if (thread_monitor_collect(pids[i], &sample) != 0) {
+                printf("Process %d terminated\n", pids[i]);
+                active[i] = 0;
+                live--;
+                continue;
+            }
+            if (is_csv) {
+                export_thread_sample_csv(&sample, output_file, append);
+                append = 1;
+            } else {
+                print_thread_sample(&sample, top_n);
             }
         }
+    }
 
-        ncurses_ui_update_status("Monitoring... (Press 'q' to quit)");
-        ncurses_ui_refresh();
+    event_loop_cleanup();
+    thread_monitor_cleanup();
+
+    print_scheduler_stats(&sched);
+    printf("\nMonitoring completed.\n");
+    return 0;
+}
+
+/* One -p target of the multi-process loop; each keeps its own deadlines
+ * so adaptive mode can sample it at its own rate */
+typedef struct {
+    pid_t pid;
+    sample_scheduler_t sched;
+    adaptive_rate_t rate;
+    cpu_metrics_t prev_cpu;
+    int has_prev;
+    network_metrics_t prev_net;
+    int has_prev_net;
+} process_target_t;
+
+/* Print one sample of a target; returns -1 once the process is gone */
+static int sample_target(process_target_t *target, const adaptive_rate_t *adaptive) {
+    if (adaptive) {
+        printf("\n--- PID %d (interval %.3fs) ---\n", target->pid,
+               target->sched.interval_ns / 1e9);
+    } else {
+        printf("\n--- PID %d ---\n", target->pid);
     }
 
-    /* Cleanup */
-    if (monitor_cpu) cpu_monitor_cleanup();
-    if (monitor_memory) memory_monitor_cleanup();
-    if (monitor_io) io_monitor_cleanup();
+    proc_snapshot_t snap;
+    if (proc_snapshot_take(target->pid, proc_snapshot_files_for(1, 1, 0), &snap) != 0) {
+        if (procfs_is_gone_error(errno)) {
+            printf("Process no longer exists\n");
+            return -1;
+        }
+        printf("Could not read process: %s\n", strerror(errno));
+        return 0;
+    }
 
-    if (enable_anomaly) {
-        anomaly_detector_cleanup(&anomaly_detector);
+    cpu_metrics_t cpu, result;
+    memset(&result, 0, sizeof(result));
+    if (cpu_monitor_from_snapshot(&snap, &cpu) == 0) {
+        if (target->has_prev) {
+            cpu_monitor_calculate_percentage(&target->prev_cpu, &cpu, &result);
+        }
+        target->prev_cpu = cpu;
+        target->has_prev = 1;
+        printf("CPU: %.2f%% | Threads: %ld\n", result.cpu_percent, cpu.num_threads);
     }
 
-    ncurses_ui_cleanup();
+    memory_metrics_t mem;
+    memset(&mem, 0, sizeof(mem));
+    if (memory_monitor_from_snapshot(&snap, &mem) == 0) {
+        printf("Memory: RSS=%lu KB, VSZ=%lu KB\n", mem.rss, mem.vsz);
+    }
 
-    printf("\nMonitoring completed.\n");
+    /* Targets sharing a network namespace share one read per tick */
+    network_metrics_t net;
+    if (network_monitor_collect(target->pid, &net) == 0) {
+        network_metrics_t rates;
+        memset(&rates, 0, sizeof(rates));
+        if (target->has_prev_net) {
+            network_monitor_calculate_rates(&target->prev_net, &net, &rates);
+        }
+        target->prev_net = net;
+        target->has_prev_net = 1;
+        printf("Network: net:[%lu] RX=%.0f B/s, TX=%.0f B/s | TCP: %d, UDP: %d",
+               (unsigned long)net.netns, rates.rx_rate, rates.tx_rate,
+               net.tcp_connections, net.udp_connections);
+        if (net.has_sockets) {
+            printf(" | TIME_WAIT: %d, full listen queues: %d",
+                   net.sockets.tcp_states[SOCK_TCP_TIME_WAIT], net.sockets.listen_full);
+        }
+        printf("\n");
+    }
+
+    if (adaptive) {
+        scheduler_set_interval(&target->sched,
+                               adaptive_rate_update(&target->rate, result.cpu_percent,
+                                                    (double)mem.rss, 0.0));
+    }
     return 0;
 }
 
-#define MAX_MONITOR_PIDS 64
+/* Stop monitoring targets[index], moving the last target into its slot */
+static void drop_target(process_target_t *targets, int *num_targets, int index,
+                        const adaptive_rate_t *adaptive) {
+    if (adaptive) {
+        printf("PID %d: ", targets[index].pid);
+        print_scheduler_stats(&targets[index].sched);
+    }
+    pidwatch_remove(targets[index].pid);
+    procfs_forget(targets[index].pid);
+    targets[index] = targets[--(*num_targets)];
+}
+
+/* Monitor several PIDs, each on its own deadline grid */
+int monitor_processes(const pid_t *pids, int num_pids, double interval, int duration,
+                      const adaptive_rate_t *adaptive) {
+    printf("Monitoring %d processes (interval: %gs)\n", num_pids, interval);
+
+    process_target_t *targets = calloc(num_pids, sizeof(process_target_t));
+    if (!targets) {
+        return -1;
+    }
+    if (event_loop_init(&running) != 0) {
+        fprintf(stderr, "Failed to create event loop: %s\n", strerror(errno));
+        free(targets);
+        return -1;
+    }
+
+    /* Initialize monitors */
+    cpu_monitor_init();
+    memory_monitor_init();
+    io_monitor_init();
+    network_monitor_init();
+    network_monitor_set_max_age((adaptive ? adaptive->floor : interval) / 2);
+
+    pidwatch_init();
+    for (int i = 0; i < num_pids; i++) {
+        pidwatch_add(pids[i]);
+    }
+    exit_queue_t exits;
+    watch_exits(&exits);
+
+    /* One clock copied to every target, so fixed-rate targets share deadlines */
+    sample_scheduler_t sched;
+    if (adaptive) {
+        interval = adaptive->interval;
+    }
+    scheduler_init(&sched, interval);
+    scheduler_next(&sched);
+    const struct timespec start = sched.start;
+
+    int num_targets = num_pids;
+    for (int i = 0; i < num_targets; i++) {
+        targets[i].pid = pids[i];
+        targets[i].sched = sched;
+        if (adaptive) {
+            targets[i].rate = *adaptive;
+        }
+        if (cpu_monitor_collect(pids[i], &targets[i].prev_cpu) == 0) {
+            targets[i].has_prev = 1;
+        }
+    }
+
+    double elapsed = 0.0;
+    while (running && num_targets > 0 && (duration == 0 || elapsed < duration)) {
+        const struct timespec *deadline = &targets[0].sched.deadline;
+        for (int i = 1; i < num_targets; i++) {
+            const struct timespec *d = &targets[i].sched.deadline;
+            if (d->tv_sec < deadline->tv_sec ||
+                (d->tv_sec == deadline->tv_sec && d->tv_nsec < deadline->tv_nsec)) {
+                deadline = d;
+            }
+        }
+
+        int rc = event_loop_run_until(deadline);
+        if (rc < 0) {
+            break;
+        }
+
+        /* Exits are handled as they arrive, the targets keep their deadlines */
+        if (rc == 1) {
+            int n = exits.count;
+            exits.count = 0;
+            for (int e = 0; e < n; e++) {
+                printf("\n--- PID %d exited after %.3fs ---\n", exits.events[e].pid,
+                       (exits.events[e].exit_time.tv_sec - start.tv_sec) +
+                       (exits.events[e].exit_time.tv_nsec - start.tv_nsec) / 1e9);
+
+                /* Final sample, then drop the target */
+                proc_snapshot_t snap;
+                cpu_metrics_t cpu;
+                if (proc_snapshot_take(exits.events[e].pid, proc_snapshot_files_for(1, 1, 0),
+                                       &snap) == 0 &&
+                    cpu_monitor_from_snapshot(&snap, &cpu) == 0) {
+                    printf("Final: utime=%lu stime=%lu ticks | Threads: %ld\n",
+                           cpu.utime, cpu.stime, cpu.num_threads);
+                }
+
+                for (int i = 0; i < num_targets; i++) {
+                    if (targets[i].pid == exits.events[e].pid) {
+                        drop_target(targets, &num_targets, i, adaptive);
+                        break;
+                    }
+                }
+            }
+            continue;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        int header = 0;
+        for (int i = 0; i < num_targets; i++) {
+            process_target_t *target = &targets[i];
+            const struct timespec *d = &target->sched.deadline;
+            if (d->tv_sec > now.tv_sec || (d->tv_sec == now.tv_sec && d->tv_nsec > now.tv_nsec)) {
+                continue;
+            }
+
+            scheduler_tick(&target->sched);
+            elapsed = scheduler_elapsed(&target->sched);
+            if (!header) {
+                printf("\n===== Sample at %.3fs =====\n", elapsed);
+                header = 1;
+            }
+            if (sample_target(target, adaptive) != 0) {
+                /* Without pidfd support a failed read is how an exit shows */
+                drop_target(targets, &num_targets, i--, adaptive);
+                continue;
+            }
+            scheduler_next(&target->sched);
+        }
+    }
+
+    event_loop_cleanup();
+    pidwatch_cleanup();
+    taskstats_cleanup();
+    cpu_monitor_cleanup();
+    memory_monitor_cleanup();
+    io_monitor_cleanup();
+    network_monitor_cleanup();
+
+    if (adaptive) {
+        for (int i = 0; i < num_targets; i++) {
+            printf("PID %d: ", targets[i].pid);
+            print_scheduler_stats(&targets[i].sched);
+        }
+    } else if (num_targets > 0) {
+        print_scheduler_stats(&targets[0].sched);
+    }
+    free(targets);
+    printf("\nMonitoring completed.\n");
+    return 0;
+}
 
 int main(int argc, char *argv[]) {
     int opt;
     pid_t pids[MAX_MONITOR_PIDS];
     int num_pids = 0;
-    int interval = 1;
+    double interval = 1.0;
     int duration = 0;
     char output_file[512] = "";
     char format[32] = "console";
-    char metrics_type[32] = "all";
+    char metrics_type[128] = "all";
     int list_ns_pid = 0;
     int compare_ns = 0;
     pid_t compare_pid1 = 0, compare_pid2 = 0;
@@ -433,6 +1563,24 @@ int main(int argc, char *argv[]) {
     int show_anomaly_stats = 0;
     int web_port = 0;
     char ui_mode[32] = "console";
+    char backend[32] = "procfs";
+    char cpu_clock[32] = "ticks";
+    char net_source[32] = "procfs";
+    int follow_children = 0;
+    int per_thread = 0;
+    int top_threads = THREAD_MONITOR_DEFAULT_TOP;
+    int scan_all = 0;
+    int scan_threads = 0;
+    int cgroup_top = 0;
+    cgroup_tree_sort_t cgroup_sort = CGROUP_TREE_SORT_CPU;
+    int use_io_uring = 0;
+    int use_adaptive = 0;
+    double budget = 0.0;
+    double adaptive_floor = 0.0, adaptive_ceiling = 0.0;
+    adaptive_rate_t adaptive;
+    uint32_t psi_stall_us = 0;
+    uint32_t psi_window_us = 2000000;
+    double throttle_seconds = 0.0;
 
     static struct option long_options[] = {
         {"pid",           required_argument, 0, 'p'},
@@ -446,10 +1594,24 @@ int main(int argc, char *argv[]) {
         {"report",        no_argument,       0, 'r'},
         {"timing",        no_argument,       0, 't'},
         {"cgroup",        required_argument, 0, 'g'},
+        {"throttle-profile", required_argument, 0, 'Q'},
+        {"cgroup-top",    required_argument, 0, 'G'},
         {"anomaly",       no_argument,       0, 'a'},
         {"anomaly-stats", no_argument,       0, 'A'},
+        {"psi-trigger",   required_argument, 0, 'P'},
         {"web",           required_argument, 0, 'w'},
         {"ui",            required_argument, 0, 'u'},
+        {"backend",       required_argument, 0, 'B'},
+        {"cpu-clock",     required_argument, 0, 'K'},
+        {"net-source",    required_argument, 0, 'E'},
+        {"follow-children", no_argument,     0, 'F'},
+        {"per-thread",    no_argument,       0, 'H'},
+        {"top",           required_argument, 0, 'N'},
+        {"all",           no_argument,       0, 'S'},
+        {"threads",       required_argument, 0, 'T'},
+        {"io-uring",      no_argument,       0, 'R'},
+        {"adaptive",      required_argument, 0, 'D'},
+        {"budget",        required_argument, 0, 'U'},
         {"verbose",       no_argument,       0, 'v'},
         {"help",          no_argument,       0, 'h'},
         {0, 0, 0, 0}
@@ -473,7 +1635,7 @@ int main(int argc, char *argv[]) {
                 }
                 break;
             case 'i':
-                interval = atoi(optarg);
+                interval = atof(optarg);
                 break;
             case 'd':
                 duration = atoi(optarg);
@@ -506,6 +1668,13 @@ int main(int argc, char *argv[]) {
             case 'g':
                 strncpy(cgroup_path, optarg, sizeof(cgroup_path) - 1);
                 break;
+            case 'Q':
+                throttle_seconds = atof(optarg);
+                if (throttle_seconds <= 0.0) {
+                    fprintf(stderr, "Invalid --throttle-profile: %s (seconds)\n", optarg);
+                    return 1;
+                }
+                break;
             case 'a':
                 enable_anomaly = 1;
                 break;
@@ -513,6 +1682,21 @@ int main(int argc, char *argv[]) {
                 show_anomaly_stats = 1;
                 enable_anomaly = 1;  /* Automatically enable if showing stats */
                 break;
+            case 'P':
+                {
+                    double stall_ms = 0.0, window_ms = 2000.0;
+                    if (sscanf(optarg, "%lf,%lf", &stall_ms, &window_ms) < 1 ||
+                        stall_ms <= 0.0 || stall_ms > window_ms ||
+                        window_ms < 500.0 || window_ms > 10000.0) {
+                        fprintf(stderr, "Invalid --psi-trigger: use MS[,WINDOW_MS] with "
+                                "MS <= WINDOW_MS and a window of 500..10000 ms\n");
+                        return 1;
+                    }
+                    psi_stall_us = (uint32_t)(stall_ms * 1000.0);
+                    psi_window_us = (uint32_t)(window_ms * 1000.0);
+                    enable_anomaly = 1;  /* Trigger events go through the detector */
+                }
+                break;
             case 'w':
                 web_port = atoi(optarg);
                 if (web_port <= 0) web_port = WEB_DEFAULT_PORT;
@@ -520,6 +1704,54 @@ int main(int argc, char *argv[]) {
             case 'u':
                 strncpy(ui_mode, optarg, sizeof(ui_mode) - 1);
                 break;
+            case 'B':
+                strncpy(backend, optarg, sizeof(backend) - 1);
+                break;
+            case 'K':
+                strncpy(cpu_clock, optarg, sizeof(cpu_clock) - 1);
+                break;
+            case 'E':
+                strncpy(net_source, optarg, sizeof(net_source) - 1);
+                break;
+            case 'F':
+                follow_children = 1;
+                break;
+            case 'H':
+                per_thread = 1;
+                break;
+            case 'N':
+                top_threads = atoi(optarg);
+                break;
+            case 'S':
+                scan_all = 1;
+                break;
+            case 'G':
+                cgroup_top = 1;
+                if (cgroup_tree_parse_sort(optarg, &cgroup_sort) != 0) {
+                    fprintf(stderr, "Invalid --cgroup-top key: %s (cpu, memory, io)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'T':
+                scan_threads = atoi(optarg);
+                break;
+            case 'R':
+                use_io_uring = 1;
+                break;
+            case 'U':
+                budget = atof(optarg) / 100.0;
+                if (budget <= 0.0) {
+                    fprintf(stderr, "Invalid --budget: %s (percent of one core)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'D':
+                use_adaptive = 1;
+                if (sscanf(optarg, "%lf,%lf", &adaptive_floor, &adaptive_ceiling) != 2) {
+                    fprintf(stderr, "Invalid format for --adaptive. Use: MIN,MAX\n");
+                    return 1;
+                }
+                break;
             case 'v':
                 verbose = 1;
                 break;
@@ -532,6 +1764,62 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (interval < SCHEDULER_MIN_INTERVAL) {
+        fprintf(stderr, "Error: Interval must be at least %g seconds\n", SCHEDULER_MIN_INTERVAL);
+        return 1;
+    }
+
+    if (use_adaptive) {
+        if (adaptive_floor < SCHEDULER_MIN_INTERVAL ||
+            adaptive_rate_init(&adaptive, adaptive_floor, adaptive_ceiling, interval) != 0) {
+            fprintf(stderr, "Error: --adaptive needs %g <= MIN <= MAX\n", SCHEDULER_MIN_INTERVAL);
+            return 1;
+        }
+        if (follow_children || per_thread || scan_all) {
+            fprintf(stderr, "Warning: --adaptive applies to -p monitoring only, using -i\n");
+            use_adaptive = 0;
+        }
+    }
+
+    if (use_io_uring && !scan_all) {
+        fprintf(stderr, "Warning: --io-uring applies to --all only\n");
+    }
+
+    /* Select the per-process counter source */
+    unsigned int metrics = parse_metrics(metrics_type);
+    if (metrics == 0) {
+        fprintf(stderr, "Unknown metric type in: %s\n", metrics_type);
+        return 1;
+    }
+
+    if (strcmp(backend, "taskstats") == 0) {
+        if (proc_snapshot_set_backend(PROCFS_BACKEND_TASKSTATS) != 0) {
+            fprintf(stderr, "Warning: taskstats unavailable (%s), using procfs\n", strerror(errno));
+        }
+    } else if (strcmp(backend, "procfs") != 0) {
+        fprintf(stderr, "Unknown backend: %s\n", backend);
+        return 1;
+    }
+
+    if (strcmp(cpu_clock, "schedstat") == 0) {
+        if (proc_snapshot_set_cpu_clock(PROCFS_CPU_CLOCK_SCHEDSTAT) != 0) {
+            fprintf(stderr, "Warning: /proc/[pid]/schedstat unavailable, using clock ticks\n");
+        }
+    } else if (strcmp(cpu_clock, "ticks") != 0) {
+        fprintf(stderr, "Unknown CPU clock: %s\n", cpu_clock);
+        return 1;
+    }
+
+    if (strcmp(net_source, "veth") == 0) {
+        if (network_monitor_set_source(NETWORK_SOURCE_VETH) != 0) {
+            fprintf(stderr, "Warning: rtnetlink unavailable (%s), using /proc/[pid]/net/dev\n",
+                    strerror(errno));
+        }
+    } else if (strcmp(net_source, "procfs") != 0) {
+        fprintf(stderr, "Unknown network source: %s\n", net_source);
+        return 1;
+    }
+
     /* Handle namespace operations */
     if (list_ns_pid > 0) {
         namespace_init();
@@ -588,92 +1876,80 @@ int main(int argc, char *argv[]) {
     }
 
     /* Handle cgroup operations */
-    if (strlen(cgroup_path) > 0) {
+    if (cgroup_top) {
+        return monitor_cgroup_tree(strlen(cgroup_path) > 0 ? cgroup_path : "/", cgroup_sort,
+                                   top_threads, interval, duration, output_file, format,
+                                   scan_threads) == 0 ? 0 : 1;
+    }
+    if (strlen(cgroup_path) > 0 && throttle_seconds > 0.0) {
         cgroup_init();
-        cgroup_metrics_t metrics;
-        if (cgroup_collect_metrics(cgroup_path, &metrics) == 0) {
-            cgroup_print_metrics(&metrics);
+        cgroup_throttle_analysis_t analysis;
+        printf("Profiling CPU throttling of %s for %gs...\n", cgroup_path, throttle_seconds);
+        int status = cgroup_analyze_throttling(cgroup_path, throttle_seconds, &analysis);
+        if (status == 0) {
+            cgroup_print_throttle_analysis(&analysis);
         } else {
-            fprintf(stderr, "Failed to collect cgroup metrics for %s\n", cgroup_path);
+            fprintf(stderr, "Failed to read cpu.stat of %s\n", cgroup_path);
         }
         cgroup_cleanup();
-        return 0;
+        return status == 0 ? 0 : 1;
+    }
+    if (strlen(cgroup_path) > 0) {
+        /* Same loop and front ends as a single -p PID */
+        return monitor_cgroup(cgroup_path, interval, duration, output_file, format,
+                              enable_anomaly, show_anomaly_stats,
+                              strcmp(ui_mode, "ncurses") == 0, web_port,
+                              psi_stall_us, psi_window_us) == 0 ? 0 : 1;
     }
 
-    /* Handle web dashboard */
-    if (web_port > 0) {
-        if (num_pids != 1) {
-            fprintf(stderr, "Error: Web dashboard requires exactly one PID (-p)\n");
+    if (web_port > 0 && num_pids != 1) {
+        fprintf(stderr, "Error: Web dashboard requires exactly one PID (-p)\n");
+        return 1;
+    }
+
+    /* Handle process tree monitoring */
+    if (follow_children) {
+        if (num_pids == 0) {
+            fprintf(stderr, "Error: --follow-children requires at least one PID (-p)\n");
             return 1;
         }
+        return monitor_process_trees(pids, num_pids, interval, duration, output_file, format)
+               == 0 ? 0 : 1;
+    }
 
-        web_config_t web_config = {
-            .port = web_port,
-            .monitored_pid = pids[0],
-            .interval = interval,
-            .enable_anomaly = enable_anomaly,
-            .running = &running
-        };
+    if (per_thread) {
+        if (num_pids == 0) {
+            fprintf(stderr, "Error: --per-thread requires at least one PID (-p)\n");
+            return 1;
+        }
+        return monitor_process_threads(pids, num_pids, interval, duration, output_file, format,
+                                       top_threads) == 0 ? 0 : 1;
+    }
 
-        return web_dashboard_start(&web_config);
+    /* Handle system-wide monitoring */
+    if (scan_all) {
+        if (use_io_uring && proc_snapshot_set_io_mode(PROCFS_IO_URING) != 0) {
+            fprintf(stderr, "Warning: io_uring unavailable (%s), using pread\n", strerror(errno));
+        }
+        return monitor_all_processes(interval, duration, output_file, format, scan_threads)
+               == 0 ? 0 : 1;
     }
 
     /* Handle process monitoring */
     if (num_pids > 0) {
         if (num_pids == 1) {
-            /* Single process - check UI mode */
-            if (strcmp(ui_mode, "ncurses") == 0) {
-                /* Ncurses UI mode */
-                return monitor_process_ncurses(pids[0], interval, duration,
-                                              metrics_type, enable_anomaly);
-            } else {
-                /* Console mode with anomaly detection */
-                return monitor_process(pids[0], interval, duration, output_file,
-                                     format, metrics_type, enable_anomaly, show_anomaly_stats);
-            }
-        } else {
-            /* Multiple processes */
-            printf("Monitoring %d processes (interval: %ds)\n", num_pids, interval);
-
-            signal(SIGINT, signal_handler);
-            signal(SIGTERM, signal_handler);
-
-            /* Initialize monitors */
-            cpu_monitor_init();
-            memory_monitor_init();
-            io_monitor_init();
-
-            int elapsed = 0;
-            while (running && (duration == 0 || elapsed < duration)) {
-                sleep(interval);
-                elapsed += interval;
-
-                printf("\n===== Sample at %ds =====\n", elapsed);
-
-                for (int i = 0; i < num_pids; i++) {
-                    printf("\n--- PID %d ---\n", pids[i]);
-
-                    cpu_metrics_t cpu;
-                    if (cpu_monitor_collect(pids[i], &cpu) == 0) {
-                        printf("CPU: %.2f%% | Threads: %ld\n",
-                               cpu.cpu_percent, cpu.num_threads);
-                    }
-
-                    memory_metrics_t mem;
-                    if (memory_monitor_collect(pids[i], &mem) == 0) {
-                        printf("Memory: RSS=%lu KB, VSZ=%lu KB\n",
-                               mem.rss, mem.vsz);
-                    }
-                }
-            }
-
-            cpu_monitor_cleanup();
-            memory_monitor_cleanup();
-            io_monitor_cleanup();
-
-            printf("\nMonitoring completed.\n");
-            return 0;
+            /* Single process: console, ncurses and web share one loop */
+            return monitor_process(pids[0], interval, duration, output_file, format,
+                                   metrics, enable_anomaly, show_anomaly_stats,
+                                   strcmp(ui_mode, "ncurses") == 0, web_port,
+                                   use_adaptive ? &adaptive : NULL, budget,
+                                   psi_stall_us, psi_window_us) == 0 ? 0 : 1;
+        }
+        if (psi_stall_us > 0) {
+            fprintf(stderr, "Warning: --psi-trigger applies to a single -p PID only\n");
         }
+        return monitor_processes(pids, num_pids, interval, duration,
+                                 use_adaptive ? &adaptive : NULL) == 0 ? 0 : 1;
     }
 
     /* No valid operation specified */
@@ -1,90 +1,104 @@
 #include "../include/monitor.h"
+#include "../include/procfs.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
 
+#define FIELD_COUNT(table) ((int)(sizeof(table) / sizeof((table)[0])))
+
+static const procfs_field_t smaps_fields[] = {
+    PROCFS_FIELD("Rss",           memory_smaps_t, rss),
+    PROCFS_FIELD("Pss",           memory_smaps_t, pss),
+    PROCFS_FIELD("Pss_Anon",      memory_smaps_t, pss_anon),
+    PROCFS_FIELD("Pss_File",      memory_smaps_t, pss_file),
+    PROCFS_FIELD("Shared_Clean",  memory_smaps_t, shared_clean),
+    PROCFS_FIELD("Shared_Dirty",  memory_smaps_t, shared_dirty),
+    PROCFS_FIELD("Private_Clean", memory_smaps_t, private_clean),
+    PROCFS_FIELD("Private_Dirty", memory_smaps_t, private_dirty),
+    PROCFS_FIELD("Swap",          memory_smaps_t, swap),
+    PROCFS_FIELD("SwapPss",       memory_smaps_t, swap_pss),
+};
+
 int memory_monitor_init(void) {
-    /* Nothing to initialize currently */
-    return 0;
+    return procfs_init();
 }
 
 void memory_monitor_cleanup(void) {
-    /* Nothing to clean up currently */
+    procfs_cleanup();
 }
 
-int memory_monitor_collect(pid_t pid, memory_metrics_t *metrics) {
-    if (!metrics) {
-        fprintf(stderr, "NULL metrics pointer\n");
+int memory_monitor_from_snapshot(const proc_snapshot_t *snap, memory_metrics_t *metrics) {
+    if (!snap || !metrics) {
+        fprintf(stderr, "NULL pointer in memory_monitor_from_snapshot\n");
         return -1;
     }
 
-    if (!process_exists(pid)) {
-        fprintf(stderr, "Process %d does not exist\n", pid);
+    if (!(snap->files & PROCFS_SNAP_STATUS)) {
         return -1;
     }
 
     /* Initialize all fields */
     memset(metrics, 0, sizeof(memory_metrics_t));
-    metrics->pid = pid;
+    metrics->pid = snap->pid;
+
+    metrics->rss = snap->vm_rss;
+    metrics->vsz = snap->vm_size;
+    metrics->shared = snap->rss_shmem;
+    metrics->data = snap->vm_data;
+    metrics->stack = snap->vm_stk;
+    metrics->text = snap->vm_exe;
+    metrics->swap = snap->vm_swap;
+
+    /* Page faults come from /proc/[pid]/stat (fields 10 and 12) or a
+     * per-task taskstats reply */
+    if ((snap->files & PROCFS_SNAP_STAT) || snap->taskstats_per_task) {
+        metrics->minor_faults = snap->minflt;
+        metrics->major_faults = snap->majflt;
+    }
 
-    /* Read /proc/[pid]/status for memory metrics */
-    char status_path[256];
-    snprintf(status_path, sizeof(status_path), "/proc/%d/status", pid);
+    metrics->timestamp = snap->timestamp;
 
-    FILE *fp = fopen(status_path, "r");
-    if (!fp) {
-        fprintf(stderr, "Failed to open %s: %s\n", status_path, strerror(errno));
+    return 0;
+}
+
+int memory_monitor_collect(pid_t pid, memory_metrics_t *metrics) {
+    if (!metrics) {
+        fprintf(stderr, "NULL metrics pointer\n");
         return -1;
     }
 
-    char line[256];
-    while (fgets(line, sizeof(line), fp)) {
-        if (strncmp(line, "VmRSS:", 6) == 0) {
-            sscanf(line + 6, "%lu", &metrics->rss);
-        } else if (strncmp(line, "VmSize:", 7) == 0) {
-            sscanf(line + 7, "%lu", &metrics->vsz);
-        } else if (strncmp(line, "RssAnon:", 8) == 0) {
-            /* RssAnon is anonymous memory */
-        } else if (strncmp(line, "RssShmem:", 9) == 0) {
-            sscanf(line + 9, "%lu", &metrics->shared);
-        } else if (strncmp(line, "VmData:", 7) == 0) {
-            sscanf(line + 7, "%lu", &metrics->data);
-        } else if (strncmp(line, "VmStk:", 6) == 0) {
-            sscanf(line + 6, "%lu", &metrics->stack);
-        } else if (strncmp(line, "VmExe:", 6) == 0) {
-            sscanf(line + 6, "%lu", &metrics->text);
-        } else if (strncmp(line, "VmSwap:", 7) == 0) {
-            sscanf(line + 7, "%lu", &metrics->swap);
+    proc_snapshot_t snap;
+    if (proc_snapshot_take(pid, proc_snapshot_files_for(0, 1, 0), &snap) != 0) {
+        if (procfs_is_gone_error(errno)) {
+            fprintf(stderr, "Process %d does not exist\n", pid);
+        } else {
+            fprintf(stderr, "Failed to read /proc/%d: %s\n", pid, strerror(errno));
         }
+        return -1;
     }
-    fclose(fp);
 
-    /* Read /proc/[pid]/stat for page faults */
-    char stat_path[256];
-    snprintf(stat_path, sizeof(stat_path), "/proc/%d/stat", pid);
+    return memory_monitor_from_snapshot(&snap, metrics);
+}
 
-    fp = fopen(stat_path, "r");
-    if (!fp) {
-        fprintf(stderr, "Failed to open %s: %s\n", stat_path, strerror(errno));
+int memory_monitor_collect_smaps(pid_t pid, memory_smaps_t *smaps) {
+    if (!smaps) {
         return -1;
     }
 
-    /* Parse stat file for page faults (fields 10 and 12) */
-    unsigned long minflt, majflt;
-    int items_read = fscanf(fp, "%*d %*s %*c %*d %*d %*d %*d %*d %*u "
-                           "%lu %*u %lu",
-                           &minflt, &majflt);
-    fclose(fp);
-
-    if (items_read == 2) {
-        metrics->minor_faults = minflt;
-        metrics->major_faults = majflt;
+    char buffer[PROCFS_BUFFER_SIZE];
+    if (procfs_read(pid, PROCFS_SMAPS_ROLLUP, buffer, sizeof(buffer)) < 0) {
+        return -1;
     }
 
-    clock_gettime(CLOCK_MONOTONIC, &metrics->timestamp);
-
+    memset(smaps, 0, sizeof(memory_smaps_t));
+    smaps->pid = pid;
+    if (procfs_parse_kv(buffer, smaps_fields, FIELD_COUNT(smaps_fields), smaps) == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &smaps->timestamp);
     return 0;
 }
 
@@ -106,6 +120,20 @@ void print_memory_metrics(const memory_metrics_t *metrics) {
     printf("=================================\n\n");
 }
 
+void print_memory_smaps(const memory_smaps_t *smaps) {
+    if (!smaps) {
+        return;
+    }
+
+    printf("=== Memory Detail (smaps_rollup) for PID %d ===\n", smaps->pid);
+    printf("PSS:                       %lu KB (anon %lu, file %lu)\n",
+           smaps->pss, smaps->pss_anon, smaps->pss_file);
+    printf("Private Clean/Dirty:       %lu / %lu KB\n", smaps->private_clean, smaps->private_dirty);
+    printf("Shared Clean/Dirty:        %lu / %lu KB\n", smaps->shared_clean, smaps->shared_dirty);
+    printf("Swap (PSS):                %lu KB (%lu KB)\n", smaps->swap, smaps->swap_pss);
+    printf("=================================\n\n");
+}
+
 int export_memory_metrics_json(const memory_metrics_t *metrics, const char *filename) {
     if (!metrics || !filename) {
         return -1;
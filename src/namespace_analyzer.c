@@ -1,4 +1,5 @@
 #include "../include/namespace.h"
+#include "../include/proc_scanner.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -152,6 +153,12 @@ int namespace_compare(pid_t pid1, pid_t pid2,
     return 0;
 }
 
+static int compare_inode(const void *a, const void *b) {
+    ino_t ia = *(const ino_t *)a;
+    ino_t ib = *(const ino_t *)b;
+    return (ia > ib) - (ia < ib);
+}
+
 int namespace_generate_report(namespace_report_t *report) {
     if (!report) {
         return -1;
@@ -163,53 +170,51 @@ int namespace_generate_report(namespace_report_t *report) {
         strncpy(report->ns_type_names[i], ns_types[i], 15);
     }
 
-    DIR *proc_dir = opendir("/proc");
-    if (!proc_dir) {
-        fprintf(stderr, "Failed to open /proc: %s\n", strerror(errno));
+    /* Parallel /proc walk; reuse the pool if --all already started it */
+    int own_pool = (proc_scanner_thread_count() == 0);
+    if (own_pool && proc_scanner_init(0) != 0) {
         return -1;
     }
 
-    /* Track unique namespace inodes */
-    ino_t unique_inodes[MAX_NS_TYPES][MAX_PROCESSES];
-    int unique_counts[MAX_NS_TYPES] = {0};
+    proc_scan_result_t result;
+    memset(&result, 0, sizeof(result));
+    if (proc_scanner_scan(PROC_SCAN_NAMESPACE, &result) < 0) {
+        if (own_pool) proc_scanner_cleanup();
+        return -1;
+    }
 
-    struct dirent *entry;
-    while ((entry = readdir(proc_dir)) != NULL) {
-        if (entry->d_type != DT_DIR) {
-            continue;
-        }
+    report->total_processes = result.listed;
 
-        pid_t pid = atoi(entry->d_name);
-        if (pid <= 0) {
-            continue;
+    /* Count distinct inodes per type: sort, then count runs */
+    ino_t *inodes = malloc((result.count > 0 ? result.count : 1) * sizeof(ino_t));
+    if (!inodes) {
+        proc_scan_result_free(&result);
+        if (own_pool) proc_scanner_cleanup();
+        return -1;
+    }
+
+    for (int i = 0; i < MAX_NS_TYPES; i++) {
+        int n = 0;
+        for (int p = 0; p < result.count; p++) {
+            if (result.entries[p].ns_inodes[i] != 0) {
+                inodes[n++] = result.entries[p].ns_inodes[i];
+            }
         }
+        qsort(inodes, n, sizeof(ino_t), compare_inode);
 
-        report->total_processes++;
-
-        /* Check each namespace type */
-        for (int i = 0; i < MAX_NS_TYPES; i++) {
-            ino_t inode;
-            if (namespace_get_inode(pid, ns_types[i], &inode) == 0) {
-                /* Check if this inode is already tracked */
-                int found = 0;
-                for (int j = 0; j < unique_counts[i]; j++) {
-                    if (unique_inodes[i][j] == inode) {
-                        found = 1;
-                        break;
-                    }
-                }
-
-                if (!found && unique_counts[i] < MAX_PROCESSES) {
-                    unique_inodes[i][unique_counts[i]++] = inode;
-                }
+        int unique = 0;
+        for (int k = 0; k < n; k++) {
+            if (k == 0 || inodes[k] != inodes[k - 1]) {
+                unique++;
             }
         }
+        report->total_unique_namespaces[i] = unique;
     }
 
-    closedir(proc_dir);
-
-    for (int i = 0; i < MAX_NS_TYPES; i++) {
-        report->total_unique_namespaces[i] = unique_counts[i];
+    free(inodes);
+    proc_scan_result_free(&result);
+    if (own_pool) {
+        proc_scanner_cleanup();
     }
 
     clock_gettime(CLOCK_REALTIME, &report->timestamp);
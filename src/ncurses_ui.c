@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
 
 #define COLOR_PAIR_HEADER 1
 #define COLOR_PAIR_NORMAL 2
@@ -55,7 +57,7 @@ void ncurses_ui_cleanup(void) {
     endwin();
 }
 
-void ncurses_ui_draw_header(const char *title, pid_t pid, int elapsed) {
+void ncurses_ui_draw_header(const char *title, pid_t pid, double elapsed) {
     if (!header_win) return;
 
     werase(header_win);
@@ -63,8 +65,12 @@ void ncurses_ui_draw_header(const char *title, pid_t pid, int elapsed) {
 
     box(header_win, 0, 0);
 
-    mvwprintw(header_win, 1, 2, "%s - PID: %d | Elapsed: %ds | Press 'q' to quit",
-              title, pid, elapsed);
+    if (pid > 0) {
+        mvwprintw(header_win, 1, 2, "%s - PID: %d | Elapsed: %.1fs | Press 'q' to quit",
+                  title, pid, elapsed);
+    } else {
+        mvwprintw(header_win, 1, 2, "%s | Elapsed: %.1fs | Press 'q' to quit", title, elapsed);
+    }
 
     wattroff(header_win, COLOR_PAIR(COLOR_PAIR_HEADER) | A_BOLD);
     wrefresh(header_win);
@@ -146,6 +152,85 @@ void ncurses_ui_draw_io_metrics(const io_metrics_t *io, int line) {
     mvwprintw(metrics_win, line + 1, 30, "| Write syscalls: %lu", io->syscw);
 }
 
+void ncurses_ui_draw_cgroup_metrics(const cgroup_metrics_t *cgroup, const cgroup_rates_t *rates,
+                                    int line) {
+    if (!metrics_win || !cgroup || !rates) return;
+
+    /* Against the quota when there is one, otherwise against one core */
+    double load = rates->cpu_limit_percent > 0.0 ? rates->cpu_limit_percent
+                                                 : rates->cpu_cores * 100.0;
+    int color = COLOR_PAIR_NORMAL;
+    if (load > 90.0 || rates->throttle_rate > 0.25) {
+        color = COLOR_PAIR_CRITICAL;
+    } else if (load > 70.0 || rates->throttle_rate > 0.0) {
+        color = COLOR_PAIR_WARNING;
+    } else if (load < 30.0) {
+        color = COLOR_PAIR_GOOD;
+    }
+
+    wattron(metrics_win, COLOR_PAIR(color));
+    mvwprintw(metrics_win, line, 2, "CPU: %6.3f cores", rates->cpu_cores);
+    wattroff(metrics_win, COLOR_PAIR(color));
+    if (rates->cpu_limit_percent > 0.0) {
+        mvwprintw(metrics_win, line, 25, "| %.1f%% of limit", rates->cpu_limit_percent);
+    } else {
+        mvwprintw(metrics_win, line, 25, "| No CPU limit");
+    }
+    mvwprintw(metrics_win, line, 50, "| Throttled: %.1f%% of periods, %.1f%% of time",
+              rates->throttle_rate * 100.0, rates->throttled_percent);
+
+    color = COLOR_PAIR_NORMAL;
+    if (rates->memory_percent > 90.0) {
+        color = COLOR_PAIR_CRITICAL;
+    } else if (rates->memory_percent > 70.0) {
+        color = COLOR_PAIR_WARNING;
+    }
+    wattron(metrics_win, COLOR_PAIR(color));
+    mvwprintw(metrics_win, line + 1, 2, "Memory: %8.2f MB", cgroup->memory.current / 1048576.0);
+    wattroff(metrics_win, COLOR_PAIR(color));
+    if (rates->memory_percent > 0.0) {
+        mvwprintw(metrics_win, line + 1, 25, "| %.1f%% of limit", rates->memory_percent);
+    }
+    mvwprintw(metrics_win, line + 1, 50, "| PIDs: %lu", cgroup->pids.current);
+
+    mvwprintw(metrics_win, line + 2, 2, "I/O Read: %8.2f KB/s", rates->read_rate / 1024.0);
+    mvwprintw(metrics_win, line + 2, 25, "| Write: %8.2f KB/s", rates->write_rate / 1024.0);
+    mvwprintw(metrics_win, line + 2, 50, "| IOPS: %.1f read, %.1f write",
+              rates->read_iops, rates->write_iops);
+}
+
+void ncurses_ui_draw_cgroup_devices(const cgroup_blkio_t *blkio, int line, int max_rows) {
+    if (!metrics_win || !blkio) return;
+
+    for (int d = 0; d < blkio->device_count && d < max_rows; d++) {
+        const cgroup_io_device_t *device = &blkio->devices[d];
+        /* Waiting for iocost budget or missing the io.latency target */
+        int missed = device->latency_target_usec > 0 &&
+                     device->avg_lat_usec > device->latency_target_usec;
+        int color = COLOR_PAIR_NORMAL;
+        if (device->cost_wait_percent > 10.0 || missed) {
+            color = COLOR_PAIR_CRITICAL;
+        } else if (device->read_rate + device->write_rate > 100.0 * 1048576.0) {
+            color = COLOR_PAIR_WARNING;
+        }
+
+        wattron(metrics_win, COLOR_PAIR(color));
+        mvwprintw(metrics_win, line + d, 2, "%-10s R %8.2f W %8.2f KB/s", device->name,
+                  device->read_rate / 1024.0, device->write_rate / 1024.0);
+        wattroff(metrics_win, COLOR_PAIR(color));
+        mvwprintw(metrics_win, line + d, 42, "| IOPS %.0f/%.0f", device->read_iops,
+                  device->write_iops);
+        if (device->has_cost) {
+            mvwprintw(metrics_win, line + d, 62, "| iocost wait %.1f%%", device->cost_wait_percent);
+        } else if (device->has_latency) {
+            mvwprintw(metrics_win, line + d, 62, "| lat %lu us", device->avg_lat_usec);
+        } else if (device->discard_rate > 0.0) {
+            mvwprintw(metrics_win, line + d, 62, "| discard %.2f KB/s",
+                      device->discard_rate / 1024.0);
+        }
+    }
+}
+
 void ncurses_ui_draw_anomaly(const anomaly_event_t *anomaly, int line) {
     if (!metrics_win || !anomaly) return;
 
@@ -217,6 +302,93 @@ void ncurses_ui_clear_metrics(void) {
 }
 
 int ncurses_ui_check_quit(void) {
-    int ch = getch();
-    return (ch == 'q' || ch == 'Q');
+    /* Drain everything typed since the last check */
+    int ch;
+    int quit = 0;
+    while ((ch = getch()) != ERR) {
+        if (ch == 'q' || ch == 'Q') {
+            quit = 1;
+        }
+    }
+    return quit;
+}
+
+static void on_keypress(int fd, uint32_t events, void *arg) {
+    (void)fd;
+    (void)events;
+    (void)arg;
+    if (ncurses_ui_check_quit()) {
+        event_loop_stop();
+    }
+}
+
+void ncurses_ui_draw_sample(const monitor_sample_t *sample, void *arg) {
+    (void)arg;
+    if (!sample) return;
+
+    /* Trigger events between ticks are drawn over the last metrics */
+    static monitor_sample_t shown;
+    if (sample->events_only) {
+        monitor_sample_merge_events(&shown, sample);
+        sample = &shown;
+    } else {
+        shown = *sample;
+    }
+
+    ncurses_ui_clear_metrics();
+    int line = 3;
+    if (sample->has_cgroup) {
+        char title[MAX_CGROUP_PATH + 32];
+        snprintf(title, sizeof(title), "Resource Monitor - Cgroup %s",
+                 sample->cgroup.cgroup_path);
+        ncurses_ui_draw_header(title, 0, sample->elapsed);
+        ncurses_ui_draw_cgroup_metrics(&sample->cgroup, &sample->cgroup_rates, line);
+        line += 4;
+        int devices = sample->cgroup.blkio.device_count;
+        if (devices > 0) {
+            devices = devices < 4 ? devices : 4;
+            ncurses_ui_draw_separator(line);
+            line++;
+            ncurses_ui_draw_cgroup_devices(&sample->cgroup.blkio, line, devices);
+            line += devices + 1;
+        }
+    } else {
+        ncurses_ui_draw_header("Resource Monitor", sample->pid, sample->elapsed);
+    }
+
+    if (sample->has_cpu) {
+        ncurses_ui_draw_cpu_metrics(&sample->cpu, line);
+        line += 3;
+    }
+    if (sample->has_memory) {
+        ncurses_ui_draw_separator(line);
+        line++;
+        ncurses_ui_draw_memory_metrics(&sample->memory, line);
+        line += 3;
+    }
+    if (sample->has_io) {
+        ncurses_ui_draw_separator(line);
+        line++;
+        ncurses_ui_draw_io_metrics(&sample->io, line);
+        line += 3;
+    }
+    if (sample->anomaly_count > 0) {
+        ncurses_ui_draw_separator(line);
+        line++;
+        for (int i = 0; i < sample->anomaly_count && i < 3; i++) {
+            ncurses_ui_draw_anomaly(&sample->anomalies[i], line);
+            line++;
+        }
+    }
+
+    ncurses_ui_update_status(sample->exited ? "Process exited (final sample shown)"
+                                            : "Monitoring... (Press 'q' to quit)");
+    ncurses_ui_refresh();
+}
+
+int ncurses_ui_attach(void) {
+    if (event_loop_add_fd(STDIN_FILENO, EPOLLIN, on_keypress, NULL) != 0) {
+        return -1;
+    }
+    return event_loop_subscribe(ncurses_ui_draw_sample, NULL);
 }
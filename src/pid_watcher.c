@@ -0,0 +1,190 @@
+#include "../include/pidwatch.h"
+#include "../include/procfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
+/* Watched process and its pidfd */
+typedef struct {
+    pid_t pid;
+    int pidfd;
+} pidwatch_entry_t;
+
+static int epoll_fd = -1;
+static pidwatch_entry_t *entries = NULL;
+static int entry_count = 0;
+static int entry_capacity = 0;
+
+static int sys_pidfd_open(pid_t pid, unsigned int flags) {
+    return (int)syscall(__NR_pidfd_open, pid, flags);
+}
+
+static int find_entry(pid_t pid) {
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].pid == pid) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void remove_entry(int index) {
+    if (epoll_fd >= 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, entries[index].pidfd, NULL);
+    }
+    close(entries[index].pidfd);
+    entries[index] = entries[--entry_count];
+}
+
+int pidwatch_init(void) {
+    if (epoll_fd >= 0) {
+        return 0;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        fprintf(stderr, "Failed to create epoll set: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void pidwatch_cleanup(void) {
+    while (entry_count > 0) {
+        remove_entry(entry_count - 1);
+    }
+    free(entries);
+    entries = NULL;
+    entry_capacity = 0;
+
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+}
+
+int pidwatch_add(pid_t pid) {
+    if (epoll_fd < 0 && pidwatch_init() != 0) {
+        return -1;
+    }
+
+    if (find_entry(pid) >= 0) {
+        return 0;
+    }
+
+    int pidfd = sys_pidfd_open(pid, 0);
+    if (pidfd < 0) {
+        return -1;
+    }
+
+    /* Open the /proc files only after the pidfd pins the process identity */
+    if (procfs_open_files(pid, PROCFS_SNAP_ALL) != 0) {
+        int saved_errno = errno;
+        close(pidfd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    /* If the pidfd already fired, the PID may have been reused in between */
+    struct pollfd pfd = { .fd = pidfd, .events = POLLIN };
+    if (poll(&pfd, 1, 0) > 0) {
+        procfs_forget(pid);
+        close(pidfd);
+        errno = ESRCH;
+        return -1;
+    }
+
+    if (entry_count == entry_capacity) {
+        int new_capacity = entry_capacity ? entry_capacity * 2 : 16;
+        pidwatch_entry_t *grown = realloc(entries, new_capacity * sizeof(pidwatch_entry_t));
+        if (!grown) {
+            close(pidfd);
+            errno = ENOMEM;
+            return -1;
+        }
+        entries = grown;
+        entry_capacity = new_capacity;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN };
+    ev.data.u64 = (uint64_t)pid;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pidfd, &ev) != 0) {
+        int saved_errno = errno;
+        close(pidfd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    entries[entry_count].pid = pid;
+    entries[entry_count].pidfd = pidfd;
+    entry_count++;
+    return 0;
+}
+
+int pidwatch_remove(pid_t pid) {
+    int index = find_entry(pid);
+    if (index < 0) {
+        return -1;
+    }
+    remove_entry(index);
+    return 0;
+}
+
+int pidwatch_wait(int timeout_ms, pidwatch_event_t *events, int max_events) {
+    if (!events || max_events <= 0 || epoll_fd < 0) {
+        return -1;
+    }
+
+    if (max_events > PIDWATCH_MAX_EVENTS) {
+        max_events = PIDWATCH_MAX_EVENTS;
+    }
+
+    struct epoll_event ready[PIDWATCH_MAX_EVENTS];
+    int n = epoll_wait(epoll_fd, ready, max_events, timeout_ms);
+    if (n < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    for (int i = 0; i < n; i++) {
+        pid_t pid = (pid_t)ready[i].data.u64;
+        events[i].pid = pid;
+        events[i].exit_time = now;
+
+        int index = find_entry(pid);
+        if (index >= 0) {
+            remove_entry(index);
+        }
+    }
+
+    return n;
+}
+
+int pidwatch_is_alive(pid_t pid) {
+    int index = find_entry(pid);
+    if (index < 0) {
+        return -1;
+    }
+
+    struct pollfd pfd = { .fd = entries[index].pidfd, .events = POLLIN };
+    return (poll(&pfd, 1, 0) > 0) ? 0 : 1;
+}
+
+int pidwatch_get_fd(void) {
+    return epoll_fd;
+}
+
+int pidwatch_count(void) {
+    return entry_count;
+}
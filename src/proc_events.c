@@ -0,0 +1,178 @@
+#include "../include/proc_events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+
+#define PROC_EVENTS_RECV_SIZE 8192
+
+static int cn_fd = -1;
+
+/* Send PROC_CN_MCAST_LISTEN or PROC_CN_MCAST_IGNORE */
+static int send_mcast_op(enum proc_cn_mcast_op op) {
+    char request[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))];
+    memset(request, 0, sizeof(request));
+
+    struct nlmsghdr *nlh = (struct nlmsghdr *)request;
+    nlh->nlmsg_len = sizeof(request);
+    nlh->nlmsg_type = NLMSG_DONE;
+    nlh->nlmsg_pid = getpid();
+
+    struct cn_msg *msg = (struct cn_msg *)NLMSG_DATA(nlh);
+    msg->id.idx = CN_IDX_PROC;
+    msg->id.val = CN_VAL_PROC;
+    msg->len = sizeof(enum proc_cn_mcast_op);
+    memcpy(msg->data, &op, sizeof(op));
+
+    return (send(cn_fd, request, sizeof(request), 0) < 0) ? -1 : 0;
+}
+
+int proc_events_init(void) {
+    if (cn_fd >= 0) {
+        return 0;
+    }
+
+    cn_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (cn_fd < 0) {
+        return -1;
+    }
+
+    /* Fork storms produce bursts; a larger buffer makes overruns rare */
+    int rcvbuf = 1 << 20;
+    setsockopt(cn_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    struct sockaddr_nl addr = {
+        .nl_family = AF_NETLINK,
+        .nl_groups = CN_IDX_PROC,
+        .nl_pid = 0,
+    };
+    if (bind(cn_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        send_mcast_op(PROC_CN_MCAST_LISTEN) != 0) {
+        int saved_errno = errno;
+        close(cn_fd);
+        cn_fd = -1;
+        errno = saved_errno;
+        return -1;
+    }
+
+    return 0;
+}
+
+void proc_events_cleanup(void) {
+    if (cn_fd < 0) {
+        return;
+    }
+    send_mcast_op(PROC_CN_MCAST_IGNORE);
+    close(cn_fd);
+    cn_fd = -1;
+}
+
+int proc_events_get_fd(void) {
+    return cn_fd;
+}
+
+/* Convert one connector record; returns 0 if it is an event we report */
+static int decode_event(const struct proc_event *ev, const struct timespec *now,
+                        proc_event_t *out) {
+    memset(out, 0, sizeof(proc_event_t));
+    out->timestamp = *now;
+
+    switch (ev->what) {
+        case PROC_EVENT_FORK:
+            /* Thread creation also reports a fork; only new thread groups count */
+            if (ev->event_data.fork.child_pid != ev->event_data.fork.child_tgid) {
+                return -1;
+            }
+            out->type = PROC_EVENT_TYPE_FORK;
+            out->pid = ev->event_data.fork.child_tgid;
+            out->parent = ev->event_data.fork.parent_tgid;
+            return 0;
+
+        case PROC_EVENT_EXEC:
+            out->type = PROC_EVENT_TYPE_EXEC;
+            out->pid = ev->event_data.exec.process_tgid;
+            return 0;
+
+        case PROC_EVENT_EXIT:
+            if (ev->event_data.exit.process_pid != ev->event_data.exit.process_tgid) {
+                return -1;
+            }
+            out->type = PROC_EVENT_TYPE_EXIT;
+            out->pid = ev->event_data.exit.process_tgid;
+            out->parent = ev->event_data.exit.parent_tgid;
+            out->exit_code = ev->event_data.exit.exit_code;
+            return 0;
+
+        default:
+            return -1;
+    }
+}
+
+int proc_events_parse(const void *buffer, size_t len, const struct timespec *now,
+                      proc_event_t *events, int max_events) {
+    if (!buffer || !now || !events || max_events <= 0) {
+        return 0;
+    }
+
+    int count = 0;
+    for (const struct nlmsghdr *nlh = buffer;
+         NLMSG_OK(nlh, len) && count < max_events;
+         nlh = NLMSG_NEXT(nlh, len)) {
+        if (nlh->nlmsg_type == NLMSG_NOOP || nlh->nlmsg_type == NLMSG_ERROR) {
+            continue;
+        }
+
+        const struct cn_msg *msg = NLMSG_DATA(nlh);
+        if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC ||
+            msg->len < sizeof(struct proc_event) - sizeof(((struct proc_event *)0)->event_data)) {
+            continue;
+        }
+
+        if (decode_event((const struct proc_event *)msg->data, now, &events[count]) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int proc_events_read(proc_event_t *events, int max_events) {
+    if (cn_fd < 0 || !events || max_events <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    char buffer[PROC_EVENTS_RECV_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+    int count = 0;
+
+    while (count < max_events) {
+        ssize_t len = recv(cn_fd, buffer, sizeof(buffer), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == ENOBUFS) {
+                /* Kernel dropped events: the caller has to resync */
+                memset(&events[count], 0, sizeof(proc_event_t));
+                events[count].type = PROC_EVENT_TYPE_OVERRUN;
+                clock_gettime(CLOCK_MONOTONIC, &events[count].timestamp);
+                count++;
+                continue;
+            }
+            return -1;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        count += proc_events_parse(buffer, (size_t)len, &now, &events[count], max_events - count);
+    }
+
+    return count;
+}
@@ -0,0 +1,517 @@
+#include "../include/proc_scanner.h"
+#include "../include/procfs.h"
+#include "../include/taskstats_backend.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+/* Same order as namespace_report_t.ns_type_names */
+static const char *scan_ns_types[MAX_NS_TYPES] = {
+    NS_TYPE_IPC, NS_TYPE_MNT, NS_TYPE_NET,
+    NS_TYPE_PID, NS_TYPE_USER, NS_TYPE_UTS,
+    NS_TYPE_CGROUP
+};
+
+/* Worker state: results stay in a private array until the merge */
+typedef struct {
+    pthread_t thread;
+    int index;
+    unsigned long seen;          /* Last generation handled */
+    proc_scan_entry_t *entries;
+    int count;
+    int capacity;
+    int skipped;                 /* PIDs of this scan that could not be read */
+    int skip_errno;
+    pid_t *shard_pids;           /* This worker's PIDs of the current scan */
+    proc_snapshot_t *shard_snaps;
+    int *shard_errors;
+    int shard_capacity;
+} scan_worker_t;
+
+static scan_worker_t workers[PROC_SCAN_MAX_THREADS];
+static int worker_count = 0;
+static int proc_fd = -1;
+
+/* Work hand-off: the scanning thread bumps generation, workers report done */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t work_done = PTHREAD_COND_INITIALIZER;
+static unsigned long generation = 0;
+static int pending_workers = 0;
+static int shutting_down = 0;
+
+static const pid_t *scan_pids = NULL;
+static int scan_pid_count = 0;
+static unsigned int scan_flags = 0;
+
+static pid_t *pid_list = NULL;
+static int pid_capacity = 0;
+
+static unsigned int snapshot_files(unsigned int flags) {
+    if (!(flags & (PROC_SCAN_CPU | PROC_SCAN_MEMORY | PROC_SCAN_IO))) {
+        return 0;
+    }
+    unsigned int files = proc_snapshot_files_for((flags & PROC_SCAN_CPU) != 0,
+                                                 (flags & PROC_SCAN_MEMORY) != 0,
+                                                 (flags & PROC_SCAN_IO) != 0);
+    /* comm, state and starttime come from stat */
+    return files | PROCFS_SNAP_STAT;
+}
+
+/* Fill an entry from a snapshot (may be NULL when only namespaces were
+ * asked for) and the namespace inodes */
+static int collect_entry(pid_t pid, unsigned int flags, const proc_snapshot_t *snap,
+                         proc_scan_entry_t *entry) {
+    memset(entry, 0, sizeof(proc_scan_entry_t));
+    entry->pid = pid;
+
+    if (snap) {
+        memcpy(entry->comm, snap->comm, sizeof(entry->comm));
+        entry->state = snap->state;
+        entry->starttime = snap->starttime;
+
+        if (flags & PROC_SCAN_CPU) {
+            cpu_monitor_from_snapshot(snap, &entry->cpu);
+        }
+        if (flags & PROC_SCAN_MEMORY) {
+            memory_monitor_from_snapshot(snap, &entry->memory);
+        }
+        if ((flags & PROC_SCAN_IO) && io_monitor_from_snapshot(snap, &entry->io) == 0) {
+            entry->has_io = 1;
+        }
+    }
+
+    if (flags & PROC_SCAN_NAMESPACE) {
+        /* Relative to the /proc descriptor: no lookup from / per call */
+        int found = 0;
+        for (int i = 0; i < MAX_NS_TYPES; i++) {
+            char path[64];
+            snprintf(path, sizeof(path), "%d/ns/%s", pid, scan_ns_types[i]);
+            struct stat st;
+            if (fstatat(proc_fd, path, &st, 0) == 0) {
+                entry->ns_inodes[i] = st.st_ino;
+                found++;
+            }
+        }
+        if (found == 0 && flags == PROC_SCAN_NAMESPACE) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Grow the per-worker shard arrays to hold count PIDs */
+static int worker_reserve_shard(scan_worker_t *worker, int count) {
+    if (count <= worker->shard_capacity) {
+        return 0;
+    }
+    int new_capacity = worker->shard_capacity ? worker->shard_capacity : 256;
+    while (new_capacity < count) {
+        new_capacity *= 2;
+    }
+
+    pid_t *pids = realloc(worker->shard_pids, new_capacity * sizeof(pid_t));
+    if (pids) {
+        worker->shard_pids = pids;
+    }
+    proc_snapshot_t *snaps = realloc(worker->shard_snaps, new_capacity * sizeof(proc_snapshot_t));
+    if (snaps) {
+        worker->shard_snaps = snaps;
+    }
+    int *errors = realloc(worker->shard_errors, new_capacity * sizeof(int));
+    if (errors) {
+        worker->shard_errors = errors;
+    }
+    if (!pids || !snaps || !errors) {
+        return -1;
+    }
+    worker->shard_capacity = new_capacity;
+    return 0;
+}
+
+static int worker_append(scan_worker_t *worker, const proc_scan_entry_t *entry) {
+    if (worker->count == worker->capacity) {
+        int new_capacity = worker->capacity ? worker->capacity * 2 : 256;
+        proc_scan_entry_t *grown = realloc(worker->entries,
+                                           new_capacity * sizeof(proc_scan_entry_t));
+        if (!grown) {
+            return -1;
+        }
+        worker->entries = grown;
+        worker->capacity = new_capacity;
+    }
+    worker->entries[worker->count++] = *entry;
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    scan_worker_t *worker = arg;
+
+    unsigned long seen = worker->seen;
+
+    procfs_init();
+
+    for (;;) {
+        pthread_mutex_lock(&pool_lock);
+        while (generation == seen && !shutting_down) {
+            pthread_cond_wait(&work_ready, &pool_lock);
+        }
+        if (shutting_down) {
+            pthread_mutex_unlock(&pool_lock);
+            break;
+        }
+        seen = generation;
+        const pid_t *pids = scan_pids;
+        int count = scan_pid_count;
+        unsigned int flags = scan_flags;
+        pthread_mutex_unlock(&pool_lock);
+
+        /* Shard by PID value so a process stays on the same worker (and in
+         * the same handle cache) from one scan to the next */
+        worker->count = 0;
+        worker->skipped = 0;
+        worker->skip_errno = 0;
+        int shard_size = 0;
+        for (int i = 0; i < count; i++) {
+            if ((int)((unsigned int)pids[i] % (unsigned int)worker_count) != worker->index) {
+                continue;
+            }
+            if (worker_reserve_shard(worker, shard_size + 1) != 0) {
+                worker->skipped++;
+                worker->skip_errno = ENOMEM;
+                continue;
+            }
+            worker->shard_pids[shard_size++] = pids[i];
+        }
+
+        /* The whole shard is read in one batch: under io_uring that is one
+         * submission per PROCFS_URING_ENTRIES reads instead of a syscall
+         * per file */
+        unsigned int files = snapshot_files(flags);
+        if (files) {
+            proc_snapshot_take_batch(worker->shard_pids, shard_size, files,
+                                     worker->shard_snaps, worker->shard_errors);
+        }
+
+        for (int i = 0; i < shard_size; i++) {
+            /* Exited since the listing: expected. Anything else (EMFILE,
+             * EACCES, ENOMEM) hides a live process and is reported */
+            if (files && worker->shard_errors[i] != 0) {
+                if (!procfs_is_gone_error(worker->shard_errors[i])) {
+                    worker->skipped++;
+                    worker->skip_errno = worker->shard_errors[i];
+                }
+                continue;
+            }
+            proc_scan_entry_t entry;
+            if (collect_entry(worker->shard_pids[i], flags,
+                              files ? &worker->shard_snaps[i] : NULL, &entry) == 0 &&
+                worker_append(worker, &entry) != 0) {
+                worker->skipped++;
+                worker->skip_errno = ENOMEM;
+            }
+        }
+
+        /* Handles of processes that exited unread linger in the cache;
+         * start over once they clearly outnumber the live shard */
+        if (procfs_cached_count() > 2 * shard_size + 64) {
+            procfs_cleanup();
+        }
+
+        pthread_mutex_lock(&pool_lock);
+        if (--pending_workers == 0) {
+            pthread_cond_signal(&work_done);
+        }
+        pthread_mutex_unlock(&pool_lock);
+    }
+
+    procfs_uring_cleanup();
+    procfs_cleanup();
+    /* The netlink socket is per thread and opened lazily by the first query */
+    taskstats_cleanup();
+    return NULL;
+}
+
+int proc_scanner_init(int threads) {
+    if (worker_count > 0) {
+        return 0;
+    }
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int)cpus : 1;
+    }
+    if (threads > PROC_SCAN_MAX_THREADS) {
+        threads = PROC_SCAN_MAX_THREADS;
+    }
+
+    proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_fd < 0) {
+        fprintf(stderr, "Failed to open /proc: %s\n", strerror(errno));
+        return -1;
+    }
+
+    shutting_down = 0;
+    for (int i = 0; i < threads; i++) {
+        memset(&workers[i], 0, sizeof(scan_worker_t));
+        workers[i].index = i;
+        workers[i].seen = generation;
+        int err = pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+        if (err != 0) {
+            fprintf(stderr, "Failed to start scanner thread: %s\n", strerror(err));
+            break;
+        }
+        worker_count++;
+    }
+
+    if (worker_count == 0) {
+        close(proc_fd);
+        proc_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void proc_scanner_cleanup(void) {
+    pthread_mutex_lock(&pool_lock);
+    shutting_down = 1;
+    pthread_cond_broadcast(&work_ready);
+    pthread_mutex_unlock(&pool_lock);
+
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+        free(workers[i].entries);
+        free(workers[i].shard_pids);
+        free(workers[i].shard_snaps);
+        free(workers[i].shard_errors);
+        memset(&workers[i], 0, sizeof(scan_worker_t));
+    }
+    worker_count = 0;
+
+    free(pid_list);
+    pid_list = NULL;
+    pid_capacity = 0;
+
+    if (proc_fd >= 0) {
+        close(proc_fd);
+        proc_fd = -1;
+    }
+}
+
+int proc_scanner_thread_count(void) {
+    return worker_count;
+}
+
+int proc_scanner_list_pids(pid_t **pids, int *capacity) {
+    if (proc_fd < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return procfs_list_pids(proc_fd, pids, capacity);
+}
+
+static int compare_entry_pid(const void *a, const void *b) {
+    pid_t pa = ((const proc_scan_entry_t *)a)->pid;
+    pid_t pb = ((const proc_scan_entry_t *)b)->pid;
+    return (pa > pb) - (pa < pb);
+}
+
+int proc_scanner_scan(unsigned int flags, proc_scan_result_t *result) {
+    if (!result || worker_count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int count = proc_scanner_list_pids(&pid_list, &pid_capacity);
+    if (count < 0) {
+        fprintf(stderr, "Failed to list /proc: %s\n", strerror(errno));
+        return -1;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    scan_pids = pid_list;
+    scan_pid_count = count;
+    scan_flags = flags;
+    pending_workers = worker_count;
+    generation++;
+    pthread_cond_broadcast(&work_ready);
+    while (pending_workers > 0) {
+        pthread_cond_wait(&work_done, &pool_lock);
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    /* Merge per-worker results into one contiguous array */
+    int total = 0;
+    for (int i = 0; i < worker_count; i++) {
+        total += workers[i].count;
+    }
+    if (total > result->capacity) {
+        proc_scan_entry_t *grown = realloc(result->entries, total * sizeof(proc_scan_entry_t));
+        if (!grown) {
+            errno = ENOMEM;
+            return -1;
+        }
+        result->entries = grown;
+        result->capacity = total;
+    }
+
+    result->count = 0;
+    result->skipped = 0;
+    result->skip_errno = 0;
+    for (int i = 0; i < worker_count; i++) {
+        memcpy(&result->entries[result->count], workers[i].entries,
+               workers[i].count * sizeof(proc_scan_entry_t));
+        result->count += workers[i].count;
+        result->skipped += workers[i].skipped;
+        if (workers[i].skipped > 0) {
+            result->skip_errno = workers[i].skip_errno;
+        }
+    }
+    qsort(result->entries, result->count, sizeof(proc_scan_entry_t), compare_entry_pid);
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->listed = count;
+    result->timestamp = end;
+    result->scan_ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    return result->count;
+}
+
+void proc_scanner_calculate_rates(const proc_scan_result_t *prev, proc_scan_result_t *curr) {
+    if (!prev || !curr) {
+        return;
+    }
+
+    /* Both arrays are sorted by PID: walk them in step */
+    int j = 0;
+    for (int i = 0; i < curr->count; i++) {
+        proc_scan_entry_t *entry = &curr->entries[i];
+        while (j < prev->count && prev->entries[j].pid < entry->pid) {
+            j++;
+        }
+        if (j >= prev->count || prev->entries[j].pid != entry->pid) {
+            continue;
+        }
+
+        const proc_scan_entry_t *old = &prev->entries[j];
+        /* A different start means the PID was reused */
+        if (old->starttime != entry->starttime) {
+            continue;
+        }
+
+        cpu_metrics_t cpu;
+        if (cpu_monitor_calculate_percentage(&old->cpu, &entry->cpu, &cpu) == 0) {
+            entry->cpu.cpu_percent = cpu.cpu_percent;
+        }
+        if (entry->has_io && old->has_io) {
+            io_metrics_t io;
+            io_monitor_calculate_rates(&old->io, &entry->io, &io);
+            entry->io.read_rate = io.read_rate;
+            entry->io.write_rate = io.write_rate;
+        }
+    }
+}
+
+void proc_scan_result_free(proc_scan_result_t *result) {
+    if (!result) {
+        return;
+    }
+    free(result->entries);
+    memset(result, 0, sizeof(proc_scan_result_t));
+}
+
+static int compare_entry_cpu(const void *a, const void *b) {
+    const proc_scan_entry_t *ea = *(const proc_scan_entry_t *const *)a;
+    const proc_scan_entry_t *eb = *(const proc_scan_entry_t *const *)b;
+    if (ea->cpu.cpu_percent != eb->cpu.cpu_percent) {
+        return (ea->cpu.cpu_percent < eb->cpu.cpu_percent) ? 1 : -1;
+    }
+    return (ea->memory.rss < eb->memory.rss) - (ea->memory.rss > eb->memory.rss);
+}
+
+void print_proc_scan_result(const proc_scan_result_t *result, int top_n) {
+    if (!result) {
+        return;
+    }
+
+    printf("=== System Scan: %d processes in %.2f ms (%d threads) ===\n",
+           result->count, result->scan_ms, worker_count);
+    if (result->skipped > 0) {
+        printf("Warning: %d processes could not be read (%s) and are missing\n",
+               result->skipped, strerror(result->skip_errno));
+    }
+
+    if (result->count == 0 || top_n <= 0) {
+        printf("\n");
+        return;
+    }
+
+    const proc_scan_entry_t **order = malloc(result->count * sizeof(*order));
+    if (!order) {
+        return;
+    }
+    for (int i = 0; i < result->count; i++) {
+        order[i] = &result->entries[i];
+    }
+    qsort(order, result->count, sizeof(*order), compare_entry_cpu);
+
+    if (top_n > result->count) {
+        top_n = result->count;
+    }
+
+    printf("%-8s %-16s %1s %8s %8s %10s %12s %12s\n",
+           "PID", "COMMAND", "S", "CPU%", "THREADS", "RSS(KB)", "READ(B/s)", "WRITE(B/s)");
+    for (int i = 0; i < top_n; i++) {
+        const proc_scan_entry_t *e = order[i];
+        printf("%-8d %-16.16s %c %8.2f %8ld %10lu %12.0f %12.0f\n",
+               e->pid, e->comm, e->state ? e->state : '?', e->cpu.cpu_percent,
+               e->cpu.num_threads, e->memory.rss, e->io.read_rate, e->io.write_rate);
+    }
+    printf("\n");
+    free(order);
+}
+
+int export_proc_scan_csv(const proc_scan_result_t *result, const char *filename, int append) {
+    if (!result || !filename) {
+        return -1;
+    }
+
+    FILE *fp = fopen(filename, append ? "a" : "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    if (!append) {
+        fprintf(fp, "timestamp,pid,comm,state,cpu_percent,num_threads,rss,vsz,");
+        fprintf(fp, "read_bytes,write_bytes,read_rate,write_rate,");
+        for (int i = 0; i < MAX_NS_TYPES; i++) {
+            fprintf(fp, "ns_%s%s", scan_ns_types[i], (i < MAX_NS_TYPES - 1) ? "," : "\n");
+        }
+    }
+
+    for (int i = 0; i < result->count; i++) {
+        const proc_scan_entry_t *e = &result->entries[i];
+        fprintf(fp, "%ld.%09ld,%d,\"%s\",%c,%.2f,%ld,%lu,%lu,%lu,%lu,%.2f,%.2f",
+                result->timestamp.tv_sec, result->timestamp.tv_nsec,
+                e->pid, e->comm, e->state ? e->state : '?', e->cpu.cpu_percent,
+                e->cpu.num_threads, e->memory.rss, e->memory.vsz,
+                e->io.read_bytes, e->io.write_bytes, e->io.read_rate, e->io.write_rate);
+        for (int n = 0; n < MAX_NS_TYPES; n++) {
+            fprintf(fp, ",%lu", (unsigned long)e->ns_inodes[n]);
+        }
+        fprintf(fp, "\n");
+    }
+
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,317 @@
+#include "../include/procfs.h"
+#include "../include/taskstats_backend.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* /proc/[pid]/stat fields used by the collectors, sorted by index (proc(5)) */
+static const procfs_stat_field_t stat_fields[] = {
+    PROCFS_STAT_FIELD(4,  proc_snapshot_t, ppid),
+    PROCFS_STAT_FIELD(10, proc_snapshot_t, minflt),
+    PROCFS_STAT_FIELD(12, proc_snapshot_t, majflt),
+    PROCFS_STAT_FIELD(14, proc_snapshot_t, utime),
+    PROCFS_STAT_FIELD(15, proc_snapshot_t, stime),
+    PROCFS_STAT_FIELD(16, proc_snapshot_t, cutime),
+    PROCFS_STAT_FIELD(17, proc_snapshot_t, cstime),
+    PROCFS_STAT_FIELD(20, proc_snapshot_t, num_threads),
+    PROCFS_STAT_FIELD(22, proc_snapshot_t, starttime),
+};
+
+static const procfs_field_t status_fields[] = {
+    PROCFS_FIELD("VmSize",   proc_snapshot_t, vm_size),
+    PROCFS_FIELD("VmRSS",    proc_snapshot_t, vm_rss),
+    PROCFS_FIELD("RssShmem", proc_snapshot_t, rss_shmem),
+    PROCFS_FIELD("VmData",   proc_snapshot_t, vm_data),
+    PROCFS_FIELD("VmStk",    proc_snapshot_t, vm_stk),
+    PROCFS_FIELD("VmExe",    proc_snapshot_t, vm_exe),
+    PROCFS_FIELD("VmSwap",   proc_snapshot_t, vm_swap),
+    PROCFS_FIELD("voluntary_ctxt_switches",    proc_snapshot_t, voluntary_ctxt_switches),
+    PROCFS_FIELD("nonvoluntary_ctxt_switches", proc_snapshot_t, nonvoluntary_ctxt_switches),
+};
+
+static const procfs_field_t io_fields[] = {
+    PROCFS_FIELD("rchar",                 proc_snapshot_t, rchar),
+    PROCFS_FIELD("wchar",                 proc_snapshot_t, wchar),
+    PROCFS_FIELD("syscr",                 proc_snapshot_t, syscr),
+    PROCFS_FIELD("syscw",                 proc_snapshot_t, syscw),
+    PROCFS_FIELD("read_bytes",            proc_snapshot_t, read_bytes),
+    PROCFS_FIELD("write_bytes",           proc_snapshot_t, write_bytes),
+    PROCFS_FIELD("cancelled_write_bytes", proc_snapshot_t, cancelled_write_bytes),
+};
+
+#define FIELD_COUNT(table) ((int)(sizeof(table) / sizeof((table)[0])))
+
+static procfs_backend_t snapshot_backend = PROCFS_BACKEND_PROCFS;
+/* Set by a thread whose taskstats queries failed: the fallback to procfs
+ * stays local to that thread (scanner workers run concurrently) */
+static _Thread_local int taskstats_failed = 0;
+static procfs_cpu_clock_t cpu_clock = PROCFS_CPU_CLOCK_TICKS;
+static long clock_ticks = 0;
+static int delayacct_enabled = 1;
+
+/* Block I/O and swap-in delays are only accounted with kernel.task_delayacct=1,
+ * off by default since 5.14; kernels without the sysctl always account them */
+static int read_task_delayacct(void) {
+    FILE *fp = fopen("/proc/sys/kernel/task_delayacct", "r");
+    if (!fp) {
+        return 1;
+    }
+    int value = 1;
+    if (fscanf(fp, "%d", &value) != 1) {
+        value = 1;
+    }
+    fclose(fp);
+    return value != 0;
+}
+
+int proc_snapshot_set_backend(procfs_backend_t backend) {
+    if (backend == PROCFS_BACKEND_TASKSTATS && taskstats_init() != 0) {
+        snapshot_backend = PROCFS_BACKEND_PROCFS;
+        return -1;
+    }
+    if (clock_ticks <= 0) {
+        clock_ticks = sysconf(_SC_CLK_TCK);
+    }
+    if (backend == PROCFS_BACKEND_TASKSTATS) {
+        delayacct_enabled = read_task_delayacct();
+        if (!delayacct_enabled) {
+            fprintf(stderr, "Warning: kernel.task_delayacct is 0, block I/O and swap-in "
+                            "delays are not measured (sysctl -w kernel.task_delayacct=1)\n");
+        }
+    }
+    snapshot_backend = backend;
+    taskstats_failed = 0;
+    return 0;
+}
+
+procfs_backend_t proc_snapshot_get_backend(void) {
+    return taskstats_failed ? PROCFS_BACKEND_PROCFS : snapshot_backend;
+}
+
+int proc_snapshot_set_cpu_clock(procfs_cpu_clock_t clock) {
+    if (clock == PROCFS_CPU_CLOCK_SCHEDSTAT && access("/proc/self/schedstat", R_OK) != 0) {
+        cpu_clock = PROCFS_CPU_CLOCK_TICKS;
+        return -1;
+    }
+    cpu_clock = clock;
+    return 0;
+}
+
+procfs_cpu_clock_t proc_snapshot_get_cpu_clock(void) {
+    return cpu_clock;
+}
+
+unsigned int proc_snapshot_files_for(int cpu, int memory, int io) {
+    unsigned int files = 0;
+
+    if (proc_snapshot_get_backend() == PROCFS_BACKEND_TASKSTATS) {
+        /* RSS and friends only exist in status; stat is kept for page
+         * faults of multi-threaded processes and dropped otherwise */
+        if (cpu) files |= PROCFS_SNAP_TASKSTATS;
+        if (memory) files |= PROCFS_SNAP_TASKSTATS | PROCFS_SNAP_STAT | PROCFS_SNAP_STATUS;
+        if (io) files |= PROCFS_SNAP_TASKSTATS | PROCFS_SNAP_IO;
+        return files;
+    }
+
+    if (cpu || memory) files |= PROCFS_SNAP_STAT | PROCFS_SNAP_STATUS;
+    if (cpu && cpu_clock == PROCFS_CPU_CLOCK_SCHEDSTAT) files |= PROCFS_SNAP_SCHEDSTAT;
+    if (io) files |= PROCFS_SNAP_IO;
+    return files;
+}
+
+static uint64_t usec_to_ticks(uint64_t usec) {
+    return usec * (uint64_t)clock_ticks / 1000000;
+}
+
+/* Threads of a process without parsing: /proc/[pid]/task has one link per
+ * thread plus "." and ".." */
+static long count_threads(pid_t pid) {
+    /* The task directory's link count is recomputed on every fstat(), so
+     * the cached descriptor avoids a path walk per sample */
+    int fd = procfs_get_fd(pid, PROCFS_TASK_DIR);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        return -1;
+    }
+    return (st.st_nlink > 2) ? (long)st.st_nlink - 2 : 1;
+}
+
+/* Fill CPU, delay and (for single-threaded processes) fault and I/O
+ * counters from one taskstats reply */
+static int take_taskstats(pid_t pid, proc_snapshot_t *snap) {
+    long threads = count_threads(pid);
+    if (threads < 0) {
+        return -1;
+    }
+
+    /* Per-task replies carry I/O and faults but only for that one thread;
+     * thread-group replies sum CPU and delays over every thread */
+    task_accounting_t acct;
+    int per_task = (threads == 1);
+    int ret = per_task ? taskstats_query_pid(pid, &acct)
+                       : taskstats_query_tgid(pid, &acct);
+    if (ret != 0) {
+        return -1;
+    }
+
+    snap->num_threads = threads;
+    snap->utime = usec_to_ticks(acct.utime_us);
+    snap->stime = usec_to_ticks(acct.stime_us);
+    snap->voluntary_ctxt_switches = acct.nvcsw;
+    snap->nonvoluntary_ctxt_switches = acct.nivcsw;
+    snap->cpu_time_ns = acct.cpu_time_ns;
+    snap->cpu_delay_ns = acct.cpu_delay_ns;
+    snap->timeslices = acct.cpu_count;
+    snap->has_delays = delayacct_enabled;
+    snap->blkio_delay_ns = acct.blkio_delay_ns;
+    snap->swapin_delay_ns = acct.swapin_delay_ns;
+
+    if (per_task && acct.has_io) {
+        snap->taskstats_per_task = 1;
+        snap->minflt = acct.minflt;
+        snap->majflt = acct.majflt;
+        snap->rchar = acct.read_char;
+        snap->wchar = acct.write_char;
+        snap->syscr = acct.read_syscalls;
+        snap->syscw = acct.write_syscalls;
+        snap->read_bytes = acct.read_bytes;
+        snap->write_bytes = acct.write_bytes;
+        snap->cancelled_write_bytes = acct.cancelled_write_bytes;
+    }
+    return 0;
+}
+
+int proc_snapshot_parse_stat(const char *buffer, proc_snapshot_t *snap) {
+    if (!buffer || !snap) {
+        return -1;
+    }
+
+    /* comm may contain spaces and parentheses: it spans from the first '('
+     * to the last ')' of the line */
+    const char *open_paren = strchr(buffer, '(');
+    const char *close_paren = strrchr(buffer, ')');
+    if (!open_paren || !close_paren || close_paren < open_paren) {
+        return -1;
+    }
+
+    size_t comm_len = (size_t)(close_paren - open_paren - 1);
+    if (comm_len >= sizeof(snap->comm)) {
+        comm_len = sizeof(snap->comm) - 1;
+    }
+    memcpy(snap->comm, open_paren + 1, comm_len);
+    snap->comm[comm_len] = '\0';
+
+    /* Field 3 (state) is a single character right after ") " */
+    if (close_paren[1] != ' ' || close_paren[2] == '\0') {
+        return -1;
+    }
+    snap->state = close_paren[2];
+
+    int found = procfs_parse_stat_fields(close_paren + 1, stat_fields,
+                                         FIELD_COUNT(stat_fields), snap);
+    return (found == FIELD_COUNT(stat_fields)) ? 0 : -1;
+}
+
+int proc_snapshot_parse_status(const char *buffer, proc_snapshot_t *snap) {
+    if (!buffer || !snap) {
+        return -1;
+    }
+
+    procfs_parse_kv(buffer, status_fields, FIELD_COUNT(status_fields), snap);
+    return 0;
+}
+
+int proc_snapshot_read_schedstat(pid_t pid, proc_snapshot_t *snap) {
+    /* The leader's schedstat misses every other thread, so multi-threaded
+     * processes are summed over task/[tid]/schedstat */
+    procfs_schedstat_t sched;
+    if (procfs_read_schedstat(pid, snap->num_threads, &sched) != 0) {
+        /* Keep the tick counters unless the process is gone */
+        return procfs_is_gone_error(errno) ? -1 : 0;
+    }
+    snap->cpu_time_ns = sched.cpu_time_ns;
+    snap->cpu_delay_ns = sched.cpu_delay_ns;
+    snap->timeslices = sched.timeslices;
+    snap->files |= PROCFS_SNAP_SCHEDSTAT;
+    return 0;
+}
+
+int proc_snapshot_parse_io(const char *buffer, proc_snapshot_t *snap) {
+    if (!buffer || !snap) {
+        return -1;
+    }
+
+    procfs_parse_kv(buffer, io_fields, FIELD_COUNT(io_fields), snap);
+    return 0;
+}
+
+int proc_snapshot_take(pid_t pid, unsigned int files, proc_snapshot_t *snap) {
+    if (!snap) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(snap, 0, sizeof(proc_snapshot_t));
+    snap->pid = pid;
+
+    char buffer[PROCFS_BUFFER_SIZE];
+
+    if (files & PROCFS_SNAP_TASKSTATS) {
+        procfs_backend_t backend = proc_snapshot_get_backend();
+        if (backend == PROCFS_BACKEND_TASKSTATS && take_taskstats(pid, snap) == 0) {
+            snap->files |= PROCFS_SNAP_TASKSTATS;
+            if (snap->taskstats_per_task) {
+                if (files & PROCFS_SNAP_IO) snap->files |= PROCFS_SNAP_IO;
+                files &= ~(PROCFS_SNAP_STAT | PROCFS_SNAP_IO);
+            }
+        } else {
+            if (backend == PROCFS_BACKEND_TASKSTATS && !procfs_is_gone_error(errno)) {
+                fprintf(stderr, "taskstats query failed (%s), using procfs\n", strerror(errno));
+                taskstats_failed = 1;
+            }
+            /* Exited tasks stay readable in procfs until reaped */
+            files |= PROCFS_SNAP_STAT | PROCFS_SNAP_STATUS;
+        }
+    }
+
+    if (files & PROCFS_SNAP_STAT) {
+        if (procfs_read(pid, PROCFS_STAT, buffer, sizeof(buffer)) < 0) {
+            return -1;
+        }
+        if (proc_snapshot_parse_stat(buffer, snap) != 0) {
+            errno = EPROTO;
+            return -1;
+        }
+        snap->files |= PROCFS_SNAP_STAT;
+    }
+
+    if ((files & PROCFS_SNAP_SCHEDSTAT) && (snap->files & PROCFS_SNAP_STAT) &&
+        proc_snapshot_read_schedstat(pid, snap) != 0) {
+        return -1;
+    }
+
+    if (files & PROCFS_SNAP_STATUS) {
+        if (procfs_read(pid, PROCFS_STATUS, buffer, sizeof(buffer)) < 0) {
+            return -1;
+        }
+        proc_snapshot_parse_status(buffer, snap);
+        snap->files |= PROCFS_SNAP_STATUS;
+    }
+
+    if (files & PROCFS_SNAP_IO) {
+        if (procfs_read(pid, PROCFS_IO, buffer, sizeof(buffer)) < 0) {
+            snap->io_errno = errno;
+            if (procfs_is_gone_error(errno)) {
+                return -1;
+            }
+        } else {
+            proc_snapshot_parse_io(buffer, snap);
+            snap->files |= PROCFS_SNAP_IO;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &snap->timestamp);
+    return 0;
+}
@@ -0,0 +1,482 @@
+#include "../include/proc_events.h"
+#include "../include/taskstats_backend.h"
+#include "../include/monitor.h"
+#include "../include/procfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+
+/* Followed process: which seed it descends from and its previous counters */
+typedef struct {
+    pid_t pid;
+    int root;                    /* Index into roots[] */
+    double prev_cpu_sec;
+    uint64_t prev_read_bytes;
+    uint64_t prev_write_bytes;
+    int exited;                  /* Waiting for the next sample to be dropped */
+    int final_captured;          /* Final accounting was folded in */
+    int clock_set;               /* ns_clock was chosen by the first reading */
+    int ns_clock;                /* CPU tracked in scheduler ns, else in ticks */
+} proc_tree_member_t;
+
+/* Seed PID and what happened in its tree since the last sample */
+typedef struct {
+    pid_t pid;
+    int forks;
+    int exits;
+    int finals;
+    double cpu_sec;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+} proc_tree_root_t;
+
+static proc_tree_root_t *roots = NULL;
+static int root_count = 0;
+static int root_capacity = 0;
+
+static proc_tree_member_t *members = NULL;
+static int member_count = 0;
+static int member_capacity = 0;
+
+static struct timespec last_sample;
+static long clock_ticks = 0;
+
+static int find_member(pid_t pid) {
+    for (int i = 0; i < member_count; i++) {
+        if (members[i].pid == pid) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* A member stays on the clock of its first reading: mixing ns runtime
+ * with tick counts would move prev_cpu_sec by the gap between the two,
+ * which fold_member()'s forward-only rule drops or counts twice */
+static void choose_clock(proc_tree_member_t *member, int has_ns) {
+    if (!member->clock_set) {
+        member->ns_clock = has_ns;
+        member->clock_set = 1;
+    }
+}
+
+/* CPU seconds of a snapshot on the member's clock; 0 (nothing to fold)
+ * when the snapshot lacks that clock */
+static double snapshot_cpu_seconds(proc_tree_member_t *member, const proc_snapshot_t *snap) {
+    choose_clock(member, snap->cpu_time_ns > 0);
+    if (member->ns_clock) {
+        return snap->cpu_time_ns / 1e9;
+    }
+    return (double)(snap->utime + snap->stime) / clock_ticks;
+}
+
+/* CPU seconds of a taskstats exit record on the member's clock: the
+ * scheduler runtime is the same counter as schedstat and taskstats
+ * replies; utime+stime is truncated to whole ticks like /proc/[pid]/stat */
+static double record_cpu_seconds(proc_tree_member_t *member, const task_accounting_t *record) {
+    choose_clock(member, record->cpu_time_ns > 0);
+    if (member->ns_clock) {
+        return record->cpu_time_ns / 1e9;
+    }
+    uint64_t ticks = (record->utime_us + record->stime_us) * (uint64_t)clock_ticks / 1000000;
+    return (double)ticks / clock_ticks;
+}
+
+static void remove_member(int index);
+
+/* Add a member; baseline 1 records its current counters so only later
+ * activity is attributed to the tree (used for pre-existing processes) */
+static int add_member(pid_t pid, int root, int baseline) {
+    int existing = find_member(pid);
+    if (existing >= 0) {
+        if (!members[existing].exited) {
+            return 0;
+        }
+        /* PID reused before the sample dropped the exited member */
+        remove_member(existing);
+    }
+
+    if (member_count == member_capacity) {
+        int new_capacity = member_capacity ? member_capacity * 2 : 64;
+        proc_tree_member_t *grown = realloc(members, new_capacity * sizeof(proc_tree_member_t));
+        if (!grown) {
+            errno = ENOMEM;
+            return -1;
+        }
+        members = grown;
+        member_capacity = new_capacity;
+    }
+
+    proc_tree_member_t *member = &members[member_count++];
+    memset(member, 0, sizeof(proc_tree_member_t));
+    member->pid = pid;
+    member->root = root;
+
+    if (baseline) {
+        proc_snapshot_t snap;
+        if (proc_snapshot_take(pid, proc_snapshot_files_for(1, 0, 1), &snap) == 0) {
+            member->prev_cpu_sec = snapshot_cpu_seconds(member, &snap);
+            member->prev_read_bytes = snap.read_bytes;
+            member->prev_write_bytes = snap.write_bytes;
+        }
+    }
+    return 1;
+}
+
+static void remove_member(int index) {
+    procfs_forget(members[index].pid);
+    members[index] = members[--member_count];
+}
+
+/* Attribute usage since the member's previous counters to its tree
+ * Counters only move forward: a partial record (one thread of a group)
+ * never lowers them. */
+static void fold_member(proc_tree_member_t *member, double cpu_sec, int has_io,
+                        uint64_t read_bytes, uint64_t write_bytes) {
+    proc_tree_root_t *root = &roots[member->root];
+
+    if (cpu_sec > member->prev_cpu_sec) {
+        root->cpu_sec += cpu_sec - member->prev_cpu_sec;
+        member->prev_cpu_sec = cpu_sec;
+    }
+
+    if (has_io) {
+        if (read_bytes > member->prev_read_bytes) {
+            root->read_bytes += read_bytes - member->prev_read_bytes;
+            member->prev_read_bytes = read_bytes;
+        }
+        if (write_bytes > member->prev_write_bytes) {
+            root->write_bytes += write_bytes - member->prev_write_bytes;
+            member->prev_write_bytes = write_bytes;
+        }
+    }
+}
+
+static void mark_exited(proc_tree_member_t *member) {
+    if (!member->exited) {
+        member->exited = 1;
+        roots[member->root].exits++;
+    }
+}
+
+/* Add every descendant of pid that is not yet a member
+ * Returns the number of members added, -1 if pid is gone. */
+static int scan_children(pid_t pid, int root, int baseline) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return -1;
+    }
+
+    int added = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+
+        /* Each thread lists the children it forked */
+        char children_path[96];
+        snprintf(children_path, sizeof(children_path), "/proc/%d/task/%s/children",
+                 pid, entry->d_name);
+        FILE *fp = fopen(children_path, "r");
+        if (!fp) {
+            continue;
+        }
+
+        int child;
+        while (fscanf(fp, "%d", &child) == 1) {
+            if (add_member(child, root, baseline) > 0) {
+                int descendants = scan_children(child, root, baseline);
+                added += 1 + (descendants > 0 ? descendants : 0);
+            }
+        }
+        fclose(fp);
+    }
+    closedir(dir);
+
+    return added;
+}
+
+int proc_tree_init(void) {
+    clock_ticks = sysconf(_SC_CLK_TCK);
+    if (clock_ticks <= 0) {
+        fprintf(stderr, "Failed to get clock ticks per second\n");
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &last_sample);
+    return procfs_init();
+}
+
+void proc_tree_cleanup(void) {
+    while (member_count > 0) {
+        remove_member(member_count - 1);
+    }
+    free(members);
+    members = NULL;
+    member_capacity = 0;
+
+    free(roots);
+    roots = NULL;
+    root_count = 0;
+    root_capacity = 0;
+}
+
+int proc_tree_add_root(pid_t pid) {
+    if (root_count == root_capacity) {
+        int new_capacity = root_capacity ? root_capacity * 2 : 16;
+        proc_tree_root_t *grown = realloc(roots, new_capacity * sizeof(proc_tree_root_t));
+        if (!grown) {
+            errno = ENOMEM;
+            return -1;
+        }
+        roots = grown;
+        root_capacity = new_capacity;
+    }
+
+    int root = root_count;
+    if (add_member(pid, root, 1) < 0) {
+        return -1;
+    }
+    memset(&roots[root_count], 0, sizeof(proc_tree_root_t));
+    roots[root_count].pid = pid;
+    root_count++;
+
+    scan_children(pid, root, 1);
+    return 0;
+}
+
+int proc_tree_handle_event(const proc_event_t *event) {
+    if (!event) {
+        return 0;
+    }
+
+    switch (event->type) {
+        case PROC_EVENT_TYPE_FORK: {
+            int parent = find_member(event->parent);
+            if (parent < 0 || members[parent].exited) {
+                return 0;
+            }
+            /* Everything a new child does happens inside the tree: no baseline */
+            int root = members[parent].root;
+            if (add_member(event->pid, root, 0) > 0) {
+                roots[root].forks++;
+                return 1;
+            }
+            return 0;
+        }
+
+        case PROC_EVENT_TYPE_EXIT: {
+            int index = find_member(event->pid);
+            if (index < 0 || members[index].exited) {
+                return 0;
+            }
+
+            /* The task is not reaped yet: read its final counters now. A
+             * taskstats exit record arriving later still refines them. */
+            proc_tree_member_t *member = &members[index];
+            proc_snapshot_t snap;
+            if (proc_snapshot_take(member->pid, proc_snapshot_files_for(1, 0, 1), &snap) == 0) {
+                fold_member(member, snapshot_cpu_seconds(member, &snap),
+                            (snap.files & PROCFS_SNAP_IO) != 0,
+                            snap.read_bytes, snap.write_bytes);
+                member->final_captured = 1;
+            }
+            mark_exited(member);
+            return 1;
+        }
+
+        case PROC_EVENT_TYPE_OVERRUN:
+            return proc_tree_resync() > 0;
+
+        default:
+            return 0;
+    }
+}
+
+int proc_tree_handle_exit_record(const task_accounting_t *record) {
+    if (!record) {
+        return 0;
+    }
+
+    /* Only whole-process records: a group aggregate, or the per-task
+     * record of a single-threaded process */
+    if (!record->is_tgid && record->pid != record->tgid) {
+        return 0;
+    }
+
+    int index = find_member(record->tgid);
+    if (index < 0) {
+        return 0;
+    }
+
+    proc_tree_member_t *member = &members[index];
+    fold_member(member, record_cpu_seconds(member, record), record->has_io,
+                record->read_bytes, record->write_bytes);
+    member->final_captured = 1;
+    mark_exited(member);
+    return 1;
+}
+
+int proc_tree_resync(void) {
+    int changed = 0;
+
+    /* Drop members that exited while events were lost */
+    for (int i = member_count - 1; i >= 0; i--) {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%d", members[i].pid);
+        if (!members[i].exited && access(path, F_OK) != 0) {
+            mark_exited(&members[i]);
+            changed++;
+        }
+    }
+
+    /* Pick up children forked while events were lost; they were born
+     * inside the tree, so all of their usage counts */
+    int count = member_count;
+    for (int i = 0; i < count; i++) {
+        if (members[i].exited) {
+            continue;
+        }
+        int added = scan_children(members[i].pid, members[i].root, 0);
+        if (added > 0) {
+            roots[members[i].root].forks += added;
+            changed += added;
+        }
+    }
+
+    return changed;
+}
+
+int proc_tree_member_count(void) {
+    int live = 0;
+    for (int i = 0; i < member_count; i++) {
+        if (!members[i].exited) {
+            live++;
+        }
+    }
+    return live;
+}
+
+int proc_tree_root_count(void) {
+    return root_count;
+}
+
+int proc_tree_sample(proc_tree_metrics_t *trees, int max_trees) {
+    if (!trees || max_trees <= 0) {
+        return -1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (now.tv_sec - last_sample.tv_sec) +
+                     (now.tv_nsec - last_sample.tv_nsec) / 1e9;
+    last_sample = now;
+
+    int count = (root_count < max_trees) ? root_count : max_trees;
+    for (int r = 0; r < count; r++) {
+        memset(&trees[r], 0, sizeof(proc_tree_metrics_t));
+        trees[r].root = roots[r].pid;
+        trees[r].timestamp = now;
+    }
+
+    unsigned int files = proc_snapshot_files_for(1, 1, 1);
+    for (int i = member_count - 1; i >= 0; i--) {
+        proc_tree_member_t *member = &members[i];
+
+        /* Exited members were folded when their exit was seen */
+        if (member->exited) {
+            if (member->final_captured) {
+                roots[member->root].finals++;
+            }
+            remove_member(i);
+            continue;
+        }
+        if (member->root >= count) {
+            continue;
+        }
+
+        /* A failed read means the exit event is still in flight */
+        proc_snapshot_t snap;
+        if (proc_snapshot_take(member->pid, files, &snap) != 0) {
+            continue;
+        }
+
+        fold_member(member, snapshot_cpu_seconds(member, &snap), (snap.files & PROCFS_SNAP_IO) != 0,
+                    snap.read_bytes, snap.write_bytes);
+
+        proc_tree_metrics_t *tree = &trees[member->root];
+        tree->processes++;
+        tree->threads += snap.num_threads;
+        tree->rss += snap.vm_rss;
+    }
+
+    for (int r = 0; r < count; r++) {
+        proc_tree_root_t *root = &roots[r];
+        trees[r].forks = root->forks;
+        trees[r].exits = root->exits;
+        trees[r].finals = root->finals;
+        trees[r].read_bytes = root->read_bytes;
+        trees[r].write_bytes = root->write_bytes;
+        if (elapsed > 0.0) {
+            trees[r].cpu_percent = root->cpu_sec / elapsed * 100.0;
+            trees[r].read_rate = root->read_bytes / elapsed;
+            trees[r].write_rate = root->write_bytes / elapsed;
+        }
+
+        pid_t pid = root->pid;
+        memset(root, 0, sizeof(proc_tree_root_t));
+        root->pid = pid;
+    }
+
+    return count;
+}
+
+void print_proc_tree_metrics(const proc_tree_metrics_t *metrics) {
+    if (!metrics) {
+        return;
+    }
+
+    printf("=== Process Tree of PID %d ===\n", metrics->root);
+    printf("Processes:     %d (+%d forked, -%d exited, %d with final accounting)\n",
+           metrics->processes, metrics->forks, metrics->exits, metrics->finals);
+    printf("Threads:       %ld\n", metrics->threads);
+    printf("CPU usage:     %.2f%%\n", metrics->cpu_percent);
+    printf("RSS:           %lu KB\n", metrics->rss);
+    printf("Read rate:     %.2f bytes/sec\n", metrics->read_rate);
+    printf("Write rate:    %.2f bytes/sec\n", metrics->write_rate);
+    printf("\n");
+}
+
+int export_proc_tree_metrics_csv(const proc_tree_metrics_t *metrics, const char *filename, int append) {
+    if (!metrics || !filename) {
+        return -1;
+    }
+
+    FILE *fp = fopen(filename, append ? "a" : "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    if (!append) {
+        fprintf(fp, "timestamp,root,processes,forks,exits,finals,threads,cpu_percent,");
+        fprintf(fp, "rss,read_bytes,write_bytes,read_rate,write_rate\n");
+    }
+
+    fprintf(fp, "%ld.%09ld,%d,%d,%d,%d,%d,%ld,%.2f,%lu,%lu,%lu,%.2f,%.2f\n",
+            metrics->timestamp.tv_sec, metrics->timestamp.tv_nsec,
+            metrics->root, metrics->processes, metrics->forks, metrics->exits,
+            metrics->finals,
+            metrics->threads, metrics->cpu_percent, metrics->rss,
+            metrics->read_bytes, metrics->write_bytes,
+            metrics->read_rate, metrics->write_rate);
+
+    fclose(fp);
+    return 0;
+}
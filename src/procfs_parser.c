@@ -0,0 +1,145 @@
+#include "../include/procfs.h"
+#include <string.h>
+
+uint64_t procfs_parse_u64(const char **cursor) {
+    const char *p = *cursor;
+    uint64_t value = 0;
+
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+
+    /* Single unsigned compare per digit */
+    unsigned int digit;
+    while ((digit = (unsigned int)(*p - '0')) < 10) {
+        value = value * 10 + digit;
+        p++;
+    }
+
+    *cursor = p;
+    return value;
+}
+
+int procfs_parse_schedstat(const char *buffer, procfs_schedstat_t *out) {
+    if (!buffer || !out) {
+        return -1;
+    }
+
+    const char *cursor = buffer;
+    out->cpu_time_ns = procfs_parse_u64(&cursor);
+    out->cpu_delay_ns = procfs_parse_u64(&cursor);
+    out->timeslices = procfs_parse_u64(&cursor);
+    return (*cursor == '\n' || *cursor == '\0') ? 0 : -1;
+}
+
+int procfs_parse_kv(const char *buffer, const procfs_field_t *fields,
+                    int field_count, void *out) {
+    if (!buffer || !fields || !out || field_count <= 0 || field_count > 64) {
+        return 0;
+    }
+
+    const uint64_t all_found = (field_count == 64) ? UINT64_MAX
+                                                   : ((1ULL << field_count) - 1);
+    uint64_t found = 0;
+    int found_count = 0;
+    const char *line = buffer;
+
+    /* First-character filter lets most lines skip key scanning entirely */
+    uint64_t first_chars[4] = {0, 0, 0, 0};
+    for (int i = 0; i < field_count; i++) {
+        unsigned char c = (unsigned char)fields[i].key[0];
+        first_chars[c >> 6] |= 1ULL << (c & 63);
+    }
+
+    while (*line && found != all_found) {
+        unsigned char first = (unsigned char)line[0];
+        if (!((first_chars[first >> 6] >> (first & 63)) & 1)) {
+            const char *next = strchr(line, '\n');
+            if (!next) {
+                break;
+            }
+            line = next + 1;
+            continue;
+        }
+
+        /* Key runs up to ':' or a blank */
+        const char *key_end = line;
+        while (*key_end && *key_end != ':' && *key_end != ' ' &&
+               *key_end != '\t' && *key_end != '\n') {
+            key_end++;
+        }
+        size_t key_len = (size_t)(key_end - line);
+
+        for (int i = 0; i < field_count; i++) {
+            if ((found >> i) & 1) {
+                continue;
+            }
+            if (fields[i].key_len != key_len || fields[i].key[0] != line[0] ||
+                memcmp(fields[i].key, line, key_len) != 0) {
+                continue;
+            }
+
+            const char *value = key_end + (*key_end == ':');
+            *(uint64_t *)((char *)out + fields[i].offset) = procfs_parse_u64(&value);
+            found |= 1ULL << i;
+            found_count++;
+            break;
+        }
+
+        const char *next = strchr(key_end, '\n');
+        if (!next) {
+            break;
+        }
+        line = next + 1;
+    }
+
+    return found_count;
+}
+
+int procfs_parse_stat_fields(const char *after_comm, const procfs_stat_field_t *fields,
+                             int field_count, void *out) {
+    if (!after_comm || !fields || !out || field_count <= 0) {
+        return 0;
+    }
+
+    /* The text after ')' starts with field 3 (state) */
+    const char *p = after_comm;
+    int index = 3;
+    int next = 0;
+
+    while (*p && next < field_count) {
+        while (*p == ' ') {
+            p++;
+        }
+        if (!*p || *p == '\n') {
+            break;
+        }
+
+        if (fields[next].index == index) {
+            int negative = (*p == '-');
+            if (negative) {
+                p++;
+            }
+            uint64_t value = procfs_parse_u64(&p);
+            if (negative) {
+                value = (uint64_t)-(int64_t)value;
+            }
+
+            char *dest = (char *)out + fields[next].offset;
+            if (fields[next].size == sizeof(uint64_t)) {
+                *(uint64_t *)dest = value;
+            } else {
+                *(uint32_t *)dest = (uint32_t)value;
+            }
+            next++;
+        }
+
+        /* Skip the rest of the field */
+        while (*p && *p != ' ' && *p != '\n') {
+            p++;
+        }
+        index++;
+    }
+
+    return next;
+}
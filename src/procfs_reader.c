@@ -0,0 +1,494 @@
+#include "../include/procfs.h"
+#include "../include/fd_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+
+#define PROCFS_INITIAL_CAPACITY 64
+#define GETDENTS_BUFFER_SIZE 65536
+
+/* Last schedstat reading of one thread */
+typedef struct {
+    pid_t tid;
+    procfs_schedstat_t counters;
+} thread_schedstat_t;
+
+/* Cached descriptors for one process */
+typedef struct {
+    fd_cache_entry_t entry;      /* last_used drives eviction at the descriptor limit */
+    pid_t pid;
+    int fds[PROCFS_FILE_COUNT];
+    thread_schedstat_t *threads; /* Per-thread schedstat, sorted by TID; NULL until summed */
+    int thread_count;
+    int thread_capacity;
+    procfs_schedstat_t exited;   /* Last readings of threads that have exited */
+} procfs_handle_t;
+
+static const char *procfs_file_names[PROCFS_FILE_COUNT] = {
+    "stat", "status", "io", "schedstat", "smaps_rollup", "fd", "task"
+};
+
+/* One table per thread so collectors need no locking */
+static _Thread_local fd_cache_t cache = FD_CACHE_INIT(procfs_handle_t, PROCFS_INITIAL_CAPACITY);
+static _Thread_local int pinned = 0;          /* Handles used since pin_mark are not evicted */
+static _Thread_local uint32_t pin_mark = 0;
+static _Thread_local pid_t *tid_list = NULL;           /* Scratch for procfs_read_schedstat */
+static _Thread_local int tid_capacity = 0;
+static _Thread_local thread_schedstat_t *thread_scratch = NULL;
+static _Thread_local int scratch_capacity = 0;
+
+static uint32_t hash_pid(pid_t pid) {
+    /* Knuth multiplicative hash */
+    return (uint32_t)pid * 2654435761u;
+}
+
+static int match_pid(const void *entry, const void *key) {
+    return ((const procfs_handle_t *)entry)->pid == *(const pid_t *)key;
+}
+
+static void close_handle(void *entry) {
+    procfs_handle_t *handle = entry;
+    for (int i = 0; i < PROCFS_FILE_COUNT; i++) {
+        if (handle->fds[i] >= 0) {
+            close(handle->fds[i]);
+            handle->fds[i] = -1;
+        }
+    }
+    free(handle->threads);
+    handle->threads = NULL;
+}
+
+static procfs_handle_t *find_handle(pid_t pid) {
+    return fd_cache_find(&cache, hash_pid(pid), match_pid, &pid);
+}
+
+static procfs_handle_t *insert_handle(pid_t pid) {
+    procfs_handle_t *handle = fd_cache_insert(&cache, hash_pid(pid));
+    if (!handle) {
+        return NULL;
+    }
+    handle->pid = pid;
+    for (int i = 0; i < PROCFS_FILE_COUNT; i++) {
+        handle->fds[i] = -1;
+    }
+    return handle;
+}
+
+static void remove_handle(procfs_handle_t *handle) {
+    fd_cache_remove(&cache, handle, close_handle);
+}
+
+int procfs_init(void) {
+    /* Several descriptors per PID quickly exceed the default soft limit */
+    fd_cache_raise_limit();
+    return 0;
+}
+
+void procfs_cleanup(void) {
+    fd_cache_clear(&cache, close_handle);
+
+    free(tid_list);
+    tid_list = NULL;
+    tid_capacity = 0;
+    free(thread_scratch);
+    thread_scratch = NULL;
+    scratch_capacity = 0;
+}
+
+int procfs_is_gone_error(int err) {
+    return err == ESRCH || err == ENOENT;
+}
+
+/* Close the least recently used half of the calling thread's handles,
+ * sparing keep and the handles pinned for a batch. Returns the number of
+ * handles dropped. */
+static int evict_lru(pid_t keep) {
+    uint32_t min_age = pinned ? cache.use_clock - pin_mark : 0;
+    return fd_cache_evict_lru(&cache, match_pid, &keep, min_age, close_handle);
+}
+
+/* Open one file of a cached process; at the descriptor limit the oldest
+ * handles are closed and the open retried. *handlep is updated since
+ * eviction moves table entries. */
+static int open_file(procfs_handle_t **handlep, procfs_file_t file) {
+    pid_t pid = (*handlep)->pid;
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/%s", pid, procfs_file_names[file]);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && (errno == EMFILE || errno == ENFILE) && evict_lru(pid) > 0) {
+        *handlep = find_handle(pid);
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+    }
+
+    procfs_handle_t *handle = *handlep;
+    if (fd < 0) {
+        int saved_errno = errno;
+        if (procfs_is_gone_error(saved_errno)) {
+            remove_handle(handle);
+        }
+        errno = saved_errno;
+        return -1;
+    }
+    handle->fds[file] = fd;
+    return 0;
+}
+
+static procfs_handle_t *get_handle(pid_t pid) {
+    procfs_handle_t *handle = find_handle(pid);
+    if (!handle) {
+        handle = insert_handle(pid);
+        if (!handle) {
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+    fd_cache_touch(&cache, handle);
+    return handle;
+}
+
+int procfs_open_files(pid_t pid, unsigned int files) {
+    if (pid <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    procfs_handle_t *handle = get_handle(pid);
+    if (!handle) {
+        return -1;
+    }
+
+    for (int i = 0; i < PROCFS_FILE_COUNT; i++) {
+        if (!(files & (1u << i)) || handle->fds[i] >= 0) {
+            continue;
+        }
+        if (open_file(&handle, (procfs_file_t)i) != 0) {
+            if ((i == PROCFS_IO || i == PROCFS_SCHEDSTAT) && !procfs_is_gone_error(errno)) {
+                continue;
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+ssize_t procfs_read(pid_t pid, procfs_file_t file, char *buffer, size_t size) {
+    if (pid <= 0 || file < 0 || file >= PROCFS_FILE_COUNT || !buffer || size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    procfs_handle_t *handle = get_handle(pid);
+    if (!handle) {
+        return -1;
+    }
+
+    if (handle->fds[file] < 0 && open_file(&handle, file) != 0) {
+        return -1;
+    }
+
+    ssize_t bytes_read = pread(handle->fds[file], buffer, size - 1, 0);
+    if (bytes_read < 0) {
+        int saved_errno = errno;
+        /* A cached descriptor of an exited task keeps failing with ESRCH */
+        if (procfs_is_gone_error(saved_errno)) {
+            remove_handle(handle);
+        }
+        errno = saved_errno;
+        return -1;
+    }
+
+    buffer[bytes_read] = '\0';
+    return bytes_read;
+}
+
+int procfs_get_fd(pid_t pid, procfs_file_t file) {
+    if (pid <= 0 || file < 0 || file >= PROCFS_FILE_COUNT) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    procfs_handle_t *handle = get_handle(pid);
+    if (!handle) {
+        return -1;
+    }
+    if (handle->fds[file] < 0 && open_file(&handle, file) != 0) {
+        return -1;
+    }
+    return handle->fds[file];
+}
+
+void procfs_pin_handles(void) {
+    pinned = 1;
+    pin_mark = cache.use_clock;
+}
+
+void procfs_unpin_handles(void) {
+    pinned = 0;
+}
+
+void procfs_forget(pid_t pid) {
+    procfs_handle_t *handle = find_handle(pid);
+    if (handle) {
+        remove_handle(handle);
+    }
+}
+
+int procfs_cached_count(void) {
+    return (int)cache.count;
+}
+
+int procfs_count_fds(pid_t pid) {
+    if (pid <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    procfs_handle_t *handle = get_handle(pid);
+    if (!handle) {
+        return -1;
+    }
+    if (handle->fds[PROCFS_FD_DIR] < 0 && open_file(&handle, PROCFS_FD_DIR) != 0) {
+        return -1;
+    }
+
+    int dirfd = handle->fds[PROCFS_FD_DIR];
+    if (lseek(dirfd, 0, SEEK_SET) < 0) {
+        return -1;
+    }
+
+    char buffer[GETDENTS_BUFFER_SIZE] __attribute__((aligned(8)));
+    int count = 0;
+
+    for (;;) {
+        long len = syscall(SYS_getdents64, dirfd, buffer, sizeof(buffer));
+        if (len < 0) {
+            int saved_errno = errno;
+            if (procfs_is_gone_error(saved_errno)) {
+                remove_handle(handle);
+            }
+            errno = saved_errno;
+            return -1;
+        }
+        if (len == 0) {
+            break;
+        }
+
+        for (long offset = 0; offset < len; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buffer + offset);
+            offset += d->d_reclen;
+            if (d->d_name[0] != '.') {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+static int compare_tid(const void *a, const void *b) {
+    pid_t x = *(const pid_t *)a, y = *(const pid_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void add_schedstat(procfs_schedstat_t *sum, const procfs_schedstat_t *value) {
+    sum->cpu_time_ns += value->cpu_time_ns;
+    sum->cpu_delay_ns += value->cpu_delay_ns;
+    sum->timeslices += value->timeslices;
+}
+
+/* Read task/[tid]/schedstat relative to the cached task directory
+ * Returns 0, 1 if the thread is gone, -1 on other errors */
+static int read_thread_schedstat(procfs_handle_t **handlep, pid_t tid, procfs_schedstat_t *out) {
+    char path[32];
+    snprintf(path, sizeof(path), "%d/schedstat", tid);
+
+    pid_t pid = (*handlep)->pid;
+    int fd = openat((*handlep)->fds[PROCFS_TASK_DIR], path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && (errno == EMFILE || errno == ENFILE) && evict_lru(pid) > 0) {
+        *handlep = find_handle(pid);
+        fd = openat((*handlep)->fds[PROCFS_TASK_DIR], path, O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        return procfs_is_gone_error(errno) ? 1 : -1;
+    }
+
+    char buffer[128];
+    ssize_t len = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    int saved_errno = errno;
+    close(fd);
+    if (len < 0) {
+        errno = saved_errno;
+        return procfs_is_gone_error(errno) ? 1 : -1;
+    }
+    buffer[len] = '\0';
+    if (procfs_parse_schedstat(buffer, out) != 0) {
+        errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+int procfs_read_schedstat(pid_t pid, long threads, procfs_schedstat_t *out) {
+    if (pid <= 0 || !out) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    procfs_handle_t *handle = get_handle(pid);
+    if (!handle) {
+        return -1;
+    }
+    memset(out, 0, sizeof(procfs_schedstat_t));
+
+    /* The leader's own file covers a process that never had more threads */
+    if (threads == 1 && !handle->threads) {
+        char buffer[128];
+        if (procfs_read(pid, PROCFS_SCHEDSTAT, buffer, sizeof(buffer)) < 0) {
+            return -1;
+        }
+        if (procfs_parse_schedstat(buffer, out) != 0) {
+            errno = EPROTO;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (handle->fds[PROCFS_TASK_DIR] < 0 && open_file(&handle, PROCFS_TASK_DIR) != 0) {
+        return -1;
+    }
+    int count = procfs_list_pids(handle->fds[PROCFS_TASK_DIR], &tid_list, &tid_capacity);
+    if (count <= 0) {
+        int saved_errno = (count == 0) ? ESRCH : errno;
+        if (procfs_is_gone_error(saved_errno)) {
+            remove_handle(handle);
+        }
+        errno = saved_errno;
+        return -1;
+    }
+    qsort(tid_list, count, sizeof(pid_t), compare_tid);
+
+    if (count > scratch_capacity) {
+        thread_schedstat_t *grown = realloc(thread_scratch, count * sizeof(thread_schedstat_t));
+        if (!grown) {
+            errno = ENOMEM;
+            return -1;
+        }
+        thread_scratch = grown;
+        scratch_capacity = count;
+    }
+
+    int live = 0;
+    for (int i = 0; i < count; i++) {
+        thread_schedstat_t *thread = &thread_scratch[live];
+        int ret = read_thread_schedstat(&handle, tid_list[i], &thread->counters);
+        if (ret < 0) {
+            /* Skipping a live thread would count it again as a new one later */
+            return -1;
+        }
+        if (ret == 0) {
+            thread->tid = tid_list[i];
+            live++;
+        }
+    }
+    if (live == 0) {
+        remove_handle(handle);
+        errno = ESRCH;
+        return -1;
+    }
+
+    if (live > handle->thread_capacity) {
+        thread_schedstat_t *grown = realloc(handle->threads, live * sizeof(thread_schedstat_t));
+        if (!grown) {
+            errno = ENOMEM;
+            return -1;
+        }
+        handle->threads = grown;
+        handle->thread_capacity = live;
+    }
+
+    /* Both lists are sorted: a thread missing from the new one has exited,
+     * and a lower runtime under the same TID is a new thread */
+    int j = 0;
+    for (int i = 0; i < handle->thread_count; i++) {
+        const thread_schedstat_t *old = &handle->threads[i];
+        while (j < live && thread_scratch[j].tid < old->tid) {
+            j++;
+        }
+        if (j >= live || thread_scratch[j].tid != old->tid ||
+            thread_scratch[j].counters.cpu_time_ns < old->counters.cpu_time_ns) {
+            add_schedstat(&handle->exited, &old->counters);
+        }
+    }
+
+    memcpy(handle->threads, thread_scratch, live * sizeof(thread_schedstat_t));
+    handle->thread_count = live;
+
+    *out = handle->exited;
+    for (int i = 0; i < live; i++) {
+        add_schedstat(out, &handle->threads[i].counters);
+    }
+    return 0;
+}
+
+int procfs_list_pids(int dirfd, pid_t **pids, int *capacity) {
+    if (dirfd < 0 || !pids || !capacity) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Rewind the cached descriptor instead of reopening the directory */
+    if (lseek(dirfd, 0, SEEK_SET) < 0) {
+        return -1;
+    }
+
+    char buffer[GETDENTS_BUFFER_SIZE] __attribute__((aligned(8)));
+    int count = 0;
+
+    for (;;) {
+        long len = syscall(SYS_getdents64, dirfd, buffer, sizeof(buffer));
+        if (len < 0) {
+            return -1;
+        }
+        if (len == 0) {
+            break;
+        }
+
+        for (long offset = 0; offset < len; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buffer + offset);
+            offset += d->d_reclen;
+
+            /* PID and TID directories are all digits; everything else starts otherwise */
+            if (d->d_type != DT_DIR || d->d_name[0] < '1' || d->d_name[0] > '9') {
+                continue;
+            }
+            const char *p = d->d_name;
+            pid_t pid = 0;
+            while ((unsigned)(*p - '0') < 10) {
+                pid = pid * 10 + (*p++ - '0');
+            }
+            if (*p != '\0') {
+                continue;
+            }
+
+            if (count == *capacity) {
+                int new_capacity = *capacity ? *capacity * 2 : 1024;
+                pid_t *grown = realloc(*pids, new_capacity * sizeof(pid_t));
+                if (!grown) {
+                    errno = ENOMEM;
+                    return -1;
+                }
+                *pids = grown;
+                *capacity = new_capacity;
+            }
+            (*pids)[count++] = pid;
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,377 @@
+#include "../include/procfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/* Files a batched snapshot reads through the ring, in parse order */
+static const procfs_file_t batch_files[] = { PROCFS_STAT, PROCFS_STATUS, PROCFS_IO };
+#define BATCH_FILE_COUNT ((int)(sizeof(batch_files) / sizeof(batch_files[0])))
+
+/* Submission and completion rings mapped from the kernel (no liburing) */
+typedef struct {
+    int fd;
+    unsigned int entries;
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned int *sq_tail;
+    unsigned int sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int cq_mask;
+    struct io_uring_cqe *cqes;
+    char *buffers;               /* entries * PROCFS_BUFFER_SIZE */
+    int registered;              /* buffers registered: IORING_OP_READ_FIXED */
+    int32_t results[PROCFS_URING_ENTRIES];
+} uring_t;
+
+static procfs_io_mode_t io_mode = PROCFS_IO_PREAD;
+
+/* One ring per thread, like the handle cache; -1 fd = not set up,
+ * setup_failed = do not retry in this thread */
+static _Thread_local uring_t ring = { .fd = -1 };
+static _Thread_local int setup_failed = 0;
+
+static int uring_setup(unsigned int entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+                       unsigned int flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned int opcode, const void *arg, unsigned int nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+void procfs_uring_cleanup(void) {
+    if (ring.fd < 0) {
+        return;
+    }
+    if (ring.sqes) munmap(ring.sqes, ring.sqes_size);
+    if (ring.cq_ptr && ring.cq_ptr != ring.sq_ptr) munmap(ring.cq_ptr, ring.cq_size);
+    if (ring.sq_ptr) munmap(ring.sq_ptr, ring.sq_size);
+    close(ring.fd);
+    free(ring.buffers);
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+}
+
+/* Map the rings and the SQE array of a ring set up by io_uring_setup() */
+static int ring_map(const struct io_uring_params *params) {
+    ring.sq_size = params->sq_off.array + params->sq_entries * sizeof(unsigned int);
+    ring.cq_size = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    int single_mmap = (params->features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && ring.cq_size > ring.sq_size) {
+        ring.sq_size = ring.cq_size;
+    }
+
+    void *ptr = mmap(NULL, ring.sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring.fd, IORING_OFF_SQ_RING);
+    if (ptr == MAP_FAILED) {
+        return -1;
+    }
+    ring.sq_ptr = ptr;
+
+    if (single_mmap) {
+        ring.cq_ptr = ring.sq_ptr;
+    } else {
+        ptr = mmap(NULL, ring.cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring.fd, IORING_OFF_CQ_RING);
+        if (ptr == MAP_FAILED) {
+            return -1;
+        }
+        ring.cq_ptr = ptr;
+    }
+
+    ring.sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+    ptr = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               ring.fd, IORING_OFF_SQES);
+    if (ptr == MAP_FAILED) {
+        return -1;
+    }
+    ring.sqes = ptr;
+
+    char *sq = ring.sq_ptr;
+    char *cq = ring.cq_ptr;
+    ring.sq_tail = (unsigned int *)(sq + params->sq_off.tail);
+    ring.sq_mask = *(unsigned int *)(sq + params->sq_off.ring_mask);
+    ring.sq_array = (unsigned int *)(sq + params->sq_off.array);
+    ring.cq_head = (unsigned int *)(cq + params->cq_off.head);
+    ring.cq_tail = (unsigned int *)(cq + params->cq_off.tail);
+    ring.cq_mask = *(unsigned int *)(cq + params->cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(cq + params->cq_off.cqes);
+    return 0;
+}
+
+static int ring_init(void) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = uring_setup(PROCFS_URING_ENTRIES, &params);
+    if (ring.fd < 0) {
+        int saved_errno = errno;
+        ring.fd = -1;
+        errno = saved_errno;
+        return -1;
+    }
+    ring.entries = params.sq_entries < PROCFS_URING_ENTRIES ? params.sq_entries
+                                                            : PROCFS_URING_ENTRIES;
+
+    if (ring_map(&params) == 0) {
+        ring.buffers = aligned_alloc(4096, (size_t)ring.entries * PROCFS_BUFFER_SIZE);
+        if (!ring.buffers) {
+            errno = ENOMEM;
+        }
+    }
+    if (!ring.buffers) {
+        int saved_errno = errno;
+        procfs_uring_cleanup();
+        errno = saved_errno;
+        return -1;
+    }
+
+    /* Registered buffers skip the per-read page pinning; without them
+     * (RLIMIT_MEMLOCK) plain IORING_OP_READ into the same memory works */
+    struct iovec iov = { ring.buffers, (size_t)ring.entries * PROCFS_BUFFER_SIZE };
+    ring.registered = (uring_register(ring.fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0);
+    return 0;
+}
+
+int proc_snapshot_set_io_mode(procfs_io_mode_t mode) {
+    if (mode == PROCFS_IO_URING) {
+        /* Probe only: each thread sets up its own ring on first batch */
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int fd = uring_setup(1, &params);
+        if (fd < 0) {
+            return -1;
+        }
+        close(fd);
+    }
+    io_mode = mode;
+    return 0;
+}
+
+procfs_io_mode_t proc_snapshot_get_io_mode(void) {
+    return io_mode;
+}
+
+/* Submit count prepared reads and wait for all of their completions */
+static int ring_submit_and_wait(unsigned int count) {
+    __atomic_store_n(ring.sq_tail, *ring.sq_tail + count, __ATOMIC_RELEASE);
+
+    unsigned int submitted = 0;
+    unsigned int reaped = 0;
+    while (reaped < count) {
+        unsigned int to_submit = count - submitted;
+        int ret = uring_enter(ring.fd, to_submit, 1, IORING_ENTER_GETEVENTS);
+        if (ret < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            return -1;
+        }
+        submitted += (unsigned int)ret;
+
+        unsigned int head = *ring.cq_head;
+        unsigned int tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const struct io_uring_cqe *cqe = &ring.cqes[head & ring.cq_mask];
+            if (cqe->user_data < ring.entries) {
+                ring.results[cqe->user_data] = cqe->res;
+            }
+            head++;
+            reaped++;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+static void prepare_read(unsigned int slot, int fd) {
+    unsigned int tail = *ring.sq_tail + slot;
+    unsigned int index = tail & ring.sq_mask;
+    struct io_uring_sqe *sqe = &ring.sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = ring.registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = 0;
+    sqe->addr = (uint64_t)(uintptr_t)(ring.buffers + (size_t)slot * PROCFS_BUFFER_SIZE);
+    sqe->len = PROCFS_BUFFER_SIZE - 1;
+    sqe->buf_index = 0;
+    sqe->user_data = slot;
+    ring.sq_array[index] = index;
+}
+
+/* Parse the completed reads of one process, mirroring proc_snapshot_take() */
+static int finish_snapshot(pid_t pid, unsigned int files, const unsigned int *slots,
+                           proc_snapshot_t *snap) {
+    for (int f = 0; f < BATCH_FILE_COUNT; f++) {
+        procfs_file_t file = batch_files[f];
+        if (!(files & (1u << file))) {
+            continue;
+        }
+
+        if (slots[f] == ~0u) {
+            continue;            /* io not openable, io_errno already set */
+        }
+        int32_t res = ring.results[slots[f]];
+        char *buffer = ring.buffers + (size_t)slots[f] * PROCFS_BUFFER_SIZE;
+        if (res < 0) {
+            if (procfs_is_gone_error(-res)) {
+                procfs_forget(pid);
+            }
+            if (file == PROCFS_IO && !procfs_is_gone_error(-res)) {
+                snap->io_errno = -res;
+                continue;
+            }
+            errno = -res;
+            return -1;
+        }
+        buffer[res] = '\0';
+
+        if (file == PROCFS_STAT) {
+            if (proc_snapshot_parse_stat(buffer, snap) != 0) {
+                errno = EPROTO;
+                return -1;
+            }
+            snap->files |= PROCFS_SNAP_STAT;
+
+            /* schedstat depends on num_threads: read synchronously */
+            if ((files & PROCFS_SNAP_SCHEDSTAT) && proc_snapshot_read_schedstat(pid, snap) != 0) {
+                return -1;
+            }
+        } else if (file == PROCFS_STATUS) {
+            proc_snapshot_parse_status(buffer, snap);
+            snap->files |= PROCFS_SNAP_STATUS;
+        } else {
+            proc_snapshot_parse_io(buffer, snap);
+            snap->files |= PROCFS_SNAP_IO;
+        }
+    }
+    return 0;
+}
+
+int proc_snapshot_take_batch(const pid_t *pids, int count, unsigned int files,
+                             proc_snapshot_t *snaps, int *errors) {
+    if (!pids || !snaps || !errors || count < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int use_ring = (io_mode == PROCFS_IO_URING) && !(files & PROCFS_SNAP_TASKSTATS);
+    if (use_ring && ring.fd < 0 && (setup_failed || ring_init() != 0)) {
+        setup_failed = 1;
+        use_ring = 0;
+    }
+
+    int taken = 0;
+    if (!use_ring) {
+        for (int i = 0; i < count; i++) {
+            errors[i] = (proc_snapshot_take(pids[i], files, &snaps[i]) == 0) ? 0 : errno;
+            taken += (errors[i] == 0);
+        }
+        return taken;
+    }
+
+    int reads_per_pid = 0;
+    for (int f = 0; f < BATCH_FILE_COUNT; f++) {
+        if (files & (1u << batch_files[f])) {
+            reads_per_pid++;
+        }
+    }
+    if (reads_per_pid == 0) {
+        for (int i = 0; i < count; i++) {
+            memset(&snaps[i], 0, sizeof(proc_snapshot_t));
+            snaps[i].pid = pids[i];
+            clock_gettime(CLOCK_MONOTONIC, &snaps[i].timestamp);
+            errors[i] = 0;
+        }
+        return count;
+    }
+    int pids_per_batch = (int)ring.entries / reads_per_pid;
+
+    unsigned int slots[PROCFS_URING_ENTRIES][BATCH_FILE_COUNT];
+    for (int start = 0; start < count; start += pids_per_batch) {
+        int end = start + pids_per_batch < count ? start + pids_per_batch : count;
+        unsigned int used = 0;
+
+        /* Queued descriptors must stay open until their reads complete */
+        procfs_pin_handles();
+
+        for (int i = start; i < end; i++) {
+            proc_snapshot_t *snap = &snaps[i];
+            memset(snap, 0, sizeof(proc_snapshot_t));
+            snap->pid = pids[i];
+            errors[i] = 0;
+
+            for (int f = 0; f < BATCH_FILE_COUNT; f++) {
+                slots[i - start][f] = ~0u;
+                procfs_file_t file = batch_files[f];
+                if (!(files & (1u << file)) || errors[i]) {
+                    continue;
+                }
+                int fd = procfs_get_fd(pids[i], file);
+                if (fd < 0) {
+                    /* io is optional unless the process is gone */
+                    if (file != PROCFS_IO || procfs_is_gone_error(errno)) {
+                        errors[i] = errno;
+                    } else {
+                        snap->io_errno = errno;
+                    }
+                    continue;
+                }
+                slots[i - start][f] = used;
+                prepare_read(used++, fd);
+            }
+        }
+
+        if (used > 0 && ring_submit_and_wait(used) != 0) {
+            /* Ring broken mid-batch: finish this thread on pread */
+            int saved_errno = errno;
+            procfs_unpin_handles();
+            procfs_uring_cleanup();
+            setup_failed = 1;
+            fprintf(stderr, "io_uring submission failed (%s), using pread\n", strerror(saved_errno));
+            for (int i = start; i < count; i++) {
+                errors[i] = (proc_snapshot_take(pids[i], files, &snaps[i]) == 0) ? 0 : errno;
+                taken += (errors[i] == 0);
+            }
+            return taken;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for (int i = start; i < end; i++) {
+            if (errors[i] == 0 && finish_snapshot(pids[i], files, slots[i - start], &snaps[i]) != 0) {
+                errors[i] = errno;
+            }
+            snaps[i].timestamp = now;
+        }
+        procfs_unpin_handles();
+
+        /* At the descriptor limit the batch's own handles are pinned;
+         * those PIDs are read one by one, which may evict older handles */
+        for (int i = start; i < end; i++) {
+            if (errors[i] == EMFILE || errors[i] == ENFILE) {
+                errors[i] = (proc_snapshot_take(pids[i], files, &snaps[i]) == 0) ? 0 : errno;
+            }
+            taken += (errors[i] == 0);
+        }
+    }
+    return taken;
+}
@@ -0,0 +1,101 @@
+#include "../include/scheduler.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#define NSEC_PER_SEC 1000000000LL
+
+static int64_t timespec_to_ns(const struct timespec *ts) {
+    return (int64_t)ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static struct timespec ns_to_timespec(int64_t ns) {
+    struct timespec ts = { ns / NSEC_PER_SEC, ns % NSEC_PER_SEC };
+    return ts;
+}
+
+int scheduler_init(sample_scheduler_t *sched, double interval) {
+    if (!sched || interval < SCHEDULER_MIN_INTERVAL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(sched, 0, sizeof(sample_scheduler_t));
+    /* Rounded to whole microseconds so "-i 0.1" is exactly 100 ms */
+    sched->interval_ns = (uint64_t)(interval * 1e6 + 0.5) * 1000;
+    clock_gettime(CLOCK_MONOTONIC, &sched->start);
+    sched->grid = sched->start;
+    sched->deadline = sched->start;
+    sched->last_tick = sched->start;
+    return 0;
+}
+
+int scheduler_next(sample_scheduler_t *sched) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    /* Deadlines come from the slot count, never from adding to the
+     * previous deadline, so rounding cannot accumulate either */
+    int64_t start = timespec_to_ns(&sched->grid);
+    int64_t now_ns = timespec_to_ns(&now);
+    int skipped = 0;
+
+    sched->slots++;
+    while (start + (int64_t)(sched->slots * sched->interval_ns) <= now_ns) {
+        sched->slots++;
+        skipped++;
+    }
+    sched->missed += skipped;
+    sched->deadline = ns_to_timespec(start + (int64_t)(sched->slots * sched->interval_ns));
+    return skipped;
+}
+
+int scheduler_set_interval(sample_scheduler_t *sched, double interval) {
+    if (!sched || interval < SCHEDULER_MIN_INTERVAL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t interval_ns = (uint64_t)(interval * 1e6 + 0.5) * 1000;
+    if (interval_ns == sched->interval_ns) {
+        return 0;
+    }
+    sched->interval_ns = interval_ns;
+    sched->grid = sched->deadline;
+    sched->slots = 0;
+    sched->retunes++;
+    return 0;
+}
+
+void scheduler_tick(sample_scheduler_t *sched) {
+    clock_gettime(CLOCK_MONOTONIC, &sched->last_tick);
+
+    sched->jitter_ns = timespec_to_ns(&sched->last_tick) - timespec_to_ns(&sched->deadline);
+    int64_t magnitude = sched->jitter_ns < 0 ? -sched->jitter_ns : sched->jitter_ns;
+    if (magnitude > sched->max_jitter_ns) {
+        sched->max_jitter_ns = magnitude;
+    }
+    sched->jitter_sum_ns += magnitude;
+    sched->ticks++;
+}
+
+double scheduler_elapsed(const sample_scheduler_t *sched) {
+    return (timespec_to_ns(&sched->deadline) - timespec_to_ns(&sched->start)) / 1e9;
+}
+
+void print_scheduler_stats(const sample_scheduler_t *sched) {
+    if (!sched || sched->ticks == 0) {
+        return;
+    }
+
+    if (sched->retunes > 0) {
+        printf("Sampling: %lu ticks, mean interval %.3f ms (%lu changes, now %.3f ms), ",
+               sched->ticks, scheduler_elapsed(sched) * 1e3 / sched->ticks,
+               sched->retunes, sched->interval_ns / 1e6);
+    } else {
+        printf("Sampling: %lu ticks every %.3f ms, ", sched->ticks, sched->interval_ns / 1e6);
+    }
+    printf("jitter mean %.3f ms, max %.3f ms, %lu missed deadline(s)\n",
+           sched->jitter_sum_ns / sched->ticks / 1e6, sched->max_jitter_ns / 1e6,
+           sched->missed);
+}
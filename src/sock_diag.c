@@ -0,0 +1,300 @@
+#include "../include/sock_diag.h"
+#include "../include/procfs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+
+#define SOCK_DIAG_BUFFER_SIZE 32768
+#define OWNER_CACHE_SIZE 16
+
+static const char *tcp_state_names[SOCK_DIAG_TCP_STATES] = {
+    "UNKNOWN", "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2",
+    "TIME_WAIT", "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING", "NEW_SYN_RECV"
+};
+
+static uint32_t diag_seq = 0;
+
+/* Last owner found per listener inode; pid -1 remembers a failed search */
+typedef struct {
+    uint32_t inode;              /* 0 marks a free entry */
+    pid_t pid;
+} owner_entry_t;
+
+static _Thread_local owner_entry_t owner_cache[OWNER_CACHE_SIZE];
+static _Thread_local int owner_next = 0;
+
+/* Namespace to enter and the result of the helper thread */
+typedef struct {
+    int target;
+    int fd;
+    int error;
+} netns_socket_t;
+
+const char *sock_diag_state_name(int state) {
+    if (state < 0 || state >= SOCK_DIAG_TCP_STATES) {
+        return "UNKNOWN";
+    }
+    return tcp_state_names[state];
+}
+
+static int open_socket(void) {
+    return socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+}
+
+static void *open_in_namespace(void *arg) {
+    netns_socket_t *request = arg;
+    /* A socket belongs to the namespace it was created in */
+    if (setns(request->target, CLONE_NEWNET) != 0) {
+        request->error = errno;
+        return NULL;
+    }
+    request->fd = open_socket();
+    if (request->fd < 0) {
+        request->error = errno;
+    }
+    return NULL;
+}
+
+int sock_diag_open(pid_t pid) {
+    if (pid <= 0) {
+        return open_socket();
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/ns/net", pid);
+    int target = open(path, O_RDONLY | O_CLOEXEC);
+    if (target < 0) {
+        return -1;
+    }
+    int self = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+    if (self < 0) {
+        int saved_errno = errno;
+        close(target);
+        errno = saved_errno;
+        return -1;
+    }
+
+    struct stat target_st, self_st;
+    int fd = -1;
+    if (fstat(target, &target_st) == 0 && fstat(self, &self_st) == 0 &&
+        target_st.st_ino == self_st.st_ino && target_st.st_dev == self_st.st_dev) {
+        fd = open_socket();
+    } else {
+        /* setns() changes only the calling thread, so a helper thread
+         * enters the namespace and exits with it */
+        netns_socket_t request = { .target = target, .fd = -1, .error = 0 };
+        pthread_t helper;
+        int err = pthread_create(&helper, NULL, open_in_namespace, &request);
+        if (err == 0) {
+            pthread_join(helper, NULL);
+            err = request.error;
+        }
+        fd = request.fd;
+        errno = err;
+    }
+
+    int saved_errno = errno;
+    close(target);
+    close(self);
+    errno = saved_errno;
+    return fd;
+}
+
+static void count_message(const struct inet_diag_msg *msg, uint8_t protocol,
+                          sock_counts_t *counts) {
+    if (protocol == IPPROTO_UDP) {
+        counts->udp_sockets++;
+        return;
+    }
+
+    if (msg->idiag_state < SOCK_DIAG_TCP_STATES) {
+        counts->tcp_states[msg->idiag_state]++;
+    }
+
+    /* For listeners rqueue is the accept queue and wqueue its backlog;
+     * the kernel drops SYNs once the queue exceeds the backlog */
+    if (msg->idiag_state == SOCK_TCP_LISTEN && msg->idiag_rqueue > msg->idiag_wqueue) {
+        counts->listen_full++;
+        if (counts->full_count < SOCK_DIAG_MAX_FULL_LISTENERS) {
+            sock_listener_t *listener = &counts->full[counts->full_count++];
+            listener->port = ntohs(msg->id.idiag_sport);
+            listener->inode = msg->idiag_inode;
+            listener->queued = msg->idiag_rqueue;
+            listener->backlog = msg->idiag_wqueue;
+        }
+    }
+}
+
+/* Dump every socket of one family/protocol pair and count it */
+static int dump(int fd, uint8_t family, uint8_t protocol, char *buffer, sock_counts_t *counts) {
+    struct {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 req;
+    } request;
+    memset(&request, 0, sizeof(request));
+    request.nlh.nlmsg_len = sizeof(request);
+    request.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.nlh.nlmsg_seq = ++diag_seq;
+    request.req.sdiag_family = family;
+    request.req.sdiag_protocol = protocol;
+    request.req.idiag_states = ~0u;
+
+    struct sockaddr_nl kernel = { .nl_family = AF_NETLINK };
+    if (sendto(fd, &request, sizeof(request), 0,
+               (struct sockaddr *)&kernel, sizeof(kernel)) < 0) {
+        return -1;
+    }
+
+    for (;;) {
+        ssize_t len = recv(fd, buffer, SOCK_DIAG_BUFFER_SIZE, 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buffer; NLMSG_OK(nlh, (size_t)len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            /* Skip stale replies left behind by an interrupted dump */
+            if (nlh->nlmsg_seq != diag_seq) {
+                continue;
+            }
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                return 0;
+            }
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr *err = NLMSG_DATA(nlh);
+                /* No IPv6 (or no UDP diag module): nothing to count */
+                if (err->error == -ENOENT || err->error == -EAFNOSUPPORT) {
+                    return 0;
+                }
+                errno = err->error ? -err->error : EPROTO;
+                return -1;
+            }
+            if (nlh->nlmsg_type == SOCK_DIAG_BY_FAMILY &&
+                nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(struct inet_diag_msg))) {
+                count_message(NLMSG_DATA(nlh), protocol, counts);
+            }
+        }
+    }
+}
+
+int sock_diag_count(int fd, sock_counts_t *counts) {
+    if (fd < 0 || !counts) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    char *buffer = malloc(SOCK_DIAG_BUFFER_SIZE);
+    if (!buffer) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memset(counts, 0, sizeof(sock_counts_t));
+    static const struct { uint8_t family, protocol; } dumps[] = {
+        { AF_INET, IPPROTO_TCP }, { AF_INET6, IPPROTO_TCP },
+        { AF_INET, IPPROTO_UDP }, { AF_INET6, IPPROTO_UDP },
+    };
+    int status = 0;
+    for (size_t i = 0; i < sizeof(dumps) / sizeof(dumps[0]) && status == 0; i++) {
+        status = dump(fd, dumps[i].family, dumps[i].protocol, buffer, counts);
+    }
+
+    int saved_errno = errno;
+    free(buffer);
+    errno = saved_errno;
+    return status;
+}
+
+/* Returns 1 if one of pid's descriptors is socket:[inode] */
+static int holds_socket(pid_t pid, const char *target) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd", pid);
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return 0;
+    }
+
+    int found = 0;
+    struct dirent *entry;
+    while (!found && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char link[64];
+        ssize_t n = readlinkat(dirfd(dir), entry->d_name, link, sizeof(link) - 1);
+        if (n > 0) {
+            link[n] = '\0';
+            found = (strcmp(link, target) == 0);
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+/* Full search of every process's descriptors */
+static pid_t search_owner(const char *target, pid_t skip) {
+    int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_fd < 0) {
+        return -1;
+    }
+    pid_t *pids = NULL;
+    int capacity = 0;
+    int count = procfs_list_pids(proc_fd, &pids, &capacity);
+    close(proc_fd);
+
+    pid_t owner = -1;
+    for (int i = 0; i < count && owner < 0; i++) {
+        if (pids[i] != skip && holds_socket(pids[i], target)) {
+            owner = pids[i];
+        }
+    }
+    free(pids);
+    return owner;
+}
+
+pid_t sock_diag_find_owner(uint32_t inode, pid_t hint) {
+    char target[32];
+    snprintf(target, sizeof(target), "socket:[%u]", inode);
+
+    if (hint > 0 && holds_socket(hint, target)) {
+        return hint;
+    }
+
+    /* A listener stays full across many prints; only a cached owner that
+     * no longer holds the socket sends it back to the full search */
+    owner_entry_t *entry = NULL;
+    for (int i = 0; i < OWNER_CACHE_SIZE; i++) {
+        if (owner_cache[i].inode == inode) {
+            entry = &owner_cache[i];
+            break;
+        }
+    }
+    if (entry && (entry->pid < 0 || holds_socket(entry->pid, target))) {
+        return entry->pid;
+    }
+    if (!entry) {
+        entry = &owner_cache[owner_next];
+        owner_next = (owner_next + 1) % OWNER_CACHE_SIZE;
+    }
+
+    entry->inode = inode;
+    entry->pid = search_owner(target, hint);
+    return entry->pid;
+}
@@ -0,0 +1,421 @@
+#include "../include/taskstats_backend.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+#include <linux/taskstats.h>
+
+#define TASKSTATS_MSG_SIZE 2048
+
+/* Generic netlink attribute helpers (linux/netlink.h only covers nlmsghdr) */
+#define GENL_MSG_DATA(nlh) ((char *)NLMSG_DATA(nlh) + GENL_HDRLEN)
+#define NLA_DATA(nla) ((char *)(nla) + NLA_HDRLEN)
+#define NLA_PAYLOAD_LEN(nla) ((int)(nla)->nla_len - NLA_HDRLEN)
+#define NLA_NEXT(nla) ((struct nlattr *)((char *)(nla) + NLA_ALIGN((nla)->nla_len)))
+
+/* Family id is global; each thread owns its socket and sequence numbers */
+static int family_id = 0;
+static _Thread_local int nl_fd = -1;
+static _Thread_local uint32_t nl_seq = 0;
+
+/* Exit notifications go to one shared socket owned by the main loop */
+static int exit_fd = -1;
+
+static int open_socket(void) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_nl addr = { .nl_family = AF_NETLINK };
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+    return fd;
+}
+
+/* Build a one-attribute genl request and read the reply into buffer
+ * With NLM_F_ACK in flags the kernel's acknowledgement is the reply. */
+static ssize_t transact(int fd, uint16_t type, uint16_t flags, uint8_t cmd,
+                        uint16_t attr_type, const void *attr_data, uint16_t attr_len,
+                        char *buffer, size_t size) {
+    char request[NLMSG_SPACE(GENL_HDRLEN + NLA_HDRLEN + 256)];
+    if (attr_len > 256) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(request, 0, sizeof(request));
+
+    struct nlmsghdr *nlh = (struct nlmsghdr *)request;
+    nlh->nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+    nlh->nlmsg_type = type;
+    nlh->nlmsg_flags = NLM_F_REQUEST | flags;
+    nlh->nlmsg_seq = ++nl_seq;
+    nlh->nlmsg_pid = 0;
+
+    struct genlmsghdr *genl = (struct genlmsghdr *)NLMSG_DATA(nlh);
+    genl->cmd = cmd;
+    genl->version = 1;
+
+    struct nlattr *nla = (struct nlattr *)GENL_MSG_DATA(nlh);
+    nla->nla_type = attr_type;
+    nla->nla_len = NLA_HDRLEN + attr_len;
+    memcpy(NLA_DATA(nla), attr_data, attr_len);
+    nlh->nlmsg_len += NLA_ALIGN(nla->nla_len);
+
+    struct sockaddr_nl kernel = { .nl_family = AF_NETLINK };
+    if (sendto(fd, request, nlh->nlmsg_len, 0,
+               (struct sockaddr *)&kernel, sizeof(kernel)) < 0) {
+        return -1;
+    }
+
+    for (;;) {
+        ssize_t len = recv(fd, buffer, size, 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        struct nlmsghdr *reply = (struct nlmsghdr *)buffer;
+        if (!NLMSG_OK(reply, (size_t)len)) {
+            errno = EPROTO;
+            return -1;
+        }
+        /* Skip stale replies left behind by an interrupted request */
+        if (reply->nlmsg_seq != nl_seq) {
+            continue;
+        }
+        if (reply->nlmsg_type == NLMSG_ERROR) {
+            struct nlmsgerr *err = (struct nlmsgerr *)NLMSG_DATA(reply);
+            if (err->error == 0 && (flags & NLM_F_ACK)) {
+                return len;
+            }
+            errno = err->error ? -err->error : EPROTO;
+            return -1;
+        }
+        return len;
+    }
+}
+
+static int resolve_family(int fd) {
+    char buffer[TASKSTATS_MSG_SIZE];
+    const char name[] = TASKSTATS_GENL_NAME;
+
+    ssize_t len = transact(fd, GENL_ID_CTRL, 0, CTRL_CMD_GETFAMILY, CTRL_ATTR_FAMILY_NAME,
+                           name, sizeof(name), buffer, sizeof(buffer));
+    if (len < 0) {
+        return -1;
+    }
+
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buffer;
+    int remaining = (int)nlh->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+    struct nlattr *nla = (struct nlattr *)GENL_MSG_DATA(nlh);
+
+    while (remaining >= NLA_HDRLEN && nla->nla_len >= NLA_HDRLEN &&
+           nla->nla_len <= remaining) {
+        if ((nla->nla_type & NLA_TYPE_MASK) == CTRL_ATTR_FAMILY_ID) {
+            return *(uint16_t *)NLA_DATA(nla);
+        }
+        remaining -= NLA_ALIGN(nla->nla_len);
+        nla = NLA_NEXT(nla);
+    }
+
+    errno = ENOENT;
+    return -1;
+}
+
+int taskstats_init(void) {
+    if (nl_fd >= 0 && family_id > 0) {
+        return 0;
+    }
+
+    if (nl_fd < 0) {
+        nl_fd = open_socket();
+        if (nl_fd < 0) {
+            return -1;
+        }
+    }
+
+    if (family_id <= 0) {
+        int id = resolve_family(nl_fd);
+        if (id < 0) {
+            int saved_errno = errno;
+            taskstats_cleanup();
+            errno = saved_errno;
+            return -1;
+        }
+        family_id = id;
+    }
+    return 0;
+}
+
+void taskstats_cleanup(void) {
+    if (nl_fd >= 0) {
+        close(nl_fd);
+        nl_fd = -1;
+    }
+}
+
+int taskstats_is_available(void) {
+    return family_id > 0;
+}
+
+static void decode_stats(const struct taskstats *ts, task_accounting_t *acct) {
+    acct->exit_code = ts->ac_exitcode;
+    acct->tgid = ts->ac_tgid ? (pid_t)ts->ac_tgid : acct->pid;
+
+    acct->utime_us = ts->ac_utime;
+    acct->stime_us = ts->ac_stime;
+    acct->cpu_time_ns = ts->cpu_run_real_total;
+    acct->nvcsw = ts->nvcsw;
+    acct->nivcsw = ts->nivcsw;
+
+    acct->cpu_count = ts->cpu_count;
+    acct->cpu_delay_ns = ts->cpu_delay_total;
+    acct->blkio_count = ts->blkio_count;
+    acct->blkio_delay_ns = ts->blkio_delay_total;
+    acct->swapin_count = ts->swapin_count;
+    acct->swapin_delay_ns = ts->swapin_delay_total;
+
+    acct->minflt = ts->ac_minflt;
+    acct->majflt = ts->ac_majflt;
+    acct->hiwater_rss_kb = ts->hiwater_rss;
+
+    acct->read_char = ts->read_char;
+    acct->write_char = ts->write_char;
+    acct->read_syscalls = ts->read_syscalls;
+    acct->write_syscalls = ts->write_syscalls;
+    acct->read_bytes = ts->read_bytes;
+    acct->write_bytes = ts->write_bytes;
+    acct->cancelled_write_bytes = ts->cancelled_write_bytes;
+}
+
+int taskstats_parse_records(const void *msg, size_t len, task_accounting_t *records,
+                            int max_records) {
+    if (!msg || !records || max_records <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const struct nlmsghdr *nlh = msg;
+    if (!NLMSG_OK(nlh, len) || nlh->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN)) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    int count = 0;
+
+    /* Each record nests {PID|TGID, STATS} inside AGGR_PID or AGGR_TGID */
+    int remaining = (int)nlh->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+    struct nlattr *nla = (struct nlattr *)GENL_MSG_DATA(nlh);
+
+    while (count < max_records && remaining >= NLA_HDRLEN &&
+           nla->nla_len >= NLA_HDRLEN && nla->nla_len <= remaining) {
+        int type = nla->nla_type & NLA_TYPE_MASK;
+        if (type == TASKSTATS_TYPE_AGGR_PID || type == TASKSTATS_TYPE_AGGR_TGID) {
+            task_accounting_t *acct = &records[count];
+            memset(acct, 0, sizeof(task_accounting_t));
+            acct->is_tgid = (type == TASKSTATS_TYPE_AGGR_TGID);
+
+            int nested_remaining = NLA_PAYLOAD_LEN(nla);
+            struct nlattr *nested = (struct nlattr *)NLA_DATA(nla);
+            while (nested_remaining >= NLA_HDRLEN && nested->nla_len >= NLA_HDRLEN &&
+                   nested->nla_len <= nested_remaining) {
+                int nested_type = nested->nla_type & NLA_TYPE_MASK;
+                if (nested_type == TASKSTATS_TYPE_PID || nested_type == TASKSTATS_TYPE_TGID) {
+                    acct->pid = (pid_t)*(uint32_t *)NLA_DATA(nested);
+                } else if (nested_type == TASKSTATS_TYPE_STATS) {
+                    /* Older kernels send a shorter struct; missing fields stay zero */
+                    struct taskstats ts;
+                    size_t copy = (size_t)NLA_PAYLOAD_LEN(nested);
+                    memset(&ts, 0, sizeof(ts));
+                    memcpy(&ts, NLA_DATA(nested), copy < sizeof(ts) ? copy : sizeof(ts));
+                    decode_stats(&ts, acct);
+                    if (acct->is_tgid) {
+                        acct->tgid = acct->pid;
+                    }
+                    acct->has_io = !acct->is_tgid;
+                    count++;
+                    break;
+                }
+                nested_remaining -= NLA_ALIGN(nested->nla_len);
+                nested = NLA_NEXT(nested);
+            }
+        }
+        remaining -= NLA_ALIGN(nla->nla_len);
+        nla = NLA_NEXT(nla);
+    }
+
+    if (count == 0) {
+        errno = ENODATA;
+    }
+    return count;
+}
+
+int taskstats_parse_message(const void *msg, size_t len, task_accounting_t *acct) {
+    return (taskstats_parse_records(msg, len, acct, 1) == 1) ? 0 : -1;
+}
+
+static int query(uint16_t attr_type, pid_t pid, task_accounting_t *acct) {
+    if (!acct) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (taskstats_init() != 0) {
+        return -1;
+    }
+
+    char buffer[TASKSTATS_MSG_SIZE];
+    uint32_t id = (uint32_t)pid;
+    ssize_t len = transact(nl_fd, (uint16_t)family_id, 0, TASKSTATS_CMD_GET, attr_type,
+                           &id, sizeof(id), buffer, sizeof(buffer));
+    if (len < 0) {
+        return -1;
+    }
+
+    return taskstats_parse_message(buffer, (size_t)len, acct);
+}
+
+int taskstats_query_tgid(pid_t tgid, task_accounting_t *acct) {
+    return query(TASKSTATS_CMD_ATTR_TGID, tgid, acct);
+}
+
+int taskstats_query_pid(pid_t pid, task_accounting_t *acct) {
+    return query(TASKSTATS_CMD_ATTR_PID, pid, acct);
+}
+
+/* CPU list accepted by REGISTER_CPUMASK, e.g. "0-7" */
+static int possible_cpus(char *buffer, size_t size) {
+    FILE *fp = fopen("/sys/devices/system/cpu/possible", "r");
+    if (fp) {
+        int ok = (fgets(buffer, (int)size, fp) != NULL);
+        fclose(fp);
+        if (ok) {
+            buffer[strcspn(buffer, "\n")] = '\0';
+            return 0;
+        }
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    if (cpus <= 0) {
+        return -1;
+    }
+    snprintf(buffer, size, "0-%ld", cpus - 1);
+    return 0;
+}
+
+int taskstats_exit_listen(void) {
+    if (exit_fd >= 0) {
+        return 0;
+    }
+    if (taskstats_init() != 0) {
+        return -1;
+    }
+
+    char cpumask[128];
+    if (possible_cpus(cpumask, sizeof(cpumask)) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    exit_fd = open_socket();
+    if (exit_fd < 0) {
+        return -1;
+    }
+
+    /* Exit storms arrive in bursts; a larger buffer makes overruns rare */
+    int rcvbuf = 1 << 20;
+    setsockopt(exit_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    char reply[TASKSTATS_MSG_SIZE];
+    if (transact(exit_fd, (uint16_t)family_id, NLM_F_ACK, TASKSTATS_CMD_GET,
+                 TASKSTATS_CMD_ATTR_REGISTER_CPUMASK, cpumask,
+                 (uint16_t)(strlen(cpumask) + 1), reply, sizeof(reply)) < 0) {
+        int saved_errno = errno;
+        close(exit_fd);
+        exit_fd = -1;
+        errno = saved_errno;
+        return -1;
+    }
+
+    fcntl(exit_fd, F_SETFL, fcntl(exit_fd, F_GETFL) | O_NONBLOCK);
+    return 0;
+}
+
+void taskstats_exit_cleanup(void) {
+    if (exit_fd < 0) {
+        return;
+    }
+
+    /* Closing the socket also drops the listener; no reply is expected and
+     * the non-blocking receive just drains what is queued */
+    char cpumask[128];
+    char reply[TASKSTATS_MSG_SIZE];
+    if (possible_cpus(cpumask, sizeof(cpumask)) == 0) {
+        transact(exit_fd, (uint16_t)family_id, 0, TASKSTATS_CMD_GET,
+                 TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK, cpumask,
+                 (uint16_t)(strlen(cpumask) + 1), reply, sizeof(reply));
+    }
+
+    close(exit_fd);
+    exit_fd = -1;
+}
+
+int taskstats_exit_get_fd(void) {
+    return exit_fd;
+}
+
+int taskstats_exit_read(task_accounting_t *records, int max_records, int *lost) {
+    if (exit_fd < 0 || !records || max_records <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (lost) {
+        *lost = 0;
+    }
+
+    char buffer[TASKSTATS_MSG_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+    int count = 0;
+
+    /* Stop while a full notification (task + group record) still fits */
+    while (count + 2 <= max_records) {
+        ssize_t len = recv(exit_fd, buffer, sizeof(buffer), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS) {
+                if (lost) *lost = 1;
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buffer;
+             NLMSG_OK(nlh, (size_t)len) && count + 2 <= max_records;
+             nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type != family_id) {
+                continue;
+            }
+            int n = taskstats_parse_records(nlh, nlh->nlmsg_len, &records[count], 2);
+            if (n > 0) {
+                count += n;
+            }
+        }
+    }
+
+    return count;
+}
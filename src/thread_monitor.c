@@ -0,0 +1,478 @@
+#include "../include/thread_monitor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* One tracked thread; stat, status and schedstat stay open for pread() */
+typedef struct {
+    pid_t tid;
+    int stat_fd;
+    int status_fd;
+    int schedstat_fd;                    /* -1 unless --cpu-clock schedstat */
+    int stale;                           /* Last read failed: the next one is a baseline */
+} thread_handle_t;
+
+/* TID table of one process. handles[i] and metrics[i] describe the same
+ * thread; both arrays are sorted by TID and double-buffered so a merge
+ * with the new listing never allocates in steady state. */
+typedef struct {
+    pid_t pid;
+    int task_fd;                         /* /proc/[pid]/task */
+    int primed;                          /* Baseline collected */
+    int count;
+    int capacity;
+    thread_handle_t *handles;
+    thread_metrics_t *metrics;
+    thread_handle_t *next_handles;
+    thread_metrics_t *next_metrics;
+    pid_t *tids;
+    int tid_capacity;
+    struct timespec timestamp;
+} thread_table_t;
+
+static thread_table_t tables[THREAD_MONITOR_MAX_PROCESSES];
+static int table_count = 0;
+static long clock_ticks = 0;
+
+static void close_thread(thread_handle_t *handle) {
+    if (handle->stat_fd >= 0) {
+        close(handle->stat_fd);
+    }
+    if (handle->status_fd >= 0) {
+        close(handle->status_fd);
+    }
+    if (handle->schedstat_fd >= 0) {
+        close(handle->schedstat_fd);
+    }
+    handle->stat_fd = -1;
+    handle->status_fd = -1;
+    handle->schedstat_fd = -1;
+}
+
+static void release_table(thread_table_t *table) {
+    for (int i = 0; i < table->count; i++) {
+        close_thread(&table->handles[i]);
+    }
+    if (table->task_fd >= 0) {
+        close(table->task_fd);
+    }
+    free(table->handles);
+    free(table->metrics);
+    free(table->next_handles);
+    free(table->next_metrics);
+    free(table->tids);
+    memset(table, 0, sizeof(thread_table_t));
+    table->task_fd = -1;
+}
+
+static thread_table_t *find_table(pid_t pid) {
+    for (int i = 0; i < table_count; i++) {
+        if (tables[i].pid == pid) {
+            return &tables[i];
+        }
+    }
+    return NULL;
+}
+
+static thread_table_t *add_table(pid_t pid) {
+    if (table_count >= THREAD_MONITOR_MAX_PROCESSES) {
+        errno = ENOSPC;
+        return NULL;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            errno = ESRCH;
+        }
+        return NULL;
+    }
+
+    thread_table_t *table = &tables[table_count++];
+    memset(table, 0, sizeof(thread_table_t));
+    table->pid = pid;
+    table->task_fd = fd;
+    return table;
+}
+
+static int reserve(thread_table_t *table, int needed) {
+    if (needed <= table->capacity) {
+        return 0;
+    }
+
+    int new_capacity = table->capacity ? table->capacity : 16;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+
+    /* Each array is stored as soon as it grows, so a failure part way
+     * leaves the table consistent at its old capacity */
+    thread_handle_t *handles = realloc(table->handles, new_capacity * sizeof(thread_handle_t));
+    if (!handles) {
+        errno = ENOMEM;
+        return -1;
+    }
+    table->handles = handles;
+
+    thread_handle_t *next_handles = realloc(table->next_handles,
+                                            new_capacity * sizeof(thread_handle_t));
+    if (!next_handles) {
+        errno = ENOMEM;
+        return -1;
+    }
+    table->next_handles = next_handles;
+
+    thread_metrics_t *metrics = realloc(table->metrics, new_capacity * sizeof(thread_metrics_t));
+    if (!metrics) {
+        errno = ENOMEM;
+        return -1;
+    }
+    table->metrics = metrics;
+
+    thread_metrics_t *next_metrics = realloc(table->next_metrics,
+                                             new_capacity * sizeof(thread_metrics_t));
+    if (!next_metrics) {
+        errno = ENOMEM;
+        return -1;
+    }
+    table->next_metrics = next_metrics;
+
+    table->capacity = new_capacity;
+    return 0;
+}
+
+static int compare_tid(const void *a, const void *b) {
+    pid_t ta = *(const pid_t *)a;
+    pid_t tb = *(const pid_t *)b;
+    return (ta > tb) - (ta < tb);
+}
+
+/* Open one file of a thread relative to the task directory, unless it is open */
+static int open_thread_file(int task_fd, pid_t tid, const char *name, int *fd) {
+    if (*fd >= 0) {
+        return 0;
+    }
+    char path[48];
+    snprintf(path, sizeof(path), "%d/%s", tid, name);
+    *fd = openat(task_fd, path, O_RDONLY | O_CLOEXEC);
+    return *fd >= 0 ? 0 : -1;
+}
+
+static void open_thread(pid_t tid, thread_handle_t *handle, thread_metrics_t *metrics) {
+    /* Files are opened by the first read_thread(), which also retries them */
+    handle->tid = tid;
+    handle->stat_fd = -1;
+    handle->status_fd = -1;
+    handle->schedstat_fd = -1;
+    handle->stale = 0;
+
+    /* A thread created after the baseline ran entirely inside this
+     * interval, so its counters start from zero */
+    memset(metrics, 0, sizeof(thread_metrics_t));
+    metrics->tid = tid;
+}
+
+/* Merge the sorted TID listing into the table; returns threads created */
+static int merge_listing(thread_table_t *table, int tid_count, int *exited) {
+    int i = 0, j = 0, n = 0, created = 0;
+
+    while (i < table->count || j < tid_count) {
+        if (j == tid_count || (i < table->count && table->handles[i].tid < table->tids[j])) {
+            close_thread(&table->handles[i++]);
+            (*exited)++;
+        } else if (i == table->count || table->tids[j] < table->handles[i].tid) {
+            open_thread(table->tids[j++], &table->next_handles[n], &table->next_metrics[n]);
+            n++;
+            created++;
+        } else {
+            table->next_handles[n] = table->handles[i];
+            table->next_metrics[n] = table->metrics[i];
+            n++;
+            i++;
+            j++;
+        }
+    }
+
+    thread_handle_t *handles = table->handles;
+    thread_metrics_t *metrics = table->metrics;
+    table->handles = table->next_handles;
+    table->metrics = table->next_metrics;
+    table->next_handles = handles;
+    table->next_metrics = metrics;
+    table->count = n;
+    return created;
+}
+
+/* pread() a whole small file; an empty read means the thread is gone */
+static int read_thread_file(int fd, char *buffer, size_t size) {
+    ssize_t len = pread(fd, buffer, size - 1, 0);
+    if (len < 0) {
+        return -1;
+    }
+    if (len == 0) {
+        errno = ESRCH;
+        return -1;
+    }
+    buffer[len] = '\0';
+    return 0;
+}
+
+/* Re-read one thread, opening whichever of its files are not open yet
+ * Returns -1 with errno set; ESRCH or ENOENT once the thread has exited. */
+static int read_thread(thread_table_t *table, thread_handle_t *handle,
+                       thread_metrics_t *metrics, double elapsed) {
+    char buffer[PROCFS_BUFFER_SIZE];
+    proc_snapshot_t snap;
+    memset(&snap, 0, sizeof(snap));
+
+    int schedstat = proc_snapshot_get_cpu_clock() == PROCFS_CPU_CLOCK_SCHEDSTAT;
+    if (open_thread_file(table->task_fd, handle->tid, "stat", &handle->stat_fd) != 0 ||
+        open_thread_file(table->task_fd, handle->tid, "status", &handle->status_fd) != 0 ||
+        (schedstat &&
+         open_thread_file(table->task_fd, handle->tid, "schedstat", &handle->schedstat_fd) != 0)) {
+        return -1;
+    }
+
+    if (read_thread_file(handle->stat_fd, buffer, sizeof(buffer)) != 0) {
+        return -1;
+    }
+    if (proc_snapshot_parse_stat(buffer, &snap) != 0) {
+        errno = EIO;
+        return -1;
+    }
+    if (read_thread_file(handle->status_fd, buffer, sizeof(buffer)) != 0) {
+        return -1;
+    }
+    proc_snapshot_parse_status(buffer, &snap);
+    if (schedstat) {
+        if (read_thread_file(handle->schedstat_fd, buffer, sizeof(buffer)) != 0) {
+            return -1;
+        }
+        procfs_schedstat_t sched;
+        if (procfs_parse_schedstat(buffer, &sched) != 0) {
+            errno = EIO;
+            return -1;
+        }
+        snap.cpu_time_ns = sched.cpu_time_ns;
+    }
+
+    /* After a failed read the stored counters are too old to diff against */
+    if (handle->stale) {
+        elapsed = 0.0;
+        handle->stale = 0;
+    }
+
+    if (elapsed > 0) {
+        if (schedstat) {
+            metrics->cpu_percent =
+                (double)(snap.cpu_time_ns - metrics->cpu_time_ns) / 1e9 / elapsed * 100.0;
+        } else {
+            uint64_t ticks = (snap.utime + snap.stime) - (metrics->utime + metrics->stime);
+            metrics->cpu_percent = (double)ticks / clock_ticks / elapsed * 100.0;
+        }
+        metrics->voluntary_rate =
+            (snap.voluntary_ctxt_switches - metrics->voluntary_ctxt_switches) / elapsed;
+        metrics->nonvoluntary_rate =
+            (snap.nonvoluntary_ctxt_switches - metrics->nonvoluntary_ctxt_switches) / elapsed;
+    }
+
+    memcpy(metrics->comm, snap.comm, sizeof(metrics->comm));
+    metrics->state = snap.state;
+    metrics->utime = snap.utime;
+    metrics->stime = snap.stime;
+    metrics->cpu_time_ns = snap.cpu_time_ns;
+    metrics->voluntary_ctxt_switches = snap.voluntary_ctxt_switches;
+    metrics->nonvoluntary_ctxt_switches = snap.nonvoluntary_ctxt_switches;
+    return 0;
+}
+
+int thread_monitor_init(void) {
+    clock_ticks = sysconf(_SC_CLK_TCK);
+    if (clock_ticks <= 0) {
+        clock_ticks = 100;
+    }
+    table_count = 0;
+    return 0;
+}
+
+void thread_monitor_cleanup(void) {
+    for (int i = 0; i < table_count; i++) {
+        release_table(&tables[i]);
+    }
+    table_count = 0;
+}
+
+void thread_monitor_forget(pid_t pid) {
+    thread_table_t *table = find_table(pid);
+    if (!table) {
+        return;
+    }
+    release_table(table);
+    /* Keep the table array dense */
+    *table = tables[--table_count];
+}
+
+int thread_monitor_collect(pid_t pid, thread_sample_t *sample) {
+    if (pid <= 0 || !sample) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (clock_ticks <= 0) {
+        thread_monitor_init();
+    }
+
+    thread_table_t *table = find_table(pid);
+    if (!table && !(table = add_table(pid))) {
+        return -1;
+    }
+
+    /* The cached directory of an exited process lists no tasks, even if
+     * the PID has been reused since */
+    int tid_count = procfs_list_pids(table->task_fd, &table->tids, &table->tid_capacity);
+    if (tid_count <= 0) {
+        thread_monitor_forget(pid);
+        errno = ESRCH;
+        return -1;
+    }
+    qsort(table->tids, tid_count, sizeof(pid_t), compare_tid);
+
+    if (reserve(table, table->count + tid_count) != 0) {
+        return -1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = 0.0;
+    if (table->primed) {
+        elapsed = (now.tv_sec - table->timestamp.tv_sec) +
+                  (now.tv_nsec - table->timestamp.tv_nsec) / 1e9;
+    }
+
+    int exited = 0;
+    int created = merge_listing(table, tid_count, &exited);
+
+    /* Compact away threads that exited between the listing and the reads */
+    int n = 0;
+    for (int i = 0; i < table->count; i++) {
+        if (read_thread(table, &table->handles[i], &table->metrics[i], elapsed) != 0) {
+            if (procfs_is_gone_error(errno)) {
+                close_thread(&table->handles[i]);
+                exited++;
+                continue;
+            }
+            /* Out of descriptors or denied: keep the thread and retry its
+             * files next time, rather than counting it as exited and then
+             * created again */
+            table->handles[i].stale = 1;
+            table->metrics[i].cpu_percent = 0.0;
+            table->metrics[i].voluntary_rate = 0.0;
+            table->metrics[i].nonvoluntary_rate = 0.0;
+        }
+        if (n != i) {
+            table->handles[n] = table->handles[i];
+            table->metrics[n] = table->metrics[i];
+        }
+        n++;
+    }
+    table->count = n;
+    table->timestamp = now;
+
+    sample->pid = pid;
+    sample->count = n;
+    sample->created = table->primed ? created : 0;
+    sample->exited = exited;
+    sample->threads = table->metrics;
+    sample->timestamp = now;
+
+    table->primed = 1;
+    return 0;
+}
+
+int thread_monitor_top(const thread_sample_t *sample, thread_metrics_t *top, int max) {
+    if (!sample || !top || max <= 0) {
+        return 0;
+    }
+
+    /* Insertion into a short sorted array: max is small, threads may be many */
+    int stored = 0;
+    for (int i = 0; i < sample->count; i++) {
+        const thread_metrics_t *t = &sample->threads[i];
+        if (stored == max && t->cpu_percent <= top[stored - 1].cpu_percent) {
+            continue;
+        }
+        int pos = (stored < max) ? stored++ : max - 1;
+        while (pos > 0 && top[pos - 1].cpu_percent < t->cpu_percent) {
+            top[pos] = top[pos - 1];
+            pos--;
+        }
+        top[pos] = *t;
+    }
+    return stored;
+}
+
+void print_thread_sample(const thread_sample_t *sample, int top_n) {
+    if (!sample) {
+        return;
+    }
+    if (top_n <= 0) {
+        top_n = THREAD_MONITOR_DEFAULT_TOP;
+    }
+
+    thread_metrics_t *top = malloc(top_n * sizeof(thread_metrics_t));
+    if (!top) {
+        return;
+    }
+    int shown = thread_monitor_top(sample, top, top_n);
+
+    double total = 0.0;
+    for (int i = 0; i < sample->count; i++) {
+        total += sample->threads[i].cpu_percent;
+    }
+
+    printf("=== Threads of PID %d: %d (+%d, -%d), %.2f%% CPU ===\n",
+           sample->pid, sample->count, sample->created, sample->exited, total);
+    printf("%-8s %-16s %s %7s %10s %10s\n",
+           "TID", "COMMAND", "S", "CPU%", "VCSW/s", "NVCSW/s");
+    for (int i = 0; i < shown; i++) {
+        printf("%-8d %-16.16s %c %7.2f %10.1f %10.1f\n",
+               top[i].tid, top[i].comm, top[i].state, top[i].cpu_percent,
+               top[i].voluntary_rate, top[i].nonvoluntary_rate);
+    }
+    printf("\n");
+    free(top);
+}
+
+int export_thread_sample_csv(const thread_sample_t *sample, const char *filename, int append) {
+    if (!sample || !filename) {
+        return -1;
+    }
+
+    FILE *fp = fopen(filename, append ? "a" : "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    if (!append) {
+        fprintf(fp, "timestamp,pid,tid,comm,state,utime,stime,cpu_percent,");
+        fprintf(fp, "voluntary_ctxt_switches,nonvoluntary_ctxt_switches,");
+        fprintf(fp, "voluntary_rate,nonvoluntary_rate\n");
+    }
+
+    for (int i = 0; i < sample->count; i++) {
+        const thread_metrics_t *t = &sample->threads[i];
+        fprintf(fp, "%ld.%09ld,%d,%d,%s,%c,%lu,%lu,%.2f,%lu,%lu,%.2f,%.2f\n",
+                sample->timestamp.tv_sec, sample->timestamp.tv_nsec,
+                sample->pid, t->tid, t->comm, t->state, t->utime, t->stime,
+                t->cpu_percent, t->voluntary_ctxt_switches, t->nonvoluntary_ctxt_switches,
+                t->voluntary_rate, t->nonvoluntary_rate);
+    }
+
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,281 @@
+#include "../include/veth_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include <linux/net_namespace.h>
+
+#define VETH_BUFFER_SIZE 65536
+
+static int route_fd = -1;
+static uint32_t route_seq = 0;
+static char *buffer = NULL;
+
+static veth_link_t *links = NULL;
+static int link_count = 0;
+static int link_capacity = 0;
+static struct timespec dump_time;
+
+int veth_stats_init(void) {
+    if (route_fd >= 0) {
+        return 0;
+    }
+
+    buffer = malloc(VETH_BUFFER_SIZE);
+    if (!buffer) {
+        errno = ENOMEM;
+        return -1;
+    }
+    route_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (route_fd < 0) {
+        int saved_errno = errno;
+        free(buffer);
+        buffer = NULL;
+        errno = saved_errno;
+        return -1;
+    }
+    return 0;
+}
+
+void veth_stats_cleanup(void) {
+    if (route_fd >= 0) {
+        close(route_fd);
+        route_fd = -1;
+    }
+    free(buffer);
+    buffer = NULL;
+    free(links);
+    links = NULL;
+    link_count = 0;
+    link_capacity = 0;
+}
+
+static int send_request(void *request, uint32_t len) {
+    struct sockaddr_nl kernel = { .nl_family = AF_NETLINK };
+    if (sendto(route_fd, request, len, 0, (struct sockaddr *)&kernel, sizeof(kernel)) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static void decode_link(const struct nlmsghdr *nlh, veth_link_t *link) {
+    const struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    memset(link, 0, sizeof(veth_link_t));
+    link->ifindex = ifi->ifi_index;
+    link->link_nsid = VETH_NSID_NONE;
+
+    int len = (int)IFLA_PAYLOAD(nlh);
+    for (const struct rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        switch (rta->rta_type) {
+            case IFLA_IFNAME:
+                snprintf(link->name, sizeof(link->name), "%s", (const char *)RTA_DATA(rta));
+                break;
+            case IFLA_LINK_NETNSID:
+                if (RTA_PAYLOAD(rta) >= sizeof(int32_t)) {
+                    link->link_nsid = *(const int32_t *)RTA_DATA(rta);
+                }
+                break;
+            case IFLA_STATS64:
+                if (RTA_PAYLOAD(rta) >= sizeof(struct rtnl_link_stats64)) {
+                    struct rtnl_link_stats64 stats;
+                    memcpy(&stats, RTA_DATA(rta), sizeof(stats));
+                    link->rx_bytes = stats.rx_bytes;
+                    link->tx_bytes = stats.tx_bytes;
+                    link->rx_packets = stats.rx_packets;
+                    link->tx_packets = stats.tx_packets;
+                    link->rx_errors = stats.rx_errors;
+                    link->tx_errors = stats.tx_errors;
+                    link->rx_dropped = stats.rx_dropped;
+                    link->tx_dropped = stats.tx_dropped;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+int veth_stats_refresh(void) {
+    if (route_fd < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct {
+        struct nlmsghdr nlh;
+        struct ifinfomsg ifi;
+    } request;
+    memset(&request, 0, sizeof(request));
+    request.nlh.nlmsg_len = sizeof(request);
+    request.nlh.nlmsg_type = RTM_GETLINK;
+    request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.nlh.nlmsg_seq = ++route_seq;
+    request.ifi.ifi_family = AF_UNSPEC;
+    if (send_request(&request, sizeof(request)) != 0) {
+        return -1;
+    }
+
+    link_count = 0;
+    for (;;) {
+        ssize_t len = recv(route_fd, buffer, VETH_BUFFER_SIZE, 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buffer; NLMSG_OK(nlh, (size_t)len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            /* Skip stale replies left behind by an interrupted dump */
+            if (nlh->nlmsg_seq != route_seq) {
+                continue;
+            }
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                clock_gettime(CLOCK_MONOTONIC, &dump_time);
+                return link_count;
+            }
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr *err = NLMSG_DATA(nlh);
+                errno = err->error ? -err->error : EPROTO;
+                return -1;
+            }
+            if (nlh->nlmsg_type != RTM_NEWLINK) {
+                continue;
+            }
+
+            if (link_count == link_capacity) {
+                int new_capacity = link_capacity ? link_capacity * 2 : 64;
+                veth_link_t *grown = realloc(links, new_capacity * sizeof(veth_link_t));
+                if (!grown) {
+                    errno = ENOMEM;
+                    return -1;
+                }
+                links = grown;
+                link_capacity = new_capacity;
+            }
+            decode_link(nlh, &links[link_count++]);
+        }
+    }
+}
+
+int veth_stats_nsid(pid_t pid) {
+    if (route_fd < 0) {
+        errno = EINVAL;
+        return -2;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/ns/net", pid);
+    int ns_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (ns_fd < 0) {
+        return -2;
+    }
+
+    struct {
+        struct nlmsghdr nlh;
+        struct rtgenmsg gen;
+        char pad[3];
+        struct rtattr rta;
+        uint32_t fd;
+    } request;
+    memset(&request, 0, sizeof(request));
+    request.nlh.nlmsg_len = sizeof(request);
+    request.nlh.nlmsg_type = RTM_GETNSID;
+    request.nlh.nlmsg_flags = NLM_F_REQUEST;
+    request.nlh.nlmsg_seq = ++route_seq;
+    request.gen.rtgen_family = AF_UNSPEC;
+    request.rta.rta_type = NETNSA_FD;
+    request.rta.rta_len = RTA_LENGTH(sizeof(uint32_t));
+    request.fd = (uint32_t)ns_fd;
+
+    int status = send_request(&request, sizeof(request));
+    int saved_errno = errno;
+    close(ns_fd);
+    if (status != 0) {
+        errno = saved_errno;
+        return -2;
+    }
+
+    for (;;) {
+        ssize_t len = recv(route_fd, buffer, VETH_BUFFER_SIZE, 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -2;
+        }
+
+        const struct nlmsghdr *nlh = (const struct nlmsghdr *)buffer;
+        if (!NLMSG_OK(nlh, (size_t)len)) {
+            errno = EPROTO;
+            return -2;
+        }
+        if (nlh->nlmsg_seq != route_seq) {
+            continue;
+        }
+        if (nlh->nlmsg_type == NLMSG_ERROR) {
+            const struct nlmsgerr *err = NLMSG_DATA(nlh);
+            errno = err->error ? -err->error : EPROTO;
+            return -2;
+        }
+
+        int nsid = VETH_NSID_NONE;
+        int attr_len = (int)NLMSG_PAYLOAD(nlh, sizeof(struct rtgenmsg));
+        const struct rtattr *rta = (const struct rtattr *)((const char *)NLMSG_DATA(nlh) +
+                                                           NLMSG_ALIGN(sizeof(struct rtgenmsg)));
+        for (; RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+            if (rta->rta_type == NETNSA_NSID && RTA_PAYLOAD(rta) >= sizeof(int32_t)) {
+                nsid = *(const int32_t *)RTA_DATA(rta);
+            }
+        }
+        return nsid < 0 ? VETH_NSID_NONE : nsid;
+    }
+}
+
+int veth_stats_totals(int nsid, veth_totals_t *totals) {
+    if (!totals || nsid < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(totals, 0, sizeof(veth_totals_t));
+    for (int i = 0; i < link_count; i++) {
+        const veth_link_t *link = &links[i];
+        if (link->link_nsid != nsid) {
+            continue;
+        }
+        if (totals->links++ == 0) {
+            memcpy(totals->first, link->name, sizeof(totals->first));
+        }
+        totals->rx_bytes += link->tx_bytes;
+        totals->tx_bytes += link->rx_bytes;
+        totals->rx_packets += link->tx_packets;
+        totals->tx_packets += link->rx_packets;
+        totals->rx_errors += link->tx_errors;
+        totals->tx_errors += link->rx_errors;
+        totals->rx_dropped += link->tx_dropped;
+        totals->tx_dropped += link->rx_dropped;
+    }
+    totals->timestamp = dump_time;
+
+    if (totals->links == 0) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+int veth_stats_links(const veth_link_t **out) {
+    if (out) {
+        *out = links;
+    }
+    return link_count;
+}
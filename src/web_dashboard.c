@@ -3,118 +3,242 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <time.h>
 #include <errno.h>
 
-static cpu_metrics_t prev_cpu, curr_cpu, result_cpu;
-static memory_metrics_t memory;
-static io_metrics_t prev_io, curr_io, result_io;
-static int monitors_initialized = 0;
-static anomaly_detector_t global_detector;
+static int server_fd = -1;
+static int client_fds[WEB_MAX_CLIENTS];
+static int client_count = 0;
+static web_config_t web_config;
+static monitor_sample_t latest;
+static int has_sample = 0;
 
 int web_dashboard_init(int port) {
-    int server_fd;
+    int fd;
     struct sockaddr_in address;
     int opt = 1;
 
     /* Create socket */
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
+    if ((fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
         perror("socket failed");
         return -1;
     }
 
     /* Set socket options */
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
         perror("setsockopt");
-        close(server_fd);
+        close(fd);
         return -1;
     }
 
     /* Bind socket */
+    memset(&address, 0, sizeof(address));
     address.sin_family = AF_INET;
     address.sin_addr.s_addr = INADDR_ANY;
     address.sin_port = htons(port);
 
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
         perror("bind failed");
-        close(server_fd);
+        close(fd);
         return -1;
     }
 
     /* Listen */
-    if (listen(server_fd, WEB_MAX_CLIENTS) < 0) {
+    if (listen(fd, WEB_MAX_CLIENTS) < 0) {
         perror("listen");
-        close(server_fd);
+        close(fd);
         return -1;
     }
 
     printf("Web dashboard server started on http://localhost:%d\n", port);
-    return server_fd;
+    return fd;
+}
+
+static void close_client(int fd) {
+    event_loop_remove_fd(fd);
+    close(fd);
+    for (int i = 0; i < client_count; i++) {
+        if (client_fds[i] == fd) {
+            client_fds[i] = client_fds[--client_count];
+            break;
+        }
+    }
 }
 
-void web_dashboard_cleanup(int server_fd) {
+void web_dashboard_cleanup(void) {
+    while (client_count > 0) {
+        close_client(client_fds[0]);
+    }
     if (server_fd >= 0) {
+        event_loop_remove_fd(server_fd);
         close(server_fd);
+        server_fd = -1;
     }
+    has_sample = 0;
+}
+
+static void on_client_ready(int fd, uint32_t events, void *arg) {
+    (void)events;
+    (void)arg;
+    char buffer[WEB_BUFFER_SIZE];
 
-    if (monitors_initialized) {
-        cpu_monitor_cleanup();
-        memory_monitor_cleanup();
-        io_monitor_cleanup();
-        monitors_initialized = 0;
+    /* One request per connection (Connection: close) */
+    ssize_t bytes_read = recv(fd, buffer, sizeof(buffer) - 1, 0);
+    if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return;
     }
+    if (bytes_read > 0) {
+        buffer[bytes_read] = '\0';
+        web_handle_request(fd, buffer, &web_config);
+    }
+    close_client(fd);
 }
 
-int web_generate_metrics_json(pid_t pid, char *buffer, size_t buffer_size,
-                              int enable_anomaly, anomaly_detector_t *detector) {
-    /* Initialize monitors if needed */
-    if (!monitors_initialized) {
-        if (cpu_monitor_init() != 0) return -1;
-        if (memory_monitor_init() != 0) return -1;
-        if (io_monitor_init() != 0) return -1;
-
-        /* Get initial readings */
-        if (cpu_monitor_collect(pid, &prev_cpu) != 0) return -1;
-        if (io_monitor_collect(pid, &prev_io) != 0) {
-            /* I/O might fail without sudo */
+static void on_connection(int fd, uint32_t events, void *arg) {
+    (void)events;
+    (void)arg;
+
+    for (;;) {
+        int client_fd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("accept");
+            }
+            return;
+        }
+        if (client_count >= WEB_MAX_CLIENTS ||
+            event_loop_add_fd(client_fd, EPOLLIN, on_client_ready, NULL) != 0) {
+            close(client_fd);
+            continue;
         }
+        client_fds[client_count++] = client_fd;
+    }
+}
 
-        monitors_initialized = 1;
-        sleep(1);  /* Wait 1 second for first meaningful measurement */
+static void on_sample(const monitor_sample_t *sample, void *arg) {
+    (void)arg;
+    /* Trigger events between ticks keep the last metrics on the page */
+    if (sample->events_only && has_sample) {
+        monitor_sample_merge_events(&latest, sample);
+        return;
     }
+    latest = *sample;
+    has_sample = 1;
+}
 
-    /* Collect current metrics */
-    if (cpu_monitor_collect(pid, &curr_cpu) != 0) {
-        return -1;  /* Process no longer exists */
+int web_dashboard_attach(const web_config_t *config) {
+    if (!config) {
+        return -1;
     }
-    cpu_monitor_calculate_percentage(&prev_cpu, &curr_cpu, &result_cpu);
 
-    if (memory_monitor_collect(pid, &memory) != 0) {
+    server_fd = web_dashboard_init(config->port);
+    if (server_fd < 0) {
         return -1;
     }
+    web_config = *config;
+    client_count = 0;
 
-    if (io_monitor_collect(pid, &curr_io) == 0) {
-        io_monitor_calculate_rates(&prev_io, &curr_io, &result_io);
-        prev_io = curr_io;
+    if (event_loop_add_fd(server_fd, EPOLLIN, on_connection, NULL) != 0 ||
+        event_loop_subscribe(on_sample, NULL) != 0) {
+        fprintf(stderr, "Failed to register web dashboard: %s\n", strerror(errno));
+        web_dashboard_cleanup();
+        return -1;
     }
 
-    /* Update anomaly detector */
-    anomaly_event_t anomalies[10];
-    int anomaly_count = 0;
+    printf("Dashboard available at: http://localhost:%d\n", config->port);
+    printf("API endpoint: http://localhost:%d/api/metrics\n", config->port);
+    return 0;
+}
 
-    if (enable_anomaly && detector) {
-        anomaly_detector_update_cpu(detector, result_cpu.cpu_percent);
-        anomaly_detector_update_memory(detector, (double)memory.rss);
-        anomaly_detector_update_io(detector, result_io.read_rate, result_io.write_rate);
+/* Counters and rates of a cgroup sample */
+static int generate_cgroup_json(const monitor_sample_t *sample, char *buffer,
+                                size_t buffer_size) {
+    const cgroup_metrics_t *cgroup = &sample->cgroup;
+    const cgroup_rates_t *rates = &sample->cgroup_rates;
+    int has_limit = cgroup->memory.limit > 0 && cgroup->memory.limit != UINT64_MAX;
+    char path[MAX_CGROUP_PATH * 6];
 
-        anomaly_count = anomaly_detector_check(detector, anomalies, 10);
+    int len = snprintf(buffer, buffer_size,
+        "{\n"
+        "  \"timestamp\": %ld,\n"
+        "  \"cgroup\": {\n"
+        "    \"path\": \"%s\",\n"
+        "    \"cpu_cores\": %.3f,\n"
+        "    \"cpu_percent\": %.2f,\n"
+        "    \"cpu_limit_percent\": %.2f,\n"
+        "    \"throttle_rate\": %.4f,\n"
+        "    \"throttled_percent\": %.2f,\n"
+        "    \"memory_mb\": %.2f,\n"
+        "    \"memory_limit_mb\": %.2f,\n"
+        "    \"memory_percent\": %.2f,\n"
+        "    \"read_rate_kbs\": %.2f,\n"
+        "    \"write_rate_kbs\": %.2f,\n"
+        "    \"read_iops\": %.2f,\n"
+        "    \"write_iops\": %.2f,\n"
+        "    \"pids\": %lu,\n"
+        "    \"devices\": [",
+        time(NULL),
+        cgroup_json_escape(cgroup->cgroup_path, path, sizeof(path)),
+        rates->cpu_cores,
+        rates->cpu_cores * 100.0,
+        rates->cpu_limit_percent,
+        rates->throttle_rate,
+        rates->throttled_percent,
+        cgroup->memory.current / 1048576.0,
+        has_limit ? cgroup->memory.limit / 1048576.0 : 0.0,
+        rates->memory_percent,
+        rates->read_rate / 1024.0,
+        rates->write_rate / 1024.0,
+        rates->read_iops,
+        rates->write_iops,
+        cgroup->pids.current
+    );
+    if (len < 0 || (size_t)len >= buffer_size) {
+        return -1;
     }
 
+    /* Which disks the cgroup keeps busy */
+    const cgroup_blkio_t *blkio = &cgroup->blkio;
+    for (int d = 0; d < blkio->device_count && len < (int)buffer_size - 400; d++) {
+        const cgroup_io_device_t *device = &blkio->devices[d];
+        len += snprintf(buffer + len, buffer_size - len,
+            "%s\n"
+            "      {\"name\": \"%s\", \"read_kbs\": %.2f, \"write_kbs\": %.2f, "
+            "\"discard_kbs\": %.2f, \"read_iops\": %.2f, \"write_iops\": %.2f, "
+            "\"discard_iops\": %.2f, \"cost_wait_percent\": %.2f, "
+            "\"avg_lat_usec\": %lu, \"latency_target_usec\": %lu}",
+            d > 0 ? "," : "", device->name,
+            device->read_rate / 1024.0, device->write_rate / 1024.0,
+            device->discard_rate / 1024.0, device->read_iops, device->write_iops,
+            device->discard_iops, device->cost_wait_percent,
+            device->avg_lat_usec, device->latency_target_usec);
+    }
+    len += snprintf(buffer + len, buffer_size - len,
+        "%s]\n"
+        "  },\n"
+        "  \"anomalies\": [\n",
+        blkio->device_count > 0 ? "\n    " : "");
+    return len;
+}
+
+int web_generate_metrics_json(const monitor_sample_t *sample, char *buffer, size_t buffer_size) {
+    if (!sample || !buffer) {
+        return -1;
+    }
+
+    const cpu_metrics_t *cpu = &sample->cpu;
+    const memory_metrics_t *memory = &sample->memory;
+    const io_metrics_t *io = &sample->io;
+
     /* Generate JSON */
-    int len = snprintf(buffer, buffer_size,
+    int len = sample->has_cgroup ? generate_cgroup_json(sample, buffer, buffer_size) :
+              snprintf(buffer, buffer_size,
         "{\n"
         "  \"timestamp\": %ld,\n"
         "  \"pid\": %d,\n"
@@ -147,32 +271,38 @@ int web_generate_metrics_json(pid_t pid, char *buffer, size_t buffer_size,
         "  },\n"
         "  \"anomalies\": [\n",
         time(NULL),
-        pid,
-        result_cpu.cpu_percent,
-        result_cpu.utime,
-        result_cpu.stime,
-        result_cpu.num_threads,
-        result_cpu.voluntary_ctxt_switches,
-        result_cpu.nonvoluntary_ctxt_switches,
-        memory.rss,
-        memory.rss / 1024.0,
-        memory.vsz,
-        memory.vsz / 1024.0,
-        memory.shared,
-        memory.data,
-        memory.stack,
-        memory.text,
-        memory.swap,
-        result_io.read_rate,
-        result_io.write_rate,
-        result_io.read_bytes,
-        result_io.write_bytes,
-        result_io.syscr,
-        result_io.syscw
+        sample->pid,
+        cpu->cpu_percent,
+        cpu->utime,
+        cpu->stime,
+        cpu->num_threads,
+        cpu->voluntary_ctxt_switches,
+        cpu->nonvoluntary_ctxt_switches,
+        memory->rss,
+        memory->rss / 1024.0,
+        memory->vsz,
+        memory->vsz / 1024.0,
+        memory->shared,
+        memory->data,
+        memory->stack,
+        memory->text,
+        memory->swap,
+        io->read_rate,
+        io->write_rate,
+        io->read_bytes,
+        io->write_bytes,
+        io->syscr,
+        io->syscw
     );
+    if (len < 0 || (size_t)len >= buffer_size) {
+        return -1;
+    }
 
     /* Add anomalies to JSON */
-    for (int i = 0; i < anomaly_count && len < (int)buffer_size - 200; i++) {
+    const anomaly_event_t *anomalies = sample->anomalies;
+    char description[sizeof(anomalies[0].description) * 6];
+    int room = (int)buffer_size - 200 - (int)sizeof(description);
+    for (int i = 0; i < sample->anomaly_count && len < room; i++) {
         if (i > 0) len += snprintf(buffer + len, buffer_size - len, ",\n");
 
         const char *severity_str = "LOW";
@@ -191,7 +321,7 @@ int web_generate_metrics_json(pid_t pid, char *buffer, size_t buffer_size,
             "    }",
             anomalies[i].type,
             severity_str,
-            anomalies[i].description,
+            cgroup_json_escape(anomalies[i].description, description, sizeof(description)),
             anomalies[i].value,
             anomalies[i].expected_mean,
             anomalies[i].deviation_sigma
@@ -200,19 +330,53 @@ int web_generate_metrics_json(pid_t pid, char *buffer, size_t buffer_size,
 
     len += snprintf(buffer + len, buffer_size - len, "\n  ]\n}\n");
 
-    prev_cpu = curr_cpu;
+    return (size_t)len < buffer_size ? len : -1;
+}
 
-    return len;
+/* Copy text into out with the HTML special characters as entities */
+static const char *html_escape(const char *text, char *out, size_t size) {
+    size_t len = 0;
+    for (const char *p = text; *p; p++) {
+        const char *entity = NULL;
+        switch (*p) {
+            case '&': entity = "&amp;"; break;
+            case '<': entity = "&lt;"; break;
+            case '>': entity = "&gt;"; break;
+            case '"': entity = "&quot;"; break;
+            case '\'': entity = "&#39;"; break;
+        }
+        size_t n = entity ? strlen(entity) : 1;
+        if (len + n >= size) {
+            break;
+        }
+        if (entity) {
+            memcpy(out + len, entity, n);
+        } else {
+            out[len] = *p;
+        }
+        len += n;
+    }
+    out[len] = '\0';
+    return out;
 }
 
-int web_generate_html(char *buffer, size_t buffer_size, pid_t pid) {
+int web_generate_html(char *buffer, size_t buffer_size, const web_config_t *config) {
+    char target[MAX_CGROUP_PATH * 6 + 32];
+    if (config->cgroup_path) {
+        char path[MAX_CGROUP_PATH * 6];
+        snprintf(target, sizeof(target), "Cgroup: %s",
+                 html_escape(config->cgroup_path, path, sizeof(path)));
+    } else {
+        snprintf(target, sizeof(target), "Process ID: %d", config->monitored_pid);
+    }
+
     return snprintf(buffer, buffer_size,
         "<!DOCTYPE html>\n"
         "<html lang=\"en\">\n"
         "<head>\n"
         "  <meta charset=\"UTF-8\">\n"
         "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
-        "  <title>Resource Monitor - PID %d</title>\n"
+        "  <title>Resource Monitor - %s</title>\n"
         "  <style>\n"
         "    * { margin: 0; padding: 0; box-sizing: border-box; }\n"
         "    body {\n"
@@ -344,14 +508,28 @@ int web_generate_html(char *buffer, size_t buffer_size, pid_t pid) {
         "  <div class=\"container\">\n"
         "    <header>\n"
         "      <h1>Resource Monitor Dashboard</h1>\n"
-        "      <div class=\"subtitle\">Process ID: %d</div>\n"
+        "      <div class=\"subtitle\">%s</div>\n"
         "    </header>\n"
         "\n"
         "    <div id=\"loading\" class=\"loading\">Loading metrics...</div>\n"
         "\n"
         "    <div id=\"content\" style=\"display: none;\">\n"
         "      <div class=\"metrics-grid\">\n"
-        "        <div class=\"metric-card\">\n"
+        "        <div class=\"metric-card\" id=\"cgroup-card\" style=\"display: none;\">\n"
+        "          <div class=\"metric-title\">Cgroup</div>\n"
+        "          <div class=\"metric-value cpu-value\" id=\"cg-cores\">-- cores</div>\n"
+        "          <div class=\"metric-details\">\n"
+        "            <div>Of CPU limit: <span id=\"cg-limit\">--</span></div>\n"
+        "            <div>Throttled: <span id=\"cg-throttle\">--</span></div>\n"
+        "            <div>Memory: <span id=\"cg-memory\">--</span></div>\n"
+        "            <div>I/O: <span id=\"cg-io\">--</span> KB/s</div>\n"
+        "            <div>IOPS: <span id=\"cg-iops\">--</span></div>\n"
+        "            <div>PIDs: <span id=\"cg-pids\">--</span></div>\n"
+        "            <div>Devices: <span id=\"cg-devices\">--</span></div>\n"
+        "          </div>\n"
+        "        </div>\n"
+        "\n"
+        "        <div class=\"metric-card proc-card\">\n"
         "          <div class=\"metric-title\">CPU Usage</div>\n"
         "          <div class=\"metric-value cpu-value\" id=\"cpu-percent\">--%%</div>\n"
         "          <div class=\"metric-details\">\n"
@@ -362,7 +540,7 @@ int web_generate_html(char *buffer, size_t buffer_size, pid_t pid) {
         "          </div>\n"
         "        </div>\n"
         "\n"
-        "        <div class=\"metric-card\">\n"
+        "        <div class=\"metric-card proc-card\">\n"
         "          <div class=\"metric-title\">Memory Usage</div>\n"
         "          <div class=\"metric-value mem-value\" id=\"mem-rss\">-- MB</div>\n"
         "          <div class=\"metric-details\">\n"
@@ -373,7 +551,7 @@ int web_generate_html(char *buffer, size_t buffer_size, pid_t pid) {
         "          </div>\n"
         "        </div>\n"
         "\n"
-        "        <div class=\"metric-card\">\n"
+        "        <div class=\"metric-card proc-card\">\n"
         "          <div class=\"metric-title\">I/O Activity</div>\n"
         "          <div class=\"metric-value io-value\" id=\"io-read\">-- KB/s</div>\n"
         "          <div class=\"metric-details\">\n"
@@ -400,6 +578,8 @@ int web_generate_html(char *buffer, size_t buffer_size, pid_t pid) {
         "\n"
         "  <script src=\"https://cdn.jsdelivr.net/npm/chart.js@4.4.0/dist/chart.umd.min.js\"></script>\n"
         "  <script>\n"
+        "    const escapeHtml = s => String(s).replace(/[&<>\"']/g, c =>\n"
+        "      ({'&': '&amp;', '<': '&lt;', '>': '&gt;', '\"': '&quot;', \"'\": '&#39;'})[c]);\n"
         "    const maxDataPoints = 60;\n"
         "    const chartData = {\n"
         "      labels: [],\n"
@@ -464,32 +644,57 @@ int web_generate_html(char *buffer, size_t buffer_size, pid_t pid) {
         "          document.getElementById('loading').style.display = 'none';\n"
         "          document.getElementById('content').style.display = 'block';\n"
         "\n"
-        "          document.getElementById('cpu-percent').textContent = data.cpu.percent.toFixed(2) + '%%';\n"
-        "          document.getElementById('cpu-threads').textContent = data.cpu.threads;\n"
-        "          document.getElementById('cpu-utime').textContent = data.cpu.utime;\n"
-        "          document.getElementById('cpu-stime').textContent = data.cpu.stime;\n"
-        "          document.getElementById('cpu-ctxt').textContent = \n"
-        "            data.cpu.ctxt_switches_vol + ' / ' + data.cpu.ctxt_switches_invol;\n"
+        "          const cg = data.cgroup;\n"
+        "          if (cg) {\n"
+        "            document.getElementById('cgroup-card').style.display = 'block';\n"
+        "            document.querySelectorAll('.proc-card').forEach(c => c.style.display = 'none');\n"
+        "            document.getElementById('cg-cores').textContent = cg.cpu_cores.toFixed(3) + ' cores';\n"
+        "            document.getElementById('cg-limit').textContent = \n"
+        "              cg.cpu_limit_percent > 0 ? cg.cpu_limit_percent.toFixed(1) + '%%' : 'unlimited';\n"
+        "            document.getElementById('cg-throttle').textContent = \n"
+        "              (cg.throttle_rate * 100).toFixed(1) + '%% of periods, ' + cg.throttled_percent.toFixed(1) + '%% of time';\n"
+        "            document.getElementById('cg-memory').textContent = cg.memory_mb.toFixed(2) + ' MB' +\n"
+        "              (cg.memory_limit_mb > 0 ? ' (' + cg.memory_percent.toFixed(1) + '%% of limit)' : '');\n"
+        "            document.getElementById('cg-io').textContent = \n"
+        "              cg.read_rate_kbs.toFixed(2) + ' / ' + cg.write_rate_kbs.toFixed(2);\n"
+        "            document.getElementById('cg-iops').textContent = \n"
+        "              cg.read_iops.toFixed(1) + ' / ' + cg.write_iops.toFixed(1);\n"
+        "            document.getElementById('cg-pids').textContent = cg.pids;\n"
+        "            document.getElementById('cg-devices').innerHTML = cg.devices.length == 0 ? 'none' :\n"
+        "              cg.devices.map(d => `<br>${d.name}: ${d.read_kbs.toFixed(1)} / ${d.write_kbs.toFixed(1)} KB/s, ` +\n"
+        "                `${(d.read_iops + d.write_iops).toFixed(0)} IOPS` +\n"
+        "                (d.discard_kbs > 0 ? `, discard ${d.discard_kbs.toFixed(1)} KB/s` : '') +\n"
+        "                (d.cost_wait_percent > 0 ? `, iocost wait ${d.cost_wait_percent.toFixed(1)}%%` : '') +\n"
+        "                (d.avg_lat_usec > 0 ? `, ${d.avg_lat_usec} us avg` : '') +\n"
+        "                (d.latency_target_usec > 0 ? ` (target ${d.latency_target_usec} us)` : '')).join('');\n"
+        "          } else {\n"
+        "            document.getElementById('cpu-percent').textContent = data.cpu.percent.toFixed(2) + '%%';\n"
+        "            document.getElementById('cpu-threads').textContent = data.cpu.threads;\n"
+        "            document.getElementById('cpu-utime').textContent = data.cpu.utime;\n"
+        "            document.getElementById('cpu-stime').textContent = data.cpu.stime;\n"
+        "            document.getElementById('cpu-ctxt').textContent = \n"
+        "              data.cpu.ctxt_switches_vol + ' / ' + data.cpu.ctxt_switches_invol;\n"
         "\n"
-        "          document.getElementById('mem-rss').textContent = data.memory.rss_mb.toFixed(2) + ' MB';\n"
-        "          document.getElementById('mem-vsz').textContent = data.memory.vsz_mb.toFixed(2);\n"
-        "          document.getElementById('mem-shared').textContent = data.memory.shared_kb;\n"
-        "          document.getElementById('mem-data').textContent = data.memory.data_kb;\n"
-        "          document.getElementById('mem-stack').textContent = data.memory.stack_kb;\n"
+        "            document.getElementById('mem-rss').textContent = data.memory.rss_mb.toFixed(2) + ' MB';\n"
+        "            document.getElementById('mem-vsz').textContent = data.memory.vsz_mb.toFixed(2);\n"
+        "            document.getElementById('mem-shared').textContent = data.memory.shared_kb;\n"
+        "            document.getElementById('mem-data').textContent = data.memory.data_kb;\n"
+        "            document.getElementById('mem-stack').textContent = data.memory.stack_kb;\n"
         "\n"
-        "          document.getElementById('io-read').textContent = data.io.read_rate_kbs.toFixed(2) + ' KB/s';\n"
-        "          document.getElementById('io-write').textContent = data.io.write_rate_kbs.toFixed(2);\n"
-        "          document.getElementById('io-read-bytes').textContent = data.io.read_bytes;\n"
-        "          document.getElementById('io-write-bytes').textContent = data.io.write_bytes;\n"
-        "          document.getElementById('io-syscalls').textContent = \n"
-        "            data.io.syscr + ' / ' + data.io.syscw;\n"
+        "            document.getElementById('io-read').textContent = data.io.read_rate_kbs.toFixed(2) + ' KB/s';\n"
+        "            document.getElementById('io-write').textContent = data.io.write_rate_kbs.toFixed(2);\n"
+        "            document.getElementById('io-read-bytes').textContent = data.io.read_bytes;\n"
+        "            document.getElementById('io-write-bytes').textContent = data.io.write_bytes;\n"
+        "            document.getElementById('io-syscalls').textContent = \n"
+        "              data.io.syscr + ' / ' + data.io.syscw;\n"
+        "          }\n"
         "\n"
         "          const now = new Date();\n"
         "          const timeLabel = now.toLocaleTimeString();\n"
         "\n"
         "          chartData.labels.push(timeLabel);\n"
-        "          chartData.datasets[0].data.push(data.cpu.percent);\n"
-        "          chartData.datasets[1].data.push(data.memory.rss_mb);\n"
+        "          chartData.datasets[0].data.push(cg ? cg.cpu_percent : data.cpu.percent);\n"
+        "          chartData.datasets[1].data.push(cg ? cg.memory_mb : data.memory.rss_mb);\n"
         "\n"
         "          if (chartData.labels.length > maxDataPoints) {\n"
         "            chartData.labels.shift();\n"
@@ -503,7 +708,7 @@ int web_generate_html(char *buffer, size_t buffer_size, pid_t pid) {
         "          if (data.anomalies && data.anomalies.length > 0) {\n"
         "            anomaliesList.innerHTML = data.anomalies.map(a => \n"
         "              `<div class=\"anomaly-item anomaly-${a.severity.toLowerCase()}\">\n"
-        "                <strong>${a.severity}</strong>: ${a.description}\n"
+        "                <strong>${a.severity}</strong>: ${escapeHtml(a.description)}\n"
         "                <br><small>Value: ${a.value.toFixed(2)}, Expected: ${a.expected.toFixed(2)}, \n"
         "                Deviation: ${a.deviation_sigma.toFixed(2)}σ</small>\n"
         "              </div>`\n"
@@ -525,107 +730,89 @@ int web_generate_html(char *buffer, size_t buffer_size, pid_t pid) {
         "  </script>\n"
         "</body>\n"
         "</html>\n",
-        pid, pid
+        target, target
     );
 }
 
-int web_handle_request(int client_fd, const char *request, web_config_t *config) {
-    char response[WEB_BUFFER_SIZE];
-    char content[WEB_BUFFER_SIZE];
-    int content_len;
-
-    /* Parse request */
-    if (strstr(request, "GET /api/metrics") != NULL) {
-        /* API endpoint - return JSON */
-        content_len = web_generate_metrics_json(config->monitored_pid, content,
-                                                sizeof(content), config->enable_anomaly,
-                                                config->enable_anomaly ? &global_detector : NULL);
-
-        if (content_len < 0) {
-            const char *error_json = "{\"error\": \"Process no longer exists\"}";
-            content_len = strlen(error_json);
-            strcpy(content, error_json);
+/* Write all of data to a non-blocking client, waiting while its send buffer is full */
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+            if ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+                poll(&pfd, 1, WEB_SEND_TIMEOUT_MS) <= 0) {
+                return -1;
+            }
+            continue;
         }
-
-        snprintf(response, sizeof(response),
-            "HTTP/1.1 200 OK\r\n"
-            "Content-Type: application/json\r\n"
-            "Access-Control-Allow-Origin: *\r\n"
-            "Content-Length: %d\r\n"
-            "Connection: close\r\n"
-            "\r\n"
-            "%s",
-            content_len, content
-        );
-    } else {
-        /* Main page - return HTML */
-        content_len = web_generate_html(content, sizeof(content), config->monitored_pid);
-
-        snprintf(response, sizeof(response),
-            "HTTP/1.1 200 OK\r\n"
-            "Content-Type: text/html\r\n"
-            "Content-Length: %d\r\n"
-            "Connection: close\r\n"
-            "\r\n"
-            "%s",
-            content_len, content
-        );
+        data += sent;
+        len -= (size_t)sent;
     }
-
-    send(client_fd, response, strlen(response), 0);
     return 0;
 }
 
-int web_dashboard_start(web_config_t *config) {
-    int server_fd, client_fd;
-    struct sockaddr_in address;
-    socklen_t addrlen = sizeof(address);
-    char buffer[WEB_BUFFER_SIZE];
+int web_handle_request(int client_fd, const char *request, const web_config_t *config) {
+    char header[256];
+    const char *headers;
+    size_t content_size = WEB_BUFFER_SIZE;
+    char *content = malloc(content_size);
+    int content_len;
 
-    /* Initialize server */
-    server_fd = web_dashboard_init(config->port);
-    if (server_fd < 0) {
+    if (!content) {
         return -1;
     }
 
-    /* Initialize anomaly detector if needed */
-    if (config->enable_anomaly) {
-        if (anomaly_detector_init(&global_detector, config->monitored_pid) != 0) {
-            fprintf(stderr, "Warning: Failed to initialize anomaly detector\n");
-            config->enable_anomaly = 0;
-        }
-    }
-
-    printf("Dashboard available at: http://localhost:%d\n", config->port);
-    printf("API endpoint: http://localhost:%d/api/metrics\n", config->port);
-    printf("Press Ctrl+C to stop the server.\n\n");
+    /* Parse request */
+    if (strstr(request, "GET /api/metrics") != NULL) {
+        /* API endpoint - return JSON */
+        content_len = has_sample ? web_generate_metrics_json(&latest, content, content_size)
+                                 : -1;
 
-    /* Main server loop */
-    while (config->running && *(config->running)) {
-        client_fd = accept(server_fd, (struct sockaddr *)&address, &addrlen);
-        if (client_fd < 0) {
-            if (errno == EINTR) {
-                continue;  /* Interrupted by signal */
-            }
-            perror("accept");
-            continue;
+        if (content_len < 0) {
+            content_len = snprintf(content, content_size, "%s",
+                                   "{\"error\": \"No sample collected yet\"}");
         }
-
-        /* Read request */
-        ssize_t bytes_read = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-        if (bytes_read > 0) {
-            buffer[bytes_read] = '\0';
-            web_handle_request(client_fd, buffer, config);
+        headers = "Content-Type: application/json\r\n"
+                  "Access-Control-Allow-Origin: *\r\n";
+    } else {
+        /* Main page - return HTML */
+        content_len = web_generate_html(content, content_size, config);
+
+        /* Size the buffer to the page and render it again */
+        if (content_len >= 0 && (size_t)content_len >= content_size) {
+            content_size = (size_t)content_len + 1;
+            char *grown = realloc(content, content_size);
+            if (!grown) {
+                free(content);
+                return -1;
+            }
+            content = grown;
+            content_len = web_generate_html(content, content_size, config);
         }
-
-        close(client_fd);
+        headers = "Content-Type: text/html\r\n";
     }
 
-    /* Cleanup */
-    if (config->enable_anomaly) {
-        anomaly_detector_cleanup(&global_detector);
+    if (content_len < 0 || (size_t)content_len >= content_size) {
+        free(content);
+        return -1;
     }
-    web_dashboard_cleanup(server_fd);
 
-    return 0;
+    /* Header and body go out separately, so Content-Length is what is sent */
+    int header_len = snprintf(header, sizeof(header),
+        "HTTP/1.1 200 OK\r\n"
+        "%s"
+        "Content-Length: %d\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        headers, content_len
+    );
+
+    int result = send_all(client_fd, header, (size_t)header_len) == 0 &&
+                 send_all(client_fd, content, (size_t)content_len) == 0 ? 0 : -1;
+    free(content);
+    return result;
 }
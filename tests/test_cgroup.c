@@ -0,0 +1,679 @@
+#include "../include/cgroup.h"
+#include "../include/cgroup_events.h"
+#include "../include/cgroup_tree.h"
+#include "../include/anomaly.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+void test_cgroup_init(void) {
+    printf("Test: Cgroup manager initialization... ");
+    assert(cgroup_init() == 0);
+    printf("PASSED (cgroup v%d at %s)\n", cgroup_detect_version() == CGROUP_V2 ? 2 : 1,
+           cgroup_get_mount_point());
+}
+
+void test_psi_parse(void) {
+    printf("Test: PSI pressure file parsing... ");
+
+    cgroup_psi_t psi;
+    const char *both = "some avg10=12.50 avg60=3.25 avg300=0.75 total=123456\n"
+                       "full avg10=1.00 avg60=0.50 avg300=0.10 total=7890\n";
+    assert(cgroup_parse_psi(both, &psi) == 0);
+    assert(psi.some_avg10 > 12.49 && psi.some_avg10 < 12.51);
+    assert(psi.some_avg300 > 0.74 && psi.some_avg300 < 0.76);
+    assert(psi.some_total == 123456);
+    assert(psi.has_full);
+    assert(psi.full_total == 7890);
+
+    /* cpu.pressure before 5.13 has no full line */
+    assert(cgroup_parse_psi("some avg10=0.00 avg60=0.00 avg300=0.00 total=42\n", &psi) == 0);
+    assert(!psi.has_full);
+    assert(psi.some_total == 42);
+
+    assert(cgroup_parse_psi("garbage\n", &psi) != 0);
+    printf("PASSED\n");
+}
+
+void test_pressure_anomaly(void) {
+    printf("Test: PSI events through the anomaly detector... ");
+
+    anomaly_detector_t detector;
+    assert(anomaly_detector_init(&detector, getpid()) == 0);
+
+    /* 100 ms within 2 s is a 5% threshold */
+    anomaly_detector_report_pressure(&detector, ANOMALY_MEMORY_PRESSURE, 25.0, 100000, 2000000);
+    anomaly_detector_report_pressure(&detector, ANOMALY_IO_PRESSURE, 2.0, 100000, 2000000);
+
+    anomaly_event_t events[4];
+    assert(anomaly_detector_take_events(&detector, events, 1) == 1);
+    assert(events[0].type == ANOMALY_MEMORY_PRESSURE);
+    assert(events[0].severity == SEVERITY_CRITICAL);
+    assert(events[0].expected_mean > 4.99 && events[0].expected_mean < 5.01);
+
+    /* The rest is returned by the next check, ahead of sampled anomalies */
+    assert(anomaly_detector_check(&detector, events, 4) == 1);
+    assert(events[0].type == ANOMALY_IO_PRESSURE);
+    assert(events[0].severity == SEVERITY_LOW);
+    assert(anomaly_detector_take_events(&detector, events, 4) == 0);
+
+    /* A full queue drops the oldest event */
+    for (int i = 0; i < ANOMALY_MAX_PENDING + 2; i++) {
+        anomaly_detector_report_pressure(&detector, ANOMALY_CPU_PRESSURE, (double)i,
+                                         100000, 2000000);
+    }
+    anomaly_event_t all[ANOMALY_MAX_PENDING];
+    assert(anomaly_detector_take_events(&detector, all, ANOMALY_MAX_PENDING) ==
+           ANOMALY_MAX_PENDING);
+    assert(all[0].value == 2.0);
+
+    anomaly_detector_cleanup(&detector);
+    printf("PASSED\n");
+}
+
+void test_psi_trigger(void) {
+    printf("Test: PSI trigger on the root cgroup... ");
+
+    cgroup_pressure_t pressure;
+    if (cgroup_collect_pressure("/", &pressure) != 0) {
+        printf("SKIPPED (kernel without PSI)\n");
+        return;
+    }
+    assert(pressure.has_psi[CGROUP_PSI_CPU]);
+
+    cgroup_psi_trigger_t trigger;
+    if (cgroup_psi_trigger_open("/", CGROUP_PSI_CPU, 0, 500000, 2000000, &trigger) != 0) {
+        printf("SKIPPED (cannot arm trigger: %s)\n", strerror(errno));
+        return;
+    }
+    assert(trigger.fd >= 0);
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    assert(epfd >= 0);
+    struct epoll_event ev = { .events = EPOLLPRI };
+    assert(epoll_ctl(epfd, EPOLL_CTL_ADD, trigger.fd, &ev) == 0);
+
+    /* Readable as a plain pressure file; firing depends on the host load */
+    cgroup_psi_t psi;
+    int fired = epoll_wait(epfd, &ev, 1, 0);
+    assert(cgroup_psi_trigger_read(&trigger, &psi) == 0);
+    assert(trigger.events == 1);
+
+    close(epfd);
+    cgroup_psi_trigger_close(&trigger);
+    assert(trigger.fd == -1);
+    printf("PASSED (%s)\n", fired > 0 ? "fired" : "armed");
+}
+
+void test_throttle_analysis(void) {
+    printf("Test: Throttling analysis from cpu.stat samples... ");
+
+    /* 0.5 cores: 5 periods at the quota (throttled), then 5 at 40% of it;
+     * four samples per 100 ms period */
+    cgroup_cpu_t samples[41];
+    memset(samples, 0, sizeof(samples));
+    for (int i = 0; i < 41; i++) {
+        cgroup_cpu_t *s = &samples[i];
+        int period = i / 4;
+        s->timestamp.tv_sec = (i * 25) / 1000;
+        s->timestamp.tv_nsec = ((i * 25) % 1000) * 1000000L;
+        s->quota_usec = 50000;
+        s->period_usec = 100000;
+        s->nr_periods = period;
+        s->nr_throttled = period < 5 ? period : 5;
+        s->throttled_usec = s->nr_throttled * 50000;
+        s->usage_usec = (period < 5 ? period * 50000 : 250000 + (period - 5) * 20000);
+    }
+
+    cgroup_throttle_analysis_t analysis;
+    assert(cgroup_analyze_throttling_samples(samples, 41, &analysis) == 0);
+    assert(analysis.configured_limit > 0.49 && analysis.configured_limit < 0.51);
+    assert(analysis.periods == 10);
+    assert(analysis.throttle_count == 5);
+    assert(analysis.throttle_ratio > 0.49 && analysis.throttle_ratio < 0.51);
+    assert(analysis.burst_count == 1 && analysis.max_burst == 5);
+    assert(analysis.usage_histogram[10] == 5);   /* 100-110% of quota */
+    assert(analysis.usage_histogram[4] == 5);    /* 40-50% */
+    assert(analysis.precision > 99.9);
+    assert(analysis.measured_usage > 0.34 && analysis.measured_usage < 0.36);
+    assert(analysis.samples == 41);
+
+    assert(cgroup_analyze_throttling_samples(samples, 1, &analysis) != 0);
+    printf("PASSED\n");
+}
+
+void test_file_cache(void) {
+    printf("Test: Cached cgroup file descriptors... ");
+
+    char buffer[4096];
+    cgroup_cache_cleanup();
+    assert(cgroup_read_file("/", CGROUP_FILE_CPU_STAT, buffer, sizeof(buffer)) > 0);
+    assert(strstr(buffer, "usage_usec") != NULL);
+    /* Spellings of the same cgroup share one handle */
+    assert(cgroup_read_file("", CGROUP_FILE_CPU_STAT, buffer, sizeof(buffer)) > 0);
+    assert(cgroup_read_file("//", CGROUP_FILE_CPU_STAT, buffer, sizeof(buffer)) > 0);
+    assert(cgroup_cached_count() == 1);
+
+    assert(cgroup_read_file("/no_such_cgroup", CGROUP_FILE_CPU_STAT, buffer,
+                            sizeof(buffer)) < 0);
+    assert(errno == ENOENT);
+    assert(cgroup_cached_count() == 1);
+
+    /* The root has no cpu.max: the miss is remembered on its handle */
+    for (int i = 0; i < 2; i++) {
+        errno = 0;
+        assert(cgroup_read_file("/", CGROUP_FILE_CPU_MAX, buffer, sizeof(buffer)) < 0);
+        assert(errno == ENOENT);
+    }
+    assert(cgroup_cached_count() == 1);
+    assert(cgroup_read_file("/", CGROUP_FILE_CPU_STAT, buffer, sizeof(buffer)) > 0);
+
+    /* A cgroup removed and created again is reopened transparently */
+    char name[64], path[MAX_CGROUP_PATH + 64];
+    snprintf(name, sizeof(name), "test_file_cache_%d", getpid());
+    snprintf(path, sizeof(path), "%s/%s", cgroup_get_mount_point(), name);
+    if (mkdir(path, 0755) == 0) {
+        assert(cgroup_read_file(name, CGROUP_FILE_CPU_STAT, buffer, sizeof(buffer)) > 0);
+        assert(cgroup_cached_count() == 2);
+        assert(rmdir(path) == 0);
+        assert(mkdir(path, 0755) == 0);
+        assert(cgroup_read_file(name, CGROUP_FILE_CPU_STAT, buffer, sizeof(buffer)) > 0);
+        assert(rmdir(path) == 0);
+        assert(cgroup_read_file(name, CGROUP_FILE_CPU_STAT, buffer, sizeof(buffer)) < 0);
+        assert(cgroup_cached_count() == 1);
+    }
+
+    cgroup_forget("/");
+    assert(cgroup_cached_count() == 0);
+    printf("PASSED\n");
+}
+
+/* Write a cgroup control file such as cgroup.subtree_control */
+static int write_control(const char *dir, const char *file, const char *value) {
+    char path[MAX_CGROUP_PATH * 2];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+    int ok = fputs(value, fp) >= 0;
+    return (fclose(fp) == 0 && ok) ? 0 : -1;
+}
+
+void test_missing_file_expiry(void) {
+    printf("Test: Missing cgroup files are retried once controllers change... ");
+
+    /* A controller the root hands down, whose file the cache knows */
+    static const struct {
+        const char *name;
+        cgroup_file_t file;
+    } controllers[] = {
+        { "pids", CGROUP_FILE_PIDS_CURRENT },
+        { "memory", CGROUP_FILE_MEMORY_CURRENT },
+        { "io", CGROUP_FILE_IO_STAT },
+    };
+    char subtree[256] = "";
+    char root_control[MAX_CGROUP_PATH + 32];
+    snprintf(root_control, sizeof(root_control), "%s/cgroup.subtree_control",
+             cgroup_get_mount_point());
+    FILE *fp = fopen(root_control, "r");
+    if (fp) {
+        if (!fgets(subtree, sizeof(subtree), fp)) {
+            subtree[0] = '\0';
+        }
+        fclose(fp);
+    }
+    int chosen = -1;
+    for (int i = 0; i < (int)(sizeof(controllers) / sizeof(controllers[0])); i++) {
+        if (strstr(subtree, controllers[i].name)) {
+            chosen = i;
+            break;
+        }
+    }
+    if (chosen < 0) {
+        printf("SKIPPED (no pids, memory or io controller on the cgroup2 root)\n");
+        return;
+    }
+
+    char name[64], child[96], path[MAX_CGROUP_PATH + 64], child_path[MAX_CGROUP_PATH + 96];
+    snprintf(name, sizeof(name), "test_missing_%d", getpid());
+    snprintf(child, sizeof(child), "%s/c", name);
+    snprintf(path, sizeof(path), "%s/%s", cgroup_get_mount_point(), name);
+    snprintf(child_path, sizeof(child_path), "%s/%s", cgroup_get_mount_point(), child);
+    if (mkdir(path, 0755) != 0 || mkdir(child_path, 0755) != 0) {
+        rmdir(path);
+        printf("SKIPPED (cannot create cgroups)\n");
+        return;
+    }
+
+    char buffer[4096];
+    cgroup_file_t file = controllers[chosen].file;
+    assert(cgroup_read_file(child, file, buffer, sizeof(buffer)) < 0);
+    assert(errno == ENOENT);
+
+    char enable[32];
+    snprintf(enable, sizeof(enable), "+%s", controllers[chosen].name);
+    assert(write_control(path, "cgroup.subtree_control", enable) == 0);
+
+    /* The mark holds until the next once-a-second comparison */
+    struct timespec wait = { 1, 100000000 };
+    nanosleep(&wait, NULL);
+    assert(cgroup_read_file(child, file, buffer, sizeof(buffer)) > 0);
+
+    cgroup_forget(child);
+    assert(rmdir(child_path) == 0);
+    assert(rmdir(path) == 0);
+    printf("PASSED\n");
+}
+
+static const cgroup_tree_node_t *find_node(const cgroup_tree_result_t *result, const char *path) {
+    for (int i = 0; i < result->count; i++) {
+        if (strcmp(result->nodes[i].path, path) == 0) {
+            return &result->nodes[i];
+        }
+    }
+    return NULL;
+}
+
+/* The test's parent and both children, with their depths and ids */
+static void assert_subtree(const cgroup_tree_result_t *result, const char *name) {
+    char node_path[MAX_CGROUP_PATH];
+    snprintf(node_path, sizeof(node_path), "/%s", name);
+    const cgroup_tree_node_t *node = find_node(result, node_path);
+    assert(node && node->depth == 1 && node->id != 0);
+
+    for (int i = 0; i < 2; i++) {
+        snprintf(node_path, sizeof(node_path), "/%s/c%d", name, i);
+        node = find_node(result, node_path);
+        assert(node && node->depth == 2 && node->id != 0);
+        assert(node->has_cpu);
+    }
+}
+
+void test_cgroup_tree(void) {
+    printf("Test: Recursive cgroup sweep... ");
+
+    /* A small subtree: parent with two children */
+    char name[64], path[MAX_CGROUP_PATH + 64], child[MAX_CGROUP_PATH + 96];
+    snprintf(name, sizeof(name), "test_cgroup_tree_%d", getpid());
+    snprintf(path, sizeof(path), "%s/%s", cgroup_get_mount_point(), name);
+    int created = (mkdir(path, 0755) == 0);
+    for (int i = 0; created && i < 2; i++) {
+        snprintf(child, sizeof(child), "%s/c%d", path, i);
+        assert(mkdir(child, 0755) == 0);
+    }
+
+    assert(cgroup_tree_init("/", 2) == 0);
+    assert(cgroup_tree_thread_count() == 2);
+
+    cgroup_tree_result_t prev, curr;
+    memset(&prev, 0, sizeof(prev));
+    memset(&curr, 0, sizeof(curr));
+    assert(cgroup_tree_scan(&prev) >= 1);
+    assert(strcmp(prev.nodes[0].path, "/") == 0 && prev.nodes[0].depth == 0);
+    for (int i = 1; i < prev.count; i++) {
+        assert(strcmp(prev.nodes[i - 1].path, prev.nodes[i].path) < 0);
+    }
+
+    if (created) {
+        assert_subtree(&prev, name);
+    }
+
+    /* Busy child in the root cgroup: rates come from the second sweep */
+    pid_t busy = fork();
+    assert(busy >= 0);
+    if (busy == 0) {
+        for (;;) {
+        }
+    }
+    usleep(200000);
+    /* Other cgroups on the host may come and go between the sweeps */
+    assert(cgroup_tree_scan(&curr) >= 1);
+    assert(strcmp(curr.nodes[0].path, "/") == 0);
+    if (created) {
+        assert_subtree(&curr, name);
+    }
+    cgroup_tree_calculate_rates(&prev, &curr);
+    kill(busy, SIGKILL);
+    waitpid(busy, NULL, 0);
+    assert(curr.nodes[0].cpu_percent > 10.0);
+    assert(curr.scan_ms < 1000.0);
+    int swept = curr.count;
+    double scan_ms = curr.scan_ms;
+
+    cgroup_tree_result_free(&prev);
+    cgroup_tree_result_free(&curr);
+    cgroup_tree_cleanup();
+
+    cgroup_tree_sort_t sort;
+    assert(cgroup_tree_parse_sort("memory", &sort) == 0 && sort == CGROUP_TREE_SORT_MEMORY);
+    assert(cgroup_tree_parse_sort("disk", &sort) != 0);
+
+    if (created) {
+        for (int i = 0; i < 2; i++) {
+            snprintf(child, sizeof(child), "%s/c%d", path, i);
+            rmdir(child);
+        }
+        rmdir(path);
+    }
+    printf("PASSED (%d cgroups in %.2f ms)\n", swept, scan_ms);
+}
+
+/* Wait for the watch set and return the first change of kind */
+static int wait_event(cgroup_event_kind_t kind, cgroup_event_t *found) {
+    struct pollfd pfd = { .fd = cgroup_events_get_fd(), .events = POLLIN };
+    for (int tries = 0; tries < 10; tries++) {
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        cgroup_event_t events[CGROUP_EVENTS_MAX_EVENTS];
+        int n = cgroup_events_read(events, CGROUP_EVENTS_MAX_EVENTS);
+        for (int i = 0; i < n; i++) {
+            if (events[i].kind == kind) {
+                *found = events[i];
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+void test_cgroup_events(void) {
+    printf("Test: cgroup.events notifications... ");
+
+    char name[64], path[MAX_CGROUP_PATH + 64];
+    snprintf(name, sizeof(name), "test_cgroup_events_%d", getpid());
+    snprintf(path, sizeof(path), "%s/%s", cgroup_get_mount_point(), name);
+    if (mkdir(path, 0755) != 0) {
+        printf("SKIPPED (cannot create cgroup: %s)\n", strerror(errno));
+        return;
+    }
+
+    int watch = cgroup_events_watch(name);
+    assert(watch >= 0);
+    assert(strcmp(cgroup_events_path(watch), name) == 0);
+
+    /* Nothing changed: the baseline produces no events */
+    cgroup_event_t events[CGROUP_EVENTS_MAX_EVENTS];
+    assert(cgroup_events_read(events, CGROUP_EVENTS_MAX_EVENTS) == 0);
+
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+
+    cgroup_event_t event;
+    int moved = (cgroup_move_process(child, name) == 0);
+    if (moved) {
+        assert(wait_event(CGROUP_EVENT_POPULATED, &event) == 0);
+        assert(event.value == 1 && event.watch == watch);
+    }
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    if (moved) {
+        assert(wait_event(CGROUP_EVENT_POPULATED, &event) == 0);
+        assert(event.value == 0);
+    }
+
+    cgroup_events_unwatch(watch);
+    assert(cgroup_events_path(watch) == NULL);
+    rmdir(path);
+    printf("PASSED\n");
+}
+
+void test_cgroup_rates(void) {
+    printf("Test: Cgroup rates between samples... ");
+
+    cgroup_metrics_t prev, curr;
+    memset(&prev, 0, sizeof(prev));
+    prev.has_cpu = prev.has_memory = prev.has_blkio = 1;
+    prev.cpu.timestamp.tv_sec = 100;
+    prev.cpu.usage_usec = 1000000;
+    prev.cpu.user_usec = 800000;
+    prev.cpu.nr_periods = 100;
+    prev.cpu.nr_throttled = 10;
+    prev.cpu.quota_usec = 200000;
+    prev.cpu.period_usec = 100000;
+    prev.blkio.timestamp = prev.cpu.timestamp;
+    prev.blkio.read_bytes = 4096;
+    prev.blkio.read_iops = 1;
+
+    /* Two seconds later: 3 s of CPU, 20 periods with 5 throttled */
+    curr = prev;
+    curr.cpu.timestamp.tv_sec = 102;
+    curr.cpu.usage_usec = 4000000;
+    curr.cpu.user_usec = 3300000;
+    curr.cpu.system_usec = 500000;
+    curr.cpu.nr_periods = 120;
+    curr.cpu.nr_throttled = 15;
+    curr.cpu.throttled_usec = 200000;
+    curr.memory.current = 256ULL << 20;
+    curr.memory.limit = 1024ULL << 20;
+    curr.blkio.timestamp = curr.cpu.timestamp;
+    curr.blkio.read_bytes = 4096 + 2 * 1048576;
+    curr.blkio.write_bytes = 8192;
+    curr.blkio.read_iops = 201;
+    curr.blkio.write_iops = 4;
+
+    cgroup_rates_t rates;
+    assert(cgroup_calculate_rates(&prev, &curr, &rates) == 0);
+    assert(rates.interval > 1.99 && rates.interval < 2.01);
+    assert(rates.cpu_cores > 1.49 && rates.cpu_cores < 1.51);
+    assert(rates.user_cores > 1.24 && rates.user_cores < 1.26);
+    assert(rates.cpu_limit_percent > 74.9 && rates.cpu_limit_percent < 75.1);
+    assert(rates.throttle_rate > 0.249 && rates.throttle_rate < 0.251);
+    assert(rates.throttled_percent > 9.9 && rates.throttled_percent < 10.1);
+    assert(rates.memory_percent > 24.9 && rates.memory_percent < 25.1);
+    assert(rates.read_rate > 1048575.0 && rates.read_rate < 1048577.0);
+    assert(rates.write_rate > 4095.0 && rates.write_rate < 4097.0);
+    assert(rates.read_iops > 99.9 && rates.read_iops < 100.1);
+    assert(rates.write_iops > 1.99 && rates.write_iops < 2.01);
+    assert(cgroup_calculate_cpu_utilization(&prev.cpu, &curr.cpu) == rates.cpu_cores);
+
+    /* A recreated cgroup restarts its counters: no activity, not a wrap */
+    curr.cpu.usage_usec = 10;
+    curr.blkio.read_bytes = 0;
+    assert(cgroup_calculate_rates(&prev, &curr, &rates) == 0);
+    assert(rates.cpu_cores == 0.0);
+    assert(rates.read_rate == 0.0);
+
+    curr.memory.limit = UINT64_MAX;
+    assert(cgroup_calculate_memory_utilization(&curr.memory) == 0.0);
+
+    /* CSV rows append under one header */
+    char path[] = "/tmp/cgroup_rates_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    assert(cgroup_export_metrics_csv(&curr, &rates, path, 0) == 0);
+    assert(cgroup_export_metrics_csv(&curr, NULL, path, 1) == 0);
+    FILE *fp = fopen(path, "r");
+    assert(fp);
+    char line[1024];
+    int lines = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lines++;
+    }
+    fclose(fp);
+    unlink(path);
+    assert(lines == 3);
+    printf("PASSED\n");
+}
+
+void test_io_stat_devices(void) {
+    printf("Test: Per-device io.stat parsing and rates... ");
+
+    /* Keys in any order, discard counters, iocost and blk-iolatency keys,
+     * and a key the parser does not know */
+    const char *before =
+        "254:0 rbytes=1048576 wbytes=0 rios=10 wios=0 dbytes=0 dios=0\n"
+        "8:16 wios=5 rios=2 wbytes=20480 rbytes=8192 dbytes=4096 dios=1 "
+        "cost.vrate=98.50 cost.usage=1000 cost.wait=0 cost.indebt=0 cost.indelay=0 "
+        "use_delay=0 delay_nsec=0 avg_lat=250 win=100 future=7\n";
+    const char *after =
+        "8:16 rbytes=8192 wbytes=2117632 rios=2 wios=105 dbytes=1052672 dios=3 "
+        "cost.vrate=100.00 cost.usage=201000 cost.wait=50000 cost.indebt=0 cost.indelay=0 "
+        "use_delay=-1 delay_nsec=0 avg_lat=900 win=100\n"
+        "254:0 rbytes=3145728 wbytes=0 rios=30 wios=0\n"
+        "7:3 rbytes=512 wbytes=0 rios=1 wios=0 dbytes=0 dios=0\n";
+
+    cgroup_blkio_t prev, curr;
+    memset(&prev, 0, sizeof(prev));
+    memset(&curr, 0, sizeof(curr));
+    assert(cgroup_parse_io_stat(before, &prev) == 2);
+    assert(prev.read_bytes == 1048576 + 8192);
+    assert(prev.write_iops == 5);
+    assert(prev.discard_bytes == 4096 && prev.discard_ios == 1);
+
+    const cgroup_io_device_t *disk = &prev.devices[1];
+    assert(disk->major == 8 && disk->minor == 16);
+    assert(disk->has_cost && disk->cost_vrate > 98.49 && disk->cost_vrate < 98.51);
+    assert(disk->has_latency && disk->avg_lat_usec == 250 && disk->latency_window_msec == 100);
+    assert(!prev.devices[0].has_cost && !prev.devices[0].has_latency);
+
+    /* Unknown devices are named by number */
+    const char *name = cgroup_device_name(8, 16);
+    assert(strcmp(disk->name, name ? name : "8:16") == 0);
+
+    prev.timestamp.tv_sec = 10;
+    assert(cgroup_parse_io_stat(after, &curr) == 3);
+    curr.timestamp.tv_sec = 12;
+    cgroup_calculate_device_rates(&prev, &curr);
+
+    disk = &curr.devices[0];
+    assert(disk->use_delay == 0);
+    assert(disk->write_rate > 1048575.0 && disk->write_rate < 1048577.0);
+    assert(disk->write_iops > 49.9 && disk->write_iops < 50.1);
+    assert(disk->discard_rate > 524287.0 && disk->discard_rate < 524289.0);
+    assert(disk->discard_iops > 0.99 && disk->discard_iops < 1.01);
+    assert(disk->cost_usage_percent > 9.9 && disk->cost_usage_percent < 10.1);
+    assert(disk->cost_wait_percent > 2.4 && disk->cost_wait_percent < 2.6);
+    assert(curr.devices[1].read_rate > 1048575.0 && curr.devices[1].read_rate < 1048577.0);
+
+    /* A device new in this sample has no rate yet */
+    assert(curr.devices[2].major == 7 && curr.devices[2].read_rate == 0.0);
+
+    /* Devices past the table still count in the totals */
+    char many[CGROUP_MAX_IO_DEVICES * 2 * 64];
+    int len = 0;
+    for (int d = 0; d < CGROUP_MAX_IO_DEVICES * 2; d++) {
+        len += snprintf(many + len, sizeof(many) - len,
+                        "250:%d rbytes=1 wbytes=0 rios=1 wios=0 dbytes=0 dios=0\n", d);
+    }
+    assert(cgroup_parse_io_stat(many, &curr) == CGROUP_MAX_IO_DEVICES);
+    assert(curr.read_bytes == CGROUP_MAX_IO_DEVICES * 2);
+    printf("PASSED\n");
+}
+
+void test_json_escape(void) {
+    printf("Test: Cgroup paths escaped in JSON... ");
+
+    char out[64];
+    assert(strcmp(cgroup_json_escape("/system.slice/a.service", out, sizeof(out)),
+                  "/system.slice/a.service") == 0);
+    assert(strcmp(cgroup_json_escape("/a\"b\\c\nd", out, sizeof(out)),
+                  "/a\\\"b\\\\c\\u000ad") == 0);
+
+    /* Truncation never splits an escape */
+    char small[4];
+    assert(strcmp(cgroup_json_escape("ab\"", small, sizeof(small)), "ab") == 0);
+
+    /* The exported file parses back to the original path */
+    cgroup_metrics_t metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    snprintf(metrics.cgroup_path, sizeof(metrics.cgroup_path), "/quote\"d");
+    char filename[64];
+    snprintf(filename, sizeof(filename), "/tmp/test_cgroup_json_%d.json", getpid());
+    assert(cgroup_export_metrics_json(&metrics, NULL, filename) == 0);
+    FILE *fp = fopen(filename, "r");
+    assert(fp);
+    char line[256];
+    assert(fgets(line, sizeof(line), fp) && fgets(line, sizeof(line), fp));
+    fclose(fp);
+    unlink(filename);
+    assert(strcmp(line, "  \"cgroup\": \"/quote\\\"d\",\n") == 0);
+    printf("PASSED\n");
+}
+
+void test_csv_quote(void) {
+    printf("Test: Cgroup paths quoted in CSV... ");
+
+    char out[64];
+    assert(strcmp(cgroup_csv_quote("/a,b\"c", out, sizeof(out)), "\"/a,b\"\"c\"") == 0);
+    char small[6];
+    assert(strcmp(cgroup_csv_quote("ab\"c", small, sizeof(small)), "\"ab\"") == 0);
+
+    /* Both exports keep the path in its own column */
+    cgroup_metrics_t metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    snprintf(metrics.cgroup_path, sizeof(metrics.cgroup_path), "/x,\"y\"");
+    metrics.blkio.device_count = 1;
+    snprintf(metrics.blkio.devices[0].name, sizeof(metrics.blkio.devices[0].name), "sda");
+
+    char filename[64];
+    snprintf(filename, sizeof(filename), "/tmp/test_cgroup_csv_%d.csv", getpid());
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 0) {
+            assert(cgroup_export_metrics_csv(&metrics, NULL, filename, 0) == 0);
+        } else {
+            assert(cgroup_export_devices_csv(&metrics, filename, 0) == 0);
+        }
+        FILE *fp = fopen(filename, "r");
+        assert(fp);
+        char header[1024], row[1024];
+        assert(fgets(header, sizeof(header), fp) && fgets(row, sizeof(row), fp));
+        assert(!fgets(out, sizeof(out), fp));
+        fclose(fp);
+
+        /* Header and row have the same number of fields outside quotes */
+        int header_fields = 1, row_fields = 1, quoted = 0;
+        for (const char *p = header; *p; p++) {
+            header_fields += (*p == ',');
+        }
+        for (const char *p = row; *p; p++) {
+            if (*p == '"') {
+                quoted = !quoted;
+            } else if (*p == ',' && !quoted) {
+                row_fields++;
+            }
+        }
+        assert(row_fields == header_fields);
+        assert(strstr(row, ",\"/x,\"\"y\"\"\",") != NULL);
+    }
+    unlink(filename);
+    printf("PASSED\n");
+}
+
+int main(void) {
+    printf("\n=== Cgroup Manager Test Suite ===\n\n");
+
+    test_cgroup_init();
+    test_psi_parse();
+    test_pressure_anomaly();
+    test_psi_trigger();
+    test_throttle_analysis();
+    test_cgroup_rates();
+    test_io_stat_devices();
+    test_json_escape();
+    test_csv_quote();
+    test_file_cache();
+    test_missing_file_expiry();
+    test_cgroup_tree();
+    test_cgroup_events();
+
+    cgroup_events_cleanup();
+    cgroup_cleanup();
+
+    printf("\n=== Cgroup Manager Tests Completed ===\n\n");
+    return 0;
+}
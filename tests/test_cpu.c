@@ -1,8 +1,27 @@
 #include "../include/monitor.h"
+#include "../include/thread_monitor.h"
+#include "../include/scheduler.h"
+#include "../include/event_loop.h"
+#include "../include/anomaly.h"
+#include "../include/collector.h"
+#include "../include/pidwatch.h"
+#include "../include/proc_events.h"
+#include "../include/proc_scanner.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
 
 void test_cpu_monitor_init(void) {
     printf("Test: CPU monitor initialization... ");
@@ -26,6 +45,985 @@ void test_cpu_collect_self(void) {
     printf("PASSED\n");
 }
 
+void test_cpu_collect_exited(void) {
+    printf("Test: CPU collection detects exited process... ");
+
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+
+    cpu_metrics_t metrics;
+    assert(cpu_monitor_collect(child, &metrics) == 0);
+    assert(cpu_monitor_collect(child, &metrics) == 0);
+
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+
+    /* Cached descriptor must report the exit instead of stale data */
+    assert(cpu_monitor_collect(child, &metrics) != 0);
+    printf("PASSED\n");
+}
+
+void test_stat_parse_tricky_comm(void) {
+    printf("Test: stat parsing with spaces/parentheses in comm... ");
+
+    const char *line = "4242 (my (odd) proc) R 1 4242 4242 0 -1 4194560 "
+                       "150 0 3 0 25 7 1 2 20 0 4 0 98765 0 0\n";
+    proc_snapshot_t snap;
+    memset(&snap, 0, sizeof(snap));
+    assert(proc_snapshot_parse_stat(line, &snap) == 0);
+    assert(strcmp(snap.comm, "my (odd) proc") == 0);
+    assert(snap.state == 'R');
+    assert(snap.ppid == 1);
+    assert(snap.minflt == 150);
+    assert(snap.majflt == 3);
+    assert(snap.utime == 25);
+    assert(snap.stime == 7);
+    assert(snap.num_threads == 4);
+    assert(snap.starttime == 98765);
+    printf("PASSED\n");
+}
+
+void test_cpu_collect_taskstats(void) {
+    printf("Test: CPU collection through taskstats backend... ");
+
+    if (proc_snapshot_set_backend(PROCFS_BACKEND_TASKSTATS) != 0) {
+        printf("SKIPPED (taskstats unavailable)\n");
+        return;
+    }
+
+    cpu_metrics_t netlink, procfs;
+    assert(cpu_monitor_collect(getpid(), &netlink) == 0);
+    /* The family resolves unprivileged but queries need CAP_NET_ADMIN */
+    if (proc_snapshot_get_backend() != PROCFS_BACKEND_TASKSTATS) {
+        proc_snapshot_set_backend(PROCFS_BACKEND_PROCFS);
+        printf("SKIPPED (taskstats queries not permitted)\n");
+        return;
+    }
+    assert(netlink.num_threads == 1);
+    assert(netlink.timeslices > 0);
+
+    proc_snapshot_set_backend(PROCFS_BACKEND_PROCFS);
+    assert(cpu_monitor_collect(getpid(), &procfs) == 0);
+    assert(procfs.cpu_time_ns == 0);
+    assert(procfs.has_delays == 0);
+
+    /* Both sources count the same scheduler events */
+    assert(netlink.voluntary_ctxt_switches <= procfs.voluntary_ctxt_switches);
+    assert(netlink.utime <= procfs.utime + 1);
+    printf("PASSED\n");
+}
+
+void test_cpu_collect_schedstat(void) {
+    printf("Test: ns CPU time from schedstat... ");
+
+    procfs_schedstat_t sched;
+    assert(procfs_parse_schedstat("1234567 890 12\n", &sched) == 0);
+    assert(sched.cpu_time_ns == 1234567);
+    assert(sched.cpu_delay_ns == 890);
+    assert(sched.timeslices == 12);
+    assert(procfs_parse_schedstat("garbage\n", &sched) != 0);
+
+    if (proc_snapshot_set_cpu_clock(PROCFS_CPU_CLOCK_SCHEDSTAT) != 0) {
+        printf("SKIPPED (schedstat unavailable)\n");
+        return;
+    }
+
+    cpu_metrics_t prev, curr, result;
+    assert(cpu_monitor_collect(getpid(), &prev) == 0);
+    assert(prev.cpu_time_ns > 0);
+    assert(prev.timeslices > 0);
+
+    /* Well below one clock tick: ticks would usually report 0% */
+    volatile unsigned long sum = 0;
+    for (unsigned long i = 0; i < 200000; i++) {
+        sum += i;
+    }
+    assert(cpu_monitor_collect(getpid(), &curr) == 0);
+    assert(curr.cpu_time_ns > prev.cpu_time_ns);
+    assert(cpu_monitor_calculate_percentage(&prev, &curr, &result) == 0);
+    assert(result.cpu_percent > 0.0);
+
+    proc_snapshot_set_cpu_clock(PROCFS_CPU_CLOCK_TICKS);
+    printf("PASSED (CPU: %.2f%%)\n", result.cpu_percent);
+}
+
+static void *spin_until_stopped(void *arg) {
+    volatile int *stop = arg;
+    volatile unsigned long sum = 0;
+    while (!*stop) {
+        sum++;
+    }
+    return NULL;
+}
+
+static uint64_t leader_schedstat_ns(void) {
+    char buffer[128];
+    int fd = open("/proc/self/schedstat", O_RDONLY);
+    assert(fd >= 0);
+    ssize_t len = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    assert(len > 0);
+    buffer[len] = '\0';
+    return strtoull(buffer, NULL, 10);
+}
+
+void test_cpu_schedstat_threads(void) {
+    printf("Test: schedstat sums every thread... ");
+
+    if (proc_snapshot_set_cpu_clock(PROCFS_CPU_CLOCK_SCHEDSTAT) != 0) {
+        printf("SKIPPED (schedstat unavailable)\n");
+        return;
+    }
+
+    volatile int stop = 0;
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, spin_until_stopped, (void *)&stop) == 0);
+
+    cpu_metrics_t prev, curr, after;
+    assert(cpu_monitor_collect(getpid(), &prev) == 0);
+    uint64_t leader_before = leader_schedstat_ns();
+    usleep(100000);
+    assert(cpu_monitor_collect(getpid(), &curr) == 0);
+    uint64_t leader_delta = leader_schedstat_ns() - leader_before;
+
+    /* The spinning thread ran while the leader slept */
+    uint64_t delta = curr.cpu_time_ns - prev.cpu_time_ns;
+    assert(curr.cpu_time_ns > prev.cpu_time_ns);
+    assert(delta > leader_delta);
+    assert(delta > 10000000ULL);
+
+    stop = 1;
+    pthread_join(thread, NULL);
+
+    /* The exited thread's runtime stays in the total */
+    assert(cpu_monitor_collect(getpid(), &after) == 0);
+    assert(after.cpu_time_ns >= curr.cpu_time_ns);
+
+    proc_snapshot_set_cpu_clock(PROCFS_CPU_CLOCK_TICKS);
+    printf("PASSED (%.1f ms over threads)\n", delta / 1e6);
+}
+
+void test_snapshot_batch(void) {
+    printf("Test: batched snapshots match single reads... ");
+
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+    pid_t gone = fork();
+    assert(gone >= 0);
+    if (gone == 0) {
+        _exit(0);
+    }
+    waitpid(gone, NULL, 0);
+
+    if (proc_snapshot_set_io_mode(PROCFS_IO_URING) != 0) {
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+        printf("SKIPPED (io_uring unavailable)\n");
+        return;
+    }
+
+    unsigned int files = PROCFS_SNAP_STAT | PROCFS_SNAP_STATUS | PROCFS_SNAP_IO;
+    pid_t pids[3] = { child, getpid(), gone };
+    proc_snapshot_t snaps[3];
+    int errors[3];
+    assert(proc_snapshot_take_batch(pids, 3, files, snaps, errors) == 2);
+    assert(errors[0] == 0 && errors[1] == 0);
+    assert(errors[2] != 0);
+
+    proc_snapshot_t single;
+    assert(proc_snapshot_take(child, files, &single) == 0);
+    assert(strcmp(snaps[0].comm, single.comm) == 0);
+    assert(snaps[0].starttime == single.starttime);
+    assert(snaps[0].vm_size == single.vm_size);
+    assert(snaps[0].files == single.files);
+    assert(snaps[1].pid == getpid() && (snaps[1].files & PROCFS_SNAP_STATUS));
+
+    proc_snapshot_set_io_mode(PROCFS_IO_PREAD);
+    procfs_uring_cleanup();
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    printf("PASSED\n");
+}
+
+void test_pidwatch_reports_exit(void) {
+    printf("Test: pidfd watch reports a child's exit... ");
+
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+
+    assert(pidwatch_init() == 0);
+    if (pidwatch_add(child) != 0) {
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+        pidwatch_cleanup();
+        printf("SKIPPED (pidfd_open unavailable: %s)\n", strerror(errno));
+        return;
+    }
+    assert(pidwatch_count() == 1);
+    assert(pidwatch_is_alive(child) == 1);
+
+    pidwatch_event_t events[PIDWATCH_MAX_EVENTS];
+    assert(pidwatch_wait(0, events, PIDWATCH_MAX_EVENTS) == 0);
+
+    struct timespec before;
+    clock_gettime(CLOCK_MONOTONIC, &before);
+    kill(child, SIGKILL);
+
+    /* The pidfd fires on exit, before the parent reaps the zombie */
+    assert(pidwatch_wait(5000, events, PIDWATCH_MAX_EVENTS) == 1);
+    assert(events[0].pid == child);
+    assert(events[0].exit_time.tv_sec > before.tv_sec ||
+           (events[0].exit_time.tv_sec == before.tv_sec &&
+            events[0].exit_time.tv_nsec >= before.tv_nsec));
+    assert(pidwatch_count() == 0);
+    assert(pidwatch_is_alive(child) == -1);
+
+    waitpid(child, NULL, 0);
+    pidwatch_cleanup();
+    printf("PASSED\n");
+}
+
+void test_pidwatch_rejects_reaped(void) {
+    printf("Test: pidfd watch refuses an already-reaped PID... ");
+
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        _exit(0);
+    }
+    waitpid(child, NULL, 0);
+
+    assert(pidwatch_init() == 0);
+    errno = 0;
+    assert(pidwatch_add(child) != 0);
+    assert(errno == ESRCH || errno == ENOSYS || errno == ENOENT);
+    assert(pidwatch_count() == 0);
+
+    pidwatch_cleanup();
+    printf("PASSED\n");
+}
+
+/* Append one proc connector message carrying ev to buffer */
+static size_t put_proc_event(char *buffer, size_t offset, const struct proc_event *ev) {
+    size_t payload = sizeof(struct cn_msg) + sizeof(struct proc_event);
+    struct nlmsghdr *nlh = (struct nlmsghdr *)(buffer + offset);
+    memset(nlh, 0, NLMSG_SPACE(payload));
+    nlh->nlmsg_len = NLMSG_LENGTH(payload);
+    nlh->nlmsg_type = NLMSG_DONE;
+
+    struct cn_msg *msg = NLMSG_DATA(nlh);
+    msg->id.idx = CN_IDX_PROC;
+    msg->id.val = CN_VAL_PROC;
+    msg->len = sizeof(struct proc_event);
+    memcpy(msg->data, ev, sizeof(*ev));
+    return offset + NLMSG_SPACE(payload);
+}
+
+void test_proc_events_parse(void) {
+    printf("Test: Proc connector messages decode to fork/exec/exit... ");
+
+    char buffer[2048] __attribute__((aligned(NLMSG_ALIGNTO)));
+    size_t len = 0;
+    struct proc_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.what = PROC_EVENT_FORK;
+    ev.event_data.fork.parent_pid = 100;
+    ev.event_data.fork.parent_tgid = 100;
+    ev.event_data.fork.child_pid = 200;
+    ev.event_data.fork.child_tgid = 200;
+    len = put_proc_event(buffer, len, &ev);
+
+    /* A new thread of 200: not a new process */
+    ev.event_data.fork.parent_pid = 200;
+    ev.event_data.fork.parent_tgid = 200;
+    ev.event_data.fork.child_pid = 201;
+    ev.event_data.fork.child_tgid = 200;
+    len = put_proc_event(buffer, len, &ev);
+
+    memset(&ev, 0, sizeof(ev));
+    ev.what = PROC_EVENT_EXEC;
+    ev.event_data.exec.process_pid = 200;
+    ev.event_data.exec.process_tgid = 200;
+    len = put_proc_event(buffer, len, &ev);
+
+    /* Thread 201 exiting is filtered, the leader's exit is reported */
+    memset(&ev, 0, sizeof(ev));
+    ev.what = PROC_EVENT_EXIT;
+    ev.event_data.exit.process_pid = 201;
+    ev.event_data.exit.process_tgid = 200;
+    len = put_proc_event(buffer, len, &ev);
+    ev.event_data.exit.process_pid = 200;
+    ev.event_data.exit.parent_pid = 100;
+    ev.event_data.exit.parent_tgid = 100;
+    ev.event_data.exit.exit_code = 9;
+    len = put_proc_event(buffer, len, &ev);
+
+    /* Events we do not report */
+    memset(&ev, 0, sizeof(ev));
+    ev.what = PROC_EVENT_UID;
+    len = put_proc_event(buffer, len, &ev);
+
+    struct timespec now = { 42, 7 };
+    proc_event_t events[8];
+    assert(proc_events_parse(buffer, len, &now, events, 8) == 3);
+    assert(events[0].type == PROC_EVENT_TYPE_FORK);
+    assert(events[0].pid == 200 && events[0].parent == 100);
+    assert(events[0].timestamp.tv_sec == 42 && events[0].timestamp.tv_nsec == 7);
+    assert(events[1].type == PROC_EVENT_TYPE_EXEC && events[1].pid == 200);
+    assert(events[2].type == PROC_EVENT_TYPE_EXIT);
+    assert(events[2].pid == 200 && events[2].parent == 100);
+    assert(events[2].exit_code == 9);
+
+    /* The output limit is honoured and truncated datagrams stop the walk */
+    assert(proc_events_parse(buffer, len, &now, events, 1) == 1);
+    assert(proc_events_parse(buffer, NLMSG_HDRLEN, &now, events, 8) == 0);
+    printf("PASSED\n");
+}
+
+void test_proc_events_child(void) {
+    printf("Test: Proc connector reports a child's fork, exec and exit... ");
+
+    if (proc_events_init() != 0) {
+        printf("SKIPPED (requires CAP_NET_ADMIN: %s)\n", strerror(errno));
+        return;
+    }
+
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        execl("/bin/true", "true", (char *)NULL);
+        _exit(127);
+    }
+
+    int forked = 0, execed = 0, exited = 0;
+    struct pollfd pfd = { .fd = proc_events_get_fd(), .events = POLLIN };
+    for (int round = 0; round < 100 && !exited; round++) {
+        if (poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        proc_event_t events[PROC_EVENTS_MAX_BATCH];
+        int n = proc_events_read(events, PROC_EVENTS_MAX_BATCH);
+        assert(n >= 0);
+        for (int i = 0; i < n; i++) {
+            if (events[i].pid != child) {
+                continue;
+            }
+            if (events[i].type == PROC_EVENT_TYPE_FORK) {
+                assert(events[i].parent == getpid());
+                forked = 1;
+            } else if (events[i].type == PROC_EVENT_TYPE_EXEC) {
+                execed = 1;
+            } else if (events[i].type == PROC_EVENT_TYPE_EXIT) {
+                assert(events[i].exit_code == 0);
+                exited = 1;
+            }
+        }
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+    proc_events_cleanup();
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(forked && execed && exited);
+    printf("PASSED\n");
+}
+
+static double seconds_between(const struct timespec *a, const struct timespec *b) {
+    return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+void test_proc_tree_fold(void) {
+    printf("Test: Process tree joins descendants and folds an exit once... ");
+
+    /* root forks a grandchild and reports its PID before we look */
+    int fds[2];
+    assert(pipe(fds) == 0);
+    pid_t root = fork();
+    assert(root >= 0);
+    if (root == 0) {
+        pid_t grandchild = fork();
+        if (grandchild == 0) {
+            pause();
+            _exit(0);
+        }
+        (void)!write(fds[1], &grandchild, sizeof(grandchild));
+        pause();
+        _exit(0);
+    }
+    pid_t grandchild;
+    assert(read(fds[0], &grandchild, sizeof(grandchild)) == sizeof(grandchild));
+    close(fds[0]);
+    close(fds[1]);
+
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+
+    assert(proc_tree_init() == 0);
+    assert(proc_tree_add_root(root) == 0);
+    assert(proc_tree_root_count() == 1);
+    assert(proc_tree_member_count() == 2);
+
+    /* Synthetic connector events: child is adopted as root's new fork */
+    proc_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = PROC_EVENT_TYPE_FORK;
+    event.pid = child;
+    event.parent = root;
+    assert(proc_tree_handle_event(&event) == 1);
+    assert(proc_tree_handle_event(&event) == 0);
+    assert(proc_tree_member_count() == 3);
+
+    proc_tree_metrics_t tree;
+    struct timespec t0, t1, t2, t3;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    assert(proc_tree_sample(&tree, 1) == 1);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    assert(tree.root == root);
+    assert(tree.processes == 3);
+    assert(tree.forks == 1 && tree.exits == 0);
+
+    /* Exit while still unreaped, as the connector reports it */
+    kill(child, SIGKILL);
+    siginfo_t info;
+    assert(waitid(P_PID, child, &info, WEXITED | WNOWAIT) == 0);
+    event.type = PROC_EVENT_TYPE_EXIT;
+    assert(proc_tree_handle_event(&event) == 1);
+    assert(proc_tree_handle_event(&event) == 0);
+    assert(proc_tree_member_count() == 2);
+
+    /* The final record refines the exit; a duplicate adds nothing */
+    task_accounting_t record;
+    memset(&record, 0, sizeof(record));
+    record.pid = child;
+    record.tgid = child;
+    record.utime_us = 3000000;
+    record.stime_us = 1000000;
+    record.cpu_time_ns = 4000000000ULL;
+    assert(proc_tree_handle_exit_record(&record) == 1);
+    assert(proc_tree_handle_exit_record(&record) == 1);
+
+    /* Records of one thread of another process are ignored */
+    record.pid = child + 1;
+    assert(proc_tree_handle_exit_record(&record) == 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    assert(proc_tree_sample(&tree, 1) == 1);
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+    assert(tree.processes == 2);
+    assert(tree.exits == 1 && tree.finals == 1);
+
+    /* 4 s of CPU over the interval, whichever clock the member used;
+     * folding twice would give 8 s */
+    double low = tree.cpu_percent / 100.0 * seconds_between(&t1, &t2);
+    double high = tree.cpu_percent / 100.0 * seconds_between(&t0, &t3);
+    assert(high >= 3.99 && low <= 4.1);
+
+    /* The exited member is gone: nothing is folded again */
+    assert(proc_tree_sample(&tree, 1) == 1);
+    assert(tree.exits == 0 && tree.finals == 0);
+    assert(tree.cpu_percent < 50.0);
+
+    proc_tree_cleanup();
+    waitpid(child, NULL, 0);
+    kill(grandchild, SIGKILL);
+    kill(root, SIGKILL);
+    waitpid(root, NULL, 0);
+    printf("PASSED\n");
+}
+
+void test_proc_tree_follows_child(void) {
+    printf("Test: Process tree follows a real child through the connector... ");
+
+    if (proc_events_init() != 0) {
+        printf("SKIPPED (requires CAP_NET_ADMIN: %s)\n", strerror(errno));
+        return;
+    }
+    assert(proc_tree_init() == 0);
+    assert(proc_tree_add_root(getpid()) == 0);
+    int before = proc_tree_member_count();
+
+    proc_tree_metrics_t tree;
+    assert(proc_tree_sample(&tree, 1) == 1);
+
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        volatile unsigned long sum = 0;
+        for (unsigned long i = 0; i < 20000000; i++) {
+            sum += i;
+        }
+        _exit(0);
+    }
+
+    /* Feed the events to the tree; the zombie stays readable until reaped */
+    int joined = 0, exited = 0;
+    struct pollfd pfd = { .fd = proc_events_get_fd(), .events = POLLIN };
+    for (int round = 0; round < 200 && !exited; round++) {
+        if (poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        proc_event_t events[PROC_EVENTS_MAX_BATCH];
+        int n = proc_events_read(events, PROC_EVENTS_MAX_BATCH);
+        assert(n >= 0);
+        for (int i = 0; i < n; i++) {
+            int changed = proc_tree_handle_event(&events[i]);
+            if (events[i].pid == child && events[i].type == PROC_EVENT_TYPE_FORK) {
+                assert(changed == 1);
+                assert(proc_tree_member_count() == before + 1);
+                joined = 1;
+            } else if (events[i].pid == child && events[i].type == PROC_EVENT_TYPE_EXIT) {
+                assert(changed == 1);
+                exited = 1;
+            }
+        }
+    }
+    assert(joined && exited);
+
+    assert(proc_tree_sample(&tree, 1) == 1);
+    assert(tree.forks == 1);
+    assert(tree.exits == 1 && tree.finals == 1);
+    assert(tree.cpu_percent > 0.0);
+
+    assert(proc_tree_sample(&tree, 1) == 1);
+    assert(tree.exits == 0 && tree.finals == 0);
+    assert(proc_tree_member_count() == before);
+
+    waitpid(child, NULL, 0);
+    proc_tree_cleanup();
+    proc_events_cleanup();
+    printf("PASSED\n");
+}
+
+#define SCAN_TEST_CHILDREN 8
+
+static int count_scan_entries(const proc_scan_result_t *result, pid_t pid) {
+    int found = 0;
+    for (int i = 0; i < result->count; i++) {
+        found += (result->entries[i].pid == pid);
+    }
+    return found;
+}
+
+void test_proc_scanner_children(void) {
+    printf("Test: Parallel /proc scan finds every child exactly once... ");
+
+    pid_t children[SCAN_TEST_CHILDREN];
+    for (int i = 0; i < SCAN_TEST_CHILDREN; i++) {
+        children[i] = fork();
+        assert(children[i] >= 0);
+        if (children[i] == 0) {
+            pause();
+            _exit(0);
+        }
+    }
+
+    assert(proc_scanner_init(2) == 0);
+    assert(proc_scanner_thread_count() == 2);
+
+    proc_scan_result_t prev, curr;
+    memset(&prev, 0, sizeof(prev));
+    memset(&curr, 0, sizeof(curr));
+    assert(proc_scanner_scan(PROC_SCAN_ALL, &prev) > SCAN_TEST_CHILDREN);
+
+    volatile unsigned long sum = 0;
+    for (unsigned long i = 0; i < 2000000; i++) {
+        sum += i;
+    }
+    assert(proc_scanner_scan(PROC_SCAN_ALL, &curr) > SCAN_TEST_CHILDREN);
+    assert(curr.skipped == 0);
+    assert(curr.count <= curr.listed);
+
+    for (int i = 0; i < SCAN_TEST_CHILDREN; i++) {
+        assert(count_scan_entries(&curr, children[i]) == 1);
+    }
+    assert(count_scan_entries(&curr, getpid()) == 1);
+    for (int i = 1; i < curr.count; i++) {
+        assert(curr.entries[i - 1].pid < curr.entries[i].pid);
+    }
+
+    proc_scanner_calculate_rates(&prev, &curr);
+    for (int i = 0; i < curr.count; i++) {
+        assert(curr.entries[i].cpu.cpu_percent >= 0.0);
+        assert(curr.entries[i].io.read_rate >= 0.0);
+        assert(curr.entries[i].io.write_rate >= 0.0);
+    }
+
+    proc_scan_result_free(&prev);
+    proc_scan_result_free(&curr);
+    proc_scanner_cleanup();
+    for (int i = 0; i < SCAN_TEST_CHILDREN; i++) {
+        kill(children[i], SIGKILL);
+        waitpid(children[i], NULL, 0);
+    }
+    printf("PASSED\n");
+}
+
+void test_procfs_descriptor_limit(void) {
+    printf("Test: Handle cache evicts instead of failing at RLIMIT_NOFILE... ");
+
+    pid_t children[SCAN_TEST_CHILDREN];
+    for (int i = 0; i < SCAN_TEST_CHILDREN; i++) {
+        children[i] = fork();
+        assert(children[i] >= 0);
+        if (children[i] == 0) {
+            pause();
+            _exit(0);
+        }
+    }
+
+    /* In a helper process: the limit cannot be raised back afterwards */
+    pid_t helper = fork();
+    assert(helper >= 0);
+    if (helper == 0) {
+        procfs_cleanup();
+        int lowest = open("/dev/null", O_RDONLY);
+        close(lowest);
+        struct rlimit rl = { (rlim_t)lowest + 8, (rlim_t)lowest + 8 };
+        if (setrlimit(RLIMIT_NOFILE, &rl) != 0) {
+            _exit(2);
+        }
+        procfs_init();
+
+        /* Three files per PID: the cache cannot hold them all */
+        char buffer[PROCFS_BUFFER_SIZE];
+        for (int round = 0; round < 2; round++) {
+            for (int i = 0; i < SCAN_TEST_CHILDREN; i++) {
+                if (procfs_read(children[i], PROCFS_STAT, buffer, sizeof(buffer)) < 0 ||
+                    procfs_read(children[i], PROCFS_STATUS, buffer, sizeof(buffer)) < 0 ||
+                    procfs_read(children[i], PROCFS_SCHEDSTAT, buffer, sizeof(buffer)) < 0) {
+                    _exit(1);
+                }
+            }
+        }
+        _exit(procfs_cached_count() < SCAN_TEST_CHILDREN ? 0 : 3);
+    }
+
+    int status;
+    assert(waitpid(helper, &status, 0) == helper);
+    for (int i = 0; i < SCAN_TEST_CHILDREN; i++) {
+        kill(children[i], SIGKILL);
+        waitpid(children[i], NULL, 0);
+    }
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    printf("PASSED\n");
+}
+
+/* Wait for the pending tick the way the monitor loops do */
+static int wait_tick(sample_scheduler_t *sched) {
+    int rc = event_loop_run_until(&sched->deadline);
+    if (rc == 0) {
+        scheduler_tick(sched);
+    }
+    return rc;
+}
+
+void test_scheduler_deadlines(void) {
+    printf("Test: Sampling deadlines stay on the interval grid... ");
+
+    volatile int running = 1;
+    assert(event_loop_init(&running) == 0);
+    sample_scheduler_t sched;
+    assert(scheduler_init(&sched, 0.0001) != 0);
+    assert(scheduler_init(&sched, 0.01) == 0);
+    assert(sched.interval_ns == 10000000);
+
+    assert(scheduler_next(&sched) == 0);
+    assert(wait_tick(&sched) == 0);
+    assert(sched.jitter_ns >= 0);
+
+    /* Overrun past the next two deadlines: they are skipped, not queued */
+    struct timespec pause = { 0, 25000000 };
+    nanosleep(&pause, NULL);
+    assert(scheduler_next(&sched) == 2);
+    assert(sched.missed == 2);
+    assert(wait_tick(&sched) == 0);
+
+    int64_t offset = (sched.deadline.tv_sec - sched.start.tv_sec) * 1000000000LL +
+                     (sched.deadline.tv_nsec - sched.start.tv_nsec);
+    assert(offset == 40000000);
+    assert(sched.ticks == 2);
+    assert(scheduler_elapsed(&sched) > 0.039 && scheduler_elapsed(&sched) < 0.041);
+    event_loop_cleanup();
+    printf("PASSED\n");
+}
+
+static void wake_on_read(int fd, uint32_t events, void *arg) {
+    (void)events;
+    char c;
+    (void)!read(fd, &c, 1);
+    if (arg) {
+        event_loop_stop();
+    } else {
+        event_loop_wake();
+    }
+}
+
+typedef struct {
+    int order[4];
+    int count;
+} fanout_t;
+
+static void record_first(const monitor_sample_t *sample, void *arg) {
+    fanout_t *fanout = arg;
+    assert(sample->pid == 42);
+    fanout->order[fanout->count++] = 1;
+}
+
+static void record_second(const monitor_sample_t *sample, void *arg) {
+    fanout_t *fanout = arg;
+    assert(sample->tick == 7);
+    fanout->order[fanout->count++] = 2;
+}
+
+static int64_t ns_until(const struct timespec *deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (deadline->tv_sec - now.tv_sec) * 1000000000LL + (deadline->tv_nsec - now.tv_nsec);
+}
+
+void test_event_loop(void) {
+    printf("Test: Event loop deadlines, wake-ups, stops and fan-out... ");
+
+    volatile int running = 1;
+    assert(event_loop_init(&running) == 0);
+
+    /* Timer: returns 0 no earlier than the deadline */
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += 20000000;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    assert(event_loop_run_until(&deadline) == 0);
+    assert(ns_until(&deadline) <= 0);
+
+    /* A handler waking the loop returns 1 long before the deadline */
+    int fds[2];
+    assert(pipe(fds) == 0);
+    assert(event_loop_add_fd(fds[0], 0, wake_on_read, NULL) == 0);
+    deadline.tv_sec += 10;
+    assert(write(fds[1], "x", 1) == 1);
+    assert(event_loop_run_until(&deadline) == 1);
+    assert(ns_until(&deadline) > 9000000000LL);
+
+    /* event_loop_stop() from a handler returns -1 and clears running */
+    assert(event_loop_remove_fd(fds[0]) == 0);
+    assert(event_loop_remove_fd(fds[0]) != 0);
+    assert(event_loop_add_fd(fds[0], 0, wake_on_read, (void *)&running) == 0);
+    assert(write(fds[1], "x", 1) == 1);
+    assert(event_loop_run_until(&deadline) == -1);
+    assert(running == 0);
+    event_loop_cleanup();
+    close(fds[0]);
+    close(fds[1]);
+
+    /* SIGTERM arrives through the signalfd and stops the loop the same way */
+    running = 1;
+    assert(event_loop_init(&running) == 0);
+    assert(raise(SIGTERM) == 0);
+    assert(event_loop_run_until(&deadline) == -1);
+    assert(running == 0);
+
+    /* Every subscriber sees each sample, in registration order */
+    fanout_t fanout;
+    memset(&fanout, 0, sizeof(fanout));
+    assert(event_loop_subscribe(record_first, &fanout) == 0);
+    assert(event_loop_subscribe(record_second, &fanout) == 0);
+    assert(event_loop_subscribe(NULL, NULL) != 0);
+
+    monitor_sample_t sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.pid = 42;
+    sample.tick = 7;
+    event_loop_publish(&sample);
+    event_loop_publish(&sample);
+    assert(fanout.count == 4);
+    assert(fanout.order[0] == 1 && fanout.order[1] == 2);
+    assert(fanout.order[2] == 1 && fanout.order[3] == 2);
+
+    /* Cleanup drops the subscribers */
+    event_loop_cleanup();
+    event_loop_publish(&sample);
+    assert(fanout.count == 4);
+    printf("PASSED\n");
+}
+
+void test_adaptive_interval(void) {
+    printf("Test: Adaptive interval relaxes when idle and drops on a spike... ");
+
+    adaptive_rate_t rate;
+    assert(adaptive_rate_init(&rate, 0.5, 0.1, 1.0) != 0);
+    assert(adaptive_rate_init(&rate, 0.1, 2.0, 5.0) == 0);
+    assert(rate.interval == 2.0);
+
+    /* Idle target: the interval stays at the ceiling */
+    for (int i = 0; i < 20; i++) {
+        assert(adaptive_rate_update(&rate, 0.0, 4096.0, 0.0) == 2.0);
+    }
+
+    /* A CPU burst goes straight to the floor */
+    assert(adaptive_rate_update(&rate, 80.0, 4096.0, 0.0) == 0.1);
+
+    /* Once quiet again it relaxes geometrically back to the ceiling */
+    double prev = 0.1;
+    for (int i = 0; i < 40; i++) {
+        double next = adaptive_rate_update(&rate, 80.0, 4096.0, 0.0);
+        assert(next >= prev);
+        prev = next;
+    }
+    assert(prev == 2.0);
+
+    /* Retuning keeps earlier deadlines and lays new ones from the last tick */
+    volatile int running = 1;
+    assert(event_loop_init(&running) == 0);
+    sample_scheduler_t sched;
+    assert(scheduler_init(&sched, 0.01) == 0);
+    scheduler_next(&sched);
+    assert(wait_tick(&sched) == 0);
+    assert(scheduler_set_interval(&sched, 0.0001) != 0);
+    assert(scheduler_set_interval(&sched, 0.02) == 0);
+    assert(scheduler_next(&sched) == 0);
+    assert(scheduler_elapsed(&sched) > 0.029 && scheduler_elapsed(&sched) < 0.031);
+    assert(sched.retunes == 1);
+    event_loop_cleanup();
+    printf("PASSED\n");
+}
+
+static int count_read(pid_t pid, void *arg) {
+    (void)pid;
+    (*(int *)arg)++;
+    return 0;
+}
+
+void test_collector_tiers(void) {
+    printf("Test: Tiered sources run on their cadences without sharing ticks... ");
+
+    collector_t collector;
+    int cheap = 0, medium = 0, expensive = 0;
+    assert(collector_init(&collector, 0.0) == 0);
+    assert(collector_register(&collector, "cheap", COST_CHEAP, 0, count_read, &cheap) == 0);
+    assert(collector_register(&collector, "medium", COST_MEDIUM, 0, count_read, &medium) == 1);
+    assert(collector_register(&collector, "expensive", COST_EXPENSIVE, 0, count_read,
+                              &expensive) == 2);
+    assert(collector_cadence(&collector, 1) == COLLECTOR_CADENCE_MEDIUM);
+    assert(collector_cadence(&collector, 2) == COLLECTOR_CADENCE_EXPENSIVE);
+
+    /* The first tick reads everything once */
+    assert(collector_is_due(&collector, 1, 0) && collector_is_due(&collector, 2, 0));
+    assert(collector_run(&collector, 0, getpid()) == 0);
+    assert(cheap == 1 && medium == 1 && expensive == 1);
+
+    for (uint64_t tick = 1; tick < 120; tick++) {
+        /* The phase spreading keeps the costly reads on different ticks */
+        assert(!(collector_is_due(&collector, 1, tick) && collector_is_due(&collector, 2, tick)));
+        assert(collector_run(&collector, tick, getpid()) == 0);
+    }
+    assert(cheap == 120);
+    assert(medium == 120 / COLLECTOR_CADENCE_MEDIUM + (collector.sources[1].phase != 0));
+    assert(expensive == 120 / COLLECTOR_CADENCE_EXPENSIVE + (collector.sources[2].phase != 0));
+    printf("PASSED\n");
+}
+
+static void *wait_on_pipe(void *arg) {
+    char c;
+    (void)!read(*(int *)arg, &c, 1);
+    return NULL;
+}
+
+void test_thread_monitor_tracks_threads(void) {
+    printf("Test: Per-thread table follows thread creation and exit... ");
+
+    thread_sample_t sample;
+    assert(thread_monitor_init() == 0);
+    assert(thread_monitor_collect(getpid(), &sample) == 0);
+    assert(sample.count == 1);
+    assert(sample.threads[0].tid == getpid());
+
+    int fds[2];
+    pthread_t thread;
+    assert(pipe(fds) == 0);
+    assert(pthread_create(&thread, NULL, wait_on_pipe, &fds[0]) == 0);
+
+    assert(thread_monitor_collect(getpid(), &sample) == 0);
+    assert(sample.count == 2);
+    assert(sample.created == 1);
+    assert(sample.threads[0].tid < sample.threads[1].tid);
+
+    assert(write(fds[1], "x", 1) == 1);
+    pthread_join(thread, NULL);
+    close(fds[0]);
+    close(fds[1]);
+
+    assert(thread_monitor_collect(getpid(), &sample) == 0);
+    assert(sample.count == 1);
+    assert(sample.exited == 1);
+
+    thread_metrics_t top[4];
+    assert(thread_monitor_top(&sample, top, 4) == 1);
+
+    thread_monitor_cleanup();
+    printf("PASSED\n");
+}
+
+void test_thread_monitor_keeps_unreadable(void) {
+    printf("Test: Per-thread table keeps threads it cannot open yet... ");
+
+    thread_sample_t sample;
+    assert(thread_monitor_init() == 0);
+    assert(thread_monitor_collect(getpid(), &sample) == 0);
+
+    int fds[2];
+    pthread_t thread;
+    assert(pipe(fds) == 0);
+    assert(pthread_create(&thread, NULL, wait_on_pipe, &fds[0]) == 0);
+
+    /* No descriptor left for the new thread's files: EMFILE, not an exit */
+    struct rlimit saved, low;
+    assert(getrlimit(RLIMIT_NOFILE, &saved) == 0);
+    int lowest = open("/dev/null", O_RDONLY);
+    close(lowest);
+    low = saved;
+    low.rlim_cur = (rlim_t)lowest;
+    assert(setrlimit(RLIMIT_NOFILE, &low) == 0);
+    int rc = thread_monitor_collect(getpid(), &sample);
+    assert(setrlimit(RLIMIT_NOFILE, &saved) == 0);
+    assert(rc == 0);
+    assert(sample.count == 2);
+    assert(sample.created == 1);
+    assert(sample.exited == 0);
+
+    /* The retry opens it without counting it again */
+    assert(thread_monitor_collect(getpid(), &sample) == 0);
+    assert(sample.count == 2);
+    assert(sample.created == 0);
+    assert(sample.exited == 0);
+
+    assert(write(fds[1], "x", 1) == 1);
+    pthread_join(thread, NULL);
+    close(fds[0]);
+    close(fds[1]);
+    thread_monitor_cleanup();
+    printf("PASSED\n");
+}
+
 void test_cpu_percentage_calculation(void) {
     printf("Test: CPU percentage calculation... ");
 
@@ -90,6 +1088,26 @@ int main(void) {
     test_process_exists();
     test_get_clock_ticks();
     test_cpu_collect_self();
+    test_cpu_collect_exited();
+    test_stat_parse_tricky_comm();
+    test_cpu_collect_taskstats();
+    test_cpu_collect_schedstat();
+    test_cpu_schedstat_threads();
+    test_snapshot_batch();
+    test_pidwatch_reports_exit();
+    test_pidwatch_rejects_reaped();
+    test_proc_events_parse();
+    test_proc_events_child();
+    test_proc_tree_fold();
+    test_proc_tree_follows_child();
+    test_proc_scanner_children();
+    test_procfs_descriptor_limit();
+    test_scheduler_deadlines();
+    test_event_loop();
+    test_adaptive_interval();
+    test_collector_tiers();
+    test_thread_monitor_tracks_threads();
+    test_thread_monitor_keeps_unreadable();
     test_cpu_percentage_calculation();
     test_cpu_export_json();
     test_cpu_export_csv();
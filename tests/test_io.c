@@ -1,10 +1,16 @@
 #include "../include/monitor.h"
+#include "../include/veth_stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <assert.h>
 #include <fcntl.h>
 #include <string.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 void test_io_monitor_init(void) {
     printf("Test: I/O monitor initialization... ");
@@ -118,6 +124,150 @@ void test_io_export_csv(void) {
     printf("PASSED\n");
 }
 
+void test_network_netns_cache(void) {
+    printf("Test: network stats shared per namespace... ");
+
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+
+    assert(network_monitor_init() == 0);
+    network_monitor_set_max_age(60.0);
+
+    network_metrics_t self, other;
+    if (network_monitor_collect(getpid(), &self) != 0) {
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+        printf("SKIPPED (no /proc/[pid]/net access)\n");
+        return;
+    }
+    assert(network_monitor_collect(child, &other) == 0);
+
+    /* Same namespace: one cached entry, identical totals from one read */
+    assert(self.netns != 0 && self.netns == other.netns);
+    assert(network_monitor_cached_count() == 1);
+    assert(other.pid == child);
+    assert(self.rx_bytes == other.rx_bytes && self.tcp_connections == other.tcp_connections);
+    assert(self.timestamp.tv_sec == other.timestamp.tv_sec &&
+           self.timestamp.tv_nsec == other.timestamp.tv_nsec);
+
+    network_metrics_t rates;
+    other.timestamp.tv_sec += 1;
+    other.rx_bytes = self.rx_bytes + 1000;
+    other.tx_bytes = self.tx_bytes + 500;
+    assert(network_monitor_calculate_rates(&self, &other, &rates) == 0);
+    assert(rates.rx_rate > 999.0 && rates.rx_rate < 1001.0);
+    assert(rates.tx_rate > 499.0 && rates.tx_rate < 501.0);
+
+    /* Counters of another namespace are not comparable */
+    other.netns = self.netns + 1;
+    assert(network_monitor_calculate_rates(&self, &other, &rates) == 0);
+    assert(rates.rx_rate == 0.0);
+
+    network_monitor_cleanup();
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    printf("PASSED (%d interface(s), TCP %d)\n", self.interface_count, self.tcp_connections);
+}
+
+void test_sock_diag_counts(void) {
+    printf("Test: sock_diag socket states... ");
+
+    int diag = sock_diag_open(0);
+    if (diag < 0) {
+        printf("SKIPPED (NETLINK_SOCK_DIAG unavailable)\n");
+        return;
+    }
+
+    /* Listener with backlog 1 and three unaccepted clients: the accept
+     * queue fills and the listener is reported as full */
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(listener, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    assert(listen(listener, 1) == 0);
+    socklen_t addr_len = sizeof(addr);
+    assert(getsockname(listener, (struct sockaddr *)&addr, &addr_len) == 0);
+
+    int clients[3];
+    for (int i = 0; i < 3; i++) {
+        clients[i] = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        connect(clients[i], (struct sockaddr *)&addr, sizeof(addr));
+    }
+    usleep(100000);
+
+    sock_counts_t counts;
+    assert(sock_diag_count(diag, &counts) == 0);
+    assert(counts.tcp_states[SOCK_TCP_LISTEN] >= 1);
+    assert(counts.tcp_states[SOCK_TCP_ESTABLISHED] >= 2);
+    assert(counts.listen_full >= 1);
+
+    uint32_t inode = 0;
+    for (int i = 0; i < counts.full_count; i++) {
+        if (counts.full[i].port == ntohs(addr.sin_port)) {
+            inode = counts.full[i].inode;
+            assert(sock_diag_find_owner(inode, 0) == getpid());
+            assert(sock_diag_find_owner(inode, 0) == getpid());
+        }
+    }
+    assert(inode != 0);
+
+    /* Once the remembered owner lets go, the next lookup searches again */
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+    close(listener);
+    assert(sock_diag_find_owner(inode, 0) == child);
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+
+    for (int i = 0; i < 3; i++) {
+        close(clients[i]);
+    }
+    close(diag);
+    printf("PASSED (%d established, %d full listener(s))\n",
+           counts.tcp_states[SOCK_TCP_ESTABLISHED], counts.listen_full);
+}
+
+void test_veth_link_dump(void) {
+    printf("Test: RTM_GETLINK interface dump... ");
+
+    if (veth_stats_init() != 0) {
+        printf("SKIPPED (NETLINK_ROUTE unavailable)\n");
+        return;
+    }
+
+    int count = veth_stats_refresh();
+    assert(count >= 1);
+    const veth_link_t *links;
+    assert(veth_stats_links(&links) == count);
+
+    int has_lo = 0;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(links[i].name, "lo") == 0) {
+            has_lo = 1;
+            assert(links[i].link_nsid == VETH_NSID_NONE);
+        }
+    }
+    assert(has_lo);
+
+    /* The monitor's own namespace is nobody's veth peer */
+    veth_totals_t totals;
+    assert(veth_stats_nsid(getpid()) >= VETH_NSID_NONE);
+    assert(veth_stats_totals(VETH_NSID_NONE, &totals) != 0);
+
+    veth_stats_cleanup();
+    printf("PASSED (%d interfaces)\n", count);
+}
+
 int main(void) {
     printf("\n=== I/O Monitor Test Suite ===\n");
     printf("NOTE: Some tests require root permissions\n\n");
@@ -128,6 +278,9 @@ int main(void) {
     test_io_rate_calculation();
     test_io_export_json();
     test_io_export_csv();
+    test_network_netns_cache();
+    test_sock_diag_counts();
+    test_veth_link_dump();
 
     io_monitor_cleanup();
 
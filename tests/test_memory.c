@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <assert.h>
+#include <string.h>
 
 void test_memory_monitor_init(void) {
     printf("Test: Memory monitor initialization... ");
@@ -75,6 +76,32 @@ void test_memory_export_csv(void) {
     printf("PASSED\n");
 }
 
+void test_status_parse(void) {
+    printf("Test: Table-driven status parsing... ");
+
+    const char *status = "Name:\tworker\n"
+                         "VmSize:\t   20480 kB\n"
+                         "VmRSS:\t    5120 kB\n"
+                         "RssShmem:\t      64 kB\n"
+                         "VmData:\t    2048 kB\n"
+                         "VmStk:\t     132 kB\n"
+                         "VmExe:\t       8 kB\n"
+                         "VmSwap:\t      16 kB\n"
+                         "voluntary_ctxt_switches:\t42\n"
+                         "nonvoluntary_ctxt_switches:\t7\n";
+    proc_snapshot_t snap;
+    memset(&snap, 0, sizeof(snap));
+    assert(proc_snapshot_parse_status(status, &snap) == 0);
+    assert(snap.vm_size == 20480);
+    assert(snap.vm_rss == 5120);
+    assert(snap.rss_shmem == 64);
+    assert(snap.vm_stk == 132);
+    assert(snap.vm_swap == 16);
+    assert(snap.voluntary_ctxt_switches == 42);
+    assert(snap.nonvoluntary_ctxt_switches == 7);
+    printf("PASSED\n");
+}
+
 void test_memory_print(void) {
     printf("Test: Memory metrics printing... ");
 
@@ -93,6 +120,7 @@ int main(void) {
     test_memory_allocation_detection();
     test_memory_export_json();
     test_memory_export_csv();
+    test_status_parse();
     test_memory_print();
 
     memory_monitor_cleanup();